@@ -90,13 +90,16 @@
 //                                      NVS
 // ---------------------------------------------------------------------------------
 
-// Конфигурация хранилища определяет количество и размер файлов в разделе (до 4096)
-#define SP_STORAGE_FILE_COUNT 42                          // Максимальное количество файлов
-#define SP_STORAGE_FILE_SIZE 96                           // Размер файла, включая байт длины (48 регистров)
+// Конфигурация хранилища: файлы хранятся журналом записей переменной длины (rec_log),
+// число файлов в разделе ограничено его размером в partitions.csv, а не произведением
+#define SP_STORAGE_FILE_COUNT 240                         // Индексов файлов (0x00 ... 0xEF)
+#define SP_STORAGE_FILE_SIZE 192                          // Наибольший размер файла, включая байт длины (96 регистров)
+#define SP_STORAGE_LOCK_MS 500                            // Ожидание прохода storage_handler_task (0x14/0x15)
 
 // номера 32-х регистров управления         0x00 ... 0x1F
 // номера 96-и регистров для чтения пакета  0x20 ... 0x7F 
 // номера 96-и регистров для записи пакета  0x80 ... 0xDF 
+// номера 32-х регистров диагностики        0xE0 ... 0xFF (только чтение)
 
 #define HLD_REGS_OFFSET        0                              // Смещение для holding-регистров
 #define MAX_CONTROL_REGS      32                              // Число регистров управления (32)
@@ -106,19 +109,23 @@
 #define HLD_READ_REG          MAX_CONTROL_REGS                // Первый регистр для чтения (0X20)
 #define HLD_READ_RESP_REG     MAX_CONTROL_REGS                // Первый регистр для чтения ответа  (0X20)
 
-#define MAX_READ_REGS         SP_STORAGE_FILE_SIZE            // Число регистров для ответа (96)
-#define MAX_OUT_BUF_REGS      SP_STORAGE_FILE_SIZE            // Максимальное количество регистров (96 слов)
+#define MAX_READ_REGS         96                              // Число регистров для ответа (96)
+#define MAX_OUT_BUF_REGS      MAX_READ_REGS                   // Максимальное количество регистров (96 слов)
                                                               // для ответа
 
 
 #define HLD_WRITE_REG         HLD_READ_REG + MAX_READ_REGS    // Первый регистр запроса (0x80)
 #define HLD_WRITE_RESP_REG    HLD_READ_REG + MAX_READ_REGS    // Первый регистр для записи ответа ?? уочнить
 
-#define MAX_WRITE_REGS        SP_STORAGE_FILE_SIZE            // Число регистров для запроса (96)
+#define MAX_WRITE_REGS        96                              // Число регистров для запроса (96)
 
 #define MAX_REGS              MAX_CONTROL_REGS + MAX_READ_REGS + MAX_WRITE_REGS  // Всего регистров (32+96+96=224)
                                                               // из них по команде 0x03 читаются (96+96=192)
 
+#define HLD_DIAG_REG          (MAX_REGS)                      // Первый регистр диагностики (0xE0)
+#define MAX_DIAG_REGS         32                              // Число регистров диагностики (32)
+#define TOTAL_REGS            (MAX_REGS + MAX_DIAG_REGS)      // Размер массива regs[] (224+32=256)
+
 #define MAX_DATA_SIZE         192            // Максимальный размер пакета (192 байта)
 
 // Константы
@@ -165,6 +172,21 @@ typedef struct
 #define REG_SP_ERROR          regs[0x0A]  // Регистр ошибок обмена с целевым прибором
 #define REG_SP_COMM           regs[0x0B]  // Регистр инициализации обмена с целевым прибором
 
+// Запрос параметра без шаблона: REG_SP_COMM = SP_COMM_DIRECT
+#define REG_SP_CHANNEL        regs[0x10]  // Номер канала
+#define REG_SP_PARAM          regs[0x11]  // Номер параметра
+#define REG_VAL_CACHE_TTL     regs[0x12]  // Допустимый возраст значения из кэша, мс (0 - кэш не используется)
+
+// Удержание ответа Modbus до завершения команды REG_SP_COMM (функция 0x17,
+// чтение окна результата при SP_FLAG_LONG_POLL)
+#define REG_MB_HOLD_MS        regs[0x13]  // Не дольше, мс (0 - ответ сразу)
+
+// Поколение результата: окно 0x20+ обновляется только вместе с этими регистрами
+// (reg_seq_write_result_end). Окно разбито на 16 блоков по RESULT_BLOCK_REGS регистров
+#define REG_RESULT_GEN        regs[0x14]  // Номер результата в окне 0x20+ (+1 на каждый, по модулю 65536)
+#define REG_RESULT_CHANGED    regs[0x15]  // Бит N - блок N (0x20 + N*6 ...) изменился относительно предыдущего результата
+#define RESULT_BLOCK_REGS     (MAX_READ_REGS / 16) // Регистров в блоке (6)
+
 // Регистры работы с разделом `response` - шаблоны ответов
 #define REG_SP_READ_RESP      regs[0x0C]  // Регистр инициализации чтения (modbus) из HLD_READ_RESP
 #define REG_SP_WRITE_RESP     regs[0x0D]  // Регистр инициализации записи (modbus) в HLD_WRITE_RESP
@@ -173,6 +195,26 @@ typedef struct
 #define REG_SP_READ_REQ       regs[0x0E]  // Регистр инициализации чтения (modbus) из HLD_READ_REQ
 #define REG_SP_WRITE_REQ      regs[0x0F]  // Регистр инициализации записи (modbus) в HLD_WRITE_REQ
 
+// Транзакция записи файлов: REG_SP_WRITE_REQ/RESP между BEGIN и COMMIT копятся в RAM
+// и записываются во flash пакетом - после сбоя видны все файлы раздела или ни одного
+#define REG_SP_TXN            regs[0x16]  // Команда / состояние транзакции
+#define SP_TXN_ABORT          0x0000      // Команда: отменить (файлы не записываются)
+#define SP_TXN_BEGIN          0x0001      // Команда: начать
+#define SP_TXN_COMMIT         0x0002      // Команда: записать накопленные файлы
+#define SP_TXN_OPEN           0x8000      // Состояние: открыта, младший байт - файлов накоплено
+#define SP_TXN_ERROR          0xFFFE      // Состояние: ошибка записи или переполнение, файлы отброшены
+#define SP_TXN_MAX_FILES      16          // Файлов в транзакции (request и response вместе)
+
+// Регистры планировщика опроса шаблонов (sp_sched)
+#define REG_SCHED_OPERATION   regs[0x1C]  // [15] 1 - чтение, 0 - запись; [7:0] номер шаблона; 0xFFFF - нет
+#define REG_SCHED_PERIOD      regs[0x1D]  // Период опроса шаблона, мс (0 - не опрашивается)
+#define REG_SCHED_PRIO        regs[0x1E]  // Приоритет опроса шаблона (0 - высший ... SP_SCHED_PRIO_LEVELS - 1)
+
+// Флаги режимов обмена
+#define REG_SP_FLAGS          regs[0x1F]
+#define SP_FLAG_LATENCY_PROBE 0x0001      // flagA() - запись REG_SP_COMM принята, flagB() - запрос SP отправлен
+#define SP_FLAG_LONG_POLL     0x0002      // Чтение окна результата во время обмена ждёт его завершения (REG_MB_HOLD_MS)
+
 // Регистры работы с разделом `config`
 #define REG_REPEAT            regs[0x17]  // Repeat request period in seconds (5+)
 #define REG_TARGET            regs[0x18]  // 
@@ -180,6 +222,21 @@ typedef struct
 #define REG_CONFIG_OPERATION  regs[0x1A]  // Операция: [15] R/W, [14:8] тип, [7:0] индекс
 #define REG_CONFIG_INDEX      regs[0x1B]  // Индекс конфигурации (STA = 0 1 2)
 
+// Регистры диагностики (только чтение командой 0x03, счётчики по модулю 65536)
+#define REG_DIAG_REQ_CACHE_HIT   regs[0xE0]  // Отправки запроса из кэша кадров
+#define REG_DIAG_REQ_CACHE_MISS  regs[0xE1]  // Сборки кадра запроса из шаблона во flash
+#define REG_DIAG_SP_POLLS        regs[0xE2]  // Запросы, отправленные планировщиком
+#define REG_DIAG_SP_TIMEOUTS     regs[0xE3]  // Запросы без ответа за SP_REPLY_TIMEOUT_MS
+#define REG_DIAG_SP_LAST_ID      regs[0xE4]  // Команда (file_raw), ответ на которую в окне 0x20
+#define REG_DIAG_SP_BATCH        regs[0xE5]  // Число шаблонов, объединённых в запрос с ответом в окне 0x20
+#define HLD_DIAG_SP_BATCH_IDS    0xE6        // Номера этих шаблонов по порядку блоков (SP_BATCH_MAX регистров)
+#define REG_DIAG_VAL_CACHE_HIT   regs[0xF0]  // Запросы без шаблона, обслуженные из кэша значений
+#define REG_DIAG_VAL_CACHE_MISS  regs[0xF1]  // Запросы без шаблона, выполненные по шине SP
+#define REG_DIAG_VAL_CACHE_RATIO regs[0xF2]  // Доля попаданий в кэш значений, %
+#define REG_DIAG_VAL_CACHE_AGE   regs[0xF3]  // Возраст последнего значения из кэша, мс (до 0xFFFF)
+#define REG_DIAG_MB_READ_HIT     regs[0xF4]  // Ответы 0x03, повторённые без сборки
+#define REG_DIAG_MB_READ_MISS    regs[0xF5]  // Ответы 0x03, собранные заново
+
 // Размер стека задачи в БАЙТАХ (8192)
 #define WIFI_MANAGER_TASK_STACK_SIZE_BYTES   8192
 
@@ -198,7 +255,24 @@ static const ParamMeta param_meta[PARAMS_COUNT] = {
 };
 
 #define MB_PORT_NUM UART_NUM_1
-#define MB_QUEUE_SIZE 2U // Нужен для инициализации UART
+#define MB_QUEUE_SIZE 20U // Глубина очереди событий драйвера UART1 (кадрирование по событиям)
+// #define MB_CRC_NIBBLE_TABLE    // CRC Modbus по таблице 16 слов (32 байта) вместо 256 слов (512 байт)
+#define MB_READ_MAX_REGS 125        // Регистров в чтении 0x03/0x17 (счётчик байт ответа - 1 байт)
+#define MB_RW_WRITE_MAX_REGS 121    // Регистров в записи 0x17
+#define MB_READ_CACHE_SLOTS 4       // Готовых ответов 0x03 (разные диапазоны опроса)
+#define MB_READ_CACHE_MAX_REGS 125  // Длиннее диапазон - ответ собирается каждый раз
+
+// Файлы Modbus (функции 0x14/0x15): номер файла - старший байт раздел, младший - индекс,
+// номер записи - регистр внутри файла (шаблон - до 96 регистров, байт длины - старший байт записи 0)
+#define MB_FILE_REQUEST 0x0100      // 0x0100 + индекс: шаблон запроса (раздел `request`)
+#define MB_FILE_RESPONSE 0x0200     // 0x0200 + индекс: шаблон ответа (раздел `response`)
+#define MB_FILE_UNITS 0x0300        // Таблица абонентов (раздел `config`): 4 регистра на запись
+#define MB_FILE_REF_TYPE 6          // Тип ссылки подзапроса (Modbus Application Protocol, 6.14)
+
+// Интервалы кадрирования Modbus RTU (Modbus over Serial Line V1.02, п. 2.5.1.1)
+#define MB_FIXED_TIMING_BAUD 19200 // Выше этой скорости T3.5 фиксирован
+#define MB_T35_FIXED_US 1750       // T3.5 для скоростей выше 19200 бод (мкс)
+#define MB_RX_TOUT_MAX 126         // Максимальный порог RX-таймаута UART ESP32 (символов)
 
 // ---------------------------------------------------------------------------------
 //                                    SP
@@ -207,7 +281,20 @@ static const ParamMeta param_meta[PARAMS_COUNT] = {
 #define SP_PORT_NUM UART_NUM_2
 
 #define SP_QUEUE_SIZE 2
+#define SP_RX_BUF_SIZE 1024                     // Кольцевой буфер приёма драйвера UART2
+#define SP_RX_FRAME_MAX_SIZE (UART_BUF_SIZE * 2) // Максимальный размер кадра ответа (со стаффингом)
+#define SP_REQ_FRAME_MAX_SIZE (2 * (4 + SP_STORAGE_FILE_SIZE - 1) + 2) // Кадр запроса: заголовок и шаблон со стаффингом + CRC
+#define SP_DIRECT_BODY_MAX_SIZE 24                       // Запрос параметра без шаблона: FNC STX HT кан HT пар FF ETX
+#define REQ_CACHE_SLOTS 24                              // Готовых кадров запроса в RAM (шаблонов - SP_STORAGE_FILE_COUNT)
+#define SP_VAL_CACHE_SIZE 32                            // Записей в кэше значений параметров
+#define SP_VAL_CACHE_VALUE_SIZE 24                      // Максимальная длина значения в кэше (символов)
+#define SP_BATCH_MAX 10                                 // Шаблонов в объединённом запросе CMD_READ_PARAMS
+#define SP_SCHED_PRIO_LEVELS 8                          // Уровней приоритета опроса шаблонов (больший номер - как последний)
+#define SP_UNIT_COUNT 4                                 // Дополнительных адресов Modbus (приборов на шине SP)
+#define SP_BATCH_PLAIN_MAX_SIZE (2 * SP_STORAGE_FILE_SIZE) // Объединённый запрос без стаффинга и CRC
+#define SP_BATCH_FRAME_MAX_SIZE (2 * SP_BATCH_PLAIN_MAX_SIZE + 2) // Объединённый запрос со стаффингом + CRC
 #define SP_FRAME_TIMEOUT_MS_DEFAULT 10   // По факту
+#define SP_REPLY_TIMEOUT_MS 1000         // Ожидание ответа на запрос, после него шина свободна
 
 // Константы протокола
 #define SOH 0x01        // Байт начала заголовка
@@ -235,7 +322,10 @@ typedef enum
 } parser_command_t;
 
 #define RAW_MODE_THRESHOLD 0xFF00        // Порог для режима RAW (отключить парсинг)
+#define SP_COMM_DIRECT     0xFE00        // REG_SP_COMM: чтение параметра REG_SP_CHANNEL/REG_SP_PARAM без шаблона
+#define SP_COMM_MODE_MASK  0xFF00        // Старший байт REG_SP_COMM - режим запроса
 #define MAX_BLOCKS            20         // Максимальное количество параметров ??? точнее блоков
+#define SP_MAX_TOKENS         64         // Размер таблицы разметки пакета (HT и FF по отдельности)
 #define MIN_PAYLOAD_SIZE 4               // Минимальный размер полезной нагрузки
 
 #define REG_REPEAT_MIN 5                 // Repeat request period min (seconds)
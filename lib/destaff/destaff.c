@@ -1,9 +1,16 @@
 /*
  *  Вариант со сдвигами в одном буфере
  *  Версия 8 июля 2025г.
+ *
+ *  Один проход по принятому пакету: CRC считается по исходным (стаффированным) байтам
+ *  до их перезаписи, DLE удаляются, позиции STX/ETX и разделителей HT/FF полезной
+ *  нагрузки записываются в таблицу разметки. Дополнительные буферы не выделяются.
+ *  Глобального состояния нет: результаты пишутся только в переданный контекст.
  */
 #include "destaff.h"
 #include "project_config.h"
+#include "sp_crc.h"
+#include "sp_swar.h"
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
@@ -14,13 +21,40 @@
 
 static const char *TAG = "DESTAFF";
 
-// Позиции STX и ETX (Глобальные переменные)
-int stx_position = -1;
-int etx_position = -1;
+// Запись позиции разделителя HT/FF полезной нагрузки в таблицу разметки
+static inline void mark_token(sp_tokens_t *tokens, uint8_t byte, size_t pos)
+{
+    if (byte == HT)
+    {
+        if (tokens->ht_count < SP_MAX_TOKENS)
+            tokens->ht[tokens->ht_count++] = (uint16_t)pos;
+        else
+            tokens->overflow = true;
+    }
+    else if (byte == FF)
+    {
+        if (tokens->ff_count < SP_MAX_TOKENS)
+            tokens->ff[tokens->ff_count++] = (uint16_t)pos;
+        else
+            tokens->overflow = true;
+    }
+}
 
-int deStaff(uint8_t *input, size_t len) // input одновременно и output
+int deStaff(sp_decoder_ctx_t *ctx, uint8_t *input, size_t len) // input одновременно и output
 {
     // Проверка валидности входных аргументов
+    if (ctx == NULL)
+        return 0;
+
+    // Результаты предыдущего пакета не должны переходить в новый
+    sp_tokens_t *tokens = &ctx->tokens;
+    ctx->stx_position = -1;
+    ctx->etx_position = -1;
+    ctx->crc = 0;
+    tokens->ht_count = 0;
+    tokens->ff_count = 0;
+    tokens->overflow = false;
+
     if (input == NULL || len == 0)
         return 0;
     if (len < BUF_MIN_SIZE || len > UART_BUF_SIZE * 2)
@@ -28,11 +62,45 @@ int deStaff(uint8_t *input, size_t len) // input одновременно и out
 
     size_t read_idx = 0;
     size_t write_idx = 0;
+    uint16_t crc = 0;
+    bool in_payload = false; // Между STX и ETX
 
     while (read_idx < len)
     {
+        // Слова без DLE - по 4 байта: CRC, сдвиг и разметка HT/FF по маске
+        if (read_idx >= 2)
+        {
+            while (read_idx + 4 <= len)
+            {
+                uint32_t v = sp_swar_load(input + read_idx);
+                if (sp_swar_has(v, DLE))
+                    break;
+
+                crc = sp_crc16_word(crc, input + read_idx);
+                memcpy(input + write_idx, &v, 4);
+
+                uint32_t sep = in_payload ? (sp_swar_eq_mask(v, HT) | sp_swar_eq_mask(v, FF)) : 0;
+                for (; sep; sep &= sep - 1)
+                {
+                    unsigned k = sp_swar_byte_index(sep);
+                    mark_token(tokens, input[write_idx + k], write_idx + k);
+                }
+
+                read_idx += 4;
+                write_idx += 4;
+            }
+            if (read_idx >= len)
+                break;
+        }
+
+        uint8_t byte = input[read_idx];
+
+        // CRC охватывает все байты после DLE SOH, включая стаффинг-символы и ETX
+        if (read_idx >= 2)
+            crc = sp_crc16_byte(crc, byte);
+
         // Проверяем текущий и следующий байт, если есть
-        if (input[read_idx] == DLE && (read_idx + 1 < len))
+        if (byte == DLE && (read_idx + 1 < len))
         {
             uint8_t next_byte = input[read_idx + 1];
 
@@ -43,9 +111,15 @@ int deStaff(uint8_t *input, size_t len) // input одновременно и out
             if (should_remove)
             {
                 if (next_byte == STX)
-                    stx_position = (int)(write_idx);
+                {
+                    ctx->stx_position = (int)(write_idx);
+                    in_payload = true;
+                }
                 if (next_byte == ETX)
-                    etx_position = (int)(write_idx);
+                {
+                    ctx->etx_position = (int)(write_idx);
+                    in_payload = false;
+                }
 
                 // Пропускаем запись текущего байта (DLE)
                 read_idx++; // Переходим к следующему байту после DLE
@@ -54,26 +128,35 @@ int deStaff(uint8_t *input, size_t len) // input одновременно и out
             }
         }
 
+        // Разметка разделителей полезной нагрузки
+        if (in_payload)
+            mark_token(tokens, byte, write_idx);
+
         // Копируем текущий байт в новую позицию
-        input[write_idx] = input[read_idx];
+        input[write_idx] = byte;
         write_idx++;
         read_idx++;
     }
 
+    ctx->crc = crc;
+
+    if (tokens->overflow)
+        ESP_LOGW(TAG, "Таблица разметки переполнена (HT %d, FF %d)", tokens->ht_count, tokens->ff_count);
+
     /* Проверка условий корректности:
     - STX должен существовать (stx_position != -1)
     - ETX должен существовать (etx_position != -1)
     - STX должен находиться строго перед ETX (stx_position < etx_position)
     */
-    if (stx_position == -1 || etx_position == -1 || stx_position >= etx_position)
+    if (ctx->stx_position == -1 || ctx->etx_position == -1 || ctx->stx_position >= ctx->etx_position)
     {
         ESP_LOGE(TAG, "Ошибка формата: STX/ETX не найдены или нарушен порядок");
         // Возвращаем специальный код ошибки
         return -1;
     }
 
-    ESP_LOGI(TAG, "Позиции STX: %d byte: 0x%02X", stx_position, input[stx_position]);
-    ESP_LOGI(TAG, "Позиции ETX: %d byte: 0x%02X", etx_position, input[etx_position]);
+    ESP_LOGI(TAG, "Позиции STX: %d byte: 0x%02X", ctx->stx_position, input[ctx->stx_position]);
+    ESP_LOGI(TAG, "Позиции ETX: %d byte: 0x%02X", ctx->etx_position, input[ctx->etx_position]);
     // Возвращаем новую длину сообщения
     return write_idx;
 }
@@ -1,7 +1,7 @@
 /*=====================================================================================
  * Description:
- *  // 
- *
+ *  Дестаффинг принятого пакета за один проход: проверка CRC, удаление символов DLE,
+ *  разметка STX/ETX и разделителей HT/FF полезной нагрузки
  *
  *====================================================================================*/
 #ifndef _DESTAFF_H_
@@ -9,13 +9,46 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
+#include "project_config.h"
 
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
-    int deStaff(uint8_t* input, size_t len);
+    // Таблица разметки пакета (смещения в дестаффированном буфере)
+    typedef struct
+    {
+        uint8_t ht_count;             // Количество найденных HT
+        uint8_t ff_count;             // Количество найденных FF
+        bool overflow;                // Разделителей больше, чем SP_MAX_TOKENS
+        uint16_t ht[SP_MAX_TOKENS];   // Позиции HT между STX и ETX
+        uint16_t ff[SP_MAX_TOKENS];   // Позиции FF между STX и ETX
+    } sp_tokens_t;
+
+    /**
+     * Контекст разбора одного пакета. Всё состояние декодера хранится здесь,
+     * поэтому пакеты разных портов/приборов можно разбирать параллельно в разных
+     * задачах без блокировок - у каждой задачи свой контекст.
+     */
+    typedef struct
+    {
+        int stx_position;   // Позиция STX в дестаффированном пакете (-1 - не найден)
+        int etx_position;   // Позиция ETX в дестаффированном пакете (-1 - не найден)
+        uint16_t crc;       // CRC16, насчитанный по байтам после DLE SOH
+        uint16_t commands;  // Коды команд: [15:8] запрос, [7:0] ответ
+        sp_tokens_t tokens; // Разметка разделителей полезной нагрузки
+    } sp_decoder_ctx_t;
+
+    /**
+     * @brief Дестаффинг в том же буфере с одновременным расчётом CRC и разметкой
+     * @param ctx Контекст разбора (позиции, CRC и разметка сбрасываются и заполняются)
+     * @param input Пакет от DLE SOH до DLE ETX включительно (без FF FF и CRC)
+     * @param len Длина пакета
+     * @return Новая длина пакета или -1 при ошибке STX/ETX (ctx->crc при этом насчитан)
+     */
+    int deStaff(sp_decoder_ctx_t *ctx, uint8_t *input, size_t len);
 
 #ifdef __cplusplus
 }
@@ -32,6 +32,7 @@
 #include "gw_nvs.h"
 #include "project_config.h"
 #include "board.h"
+#include "mb_frame.h"
 #include <stdio.h>
 #include <string.h>
 #include "esp_log.h"
@@ -45,7 +46,10 @@ static const char *TAG = "NVS";
 static const uint32_t baud_table[10] = {300, 600, 1200, 2400, 4800, 9600, 19200, 38400, 57600, 115200};
 
 /* Массив регистров Modbus */
-uint16_t regs[MAX_REGS];
+uint16_t regs[TOTAL_REGS];
+
+/* Очередь событий драйвера UART1 (кадрирование Modbus RTU по RX-таймауту) */
+QueueHandle_t mb_uart_queue = NULL;
 
 uint8_t dad; // адрес приёмника запроса (задаётся в настройках шлюза и целевого прибора)
 uint8_t sad; // адрес источника запроса (задаётся в настройках шлюза)
@@ -394,7 +398,8 @@ void mb_uart1_init()
             .rx_flow_ctrl_thresh = 122,
         };
 
-    ESP_ERROR_CHECK(uart_driver_install(MB_PORT_NUM, UART_BUF_SIZE, UART_BUF_SIZE, MB_QUEUE_SIZE, NULL, 0));
+    /* Драйвер с очередью событий: конец кадра определяется по RX-таймауту (см. uart1_task) */
+    ESP_ERROR_CHECK(uart_driver_install(MB_PORT_NUM, UART_BUF_SIZE, UART_BUF_SIZE, MB_QUEUE_SIZE, &mb_uart_queue, 0));
 
     /* IO33 свободен (трюк) */
     ESP_ERROR_CHECK(uart_set_pin(MB_PORT_NUM, CONFIG_MB_UART_TXD, CONFIG_MB_UART_RXD, CONFIG_MB_UART_RTS, CONFIG_MB_UART_DTS));
@@ -403,6 +408,12 @@ void mb_uart1_init()
     ESP_ERROR_CHECK(uart_set_mode(MB_PORT_NUM, UART_MODE_RS485_HALF_DUPLEX));
 
     ESP_ERROR_CHECK(uart_param_config(MB_PORT_NUM, &uart_mb_config));
+
+    /* Аппаратный RX-таймаут UART = T3.5 для текущей скорости */
+    uint8_t rx_tout = mb_frame_rx_timeout(mb_baud_rate);
+    ESP_ERROR_CHECK(uart_set_rx_timeout(MB_PORT_NUM, rx_tout));
+    ESP_LOGI(TAG, "Modbus T3.5 = %lu us, RX timeout %d symbols",
+             (unsigned long)mb_frame_t35_us(mb_baud_rate), rx_tout);
     ESP_LOGI(TAG, "slave_uart initialized.");
 }
 
@@ -434,7 +445,7 @@ void sp_uart2_init()
             .rx_flow_ctrl_thresh = 122,
         };
 
-    ESP_ERROR_CHECK(uart_driver_install(SP_PORT_NUM, UART_BUF_SIZE, UART_BUF_SIZE, SP_QUEUE_SIZE, NULL, 0));
+    ESP_ERROR_CHECK(uart_driver_install(SP_PORT_NUM, SP_RX_BUF_SIZE, UART_BUF_SIZE, SP_QUEUE_SIZE, NULL, 0));
 
     /* IO17 свободен (трюк) */
     ESP_ERROR_CHECK(uart_set_pin(SP_PORT_NUM, CONFIG_SP_UART_TXD, CONFIG_SP_UART_RXD, CONFIG_SP_UART_RTS, CONFIG_SP_UART_DTS));
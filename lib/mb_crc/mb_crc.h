@@ -2,6 +2,7 @@
 #define _MB_CRC_H_
 
 #include <stdint.h>
+#include <stddef.h>
 #include "freertos/FreeRTOS.h"
 
 #ifdef __cplusplus
@@ -9,6 +10,24 @@ extern "C"
 {
 #endif
 
+    // Начальное значение CRC
+    static inline uint16_t mb_crc16_init(void)
+    {
+        return 0xFFFF;
+    }
+
+    /**
+     * @brief Добавление очередной части данных к CRC (по мере приёма байтов)
+     * @note  CRC кадра вместе с его CRC (младший байт первым) равен 0
+     */
+    uint16_t mb_crc16_update(uint16_t crc, const uint8_t *buffer, size_t length);
+
+    // Итоговое значение CRC (Modbus RTU - без финального XOR)
+    static inline uint16_t mb_crc16_final(uint16_t crc)
+    {
+        return crc;
+    }
+
     uint16_t mb_crc16(const uint8_t *buffer, size_t length);
 
 #ifdef __cplusplus
@@ -0,0 +1,219 @@
+/**
+ * Функции Modbus 0x14/0x15 - файлы шаблонов и таблица абонентов.
+ *
+ * Кадр проверяется целиком до первого обращения к хранилищу: при ошибке
+ * адреса или длины ни один подзапрос 0x15 не записывается. Запись шаблона
+ * выполняется из uart1_task под мьютексом storage_handler_task, ответ
+ * мастеру уходит после записи во flash (или в транзакцию). Сектор журнала при
+ * этом не стирается: рабочий заполнен - исключение 0x06, переход на следующий
+ * сектор делает storage_handler_task.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include "mb_file.h"
+#include <string.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "sp_storage.h"
+#include "sp_units.h"
+
+static const char *TAG = "MB_FILE";
+
+#define MB_FILE_SUB_HDR 7          // Тип ссылки, номер файла, номер записи, длина записи
+#define MB_FILE_UNIT_REGS 4        // Регистров на запись таблицы абонентов
+#define MB_FILE_TEMPLATE_REGS (SP_STORAGE_FILE_SIZE / 2)
+
+// Подзапрос: файл и диапазон записей
+typedef struct
+{
+    uint16_t file;
+    uint16_t record;
+    uint16_t count;
+} mb_file_sub_t;
+
+static void sub_parse(const uint8_t *p, mb_file_sub_t *sub)
+{
+    sub->file = (p[1] << 8) | p[2];
+    sub->record = (p[3] << 8) | p[4];
+    sub->count = (p[5] << 8) | p[6];
+}
+
+// Число записей файла (0 - файла нет)
+static uint16_t file_records(uint16_t file)
+{
+    if (file == MB_FILE_UNITS)
+        return SP_UNIT_COUNT * MB_FILE_UNIT_REGS;
+    if ((file & 0xFF00) != MB_FILE_REQUEST && (file & 0xFF00) != MB_FILE_RESPONSE)
+        return 0;
+    return (file & 0xFF) < SP_STORAGE_FILE_COUNT ? MB_FILE_TEMPLATE_REGS : 0;
+}
+
+// Проверка подзапроса: 0 или код исключения
+static uint8_t sub_check(const uint8_t *p, const mb_file_sub_t *sub)
+{
+    if (p[0] != MB_FILE_REF_TYPE || sub->count == 0)
+        return 0x02;
+    uint16_t records = file_records(sub->file);
+    if (sub->record >= records || sub->count > records - sub->record)
+        return 0x02;
+    return 0;
+}
+
+static uint8_t err_to_exception(esp_err_t err)
+{
+    if (err == ESP_OK)
+        return 0;
+    if (err == ESP_ERR_INVALID_ARG)
+        return 0x02;
+    if (err == ESP_ERR_TIMEOUT)
+        return 0x06; // Устройство занято - мастер повторит запрос
+    return 0x04;
+}
+
+// Поле записи таблицы абонентов по номеру регистра
+static uint8_t *unit_field(sp_unit_cfg_t *u, uint16_t reg)
+{
+    switch (reg % MB_FILE_UNIT_REGS)
+    {
+    case 0:
+        return &u->mb_addr;
+    case 1:
+        return &u->dad;
+    case 2:
+        return &u->file_first;
+    default:
+        return &u->file_count;
+    }
+}
+
+// Чтение подзапроса в dst (2 * count байт)
+static esp_err_t sub_read(const mb_file_sub_t *sub, uint8_t *dst)
+{
+    if (sub->file != MB_FILE_UNITS)
+        return sp_storage_file_get((sub->file & 0xFF00) == MB_FILE_RESPONSE, sub->file & 0xFF,
+                                   2 * sub->record, dst, 2 * sub->count);
+
+    sp_unit_cfg_t u;
+    for (uint16_t i = 0; i < sub->count; i++)
+    {
+        uint16_t reg = sub->record + i;
+        if (i == 0 || reg % MB_FILE_UNIT_REGS == 0)
+        {
+            esp_err_t err = sp_storage_unit_get(reg / MB_FILE_UNIT_REGS, &u);
+            if (err != ESP_OK)
+                return err;
+        }
+        dst[2 * i] = 0;
+        dst[2 * i + 1] = *unit_field(&u, reg);
+    }
+    return ESP_OK;
+}
+
+// Запись подзапроса из src (2 * count байт)
+static esp_err_t sub_write(const mb_file_sub_t *sub, const uint8_t *src)
+{
+    if (sub->file != MB_FILE_UNITS)
+        return sp_storage_file_put((sub->file & 0xFF00) == MB_FILE_RESPONSE, sub->file & 0xFF,
+                                   2 * sub->record, src, 2 * sub->count);
+
+    // Запись таблицы применяется один раз, даже если изменены не все её поля
+    uint16_t reg = sub->record;
+    uint16_t end = sub->record + sub->count;
+    while (reg < end)
+    {
+        uint8_t slot = reg / MB_FILE_UNIT_REGS;
+        sp_unit_cfg_t u;
+        esp_err_t err = sp_storage_unit_get(slot, &u);
+        for (; err == ESP_OK && reg < end && reg / MB_FILE_UNIT_REGS == slot; reg++, src += 2)
+            *unit_field(&u, reg) = src[1];
+        if (err == ESP_OK)
+            err = sp_storage_unit_set(slot, &u);
+        if (err != ESP_OK)
+            return err;
+    }
+    return ESP_OK;
+}
+
+uint8_t mb_file_read(const uint8_t *frame, uint16_t frame_len, uint8_t *resp, uint16_t *resp_len)
+{
+    // Число байт подзапросов: 0x07 ... 0xF5, кратно 7 (Modbus Application Protocol, 6.14)
+    uint8_t bytes = frame_len > 2 ? frame[2] : 0;
+    if (bytes < MB_FILE_SUB_HDR || bytes > 0xF5 || bytes % MB_FILE_SUB_HDR != 0 || frame_len != 3 + bytes)
+        return 0x03;
+
+    // Длина ответа: адрес, функция, число байт, по подзапросу - длина, тип ссылки, данные
+    uint16_t len = 3;
+    for (uint16_t pos = 3; pos < frame_len; pos += MB_FILE_SUB_HDR)
+    {
+        mb_file_sub_t sub;
+        sub_parse(&frame[pos], &sub);
+        uint8_t ex = sub_check(&frame[pos], &sub);
+        if (ex)
+            return ex;
+        len += 2 + 2 * sub.count;
+        if (len > MB_FILE_RESP_MAX_SIZE - 2)
+            return 0x03;
+    }
+
+    resp[0] = frame[0];
+    resp[1] = frame[1];
+    resp[2] = len - 3;
+    uint16_t out = 3;
+    for (uint16_t pos = 3; pos < frame_len; pos += MB_FILE_SUB_HDR)
+    {
+        mb_file_sub_t sub;
+        sub_parse(&frame[pos], &sub);
+        resp[out++] = 1 + 2 * sub.count;
+        resp[out++] = MB_FILE_REF_TYPE;
+        esp_err_t err = sub_read(&sub, &resp[out]);
+        if (err != ESP_OK)
+        {
+            ESP_LOGW(TAG, "0x14: файл 0x%04X, 0x%x", sub.file, err);
+            return err_to_exception(err);
+        }
+        out += 2 * sub.count;
+    }
+
+    *resp_len = out;
+    return 0;
+}
+
+uint8_t mb_file_write(const uint8_t *frame, uint16_t frame_len)
+{
+    // Число байт подзапросов: 0x09 ... 0xFB
+    uint8_t bytes = frame_len > 2 ? frame[2] : 0;
+    if (bytes < MB_FILE_SUB_HDR + 2 || bytes > 0xFB || frame_len != 3 + bytes)
+        return 0x03;
+
+    // Подзапросы должны занять кадр без остатка
+    uint16_t pos = 3;
+    while (pos < frame_len)
+    {
+        if (frame_len - pos < MB_FILE_SUB_HDR)
+            return 0x03;
+        mb_file_sub_t sub;
+        sub_parse(&frame[pos], &sub);
+        if (sub.count == 0 || frame_len - pos - MB_FILE_SUB_HDR < 2 * sub.count)
+            return 0x03;
+        uint8_t ex = sub_check(&frame[pos], &sub);
+        if (ex)
+            return ex;
+        pos += MB_FILE_SUB_HDR + 2 * sub.count;
+    }
+
+    for (pos = 3; pos < frame_len;)
+    {
+        mb_file_sub_t sub;
+        sub_parse(&frame[pos], &sub);
+        esp_err_t err = sub_write(&sub, &frame[pos + MB_FILE_SUB_HDR]);
+        if (err != ESP_OK)
+        {
+            ESP_LOGW(TAG, "0x15: файл 0x%04X, 0x%x", sub.file, err);
+            return err_to_exception(err);
+        }
+        pos += MB_FILE_SUB_HDR + 2 * sub.count;
+    }
+    return 0;
+}
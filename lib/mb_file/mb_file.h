@@ -0,0 +1,47 @@
+/*=====================================================================================
+ * Description:
+ *  Функции Modbus 0x14 (Read File Record) и 0x15 (Write File Record)
+ *
+ *  Шаблоны и таблица абонентов читаются и записываются напрямую в sp_storage -
+ *  без окон 0x20/0x80, регистров-команд 0x0C-0x0F/0x1A и ожидания прохода
+ *  storage_handler_task. Номер файла (project_config.h):
+ *   MB_FILE_REQUEST  + индекс  шаблон запроса, записи 0 ... SP_STORAGE_FILE_SIZE / 2 - 1
+ *   MB_FILE_RESPONSE + индекс  шаблон ответа, записи 0 ... SP_STORAGE_FILE_SIZE / 2 - 1
+ *   MB_FILE_UNITS              таблица абонентов, записи 0 ... 4 * SP_UNIT_COUNT - 1
+ *  Запись файла - регистр (2 байта). Запись шаблона в открытой транзакции
+ *  (REG_SP_TXN) накапливается вместе с остальными её файлами.
+ *====================================================================================*/
+#ifndef _MB_FILE_H_
+#define _MB_FILE_H_
+
+#include <stdint.h>
+#include "project_config.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define MB_FILE_RESP_MAX_SIZE 256 // Кадр ответа RTU целиком (с адресом и CRC)
+
+    /**
+     * @brief Функция 0x14: ответ на кадр запроса
+     * @param frame   кадр без CRC: адрес, 0x14, число байт, подзапросы
+     * @param resp    MB_FILE_RESP_MAX_SIZE байт: ответ без CRC
+     * @param resp_len [out] длина ответа без CRC
+     * @return 0 или код исключения Modbus
+     */
+    uint8_t mb_file_read(const uint8_t *frame, uint16_t frame_len, uint8_t *resp, uint16_t *resp_len);
+
+    /**
+     * @brief Функция 0x15: запись подзапросов кадра (ответ - эхо кадра)
+     * @param frame кадр без CRC: адрес, 0x15, число байт, подзапросы с данными
+     * @return 0 или код исключения Modbus (ни один подзапрос не записан при 0x02/0x03)
+     */
+    uint8_t mb_file_write(const uint8_t *frame, uint16_t frame_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _MB_FILE_H_
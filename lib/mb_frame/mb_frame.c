@@ -0,0 +1,64 @@
+/**
+ * Сборка кадров Modbus RTU по событиям драйвера UART1.
+ *
+ * Интервалы - Modbus over Serial Line V1.02, п. 2.5.1.1: до 19200 бод T3.5 -
+ * 3.5 символа, выше - фиксированные 1750 мкс. Межсимвольный интервал T1.5 не
+ * контролируется: драйвер UART отдаёт байты пачками без отметок времени, а
+ * кадр с разрывом внутри отбрасывается по CRC.
+ *
+ * CRC накапливается по мере приёма пачек, к таймауту остаётся только сравнить
+ * его с нулём.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include "mb_frame.h"
+#include "mb_crc.h"
+#include "project_config.h"
+
+uint32_t mb_frame_char_us(uint32_t baud)
+{
+    return (10UL * 1000000UL + baud - 1) / baud;
+}
+
+uint32_t mb_frame_t35_us(uint32_t baud)
+{
+    if (baud > MB_FIXED_TIMING_BAUD)
+        return MB_T35_FIXED_US;
+    return (mb_frame_char_us(baud) * 35 + 9) / 10;
+}
+
+uint8_t mb_frame_rx_timeout(uint32_t baud)
+{
+    uint32_t char_us = mb_frame_char_us(baud);
+    uint32_t symbols = (mb_frame_t35_us(baud) + char_us - 1) / char_us;
+
+    if (symbols < 1)
+        symbols = 1;
+    if (symbols > MB_RX_TOUT_MAX)
+        symbols = MB_RX_TOUT_MAX;
+    return (uint8_t)symbols;
+}
+
+void mb_frame_reset(mb_frame_t *frame)
+{
+    frame->len = 0;
+    frame->crc = mb_crc16_init();
+    frame->error = false;
+}
+
+uint8_t *mb_frame_reserve(mb_frame_t *frame, size_t size)
+{
+    if (frame->len + size > MAX_PDU_LENGTH)
+    {
+        frame->error = true;
+        return NULL;
+    }
+    return frame->buf + frame->len;
+}
+
+void mb_frame_commit(mb_frame_t *frame, size_t len)
+{
+    frame->crc = mb_crc16_update(frame->crc, frame->buf + frame->len, len);
+    frame->len += len;
+}
@@ -0,0 +1,71 @@
+/*=====================================================================================
+ * Description:
+ *  Сборка кадров Modbus RTU из событий драйвера UART1
+ *
+ *  Конец кадра - аппаратный RX-таймаут UART (событие UART_DATA с timeout_flag),
+ *  порог которого не меньше T3.5 для текущей скорости. Данные между таймаутами
+ *  (в том числе несколько событий по заполнению FIFO) - один кадр.
+ *====================================================================================*/
+#ifndef _MB_FRAME_H_
+#define _MB_FRAME_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "project_config.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef struct
+    {
+        uint16_t len;                // Длина собранных данных
+        uint16_t crc;                // CRC собранных данных (у целого кадра вместе с CRC - 0)
+        bool error;                  // Кадр испорчен (переполнение, ошибка линии)
+        uint8_t buf[MAX_PDU_LENGTH]; // Кадр: адрес, функция, данные, CRC
+    } mb_frame_t;
+
+    // Длительность символа 8N1 (старт + 8 бит + стоп), мкс
+    uint32_t mb_frame_char_us(uint32_t baud);
+
+    // Интервал T3.5 (минимальная пауза между кадрами), мкс
+    uint32_t mb_frame_t35_us(uint32_t baud);
+
+    /**
+     * @brief Порог аппаратного RX-таймаута UART в символах, не меньший T3.5
+     * @note  Округление вверх - конец кадра обнаруживается не позже чем через
+     *        один символ сверх T3.5
+     */
+    uint8_t mb_frame_rx_timeout(uint32_t baud);
+
+    // Начало нового кадра
+    void mb_frame_reset(mb_frame_t *frame);
+
+    /**
+     * @brief Место под size очередных байт кадра
+     * @return NULL - кадр не помещается в буфер, он помечается испорченным
+     */
+    uint8_t *mb_frame_reserve(mb_frame_t *frame, size_t size);
+
+    // Учёт len байт, принятых в место из mb_frame_reserve()
+    void mb_frame_commit(mb_frame_t *frame, size_t len);
+
+    // Ошибка линии: кадр отбрасывается по ближайшему таймауту
+    static inline void mb_frame_error(mb_frame_t *frame)
+    {
+        frame->error = true;
+    }
+
+    // Кадр по таймауту пригоден для разбора (не пуст и не испорчен)
+    static inline bool mb_frame_complete(const mb_frame_t *frame)
+    {
+        return frame->len > 0 && !frame->error;
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _MB_FRAME_H_
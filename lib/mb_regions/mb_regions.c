@@ -0,0 +1,143 @@
+/**
+ * Таблица областей регистров Modbus.
+ *
+ * Вместо проверок диапазонов в каждой ветке switch (mb_func) uart1_task -
+ * одна таблица. Запись управляющего регистра сразу запускает работу:
+ * сохранение в NVS, пробуждение uart2_task (обмен по SP) или storage_handler_task
+ * (файлы и конфигурация), без ожидания их очередного опроса регистров.
+ * Чтение окна результата в режиме long-poll ждёт завершения обмена по SP -
+ * мастеру не нужно часто опрашивать REG_SP_ERROR / 0x20+.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include "mb_regions.h"
+#include "board.h"
+#include "gw_nvs.h"
+#include "sp_storage.h"
+#include "uart2_task.h"
+#include "reg_seq.h"
+
+extern uint16_t regs[];
+
+_Static_assert(MAX_CONTROL_REGS % (1 << MB_REGION_SHIFT) == 0 &&
+                   MAX_READ_REGS % (1 << MB_REGION_SHIFT) == 0 &&
+                   MAX_WRITE_REGS % (1 << MB_REGION_SHIFT) == 0 &&
+                   MAX_DIAG_REGS % (1 << MB_REGION_SHIFT) == 0,
+               "Границы областей регистров должны быть кратны 32");
+
+// Управляющие регистры записаны командой 0x06 или 0x17
+static void control_on_write(uint16_t reg, uint16_t count)
+{
+    for (uint16_t r = reg; r < reg + count; r++)
+    {
+        // Параметры связи - в NVS (вступают в силу после перезагрузки)
+        if (r < MAX_PARAM_INDEX)
+            write_parameter_to_nvs(r, regs[r]);
+
+        uint16_t *p = &regs[r];
+        if (p == &REG_SP_COMM || p == &REG_SCHED_OPERATION)
+        {
+            if (p == &REG_SP_COMM && (REG_SP_FLAGS & SP_FLAG_LATENCY_PROBE))
+                flagA();
+            sp_comm_notify();
+        }
+        else if (p == &REG_SP_READ_RESP || p == &REG_SP_WRITE_RESP ||
+                 p == &REG_SP_READ_REQ || p == &REG_SP_WRITE_REQ ||
+                 p == &REG_CONFIG_OPERATION || p == &REG_SP_TXN)
+        {
+            sp_storage_notify();
+        }
+    }
+}
+
+// Чтение окна результата: при SP_FLAG_LONG_POLL ответ ждёт завершения команды обмена
+static void result_on_read(uint16_t reg, uint16_t count)
+{
+    uint32_t ticket;
+    if ((REG_SP_FLAGS & SP_FLAG_LONG_POLL) && REG_MB_HOLD_MS != 0 && sp_comm_in_flight(&ticket))
+        sp_comm_wait(ticket, pdMS_TO_TICKS(REG_MB_HOLD_MS));
+}
+
+static const mb_region_t mb_regions[] = {
+    {0, MAX_CONTROL_REGS,
+     MB_ACCESS_READ | MB_ACCESS_WRITE_SINGLE | MB_ACCESS_WRITE_RW, NULL, control_on_write, false},
+    {HLD_READ_REG, MAX_READ_REGS,
+     MB_ACCESS_READ | MB_ACCESS_WRITE_MULTI | MB_ACCESS_WRITE_RW, result_on_read, NULL, true},
+    {HLD_WRITE_REG, MAX_WRITE_REGS,
+     MB_ACCESS_READ | MB_ACCESS_WRITE_SINGLE | MB_ACCESS_WRITE_MULTI | MB_ACCESS_WRITE_RW, NULL, NULL, true},
+    {HLD_DIAG_REG, MAX_DIAG_REGS,
+     MB_ACCESS_READ, NULL, NULL, false},
+};
+
+#define MB_BLOCK(reg) ((reg) >> MB_REGION_SHIFT)
+
+// Номер области для каждого блока из 32 регистров
+static const uint8_t mb_region_of[MB_BLOCK(TOTAL_REGS)] = {
+    [MB_BLOCK(0)... MB_BLOCK(HLD_READ_REG) - 1] = 0,
+    [MB_BLOCK(HLD_READ_REG)... MB_BLOCK(HLD_WRITE_REG) - 1] = 1,
+    [MB_BLOCK(HLD_WRITE_REG)... MB_BLOCK(HLD_DIAG_REG) - 1] = 2,
+    [MB_BLOCK(HLD_DIAG_REG)... MB_BLOCK(TOTAL_REGS) - 1] = 3,
+};
+
+static inline const mb_region_t *mb_region_find(uint16_t reg)
+{
+    return &mb_regions[mb_region_of[MB_BLOCK(reg)]];
+}
+
+bool mb_region_allowed(uint16_t reg, uint16_t count, uint8_t access)
+{
+    if (count == 0 || reg >= TOTAL_REGS || reg + count > TOTAL_REGS)
+        return false;
+
+    // Диапазон длиннее области проверяется по каждой перекрытой области
+    uint16_t end = reg + count;
+    while (reg < end)
+    {
+        const mb_region_t *r = mb_region_find(reg);
+        if ((r->access & access) != access)
+            return false;
+        reg = r->first + r->count;
+    }
+    return true;
+}
+
+bool mb_region_tracked(uint16_t reg, uint16_t count)
+{
+    uint16_t end = reg + count;
+    while (reg < end)
+    {
+        const mb_region_t *r = mb_region_find(reg);
+        if (!r->tracked)
+            return false;
+        reg = r->first + r->count;
+    }
+    return true;
+}
+
+// Вызов обработчика каждой перекрытой области для своей части диапазона
+static void mb_region_call(uint16_t reg, uint16_t count, bool write)
+{
+    uint16_t end = reg + count;
+    while (reg < end)
+    {
+        const mb_region_t *r = mb_region_find(reg);
+        uint16_t region_end = r->first + r->count;
+        uint16_t part_end = end < region_end ? end : region_end;
+        mb_region_hook_t hook = write ? r->on_write : r->on_read;
+        if (hook)
+            hook(reg, part_end - reg);
+        reg = part_end;
+    }
+}
+
+void mb_region_before_read(uint16_t reg, uint16_t count)
+{
+    mb_region_call(reg, count, false);
+}
+
+void mb_region_after_write(uint16_t reg, uint16_t count)
+{
+    reg_seq_touch(reg, count); // 0x06 пишет регистр без reg_seq
+    mb_region_call(reg, count, true);
+}
@@ -0,0 +1,78 @@
+/*=====================================================================================
+ * Description:
+ *  Таблица областей регистров Modbus: права доступа и обработчики чтения/записи
+ *
+ *  Области (границы - из project_config.h, кратны 32 регистрам):
+ *   0x00 ... 0x1F  управление      0x03, 0x06, 0x17
+ *   0x20 ... 0x7F  окно результата 0x03, 0x10, 0x17
+ *   0x80 ... 0xDF  окно записи     0x03, 0x06, 0x10, 0x17
+ *   0xE0 ... 0xFF  диагностика     0x03 (и чтение 0x17)
+ *
+ *  Область регистра находится по индексу reg >> MB_REGION_SHIFT - за O(1).
+ *  on_write вызывается после записи и ответа мастеру (запуск работы без опроса
+ *  регистров-флагов), on_read - перед снимком регистров (ленивое вычисление).
+ *
+ *  Области с tracked пишутся только через reg_seq (и записями Modbus, которые
+ *  учитывает mb_region_after_write): готовый ответ на их чтение годен, пока не
+ *  изменилось поколение reg_seq_gen(). Управление и диагностику задачи меняют
+ *  присваиванием, их ответ сверяется со снимком.
+ *====================================================================================*/
+#ifndef _MB_REGIONS_H_
+#define _MB_REGIONS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "project_config.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define MB_REGION_SHIFT 5 // Гранулярность таблицы - 32 регистра
+
+    // Права доступа к области
+#define MB_ACCESS_READ 0x01         // Функция 0x03
+#define MB_ACCESS_WRITE_SINGLE 0x02 // Функция 0x06
+#define MB_ACCESS_WRITE_MULTI 0x04  // Функция 0x10
+#define MB_ACCESS_WRITE_RW 0x08     // Запись функцией 0x17
+
+    // Обработчик диапазона [reg, reg + count) внутри одной области
+    typedef void (*mb_region_hook_t)(uint16_t reg, uint16_t count);
+
+    typedef struct
+    {
+        uint16_t first;           // Первый регистр области
+        uint16_t count;           // Число регистров
+        uint8_t access;           // MB_ACCESS_*
+        mb_region_hook_t on_read; // NULL - нет
+        mb_region_hook_t on_write;
+        bool tracked;             // Все записи меняют поколение reg_seq_gen()
+    } mb_region_t;
+
+    /**
+     * @brief Проверка доступа к диапазону регистров
+     * @return true - все регистры диапазона существуют и допускают access
+     */
+    bool mb_region_allowed(uint16_t reg, uint16_t count, uint8_t access);
+
+    /**
+     * @brief Все области диапазона tracked: его изменения видны по reg_seq_gen()
+     */
+    bool mb_region_tracked(uint16_t reg, uint16_t count);
+
+    /**
+     * @brief Вызов on_read областей, перекрывающих диапазон
+     */
+    void mb_region_before_read(uint16_t reg, uint16_t count);
+
+    /**
+     * @brief Вызов on_write областей, перекрывающих диапазон, и учёт записи в reg_seq_gen()
+     */
+    void mb_region_after_write(uint16_t reg, uint16_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _MB_REGIONS_H_
@@ -17,13 +17,15 @@
 #include "esp_log.h"
 #include "esp_heap_caps.h"
 #include "destaff.h"
+#include "val_cache.h"
+#include "reg_seq.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
 static const char *TAG = "PARSER";
 
 // Внешние переменные
 extern uint16_t regs[];     // Массив регистров MODBUS
-extern int stx_position;    // Позиция начала данных (STX)
-extern int etx_position;    // Позиция конца данных (ETX)
 
 // Общие структуры данных
 typedef struct {
@@ -91,33 +93,73 @@ static void print_parameter_blocks(param_block_t *params, uint8_t field_count) {
 
 /**
  * @brief Универсальный обработчик блока параметра
- * @param start Начало блока данных
- * @param end Конец блока данных
+ * @param data Дестаффированный пакет
+ * @param start Смещение начала блока
+ * @param end Смещение конца блока (позиция FF или ETX)
+ * @param tokens Таблица разметки пакета
+ * @param ht_idx Курсор по таблице HT (позиции возрастают, курсор только движется вперёд)
  * @param block Структура для сохранения результатов
  */
-static void process_param_block(const uint8_t *start, const uint8_t *end, param_block_t *block) {
+static void process_param_block(const uint8_t *data, size_t start, size_t end,
+                                const sp_tokens_t *tokens, uint8_t *ht_idx,
+                                param_block_t *block) {
     memset(block, 0, sizeof(param_block_t));
     if (start >= end) return;
-    const uint8_t *ptr = start;
+    // Разделители HT внутри блока
+    while (*ht_idx < tokens->ht_count && tokens->ht[*ht_idx] < start) (*ht_idx)++;
+    uint8_t i = *ht_idx;
+    size_t pos = start;
     // Обработка значения
-    if (*ptr == HT) ptr++;
-    block->value.data = (uint8_t *)ptr;
-    while (ptr < end && *ptr != HT && *ptr != FF) ptr++;
-    block->value.len = ptr - block->value.data;
+    if (i < tokens->ht_count && tokens->ht[i] == pos) { pos++; i++; }
+    size_t field_end = (i < tokens->ht_count && tokens->ht[i] < end) ? tokens->ht[i] : end;
+    block->value.data = (uint8_t *)data + pos;
+    block->value.len = field_end - pos;
     // Обработка единиц измерения
-    if (ptr < end && *ptr == HT) {
-        ptr++;
-        block->units.data = (uint8_t *)ptr;
-        while (ptr < end && *ptr != HT && *ptr != FF) ptr++;
-        block->units.len = ptr - block->units.data;
+    if (field_end < end) {
+        pos = field_end + 1; i++;
+        field_end = (i < tokens->ht_count && tokens->ht[i] < end) ? tokens->ht[i] : end;
+        block->units.data = (uint8_t *)data + pos;
+        block->units.len = field_end - pos;
     }
-    // Обработка метки времени
-    if (ptr < end && *ptr == HT) {
-        ptr++;
-        block->timestamp.data = (uint8_t *)ptr;
-        while (ptr < end && *ptr != FF) ptr++;
-        block->timestamp.len = ptr - block->timestamp.data;
+    // Обработка метки времени (до конца блока)
+    if (field_end < end) {
+        pos = field_end + 1;
+        block->timestamp.data = (uint8_t *)data + pos;
+        block->timestamp.len = end - pos;
     }
+    while (*ht_idx < tokens->ht_count && tokens->ht[*ht_idx] < end) (*ht_idx)++;
+}
+
+/**
+ * @brief Разбивка полезной нагрузки на блоки по таблице разделителей FF
+ * @param data Дестаффированный пакет
+ * @param first Смещение начала первого блока
+ * @param end Смещение ETX
+ * @param tokens Таблица разметки пакета
+ * @param params Массив блоков (не более MAX_BLOCKS)
+ * @return Количество блоков
+ */
+static uint8_t split_param_blocks(const uint8_t *data, size_t first, size_t end,
+                                  const sp_tokens_t *tokens, param_block_t *params) {
+    uint8_t field_count = 0;
+    uint8_t ht_idx = 0;
+    size_t block_start = first;
+    for (uint8_t f = 0; f < tokens->ff_count && field_count < MAX_BLOCKS; f++) {
+        size_t ff = tokens->ff[f];
+        if (ff < first) continue;
+        if (ff >= end) break;
+        if (ff > block_start) {
+            process_param_block(data, block_start, ff, tokens, &ht_idx, &params[field_count]);
+            field_count++;
+        }
+        block_start = ff + 1;
+    }
+    // Обработка последнего блока
+    if (block_start < end && field_count < MAX_BLOCKS) {
+        process_param_block(data, block_start, end, tokens, &ht_idx, &params[field_count]);
+        field_count++;
+    }
+    return field_count;
 }
 
 /**
@@ -127,143 +169,156 @@ static void process_param_block(const uint8_t *start, const uint8_t *end, param_
  * @param start_reg Начальный регистр для записи
  */
 static void write_to_modbus(param_block_t *params, uint8_t field_count, uint16_t start_reg) {
-    size_t reg_index = start_reg;
-    uint16_t written_fields = 0;
     // Проверка доступности регистров
     if (start_reg + MAX_OUT_BUF_REGS > MAX_REGS) {
         ESP_LOGE(TAG, "Недостаточно регистров MODBUS");
         return;
     }
+    // Окно собирается в буфере и публикуется одной записью: чтение 0x03
+    // видит либо прежний, либо новый результат целиком
+    uint16_t out[MAX_OUT_BUF_REGS];
+    size_t reg_index = 0;
+    uint16_t written_fields = 0;
     // Резервирование места под счетчик
     uint16_t count_reg = reg_index++;
-    regs[count_reg] = 0;
+    out[count_reg] = 0;
     // Запись данных параметров
     for (int i = 0; i < field_count; i++) {
         size_t required_regs = 1 + (params[i].value.len + 1) / 2;
         // Проверка лимита регистров
-        if (reg_index + required_regs > start_reg + MAX_OUT_BUF_REGS) {
+        if (reg_index + required_regs > MAX_OUT_BUF_REGS) {
             ESP_LOGW(TAG, "Превышен лимит регистров для параметра %d", i);
             break;
         }
         // Запись длины значения
-        regs[reg_index++] = params[i].value.len;
+        out[reg_index++] = params[i].value.len;
         written_fields++;
         // Упаковка значения в регистры
         const uint8_t *val_ptr = params[i].value.data;
         size_t bytes_left = params[i].value.len;
         while (bytes_left > 0) {
             if (bytes_left == 1) {
-                regs[reg_index++] = (*val_ptr) << 8;
+                out[reg_index++] = (*val_ptr) << 8;
                 bytes_left = 0;
             } else {
-                regs[reg_index++] = (val_ptr[0] << 8) | val_ptr[1];
+                out[reg_index++] = (val_ptr[0] << 8) | val_ptr[1];
                 val_ptr += 2;
                 bytes_left -= 2;
             }
         }
     }
     // Обновление счетчика параметров
-    regs[count_reg] = written_fields;
+    out[count_reg] = written_fields;
+    reg_seq_write_result(out, reg_index);
     // Отправка по WiFi
 #ifdef WIFI_ENABLED
-    wifi_send_data((const uint8_t*)&regs[start_reg], (reg_index - start_reg) * sizeof(uint16_t));
+    wifi_send_data((const uint8_t*)out, reg_index * sizeof(uint16_t));
 #endif
     ESP_LOGI(TAG, "Данные записаны в регистры [0x%X-0x%X]", 
-             start_reg, reg_index - 1);
+             start_reg, start_reg + reg_index - 1);
     printf("Успешно записано полей: %d\n", written_fields);
 }
 
+/**
+ * @brief Сохранение значений ответа в кэш
+ * @details Ответ CMD_READ_PARAMS - пары блоков "указатель (HT кан HT пар) - информация"
+ * @param dad Адрес прибора, ответившего на запрос (SAD ответа)
+ */
+static void store_to_cache(uint8_t dad, const param_block_t *params, uint8_t field_count) {
+    uint32_t now_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    for (int i = 0; i + 1 < field_count; i += 2) {
+        uint16_t channel, param;
+        if (!val_cache_parse_number(params[i].value.data, params[i].value.len, &channel) ||
+            !val_cache_parse_number(params[i].units.data, params[i].units.len, &param)) {
+            continue;
+        }
+        val_cache_store(dad, channel, param,
+                        params[i + 1].value.data, params[i + 1].value.len, now_ms);
+    }
+}
+
 /**
  * @brief Обработка ответа с параметрами (FNC=0x03)
  */
-void handle_read_parameter(const uint8_t fnc, const uint8_t *data, size_t len) {
+void handle_read_parameter(const sp_decoder_ctx_t *ctx, const uint8_t fnc,
+                           const uint8_t *data, size_t len) {
     if (fnc != 0x03) {
         ESP_LOGE(TAG, "Неверный код функции: 0x%02X (ожидалось 0x03)", fnc);
         return;
     }
     // Извлечение полезной нагрузки
-    const uint8_t *payload_start = data + stx_position + 1;
-    const uint8_t *payload_end = data + etx_position;
-    size_t payload_len = payload_end - payload_start;
+    const sp_tokens_t *tokens = &ctx->tokens;
+    size_t payload_start = ctx->stx_position + 1;
+    size_t payload_end = ctx->etx_position;
 
     // Защита от пустых пакетов
-    if (payload_len == 0) {
+    if (payload_end <= payload_start) {
          ESP_LOGW(TAG, "Пустая полезная нагрузка. Пропуск обработки.");
          return;
     }
 
-    // Разбивка на блоки параметров
+    // Разбивка на блоки параметров по таблице разметки
     param_block_t params[MAX_BLOCKS];
-    uint8_t field_count = 0;
-    const uint8_t *block_start = payload_start;
-    const uint8_t *ptr = payload_start;
-    while (ptr < payload_end && field_count < MAX_BLOCKS) {
-        if (*ptr == FF) {
-            if (ptr > block_start) {
-                process_param_block(block_start, ptr, &params[field_count]);
-                field_count++;
-            }
-            block_start = ptr + 1;
-        }
-        ptr++;
-    }
-    // Обработка последнего блока
-    if (block_start < payload_end && field_count < MAX_BLOCKS) {
-        process_param_block(block_start, payload_end, &params[field_count]);
-        field_count++;
-    }
+    uint8_t field_count = split_param_blocks(data, payload_start, payload_end, tokens, params);
     // Вывод в терминал
     print_parameter_blocks(params, field_count);
     // Запись в регистры MODBUS
     write_to_modbus(params, field_count, HLD_OUTPUT);
+    // Кэш значений (адрес прибора - SAD ответа)
+    if (len > 2) {
+        store_to_cache(data[2], params, field_count);
+    }
+}
+
+/**
+ * @brief Ответ на чтение параметра из кэша значений
+ * @details Регистры заполняются так же, как handle_read_parameter() для ответа
+ *          на запрос одного параметра: блок указателя (номер канала) и блок значения
+ */
+void handle_cached_parameter(uint16_t channel, const uint8_t *value, size_t len) {
+    char channel_text[6];
+    int channel_len = snprintf(channel_text, sizeof(channel_text), "%u", channel);
+
+    param_block_t params[2];
+    memset(params, 0, sizeof(params));
+    params[0].value.data = (uint8_t *)channel_text;
+    params[0].value.len = channel_len;
+    params[1].value.data = (uint8_t *)value;
+    params[1].value.len = len;
+    write_to_modbus(params, 2, HLD_OUTPUT);
 }
 
 /**
  * @brief Обработка индексного массива (FNC=0x14)
  */
-void handle_read_elements_index_array(const uint8_t fnc, const uint8_t *data, size_t len) {
+void handle_read_elements_index_array(const sp_decoder_ctx_t *ctx, const uint8_t fnc,
+                                      const uint8_t *data, size_t len) {
     if (fnc != 0x14) {
         ESP_LOGE(TAG, "Неверный код функции: 0x%02X (ожидалось 0x14)", fnc);
         return;
     }
     // Извлечение полезной нагрузки
-    const uint8_t *payload_start = data + stx_position + 1;
-    const uint8_t *payload_end = data + etx_position;
-    size_t payload_len = payload_end - payload_start;
+    const sp_tokens_t *tokens = &ctx->tokens;
+    size_t payload_start = ctx->stx_position + 1;
+    size_t payload_end = ctx->etx_position;
 
     // Защита от пустых пакетов
-    if (payload_len == 0) {
+    if (payload_end <= payload_start) {
          ESP_LOGW(TAG, "Пустая полезная нагрузка. Пропуск обработки.");
          return;
     }
 
     // Пропуск указателя запроса (до первого FF)
-    const uint8_t *first_ff = memchr(payload_start, FF, payload_len);
-    if (!first_ff) {
+    uint8_t f = 0;
+    while (f < tokens->ff_count && tokens->ff[f] < payload_start) f++;
+    if (f >= tokens->ff_count || tokens->ff[f] >= payload_end) {
         ESP_LOGE(TAG, "Ошибка формата: отсутствует FF");
         return;
     }
 
-    // Разбивка на блоки параметров
+    // Разбивка на блоки параметров по таблице разметки
     param_block_t params[MAX_BLOCKS];
-    uint8_t field_count = 0;
-    const uint8_t *block_start = first_ff + 1;
-    const uint8_t *ptr = block_start;
-    while (ptr < payload_end && field_count < MAX_BLOCKS) {
-        if (*ptr == FF) {
-            if (ptr > block_start) {
-                process_param_block(block_start, ptr, &params[field_count]);
-                field_count++;
-            }
-            block_start = ptr + 1;
-        }
-        ptr++;
-    }
-    // Обработка последнего блока
-    if (block_start < payload_end && field_count < MAX_BLOCKS) {
-        process_param_block(block_start, payload_end, &params[field_count]);
-        field_count++;
-    }
+    uint8_t field_count = split_param_blocks(data, tokens->ff[f] + 1, payload_end, tokens, params);
     // Вывод в терминал
     print_parameter_blocks(params, field_count);
     // Запись в регистры MODBUS
@@ -276,7 +331,11 @@ void handle_read_elements_index_array(const uint8_t fnc, const uint8_t *data, si
  * 
  * 1. Унификация структур данных:
  *    - общие структуры `param_value_t` и `param_block_t`;
- *    - единая функция обработки блоков `process_param_block()`.
+ *    - единая функция обработки блоков `process_param_block()`;
+ *    - границы блоков и полей берутся из таблицы разметки `sp_tokens_t`,
+ *      заполненной deStaff() за тот же проход, что и дестаффинг, без повторного сканирования;
+ *    - всё состояние разбора передаётся явно через `sp_decoder_ctx_t`, глобальных
+ *      переменных нет - обработчики реентерабельны.
  * 
  * 2. Централизация вывода:
  *    - функция `write_to_modbus()` заменяет дублированный код;
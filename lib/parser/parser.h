@@ -4,22 +4,35 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
+#include "destaff.h"
 
 /**
  * @brief Обрабатывает ответ с элементами индексного массива
+ * @param ctx Контекст разбора пакета (заполнен deStaff())
  * @param fnc Код функции (должен быть 0x14)
  * @param data Указатель на данные пакета (от SOH = 01h до ETX = 03h)
  * @param len Длина данных пакета в байтах
  */
-void handle_read_elements_index_array(const uint8_t fnc, const uint8_t *data, size_t len);
+void handle_read_elements_index_array(const sp_decoder_ctx_t *ctx, const uint8_t fnc,
+                                      const uint8_t *data, size_t len);
 
 /**
  * @brief Обработка ответа с параметрами
+ * @param ctx Контекст разбора пакета (заполнен deStaff())
  * @param fnc Код функции (должен быть 0x03)
  * @param data Указатель на данные пакета (от SOH = 01h до ETX = 03h)
  * @param len Длина данных пакета в байтах
  */
-void handle_read_parameter(const uint8_t fnc, const uint8_t *data, size_t len);
+void handle_read_parameter(const sp_decoder_ctx_t *ctx, const uint8_t fnc,
+                           const uint8_t *data, size_t len);
+
+/**
+ * @brief Запись в регистры значения параметра из кэша (как ответ на запрос одного параметра)
+ * @param channel Номер канала
+ * @param value Значение в символьном формате
+ * @param len Длина значения
+ */
+void handle_cached_parameter(uint16_t channel, const uint8_t *value, size_t len);
 
 // Объявление функции для отправки по WiFi
 #ifdef WIFI_ENABLED
@@ -0,0 +1,921 @@
+/**
+ * Журнальное хранилище файлов во flash.
+ *
+ * Раньше запись файла 96 байт стоила чтения сектора 4 КБ в кучу, его стирания
+ * (десятки мс) и записи 16 страниц - 42 шаблона при вводе - 42 стирания. Теперь
+ * запись - добавление в конец журнала, стирание - одно на сектор записей.
+ *
+ * Запись хранит данные файла только до последнего значащего байта (но не
+ * короче байта длины и шаблона), выровненные до 16 байт. Файлов в разделе -
+ * сколько поместится по сумме их записей, а не SP_STORAGE_FILE_SIZE на каждый.
+ *
+ * Сектор после рабочего всегда стёрт (запасной). Рабочий заполнен - запасной
+ * становится рабочим, живые записи следующего за ним (самого старого) сектора
+ * переносятся в рабочий, самый старый стирается и становится запасным. Записи
+ * переносятся в том же порядке и с той же длиной, новый рабочий пуст - перенос
+ * всегда помещается. Живых записей не больше capacity - среди секторов есть
+ * такой, после переноса которого в рабочем остаётся место под любую запись.
+ *
+ * Записи сектора читаются подряд по длине из заголовка. Запись с неверной CRC
+ * (обрыв питания) пропускается: её длине верить нельзя, следующая ищется с шагом
+ * 16 байт. Записи сектора кончаются там, где до конца сектора flash не записан, -
+ * с этого места и продолжается запись после монтирования.
+ *
+ * Если после сбоя при переносе записи не помещаются, журнал уплотняется целиком
+ * через RAM (rec_log_compact) - единственный случай стирания всех секторов.
+ *
+ * Пакет записей (rec_log_write_batch) пишется подряд в одном секторе, каждая
+ * запись несёт размер пакета и свой номер в нём. При монтировании пакет
+ * учитывается, только если все его записи целы, - иначе не применяется ни одна.
+ *
+ * Транзакция двух журналов (rec_log_write_txn): в каждом - пакет с номером
+ * транзакции, который применяется только с отметкой фиксации вплотную за ним
+ * (место под неё занимается вместе с пакетом). Точка фиксации - отметка в первом
+ * журнале, она пишется после обоих пакетов. Пакет второго журнала без отметки
+ * после сбоя применяет rec_log_txn_recover(), если последняя отметка первого
+ * журнала - его транзакции: файлы пакета переписываются обычным пакетом, за ним -
+ * отметка. Номер транзакции не повторяет номер последнего пакета без отметки,
+ * поэтому отменённый пакет не получит чужую отметку.
+ *
+ * Отображение раздела не пересоздаётся: записи после добавления не меняются,
+ * а esp_partition_write/erase_range сами сбрасывают кэш затронутой области.
+ * Стирание сектора (перенос записей) идёт под той же блокировкой, что и
+ * просмотр, - указатель на стираемую запись у читателя остаться не может.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include "rec_log.h"
+#include "sp_crc.h"
+#include "esp_log.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+static const char *TAG = "REC_LOG";
+
+static const uint8_t rec_log_empty[SP_STORAGE_FILE_SIZE]; // Файла нет - длина 0
+
+// Вид записи
+#define REC_KIND_FILE 0xFF   // Файл (и записи до введения транзакций: поле было резервным)
+#define REC_KIND_TXN 0x01    // Файл пакета транзакции: действует только с отметкой фиксации
+#define REC_KIND_COMMIT 0x02 // Отметка фиксации транзакции (данные - один нулевой байт)
+#define REC_COMMIT_SIZE (REC_LOG_HDR_SIZE + REC_LOG_ALIGN)
+
+typedef struct
+{
+    uint32_t magic;       // REC_LOG_MAGIC
+    uint32_t seq;         // Порядковый номер записи в журнале
+    uint8_t file_id;      // Индекс файла
+    uint8_t batch_total;  // Записей в пакете (1 - одиночная запись)
+    uint8_t batch_index;  // Номер записи в пакете
+    uint8_t len;          // Байт данных (1 ... SP_STORAGE_FILE_SIZE)
+    uint8_t kind;         // REC_KIND_*
+    uint8_t txn;          // Номер транзакции (REC_KIND_TXN, REC_KIND_COMMIT), иначе 0xFF
+    uint16_t crc;         // CRC-16 заголовка (до crc) и данных
+} rec_log_hdr_t;
+
+_Static_assert(sizeof(rec_log_hdr_t) == REC_LOG_HDR_SIZE, "Заголовок записи - 16 байт");
+_Static_assert(REC_LOG_HDR_SIZE % REC_LOG_ALIGN == 0, "Запись в зашифрованный раздел - блоками по 16 байт");
+_Static_assert(SP_STORAGE_FILE_SIZE <= 255, "Длина данных записи - 1 байт");
+_Static_assert(SP_STORAGE_FILE_COUNT <= 255, "Индекс файла - 1 байт");
+
+// Байт flash под записью с len байт данных
+static uint16_t rec_size(uint8_t len)
+{
+    return REC_LOG_HDR_SIZE + (len + REC_LOG_ALIGN - 1) / REC_LOG_ALIGN * REC_LOG_ALIGN;
+}
+
+// Хранимая часть файла: байт длины, шаблон и всё до последнего ненулевого байта
+static uint8_t rec_data_len(const uint8_t *data)
+{
+    uint16_t len = SP_STORAGE_FILE_SIZE;
+    while (len > 1 && data[len - 1] == 0)
+        len--;
+    uint16_t declared = (uint16_t)data[0] + 1;
+    if (declared > SP_STORAGE_FILE_SIZE)
+        declared = SP_STORAGE_FILE_SIZE;
+    return len > declared ? len : declared;
+}
+
+static uint32_t rec_offset(uint16_t sector, uint16_t pos)
+{
+    return (uint32_t)sector * REC_LOG_SECTOR_SIZE + pos;
+}
+
+static uint16_t rec_crc(const uint8_t *rec)
+{
+    const rec_log_hdr_t *hdr = (const rec_log_hdr_t *)rec;
+    uint16_t crc = sp_crc16_update(sp_crc16_init(), rec, offsetof(rec_log_hdr_t, crc));
+    return sp_crc16_final(sp_crc16_update(crc, rec + REC_LOG_HDR_SIZE, hdr->len));
+}
+
+// Место не записывалось (необработанное чтение: у зашифрованного раздела стёртый flash - 0xFF)
+static bool rec_raw_erased(const rec_log_t *log, uint32_t offset, uint16_t size)
+{
+    uint8_t raw[64];
+    while (size > 0)
+    {
+        uint16_t n = size < sizeof(raw) ? size : sizeof(raw);
+        if (esp_partition_read_raw(log->part, offset, raw, n) != ESP_OK)
+            return false;
+        for (int i = 0; i < n; i++)
+            if (raw[i] != 0xFF)
+                return false;
+        offset += n;
+        size -= n;
+    }
+    return true;
+}
+
+// Сектор с позиции pos до конца не записывался - записей дальше нет. Иначе на pos
+// оборванная запись (сбой питания): следующие записи ищутся с шагом REC_LOG_ALIGN
+static bool rec_tail_erased(const rec_log_t *log, uint16_t sector, uint16_t pos)
+{
+    return rec_raw_erased(log, rec_offset(sector, pos), REC_LOG_SECTOR_SIZE - pos);
+}
+
+// Чтение и проверка записи (rec - REC_LOG_REC_MAX байт): не выходит за сектор, CRC совпадает
+static bool rec_read_valid(const rec_log_t *log, uint32_t offset, uint8_t *rec)
+{
+    const rec_log_hdr_t *hdr = (const rec_log_hdr_t *)rec;
+    if (esp_partition_read(log->part, offset, rec, REC_LOG_HDR_SIZE) != ESP_OK ||
+        hdr->magic != REC_LOG_MAGIC || hdr->file_id >= SP_STORAGE_FILE_COUNT ||
+        hdr->len == 0 || hdr->len > SP_STORAGE_FILE_SIZE ||
+        offset % REC_LOG_SECTOR_SIZE + rec_size(hdr->len) > REC_LOG_SECTOR_SIZE)
+        return false;
+
+    return esp_partition_read(log->part, offset + REC_LOG_HDR_SIZE, rec + REC_LOG_HDR_SIZE, hdr->len) == ESP_OK &&
+           hdr->crc == rec_crc(rec);
+}
+
+static esp_err_t rec_erase_sector(rec_log_t *log, uint16_t sector)
+{
+    log->erases++;
+    return esp_partition_erase_range(log->part, (uint32_t)sector * REC_LOG_SECTOR_SIZE, REC_LOG_SECTOR_SIZE);
+}
+
+// Свободно в рабочем секторе
+static uint16_t rec_head_free(const rec_log_t *log)
+{
+    return REC_LOG_SECTOR_SIZE - log->head_pos;
+}
+
+// Каталог: файл теперь в записи offset с len байт данных
+static void rec_index_set(rec_log_t *log, uint8_t file_id, int32_t offset, uint8_t len)
+{
+    if (log->index[file_id] >= 0)
+        log->live -= rec_size(log->len[file_id]);
+    log->index[file_id] = offset;
+    log->len[file_id] = len;
+    log->live += rec_size(len);
+}
+
+// Добавление записи пакета в рабочий сектор (место есть), offset - её смещение
+static esp_err_t rec_append_batch(rec_log_t *log, uint8_t file_id, const uint8_t *data, uint8_t len,
+                                  uint8_t batch_total, uint8_t batch_index, uint8_t kind, uint8_t txn,
+                                  int32_t *offset_out)
+{
+    uint8_t rec[REC_LOG_REC_MAX];
+    uint16_t size = rec_size(len);
+    rec_log_hdr_t *hdr = (rec_log_hdr_t *)rec;
+    hdr->magic = REC_LOG_MAGIC;
+    hdr->seq = ++log->seq;
+    hdr->file_id = file_id;
+    hdr->batch_total = batch_total;
+    hdr->batch_index = batch_index;
+    hdr->len = len;
+    hdr->kind = kind;
+    hdr->txn = txn;
+    memcpy(rec + REC_LOG_HDR_SIZE, data, len);
+    memset(rec + REC_LOG_HDR_SIZE + len, 0xFF, size - REC_LOG_HDR_SIZE - len);
+    hdr->crc = rec_crc(rec);
+
+    uint32_t offset = rec_offset(log->head, log->head_pos);
+    log->head_pos += size; // Место занято и при ошибке записи
+    *offset_out = offset;
+    return esp_partition_write(log->part, offset, rec, size);
+}
+
+// Добавление одиночной записи с обновлением каталога
+static esp_err_t rec_append(rec_log_t *log, uint8_t file_id, const uint8_t *data, uint8_t len)
+{
+    int32_t offset;
+    esp_err_t err = rec_append_batch(log, file_id, data, len, 1, 0, REC_KIND_FILE, 0xFF, &offset);
+    if (err == ESP_OK)
+        rec_index_set(log, file_id, offset, len);
+    return err;
+}
+
+static uint8_t rec_batch_total(const rec_log_hdr_t *hdr)
+{
+    return (hdr->batch_total == 0 || hdr->batch_total == 0xFF) ? 1 : hdr->batch_total;
+}
+
+/**
+ * Пакет, начинающийся в позиции pos сектора, цел: все записи на месте, номера подряд.
+ * ids/offsets/lens/seqs - записи пакета
+ */
+static bool rec_batch_complete(const rec_log_t *log, uint16_t sector, uint16_t pos, const rec_log_hdr_t *first,
+                               uint8_t *ids, int32_t *offsets, uint8_t *lens, uint32_t *seqs)
+{
+    uint8_t total = rec_batch_total(first);
+    if (first->batch_index != 0 || total > REC_LOG_BATCH_MAX)
+        return false;
+
+    uint8_t rec[REC_LOG_REC_MAX];
+    const rec_log_hdr_t *hdr = (const rec_log_hdr_t *)rec;
+    for (uint8_t k = 0; k < total; k++)
+    {
+        uint32_t offset = rec_offset(sector, pos);
+        if (pos + REC_LOG_HDR_SIZE > REC_LOG_SECTOR_SIZE || !rec_read_valid(log, offset, rec) ||
+            hdr->batch_total != first->batch_total || hdr->batch_index != k || hdr->seq != first->seq + k ||
+            hdr->kind != first->kind || hdr->txn != first->txn)
+            return false;
+        ids[k] = hdr->file_id;
+        offsets[k] = offset;
+        lens[k] = hdr->len;
+        seqs[k] = hdr->seq;
+        pos += rec_size(hdr->len);
+    }
+    return true;
+}
+
+// Отметка фиксации транзакции txn - запись номер seq в позиции pos сектора (вплотную за пакетом)
+static bool rec_txn_committed(const rec_log_t *log, uint16_t sector, uint32_t pos, uint32_t seq, uint8_t txn)
+{
+    uint8_t rec[REC_LOG_REC_MAX];
+    const rec_log_hdr_t *hdr = (const rec_log_hdr_t *)rec;
+    return pos + REC_LOG_HDR_SIZE <= REC_LOG_SECTOR_SIZE && rec_read_valid(log, rec_offset(sector, pos), rec) &&
+           hdr->kind == REC_KIND_COMMIT && hdr->seq == seq && hdr->txn == txn;
+}
+
+static bool rec_in_sector(int32_t offset, uint16_t sector)
+{
+    return offset >= 0 && (uint32_t)offset / REC_LOG_SECTOR_SIZE == sector;
+}
+
+// Перенос живых записей сектора в рабочий (в порядке записи) и стирание сектора
+static esp_err_t rec_reclaim(rec_log_t *log, uint16_t sector)
+{
+    uint8_t rec[REC_LOG_REC_MAX];
+    const rec_log_hdr_t *hdr = (const rec_log_hdr_t *)rec;
+    uint16_t pos = 0;
+    while (pos + REC_LOG_HDR_SIZE <= REC_LOG_SECTOR_SIZE)
+    {
+        uint32_t offset = rec_offset(sector, pos);
+        if (!rec_read_valid(log, offset, rec))
+        {
+            if (rec_tail_erased(log, sector, pos))
+                break;
+            pos += REC_LOG_ALIGN;
+            continue;
+        }
+        pos += rec_size(hdr->len);
+        if (log->index[hdr->file_id] != (int32_t)offset)
+            continue;
+        if (rec_head_free(log) < rec_size(hdr->len))
+            return ESP_ERR_NO_MEM;
+        esp_err_t err = rec_append(log, hdr->file_id, rec + REC_LOG_HDR_SIZE, hdr->len);
+        if (err != ESP_OK)
+            return err;
+    }
+
+    // Живая запись, которую не удалось прочитать, - уплотнение решит по CRC
+    for (int f = 0; f < SP_STORAGE_FILE_COUNT; f++)
+        if (rec_in_sector(log->index[f], sector))
+            return ESP_ERR_INVALID_CRC;
+    return rec_erase_sector(log, sector);
+}
+
+// Уплотнение через RAM: все живые файлы - с сектора 0, остальные стёрты
+static esp_err_t rec_log_compact(rec_log_t *log)
+{
+    uint8_t *files = malloc(log->live ? log->live : 1);
+    if (!files)
+        return ESP_ERR_NO_MEM;
+
+    // Данные файлов подряд по индексу, длины - в каталоге (len = 0 - файла нет)
+    uint8_t rec[REC_LOG_REC_MAX];
+    const rec_log_hdr_t *hdr = (const rec_log_hdr_t *)rec;
+    uint32_t used = 0;
+    for (int f = 0; f < SP_STORAGE_FILE_COUNT; f++)
+    {
+        if (log->index[f] >= 0 && rec_read_valid(log, log->index[f], rec))
+        {
+            log->len[f] = hdr->len;
+            memcpy(files + used, rec + REC_LOG_HDR_SIZE, hdr->len);
+            used += hdr->len;
+        }
+        else
+        {
+            log->len[f] = 0;
+        }
+        log->index[f] = -1;
+    }
+    log->live = 0;
+
+    ESP_LOGW(TAG, "Уплотнение журнала '%s'", log->part->label);
+    esp_err_t err = ESP_OK;
+    for (uint16_t s = 0; s < log->sectors && err == ESP_OK; s++)
+        err = rec_erase_sector(log, s);
+
+    log->head = 0;
+    log->head_pos = 0;
+    used = 0;
+    for (int f = 0; f < SP_STORAGE_FILE_COUNT && err == ESP_OK; f++)
+    {
+        uint8_t len = log->len[f];
+        if (len == 0)
+            continue;
+        if (rec_head_free(log) < rec_size(len))
+        {
+            log->head++;
+            log->head_pos = 0;
+        }
+        if (log->head + 1 >= log->sectors)
+            err = ESP_ERR_NO_MEM; // Не помещается при запасном секторе (capacity)
+        else
+            err = rec_append(log, f, files + used, len);
+        used += len;
+    }
+
+    free(files);
+    return err;
+}
+
+// Рабочий сектор заполнен: переход на запасной, освобождение следующего
+static esp_err_t rec_rotate(rec_log_t *log)
+{
+    log->head = (log->head + 1) % log->sectors;
+    log->head_pos = 0;
+
+    esp_err_t err = rec_reclaim(log, (log->head + 1) % log->sectors);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Ошибка освобождения сектора '%s': 0x%x", log->part->label, err);
+        err = rec_log_compact(log);
+    }
+    return err;
+}
+
+// Место под size байт подряд в рабочем секторе
+static esp_err_t rec_reserve(rec_log_t *log, uint16_t size)
+{
+    esp_err_t err = ESP_OK;
+    // Перенесённые записи могли занять новый сектор - следующий переход
+    for (uint16_t i = 0; err == ESP_OK && rec_head_free(log) < size && i < log->sectors; i++)
+        err = rec_rotate(log);
+    if (err == ESP_OK && rec_head_free(log) < size)
+    {
+        // Место есть только суммарно - сбор живых записей в начало раздела,
+        // за ними - стёртые сектора
+        err = rec_log_compact(log);
+        if (err == ESP_OK && rec_head_free(log) < size && log->head + 2 < log->sectors)
+        {
+            log->head++;
+            log->head_pos = 0;
+        }
+        if (err == ESP_OK && rec_head_free(log) < size)
+            err = ESP_ERR_NO_MEM;
+    }
+    return err;
+}
+
+// Граница записей сектора: начало не записанного хвоста (оборванные записи - до неё).
+// Оборванная запись с целым заголовком пропускается на весь свой размер: новая запись
+// в её не записанном хвосте могла бы дописать недостающие байты и совпасть по CRC
+static uint16_t rec_sector_end(const rec_log_t *log, uint16_t sector)
+{
+    uint8_t rec[REC_LOG_REC_MAX];
+    const rec_log_hdr_t *hdr = (const rec_log_hdr_t *)rec;
+    uint16_t pos = 0;
+    while (pos + REC_LOG_HDR_SIZE <= REC_LOG_SECTOR_SIZE)
+    {
+        if (rec_read_valid(log, rec_offset(sector, pos), rec))
+            pos += rec_size(hdr->len);
+        else if (rec_tail_erased(log, sector, pos))
+            return pos;
+        else if (hdr->magic == REC_LOG_MAGIC && hdr->len > 0 && hdr->len <= SP_STORAGE_FILE_SIZE)
+            pos += rec_size(hdr->len);
+        else
+            pos += REC_LOG_ALIGN;
+    }
+    return REC_LOG_SECTOR_SIZE;
+}
+
+esp_err_t rec_log_mount(rec_log_t *log, const esp_partition_t *part)
+{
+    SemaphoreHandle_t lock = log->lock;
+    memset(log, 0, sizeof(*log));
+    log->lock = lock;
+    log->part = part;
+    log->sectors = part->size / REC_LOG_SECTOR_SIZE;
+    for (int f = 0; f < SP_STORAGE_FILE_COUNT; f++)
+        log->index[f] = -1;
+
+    if (log->sectors < REC_LOG_MIN_SECTORS)
+        return ESP_ERR_INVALID_SIZE;
+
+    // Запасной сектор не считается, в каждом рабочем - запас на самую длинную запись
+    log->capacity = (uint32_t)(log->sectors - 1) * (REC_LOG_SECTOR_SIZE - REC_LOG_REC_MAX);
+
+    if (!log->lock)
+        log->lock = xSemaphoreCreateMutex();
+    if (!log->lock)
+        return ESP_ERR_NO_MEM;
+
+    const void *map = NULL;
+    if (esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA, &map, &log->map_handle) == ESP_OK)
+        log->map = map;
+    else
+        ESP_LOGW(TAG, "Журнал '%s': нет отображения в память - чтение копией", part->label);
+
+    uint32_t *file_seq = calloc(SP_STORAGE_FILE_COUNT, sizeof(uint32_t));
+    if (!file_seq)
+        return ESP_ERR_NO_MEM;
+
+    // Построение каталога: для каждого файла - запись с наибольшим номером
+    uint8_t rec[REC_LOG_REC_MAX];
+    uint32_t head_seq = 0;
+    bool found = false;
+    uint32_t commit_seq = 0; // Последняя отметка фиксации
+    bool commit_found = false;
+    uint32_t pending_seq = 0; // Последняя запись последнего пакета транзакции без отметки
+    bool pending_found = false;
+    uint8_t batch_ids[REC_LOG_BATCH_MAX];
+    int32_t batch_offsets[REC_LOG_BATCH_MAX];
+    uint8_t batch_lens[REC_LOG_BATCH_MAX];
+    uint32_t batch_seqs[REC_LOG_BATCH_MAX];
+    for (uint16_t s = 0; s < log->sectors; s++)
+    {
+        uint16_t pos = 0;
+        while (pos + REC_LOG_HDR_SIZE <= REC_LOG_SECTOR_SIZE)
+        {
+            uint32_t offset = rec_offset(s, pos);
+            if (!rec_read_valid(log, offset, rec))
+            {
+                if (rec_tail_erased(log, s, pos))
+                    break;
+                pos += REC_LOG_ALIGN;
+                continue;
+            }
+
+            const rec_log_hdr_t *hdr = (const rec_log_hdr_t *)rec;
+            uint16_t here = pos;
+            pos += rec_size(hdr->len);
+            if (!found || (int32_t)(hdr->seq - head_seq) > 0)
+            {
+                head_seq = hdr->seq;
+                log->head = s;
+            }
+            found = true;
+
+            if (hdr->kind == REC_KIND_COMMIT)
+            {
+                if (!commit_found || (int32_t)(hdr->seq - commit_seq) > 0)
+                {
+                    commit_seq = hdr->seq;
+                    log->txn = hdr->txn;
+                    commit_found = true;
+                }
+                continue;
+            }
+
+            // Пакет применяется целиком по первой записи, остальные его записи пропускаются
+            uint8_t total = 1;
+            batch_ids[0] = hdr->file_id;
+            batch_offsets[0] = offset;
+            batch_lens[0] = hdr->len;
+            batch_seqs[0] = hdr->seq;
+            if (rec_batch_total(hdr) > 1)
+            {
+                if (!rec_batch_complete(log, s, here, hdr, batch_ids, batch_offsets, batch_lens, batch_seqs))
+                    continue;
+                total = rec_batch_total(hdr);
+            }
+
+            // Пакет транзакции без отметки фиксации не применяется. Последний - если после
+            // него в журнале нет отметок - ждёт решения rec_log_txn_recover()
+            if (hdr->kind == REC_KIND_TXN)
+            {
+                uint32_t last = batch_seqs[total - 1];
+                uint32_t end = batch_offsets[total - 1] + rec_size(batch_lens[total - 1]) - rec_offset(s, 0);
+                if (!rec_txn_committed(log, s, end, last + 1, hdr->txn))
+                {
+                    if (!pending_found || (int32_t)(last - pending_seq) > 0)
+                    {
+                        pending_seq = last;
+                        pending_found = true;
+                        log->txn_pending_id = hdr->txn;
+                        log->txn_count = total;
+                        memcpy(log->txn_ids, batch_ids, total);
+                        memcpy(log->txn_offsets, batch_offsets, total * sizeof(batch_offsets[0]));
+                        memcpy(log->txn_lens, batch_lens, total);
+                    }
+                    continue;
+                }
+            }
+
+            for (uint8_t k = 0; k < total; k++)
+            {
+                uint8_t f = batch_ids[k];
+                if (log->index[f] < 0 || (int32_t)(batch_seqs[k] - file_seq[f]) > 0)
+                {
+                    rec_index_set(log, f, batch_offsets[k], batch_lens[k]);
+                    file_seq[f] = batch_seqs[k];
+                }
+            }
+        }
+    }
+    free(file_seq);
+
+    if (!found)
+    {
+        // Пустой раздел или раздел прежнего формата - очистка только записанных
+        // секторов: чистый раздел (журнал без файлов) не стирается при каждом включении
+        uint16_t erased = 0;
+        for (uint16_t s = 0; s < log->sectors; s++)
+        {
+            if (rec_raw_erased(log, rec_offset(s, 0), REC_LOG_SECTOR_SIZE))
+                continue;
+            esp_err_t err = rec_erase_sector(log, s);
+            if (err != ESP_OK)
+                return err;
+            erased++;
+        }
+        if (erased)
+            ESP_LOGW(TAG, "Журнал '%s' пуст - форматирование, стёрто секторов: %d", part->label, erased);
+        return ESP_OK;
+    }
+
+    log->seq = head_seq;
+    log->head_pos = rec_sector_end(log, log->head);
+    log->txn_pending = pending_found && (!commit_found || (int32_t)(pending_seq - commit_seq) > 0);
+
+    // Сбой питания при переходе на новый сектор: следующий за рабочим не стёрт
+    uint16_t spare = (log->head + 1) % log->sectors;
+    if (!rec_raw_erased(log, rec_offset(spare, 0), REC_LOG_SECTOR_SIZE))
+    {
+        ESP_LOGW(TAG, "Журнал '%s': освобождение сектора %d", part->label, spare);
+        esp_err_t err = rec_reclaim(log, spare);
+        if (err != ESP_OK)
+            err = rec_log_compact(log);
+        if (err != ESP_OK)
+            return err;
+    }
+
+    ESP_LOGI(TAG, "Журнал '%s': рабочий сектор %d, занято %d/%d, файлы %lu/%lu байт, номер %lu", part->label,
+             log->head, log->head_pos, REC_LOG_SECTOR_SIZE, (unsigned long)log->live,
+             (unsigned long)log->capacity, (unsigned long)log->seq);
+    return ESP_OK;
+}
+
+const uint8_t *rec_log_view_begin(rec_log_t *log, uint8_t file_id)
+{
+    if (!log->part || file_id >= SP_STORAGE_FILE_COUNT)
+        return NULL;
+
+    xSemaphoreTake(log->lock, portMAX_DELAY);
+    int32_t offset = log->index[file_id];
+    if (offset < 0)
+        return rec_log_empty;
+    if (log->map)
+        return log->map + offset + REC_LOG_HDR_SIZE;
+
+    uint8_t len = log->len[file_id];
+    if (esp_partition_read(log->part, offset + REC_LOG_HDR_SIZE, log->view_buf, len) != ESP_OK)
+        return rec_log_empty;
+    memset(log->view_buf + len, 0, SP_STORAGE_FILE_SIZE - len);
+    return log->view_buf;
+}
+
+void rec_log_view_end(rec_log_t *log)
+{
+    xSemaphoreGive(log->lock);
+}
+
+esp_err_t rec_log_read(rec_log_t *log, uint8_t file_id, uint8_t *data)
+{
+    const uint8_t *view = rec_log_view_begin(log, file_id);
+    if (!view)
+        return ESP_ERR_INVALID_ARG;
+    uint8_t len = log->index[file_id] < 0 ? 0 : log->len[file_id];
+    memcpy(data, view, len);
+    memset(data + len, 0, SP_STORAGE_FILE_SIZE - len);
+    rec_log_view_end(log);
+    return ESP_OK;
+}
+
+// Живых байт после замены файлов ids новыми записями lens
+static uint32_t rec_live_after(const rec_log_t *log, const uint8_t *ids, const uint8_t *lens, uint8_t count)
+{
+    uint32_t live = log->live;
+    for (uint8_t k = 0; k < count; k++)
+    {
+        if (log->index[ids[k]] >= 0)
+            live -= rec_size(log->len[ids[k]]);
+        live += rec_size(lens[k]);
+    }
+    return live;
+}
+
+// Запись файла; may_erase = false - только в свободное место рабочего сектора
+static esp_err_t rec_write(rec_log_t *log, uint8_t file_id, const uint8_t *data, bool may_erase)
+{
+    if (!log->part || file_id >= SP_STORAGE_FILE_COUNT)
+        return ESP_ERR_INVALID_ARG;
+
+    uint8_t len = rec_data_len(data);
+    esp_err_t err = ESP_OK;
+    xSemaphoreTake(log->lock, portMAX_DELAY);
+    if (rec_live_after(log, &file_id, &len, 1) > log->capacity)
+    {
+        ESP_LOGE(TAG, "Журнал '%s' заполнен: файл %d не записан", log->part->label, file_id);
+        err = ESP_ERR_NO_MEM;
+    }
+    if (err == ESP_OK && !may_erase && rec_head_free(log) < rec_size(len))
+        err = ESP_ERR_INVALID_STATE;
+    if (err == ESP_OK)
+        err = rec_reserve(log, rec_size(len));
+    if (err == ESP_OK)
+        err = rec_append(log, file_id, data, len);
+    xSemaphoreGive(log->lock);
+    return err;
+}
+
+esp_err_t rec_log_write(rec_log_t *log, uint8_t file_id, const uint8_t *data)
+{
+    return rec_write(log, file_id, data, true);
+}
+
+esp_err_t rec_log_write_no_erase(rec_log_t *log, uint8_t file_id, const uint8_t *data)
+{
+    return rec_write(log, file_id, data, false);
+}
+
+esp_err_t rec_log_make_room(rec_log_t *log)
+{
+    if (!log->part)
+        return ESP_ERR_INVALID_STATE;
+
+    esp_err_t err = ESP_OK;
+    xSemaphoreTake(log->lock, portMAX_DELAY);
+    if (rec_head_free(log) < REC_LOG_REC_MAX)
+        err = rec_reserve(log, REC_LOG_REC_MAX);
+    xSemaphoreGive(log->lock);
+    return err;
+}
+
+// Проверка пакета: индексы в диапазоне и не повторяются; lens - длины записей, size - их байт flash
+static esp_err_t rec_batch_check(const uint8_t *ids, const uint8_t *data, uint8_t count,
+                                 uint8_t *lens, uint16_t *size)
+{
+    if (count == 0 || count > REC_LOG_BATCH_MAX)
+        return ESP_ERR_INVALID_ARG;
+
+    *size = 0;
+    for (uint8_t k = 0; k < count; k++)
+    {
+        if (ids[k] >= SP_STORAGE_FILE_COUNT)
+            return ESP_ERR_INVALID_ARG;
+        for (uint8_t j = 0; j < k; j++)
+            if (ids[j] == ids[k])
+                return ESP_ERR_INVALID_ARG;
+        lens[k] = rec_data_len(data + k * SP_STORAGE_FILE_SIZE);
+        *size += rec_size(lens[k]);
+    }
+    return ESP_OK;
+}
+
+// Пакет подряд в одном секторе (журнал заблокирован); за пакетом в том же секторе
+// остаётся reserve байт. Каталог не изменяется
+static esp_err_t rec_batch_append(rec_log_t *log, const uint8_t *ids, const uint8_t *data, const uint8_t *lens,
+                                  uint8_t count, uint16_t size, uint16_t reserve, uint8_t kind, uint8_t txn,
+                                  int32_t *offsets)
+{
+    if (rec_live_after(log, ids, lens, count) > log->capacity)
+    {
+        ESP_LOGE(TAG, "Журнал '%s' заполнен: пакет из %d файлов не записан", log->part->label, count);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Пакет - подряд в одном секторе: не помещается - переход на следующий
+    esp_err_t err = rec_reserve(log, size + reserve);
+    for (uint8_t k = 0; k < count && err == ESP_OK; k++)
+        err = rec_append_batch(log, ids[k], data + k * SP_STORAGE_FILE_SIZE, lens[k], count, k, kind, txn,
+                               &offsets[k]);
+    return err;
+}
+
+esp_err_t rec_log_write_batch(rec_log_t *log, const uint8_t *ids, const uint8_t *data, uint8_t count)
+{
+    uint8_t lens[REC_LOG_BATCH_MAX];
+    uint16_t size;
+    esp_err_t err = rec_batch_check(ids, data, count, lens, &size);
+    if (!log->part)
+        err = ESP_ERR_INVALID_ARG;
+    if (err != ESP_OK)
+        return err;
+
+    xSemaphoreTake(log->lock, portMAX_DELAY);
+    int32_t offsets[REC_LOG_BATCH_MAX];
+    err = rec_batch_append(log, ids, data, lens, count, size, 0, REC_KIND_FILE, 0xFF, offsets);
+
+    // Каталог - только после записи всего пакета
+    if (err == ESP_OK)
+        for (uint8_t k = 0; k < count; k++)
+            rec_index_set(log, ids[k], offsets[k], lens[k]);
+
+    xSemaphoreGive(log->lock);
+    return err;
+}
+
+// Пакет транзакции txn: в каталог - только по отметке фиксации (rec_txn_commit),
+// место под отметку - вплотную за пакетом
+static esp_err_t rec_txn_put(rec_log_t *log, uint8_t txn, const uint8_t *ids, const uint8_t *data, uint8_t count)
+{
+    uint8_t lens[REC_LOG_BATCH_MAX];
+    uint16_t size;
+    esp_err_t err = rec_batch_check(ids, data, count, lens, &size);
+    if (err != ESP_OK)
+        return err;
+
+    xSemaphoreTake(log->lock, portMAX_DELAY);
+    err = rec_batch_append(log, ids, data, lens, count, size, REC_COMMIT_SIZE, REC_KIND_TXN, txn, log->txn_offsets);
+    if (err == ESP_OK)
+    {
+        log->txn_pending = true;
+        log->txn_pending_id = txn;
+        log->txn_count = count;
+        memcpy(log->txn_ids, ids, count);
+        memcpy(log->txn_lens, lens, count);
+    }
+    xSemaphoreGive(log->lock);
+    return err;
+}
+
+// Отметка фиксации без пакета (журнал заблокирован)
+static esp_err_t rec_txn_mark(rec_log_t *log, uint8_t txn)
+{
+    int32_t offset;
+    esp_err_t err = rec_reserve(log, REC_COMMIT_SIZE);
+    if (err == ESP_OK)
+        err = rec_append_batch(log, 0, rec_log_empty, 1, 1, 0, REC_KIND_COMMIT, txn, &offset);
+    return err;
+}
+
+// Номер записи по смещению (0 - не читается)
+static uint32_t rec_seq_at(const rec_log_t *log, int32_t offset)
+{
+    rec_log_hdr_t hdr;
+    if (offset < 0 || esp_partition_read(log->part, offset, &hdr, sizeof(hdr)) != ESP_OK)
+        return 0;
+    return hdr.seq;
+}
+
+// Файлы пакета транзакции - обычным пакетом (журнал заблокирован): отметку уже не
+// поставить вплотную за ним (обрыв питания при её записи или её повторной записи).
+// Файлы, записанные после пакета, не заменяются
+static esp_err_t rec_txn_rewrite(rec_log_t *log)
+{
+    uint32_t txn_seq = rec_seq_at(log, log->txn_offsets[log->txn_count - 1]);
+    uint8_t *data = calloc(log->txn_count, SP_STORAGE_FILE_SIZE);
+    if (!data)
+        return ESP_ERR_NO_MEM;
+
+    esp_err_t err = ESP_OK;
+    uint8_t ids[REC_LOG_BATCH_MAX];
+    uint8_t count = 0;
+    for (uint8_t k = 0; k < log->txn_count && err == ESP_OK; k++)
+    {
+        uint8_t f = log->txn_ids[k];
+        if (log->index[f] >= 0 && (int32_t)(rec_seq_at(log, log->index[f]) - txn_seq) > 0)
+            continue;
+        ids[count] = f;
+        err = esp_partition_read(log->part, log->txn_offsets[k] + REC_LOG_HDR_SIZE,
+                                 data + count * SP_STORAGE_FILE_SIZE, log->txn_lens[k]);
+        count++;
+    }
+
+    uint8_t lens[REC_LOG_BATCH_MAX];
+    uint16_t size;
+    int32_t offsets[REC_LOG_BATCH_MAX];
+    if (err == ESP_OK && count > 0)
+    {
+        err = rec_batch_check(ids, data, count, lens, &size);
+        if (err == ESP_OK)
+            err = rec_batch_append(log, ids, data, lens, count, size, 0, REC_KIND_FILE, 0xFF, offsets);
+        if (err == ESP_OK)
+            for (uint8_t k = 0; k < count; k++)
+                rec_index_set(log, ids[k], offsets[k], lens[k]);
+    }
+    free(data);
+    return err;
+}
+
+// Фиксация транзакции txn: отметка вплотную за её пакетом и пакет - в каталог
+static esp_err_t rec_txn_commit(rec_log_t *log, uint8_t txn)
+{
+    esp_err_t err = ESP_OK;
+    xSemaphoreTake(log->lock, portMAX_DELAY);
+    if (!log->txn_pending)
+    {
+        // Файлов транзакции в журнале нет - только отметка
+        err = rec_txn_mark(log, txn);
+    }
+    else
+    {
+        uint8_t last = log->txn_count - 1;
+        uint32_t end = log->txn_offsets[last] + rec_size(log->txn_lens[last]);
+        int32_t offset;
+        if (log->txn_pending_id == txn && rec_offset(log->head, log->head_pos) == end &&
+            rec_head_free(log) >= REC_COMMIT_SIZE)
+            err = rec_append_batch(log, 0, rec_log_empty, 1, 1, 0, REC_KIND_COMMIT, txn, &offset);
+        else
+            err = ESP_ERR_INVALID_STATE;
+
+        if (err == ESP_OK)
+        {
+            for (uint8_t k = 0; k < log->txn_count; k++)
+                rec_index_set(log, log->txn_ids[k], log->txn_offsets[k], log->txn_lens[k]);
+        }
+        else
+        {
+            ESP_LOGW(TAG, "Журнал '%s': транзакция %d - перезапись пакета", log->part->label, txn);
+            err = rec_txn_rewrite(log);
+            if (err == ESP_OK)
+                err = rec_txn_mark(log, txn);
+        }
+    }
+    if (err == ESP_OK)
+    {
+        log->txn = txn;
+        log->txn_pending = false;
+    }
+    xSemaphoreGive(log->lock);
+    return err;
+}
+
+// Отмена: пакет остаётся во flash без отметки и не применяется
+static void rec_txn_abort(rec_log_t *log)
+{
+    xSemaphoreTake(log->lock, portMAX_DELAY);
+    log->txn_pending = false;
+    xSemaphoreGive(log->lock);
+}
+
+esp_err_t rec_log_write_txn(rec_log_t *first, const uint8_t *first_ids, const uint8_t *first_data,
+                            uint8_t first_count, rec_log_t *second, const uint8_t *second_ids,
+                            const uint8_t *second_data, uint8_t second_count)
+{
+    if (!first->part || !second->part || first_count + second_count == 0)
+        return ESP_ERR_INVALID_ARG;
+
+    // Номер - не совпадающий с пакетами без отметки: отменённый пакет, оставшийся
+    // последним в журнале, не должен получить чужую отметку
+    uint8_t txn = first->txn + 1;
+    while (txn == first->txn_pending_id || txn == second->txn_pending_id)
+        txn++;
+    esp_err_t err = ESP_OK;
+    if (first_count)
+        err = rec_txn_put(first, txn, first_ids, first_data, first_count);
+    if (err == ESP_OK && second_count)
+        err = rec_txn_put(second, txn, second_ids, second_data, second_count);
+
+    // Точка фиксации - отметка в первом журнале: до неё после сбоя не применяется ни один пакет
+    if (err == ESP_OK)
+        err = rec_txn_commit(first, txn);
+    if (err != ESP_OK)
+    {
+        rec_txn_abort(first);
+        rec_txn_abort(second);
+        return err;
+    }
+
+    // Пакет второго журнала без отметки после сбоя применит rec_log_txn_recover()
+    if (second_count)
+        err = rec_txn_commit(second, txn);
+    return err;
+}
+
+esp_err_t rec_log_txn_recover(rec_log_t *first, rec_log_t *second)
+{
+    // Пакет первого журнала без отметки - транзакция не зафиксирована
+    if (first->txn_pending)
+        ESP_LOGW(TAG, "Журнал '%s': транзакция %d не зафиксирована - отменена", first->part->label,
+                 first->txn_pending_id);
+    rec_txn_abort(first);
+
+    if (!second->txn_pending)
+        return ESP_OK;
+    if (second->txn_pending_id != first->txn)
+    {
+        ESP_LOGW(TAG, "Журнал '%s': транзакция %d не зафиксирована - отменена", second->part->label,
+                 second->txn_pending_id);
+        rec_txn_abort(second);
+        return ESP_OK;
+    }
+    ESP_LOGW(TAG, "Журнал '%s': завершение транзакции %d", second->part->label, first->txn);
+    return rec_txn_commit(second, first->txn);
+}
@@ -0,0 +1,159 @@
+/*=====================================================================================
+ * Description:
+ *  Журнальное хранилище файлов (шаблонов) в разделе flash
+ *
+ *  Раздел - кольцо секторов по 4 КБ, файл записывается в конец журнала записью
+ *  переменной длины: заголовок (метка, порядковый номер, индекс, длина, CRC) и
+ *  данные без хвоста нулей - шаблон из 20 байт занимает 48 байт flash, а не
+ *  SP_STORAGE_FILE_SIZE. Каталог в RAM (index/len по индексу файла - поиск за O(1))
+ *  хранит смещение и длину последней записи каждого файла и строится при
+ *  монтировании. Сектор стирается только при переходе журнала на следующий
+ *  сектор: живые записи самого старого сектора переносятся в новый, после чего
+ *  он стирается.
+ *
+ *  Размер раздела задаётся только в partitions.csv (секторов - сколько в нём
+ *  поместится), файлов - до SP_STORAGE_FILE_COUNT. Записи и заголовки кратны
+ *  16 байтам (раздел может быть зашифрован), свободное место определяется по
+ *  необработанному чтению (esp_partition_read_raw).
+ *
+ *  Раздел отображается в память при монтировании (esp_partition_mmap): читатели
+ *  получают указатель на данные записи без копирования и без esp_partition_read
+ *  (расшифровка - аппаратно, через кэш). Указатель действителен между
+ *  rec_log_view_begin() и rec_log_view_end() - запись журнала (и стирание сектора)
+ *  в это время ждёт.
+ *
+ *  Транзакция двух журналов (request и response): после сбоя питания применены
+ *  либо файлы обоих пакетов, либо ни одного (rec_log_write_txn, rec_log_txn_recover).
+ *====================================================================================*/
+#ifndef _REC_LOG_H_
+#define _REC_LOG_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_partition.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "project_config.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define REC_LOG_MAGIC 0x53504632UL                                  // "SPF2"
+#define REC_LOG_HDR_SIZE 16                                         // Заголовок записи
+#define REC_LOG_ALIGN 16                                            // Кратность записи
+#define REC_LOG_REC_MAX (REC_LOG_HDR_SIZE + SP_STORAGE_FILE_SIZE)   // Самая длинная запись (208 байт)
+#define REC_LOG_SECTOR_SIZE 4096
+#define REC_LOG_MIN_SECTORS 3                                       // Рабочий, запасной и ещё один
+#define REC_LOG_BATCH_MAX (REC_LOG_SECTOR_SIZE / REC_LOG_REC_MAX)   // Записей в пакете (19)
+
+    typedef struct
+    {
+        const esp_partition_t *part;
+        SemaphoreHandle_t lock;
+        uint16_t sectors;                       // Секторов в разделе
+        uint16_t head;                          // Сектор, в который идёт запись
+        uint16_t head_pos;                      // Первый свободный байт в нём
+        uint32_t seq;                           // Номер последней записи
+        int32_t index[SP_STORAGE_FILE_COUNT];   // Каталог: смещение последней записи файла (-1 - нет)
+        uint8_t len[SP_STORAGE_FILE_COUNT];     // Каталог: байт данных в записи
+        uint32_t live;                          // Байт flash под последними записями файлов
+        uint32_t capacity;                      // Предел live, при котором переход всегда найдёт место
+        uint32_t erases;                        // Стираний секторов с момента монтирования
+        const uint8_t *map;                     // Отображение раздела (NULL - чтение копией)
+        esp_partition_mmap_handle_t map_handle;
+        uint8_t view_buf[SP_STORAGE_FILE_SIZE]; // Копия файла, если отображения нет
+
+        // Транзакция двух журналов
+        uint8_t txn;                            // Номер последней отметки фиксации
+        bool txn_pending;                       // Пакет транзакции записан, отметки нет (не в каталоге)
+        uint8_t txn_pending_id;                 // Номер последнего пакета без отметки (и после отмены)
+        uint8_t txn_count;                      // Его записи
+        uint8_t txn_ids[REC_LOG_BATCH_MAX];
+        int32_t txn_offsets[REC_LOG_BATCH_MAX];
+        uint8_t txn_lens[REC_LOG_BATCH_MAX];
+    } rec_log_t;
+
+    /**
+     * @brief Монтирование: построение индекса, восстановление после сбоя питания
+     * @note  Раздел без записей журнала (пустой или старого формата) очищается
+     */
+    esp_err_t rec_log_mount(rec_log_t *log, const esp_partition_t *part);
+
+    /**
+     * @brief Чтение файла (SP_STORAGE_FILE_SIZE байт, не хранимый хвост - нули)
+     * @note  Файла нет - данные нулевые (длина 0), ESP_OK
+     */
+    esp_err_t rec_log_read(rec_log_t *log, uint8_t file_id, uint8_t *data);
+
+    /**
+     * @brief Данные файла без копирования
+     * @note  Действительны 1 + data[0] байт (байт длины и шаблон, не больше
+     *        SP_STORAGE_FILE_SIZE), дальше - следующая запись журнала
+     * @return NULL - неверный индекс (rec_log_view_end не вызывается);
+     *         файла нет - нулевые данные
+     * @note  Журнал заблокирован до rec_log_view_end()
+     */
+    const uint8_t *rec_log_view_begin(rec_log_t *log, uint8_t file_id);
+
+    /**
+     * @brief Конец работы с данными rec_log_view_begin()
+     */
+    void rec_log_view_end(rec_log_t *log);
+
+    /**
+     * @brief Запись файла в конец журнала
+     * @param data SP_STORAGE_FILE_SIZE байт; хранятся байт длины, шаблон и данные
+     *             за ним до последнего ненулевого байта
+     * @return ESP_ERR_NO_MEM - файлы не помещаются в раздел (capacity)
+     */
+    esp_err_t rec_log_write(rec_log_t *log, uint8_t file_id, const uint8_t *data);
+
+    /**
+     * @brief Запись файла без стирания секторов (ответ мастеру ждёт записи)
+     * @return ESP_ERR_INVALID_STATE - в рабочем секторе нет места, нужен переход
+     *         (rec_log_make_room); файл не записан
+     */
+    esp_err_t rec_log_write_no_erase(rec_log_t *log, uint8_t file_id, const uint8_t *data);
+
+    /**
+     * @brief Переход на следующий сектор заранее: в рабочем секторе нет места под
+     *        самую длинную запись (стирание сектора и перенос его записей)
+     */
+    esp_err_t rec_log_make_room(rec_log_t *log);
+
+    /**
+     * @brief Запись нескольких файлов одним пакетом: после сбоя питания видны
+     *        либо все файлы пакета, либо ни одного
+     * @param ids  индексы файлов (count штук)
+     * @param data данные файлов подряд, count * SP_STORAGE_FILE_SIZE байт
+     * @param count 1 ... REC_LOG_BATCH_MAX, индексы не повторяются
+     */
+    esp_err_t rec_log_write_batch(rec_log_t *log, const uint8_t *ids, const uint8_t *data, uint8_t count);
+
+    /**
+     * @brief Транзакция двух журналов: пакет first и пакет second применяются оба или
+     *        ни один, в том числе после сбоя питания
+     * @param first_count, second_count 0 ... REC_LOG_BATCH_MAX (пустой пакет не пишется)
+     * @note  Ошибка до фиксации - не применён ни один пакет. Ошибка фиксации second -
+     *        пакет second применит rec_log_txn_recover() после перезапуска
+     */
+    esp_err_t rec_log_write_txn(rec_log_t *first, const uint8_t *first_ids, const uint8_t *first_data,
+                                uint8_t first_count, rec_log_t *second, const uint8_t *second_ids,
+                                const uint8_t *second_data, uint8_t second_count);
+
+    /**
+     * @brief Завершение транзакции, прерванной сбросом: пакет second применяется, если
+     *        зафиксирован пакет first, иначе отменяется
+     * @note  Вызывается после монтирования обоих журналов, до записи в них
+     */
+    esp_err_t rec_log_txn_recover(rec_log_t *first, rec_log_t *second);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _REC_LOG_H_
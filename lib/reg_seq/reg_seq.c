@@ -0,0 +1,230 @@
+/**
+ * Согласованные снимки регистров Modbus.
+ *
+ * Счётчик reg_seq чётный - регистры в покое, нечётный - идёт групповая запись.
+ * Писатель: spinlock -> seq+1 -> регистры -> seq+1. Внутри критической секции
+ * писателя не вытесняет ни задача, ни прерывание того же ядра, поэтому читатель
+ * на том же ядре никогда не застаёт запись, а читатель на другом ядре ждёт
+ * несколько микросекунд (96 слов).
+ *
+ * Поколения блоков по 32 регистра растут внутри той же критической секции, до
+ * второго шага счётчика. Для групповой записи без диапазона (begin/end) растут
+ * поколения всех блоков: такие записи редки (диагностика после транзакции,
+ * чтение файлов и конфигурации, запись 0x10), и обычно рядом с ними меняется и
+ * окно результата.
+ *
+ * Для окна результата хранится копия предыдущего результата: карта изменённых
+ * блоков строится сравнением внутри той же критической секции. Окна
+ * дополнительных абонентов хранятся здесь же и пишутся под тем же счётчиком.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include "reg_seq.h"
+#include "freertos/FreeRTOS.h"
+#include <string.h>
+
+extern uint16_t regs[];
+
+static volatile uint32_t reg_seq;
+static portMUX_TYPE reg_seq_mux = portMUX_INITIALIZER_UNLOCKED;
+
+#define REG_SEQ_GEN_SHIFT 5 // Блок поколения - 32 регистра
+#define REG_SEQ_GEN_BLOCKS (TOTAL_REGS >> REG_SEQ_GEN_SHIFT)
+_Static_assert(TOTAL_REGS % (1 << REG_SEQ_GEN_SHIFT) == 0, "regs[] - целое число блоков поколения");
+static volatile uint32_t block_gen[REG_SEQ_GEN_BLOCKS];
+
+_Static_assert(MAX_READ_REGS == 16 * RESULT_BLOCK_REGS, "REG_RESULT_CHANGED: 16 блоков окна");
+static uint16_t result_prev[MAX_READ_REGS]; // Окно 0x20+ на момент прошлого результата
+
+// Окна результата дополнительных абонентов (абонент N - элемент N - 1)
+typedef struct
+{
+    uint16_t gen;
+    uint16_t changed;
+    uint16_t window[MAX_READ_REGS];
+} reg_seq_unit_t;
+
+static reg_seq_unit_t unit_results[SP_UNIT_COUNT];
+static int result_unit = 0; // Только uart2_task
+
+void reg_seq_write_begin(void)
+{
+    portENTER_CRITICAL(&reg_seq_mux);
+    __atomic_store_n(&reg_seq, reg_seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+// Поколение блоков диапазона (писатель - под reg_seq_mux)
+static void reg_seq_mark(uint16_t start_reg, uint16_t count)
+{
+    uint16_t last = (start_reg + count - 1) >> REG_SEQ_GEN_SHIFT;
+    for (uint16_t b = start_reg >> REG_SEQ_GEN_SHIFT; b <= last && b < REG_SEQ_GEN_BLOCKS; b++)
+        __atomic_store_n(&block_gen[b], block_gen[b] + 1, __ATOMIC_RELAXED);
+}
+
+// Конец записи с известным диапазоном
+static void reg_seq_write_end_marked(void)
+{
+    __atomic_store_n(&reg_seq, reg_seq + 1, __ATOMIC_RELEASE);
+    portEXIT_CRITICAL(&reg_seq_mux);
+}
+
+void reg_seq_write_end(void)
+{
+    reg_seq_mark(0, TOTAL_REGS);
+    reg_seq_write_end_marked();
+}
+
+void reg_seq_touch(uint16_t start_reg, uint16_t count)
+{
+    if (count == 0)
+        return;
+    portENTER_CRITICAL(&reg_seq_mux);
+    reg_seq_mark(start_reg, count);
+    portEXIT_CRITICAL(&reg_seq_mux);
+}
+
+uint32_t reg_seq_gen(uint16_t start_reg, uint16_t count)
+{
+    // Сумма поколений блоков: меняется, если изменилось любое из них
+    uint32_t gen = 0;
+    uint16_t last = (start_reg + count - 1) >> REG_SEQ_GEN_SHIFT;
+    for (uint16_t b = start_reg >> REG_SEQ_GEN_SHIFT; b <= last && b < REG_SEQ_GEN_BLOCKS; b++)
+        gen += __atomic_load_n(&block_gen[b], __ATOMIC_ACQUIRE);
+    return gen;
+}
+
+// Карта изменённых блоков и номер результата окна 0x20+ (писатель - под reg_seq_mux)
+static void reg_seq_result_publish(void)
+{
+    uint16_t changed = 0;
+    for (int b = 0; b < 16; b++)
+    {
+        const uint16_t *cur = &regs[HLD_READ_REG + b * RESULT_BLOCK_REGS];
+        uint16_t *prev = &result_prev[b * RESULT_BLOCK_REGS];
+        if (memcmp(cur, prev, RESULT_BLOCK_REGS * sizeof(uint16_t)) != 0)
+        {
+            memcpy(prev, cur, RESULT_BLOCK_REGS * sizeof(uint16_t));
+            changed |= 1u << b;
+        }
+    }
+    REG_RESULT_CHANGED = changed;
+    REG_RESULT_GEN++;
+}
+
+// Поколения окна результата и регистров REG_RESULT_GEN, REG_RESULT_CHANGED
+static void reg_seq_result_mark(void)
+{
+    reg_seq_mark(HLD_READ_REG, MAX_READ_REGS);
+    reg_seq_mark(&REG_RESULT_GEN - regs, 1);
+    reg_seq_mark(&REG_RESULT_CHANGED - regs, 1);
+}
+
+void reg_seq_write_result_end(void)
+{
+    reg_seq_result_publish();
+    reg_seq_write_end();
+}
+
+void reg_seq_write(uint16_t start_reg, const uint16_t *src, uint16_t count)
+{
+    reg_seq_write_begin();
+    memcpy(&regs[start_reg], src, count * sizeof(uint16_t));
+    reg_seq_mark(start_reg, count);
+    reg_seq_write_end_marked();
+}
+
+void reg_seq_set_result_unit(int unit)
+{
+    result_unit = (unit >= 1 && unit <= SP_UNIT_COUNT) ? unit : 0;
+}
+
+void reg_seq_write_result(const uint16_t *src, uint16_t count)
+{
+    if (result_unit == 0)
+    {
+        reg_seq_write_begin();
+        memcpy(&regs[HLD_READ_REG], src, count * sizeof(uint16_t));
+        reg_seq_result_publish();
+        reg_seq_result_mark();
+        reg_seq_write_end_marked();
+        return;
+    }
+
+    reg_seq_unit_t *u = &unit_results[result_unit - 1];
+    uint16_t changed = 0;
+    reg_seq_write_begin();
+    for (uint16_t i = 0; i < count; i++)
+    {
+        if (u->window[i] != src[i])
+        {
+            u->window[i] = src[i];
+            changed |= 1u << (i / RESULT_BLOCK_REGS);
+        }
+    }
+    u->changed = changed;
+    u->gen++;
+    reg_seq_result_mark();
+    reg_seq_write_end_marked();
+}
+
+// Подстановка окна результата абонента в снимок [start_reg, start_reg + count)
+static void reg_seq_unit_overlay(const reg_seq_unit_t *u, uint16_t start_reg, uint16_t *dst, uint16_t count)
+{
+    const uint16_t end = start_reg + count;
+    const uint16_t gen_reg = &REG_RESULT_GEN - regs;
+    const uint16_t changed_reg = &REG_RESULT_CHANGED - regs;
+
+    if (gen_reg >= start_reg && gen_reg < end)
+        dst[gen_reg - start_reg] = u->gen;
+    if (changed_reg >= start_reg && changed_reg < end)
+        dst[changed_reg - start_reg] = u->changed;
+
+    uint16_t first = start_reg > HLD_READ_REG ? start_reg : HLD_READ_REG;
+    uint16_t last = end < HLD_READ_REG + MAX_READ_REGS ? end : HLD_READ_REG + MAX_READ_REGS;
+    if (first < last)
+        memcpy(&dst[first - start_reg], &u->window[first - HLD_READ_REG], (last - first) * sizeof(uint16_t));
+}
+
+void reg_seq_read_unit(int unit, uint16_t start_reg, uint16_t *dst, uint16_t count)
+{
+    if (unit < 1 || unit > SP_UNIT_COUNT)
+    {
+        reg_seq_read(start_reg, dst, count);
+        return;
+    }
+
+    const reg_seq_unit_t *u = &unit_results[unit - 1];
+    uint32_t seq;
+    for (;;)
+    {
+        seq = __atomic_load_n(&reg_seq, __ATOMIC_ACQUIRE);
+        if (seq & 1)
+            continue; // Запись на другом ядре
+
+        memcpy(dst, &regs[start_reg], count * sizeof(uint16_t));
+        reg_seq_unit_overlay(u, start_reg, dst, count);
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&reg_seq, __ATOMIC_RELAXED) == seq)
+            break;
+    }
+}
+
+void reg_seq_read(uint16_t start_reg, uint16_t *dst, uint16_t count)
+{
+    uint32_t seq;
+    for (;;)
+    {
+        seq = __atomic_load_n(&reg_seq, __ATOMIC_ACQUIRE);
+        if (seq & 1)
+            continue; // Запись на другом ядре
+
+        memcpy(dst, &regs[start_reg], count * sizeof(uint16_t));
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&reg_seq, __ATOMIC_RELAXED) == seq)
+            break;
+    }
+}
@@ -0,0 +1,101 @@
+/*=====================================================================================
+ * Description:
+ *  Согласованные снимки регистров Modbus (seqlock)
+ *
+ *  Регистры regs[] пишут несколько задач: uart1_task (0x06/0x10), parser (окно 0x20+),
+ *  storage_handler_task (чтение файлов и конфигурации), uart2_task (диагностика).
+ *  Групповая запись обрамляется счётчиком последовательности: нечётный - идёт запись.
+ *  Чтение копирует регистры и повторяет копирование, если счётчик изменился, -
+ *  ответ 0x03 никогда не содержит половину старого и половину нового результата.
+ *
+ *  Писатели упорядочены spinlock'ом (portMUX), читатели блокировок не берут.
+ *  Одиночный регистр (16 бит) пишется атомарно и обрамления не требует.
+ *
+ *  Запись результата в окно 0x20+ завершается reg_seq_write_result_end(): в той же
+ *  транзакции растёт REG_RESULT_GEN и заполняется REG_RESULT_CHANGED - мастер читает
+ *  два регистра и забирает только изменившиеся блоки.
+ *
+ *  Поколение (reg_seq_gen) растёт при каждой записи через reg_seq в блоки по 32
+ *  регистра, перекрытые диапазоном: готовый ответ 0x03 годен, пока поколение его
+ *  диапазона то же, - без снимка и сравнения. Одиночные присваивания мимо reg_seq
+ *  поколение не меняют (кроме учтённых reg_seq_touch()).
+ *
+ *  У дополнительных абонентов (sp_units) окно результата и эти два регистра свои:
+ *  результат транзакции абонента пишется в его окно, чтение по его адресу Modbus
+ *  (reg_seq_read_unit) подставляет их вместо regs[].
+ *====================================================================================*/
+#ifndef _REG_SEQ_H_
+#define _REG_SEQ_H_
+
+#include <stdint.h>
+#include "project_config.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Начало групповой записи в regs[] (критическая секция)
+     * @note  Между begin и end - только присваивания регистрам: без логов, ожиданий и flash
+     */
+    void reg_seq_write_begin(void);
+
+    /**
+     * @brief Конец групповой записи в regs[]
+     */
+    void reg_seq_write_end(void);
+
+    /**
+     * @brief Конец групповой записи, обновившей окно результата 0x20+
+     * @details Сравнивает окно с предыдущим результатом, публикует карту изменённых
+     *          блоков (REG_RESULT_CHANGED) и следующий номер REG_RESULT_GEN
+     */
+    void reg_seq_write_result_end(void);
+
+    /**
+     * @brief Запись блока регистров одной транзакцией
+     */
+    void reg_seq_write(uint16_t start_reg, const uint16_t *src, uint16_t count);
+
+    /**
+     * @brief Запись результата в окно 0x20+ одной транзакцией (с REG_RESULT_GEN/CHANGED)
+     * @details Окно - абонента, заданного reg_seq_set_result_unit()
+     */
+    void reg_seq_write_result(const uint16_t *src, uint16_t count);
+
+    /**
+     * @brief Абонент текущей транзакции SP: его окно получает reg_seq_write_result()
+     * @param unit SP_UNIT_PRIMARY (regs[]) или 1 ... SP_UNIT_COUNT
+     */
+    void reg_seq_set_result_unit(int unit);
+
+    /**
+     * @brief Учёт записи диапазона, сделанной без обрамления (одиночный регистр)
+     */
+    void reg_seq_touch(uint16_t start_reg, uint16_t count);
+
+    /**
+     * @brief Поколение диапазона регистров: меняется при любой записи в его блоки
+     * @details Общее для окон результата всех абонентов. Записи в группе begin/end
+     *          без диапазона (reg_seq_write_end, reg_seq_write_result_end) меняют
+     *          поколение всех блоков
+     */
+    uint32_t reg_seq_gen(uint16_t start_reg, uint16_t count);
+
+    /**
+     * @brief Согласованный снимок блока регистров
+     * @param dst [out] count слов
+     */
+    void reg_seq_read(uint16_t start_reg, uint16_t *dst, uint16_t count);
+
+    /**
+     * @brief Снимок регистров для абонента: окно результата и REG_RESULT_GEN/CHANGED - его
+     */
+    void reg_seq_read_unit(int unit, uint16_t start_reg, uint16_t *dst, uint16_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _REG_SEQ_H_
@@ -0,0 +1,249 @@
+/**
+ * Кэш готовых кадров запроса SP.
+ *
+ * Раньше каждая отправка (команда REG_SP_COMM и автоповтор REG_REPEAT) читала
+ * шаблон из flash, выделяла два буфера, выполняла стаффинг и считала CRC.
+ * Теперь это делается один раз на шаблон, повторные отправки берут кадр из RAM.
+ * Шаблонов во flash может быть сотни, кадров в RAM - REQ_CACHE_SLOTS: при промахе
+ * вытесняется кадр, к которому дольше всего не обращались.
+ *
+ * Согласование с задачей хранилища без блокировок:
+ * - запись шаблона (storage_handler_task) после записи во flash увеличивает
+ *   поколение req_gen[file_id];
+ * - сборка кадра (uart2_task) запоминает поколение ДО чтения flash, поэтому
+ *   запись, пришедшая во время сборки, приведёт к повторной сборке при следующей
+ *   отправке.
+ *
+ * Счётчики попаданий/промахов - в регистрах диагностики 0xE0/0xE1.
+ *
+ * Запрос параметра без шаблона (req_cache_direct) собирается из номеров канала
+ * и параметра и во flash не обращается.
+ *
+ * Разметка указателей (число и длина) запоминается для каждого шаблона при сборке
+ * его кадра вместе с поколением: отбор шаблонов в объединённый запрос проверяет
+ * её, не занимая места в кэше кадров и не читая flash.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include "req_cache.h"
+#include "project_config.h"
+#include "sp_storage.h"
+#include "staff.h"
+#include "esp_log.h"
+#include <string.h>
+#include <stdio.h>
+
+extern uint16_t regs[];
+
+static const char *TAG = "REQ_CACHE";
+
+#define REQ_HEADER_LEN 4 // SOH DAD SAD ISI
+
+static req_cache_entry_t req_cache[REQ_CACHE_SLOTS];
+static uint32_t req_clock; // Счётчик обращений для вытеснения
+static volatile uint32_t req_gen[SP_STORAGE_FILE_COUNT];
+
+// Разметка указателей шаблона на момент последней сборки кадра
+typedef struct
+{
+    bool known;
+    uint8_t ptr_count;
+    uint8_t ptr_len;
+    uint32_t gen;
+} req_pointers_t;
+
+static req_pointers_t req_pointers[SP_STORAGE_FILE_COUNT];
+
+// Разметка указателей шаблона CMD_READ_PARAMS: FNC DataHead STX (HT кан HT пар FF)... ETX.
+// Шаблоны другого вида не объединяются в общий запрос (ptr_count = 0)
+static void req_cache_index_pointers(req_cache_entry_t *e)
+{
+    e->ptr_count = 0;
+    if (e->body_len < 3 || e->body[0] != (CMD_READ_PARAMS >> 8) || e->body[e->body_len - 1] != ETX)
+        return;
+
+    const uint8_t *stx = memchr(e->body + 1, STX, e->body_len - 1);
+    if (!stx)
+        return;
+
+    uint8_t start = stx - e->body + 1;
+    uint8_t end = e->body_len - 1;
+    if (end <= start || e->body[start] != HT || e->body[end - 1] != FF)
+        return;
+
+    uint8_t count = 0;
+    for (uint8_t i = start; i < end; i++)
+    {
+        if (e->body[i] == FF)
+            count++;
+    }
+
+    e->ptr_start = start;
+    e->ptr_end = end;
+    e->ptr_count = count;
+}
+
+// Сборка кадра из шаблона body (FNC DataHead STX ... ETX): заголовок, стаффинг, CRC
+static esp_err_t req_frame_build(req_cache_entry_t *e, uint8_t dad, uint8_t sad,
+                                 const uint8_t *body, uint8_t body_len)
+{
+    uint8_t plain[REQ_HEADER_LEN + SP_STORAGE_FILE_SIZE - 1];
+
+    // Формирование заголовка пакета
+    plain[0] = SOH;
+    plain[1] = dad;
+    plain[2] = sad;
+    plain[3] = ISI;
+    memcpy(plain + REQ_HEADER_LEN, body, body_len);
+
+    // Стаффинг и CRC (без DLE SOH) за один проход
+    int frame_len = staff_frame(plain, REQ_HEADER_LEN + body_len, e->frame, sizeof(e->frame));
+    if (frame_len == 0)
+        return ESP_FAIL;
+
+    e->len = frame_len;
+    e->dad = dad;
+    e->sad = sad;
+    e->fnc = body[0];
+    e->body_len = body_len;
+    if (e->body != body)
+        memcpy(e->body, body, body_len);
+    req_cache_index_pointers(e);
+    return ESP_OK;
+}
+
+// Сборка кадра из шаблона во flash
+static esp_err_t req_cache_build(uint8_t file_id, uint8_t dad, uint8_t sad, req_cache_entry_t *e)
+{
+    uint32_t gen = req_gen[file_id];
+
+    e->valid = false;
+
+    // Шаблон - прямо из отображения раздела, без копии на стеке
+    const uint8_t *file_data = request_view_begin(file_id);
+    if (!file_data)
+        return ESP_ERR_INVALID_ARG;
+
+    uint8_t data_len = file_data[0];
+    esp_err_t err = ESP_OK;
+    if (data_len > SP_STORAGE_FILE_SIZE - 1)
+    {
+        ESP_LOGE(TAG, "Шаблон %d: недопустимая длина %d", file_id, data_len);
+        err = ESP_ERR_INVALID_SIZE;
+    }
+    else if (req_frame_build(e, dad, sad, file_data + 1, data_len) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Шаблон %d: ошибка стаффинга", file_id);
+        err = ESP_FAIL;
+    }
+    request_view_end();
+    if (err != ESP_OK)
+        return err;
+
+    e->file_id = file_id;
+    e->gen = gen;
+    e->valid = true;
+
+    req_pointers_t *p = &req_pointers[file_id];
+    p->ptr_count = e->ptr_count;
+    p->ptr_len = e->ptr_count ? e->ptr_end - e->ptr_start : 0;
+    p->gen = gen;
+    p->known = true;
+    return ESP_OK;
+}
+
+esp_err_t req_cache_get(uint8_t file_id, uint8_t dad, uint8_t sad, const req_cache_entry_t **entry)
+{
+    if (file_id >= SP_STORAGE_FILE_COUNT)
+        return ESP_ERR_INVALID_ARG;
+
+    // Кадр шаблона или место для него: свободное либо давно не использованное
+    req_cache_entry_t *e = NULL;
+    req_cache_entry_t *victim = &req_cache[0];
+    for (int i = 0; i < REQ_CACHE_SLOTS && !e; i++)
+    {
+        req_cache_entry_t *c = &req_cache[i];
+        if (c->valid && c->file_id == file_id)
+            e = c;
+        else if (victim->valid && (!c->valid || (int32_t)(c->used - victim->used) < 0))
+            victim = c;
+    }
+    if (!e)
+        e = victim;
+    e->used = ++req_clock;
+
+    if (e->valid && e->file_id == file_id && e->gen == req_gen[file_id] && e->dad == dad && e->sad == sad)
+    {
+        REG_DIAG_REQ_CACHE_HIT++;
+        *entry = e;
+        return ESP_OK;
+    }
+
+    REG_DIAG_REQ_CACHE_MISS++;
+    esp_err_t err = req_cache_build(file_id, dad, sad, e);
+    if (err != ESP_OK)
+        return err;
+
+    ESP_LOGI(TAG, "Кадр шаблона %d собран: %d байт", file_id, e->len);
+    *entry = e;
+    return ESP_OK;
+}
+
+bool req_cache_pointers(uint8_t file_id, uint8_t *ptr_count, uint8_t *ptr_len)
+{
+    if (file_id >= SP_STORAGE_FILE_COUNT)
+        return false;
+
+    const req_pointers_t *p = &req_pointers[file_id];
+    if (!p->known || p->gen != req_gen[file_id])
+        return false;
+
+    *ptr_count = p->ptr_count;
+    *ptr_len = p->ptr_len;
+    return true;
+}
+
+void req_cache_invalidate(uint8_t file_id)
+{
+    if (file_id < SP_STORAGE_FILE_COUNT)
+        req_gen[file_id]++;
+}
+
+void req_cache_invalidate_all(void)
+{
+    for (int i = 0; i < SP_STORAGE_FILE_COUNT; i++)
+        req_gen[i]++;
+}
+
+esp_err_t req_cache_direct(uint8_t dad, uint8_t sad, uint16_t channel, uint16_t param,
+                           const req_cache_entry_t **entry)
+{
+    static req_cache_entry_t direct;
+    static uint16_t direct_channel, direct_param;
+
+    if (direct.valid && direct.dad == dad && direct.sad == sad &&
+        direct_channel == channel && direct_param == param)
+    {
+        *entry = &direct;
+        return ESP_OK;
+    }
+
+    // FNC, пустой DataHead, STX, HT кан HT пар FF, ETX
+    uint8_t body[SP_DIRECT_BODY_MAX_SIZE];
+    int n = snprintf((char *)body, sizeof(body), "%c%c%c%u%c%u%c%c",
+                     CMD_READ_PARAMS >> 8, STX, HT, channel, HT, param, FF, ETX);
+    if (n <= 0 || n >= (int)sizeof(body))
+        return ESP_ERR_INVALID_SIZE;
+
+    direct.valid = false;
+    esp_err_t err = req_frame_build(&direct, dad, sad, body, n);
+    if (err != ESP_OK)
+        return err;
+
+    direct_channel = channel;
+    direct_param = param;
+    direct.valid = true;
+    *entry = &direct;
+    return ESP_OK;
+}
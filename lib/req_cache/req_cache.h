@@ -0,0 +1,94 @@
+/*=====================================================================================
+ * Description:
+ *  Кэш готовых кадров запроса SP (REQ_CACHE_SLOTS недавно отправленных шаблонов
+ *  раздела `request`, вытеснение - давно не использованного)
+ *
+ *  Кадр хранится полностью сформированным: DLE SOH DAD SAD DLE ISI <шаблон> CRC1 CRC2,
+ *  со стаффингом и CRC, так что отправка из кэша - это один uart_write_bytes().
+ *  Кадр пересобирается при перезаписи шаблона (request_write_file) и при смене
+ *  адресов DAD/SAD.
+ *====================================================================================*/
+#ifndef _REQ_CACHE_H_
+#define _REQ_CACHE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "project_config.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef struct
+    {
+        bool valid;                            // Кадр собран
+        uint8_t file_id;                       // Шаблон, из которого собран кадр
+        uint32_t used;                         // Момент последнего обращения (вытеснение)
+        uint8_t dad;                           // Адрес приёмника, с которым собран кадр
+        uint8_t sad;                           // Адрес источника, с которым собран кадр
+        uint8_t fnc;                           // Код функции шаблона (старший байт commands)
+        uint32_t gen;                          // Поколение шаблона на момент сборки
+        uint16_t len;                          // Длина кадра
+        uint8_t frame[SP_REQ_FRAME_MAX_SIZE];  // Кадр для отправки
+
+        // Шаблон без стаффинга: FNC DataHead STX <указатели> ETX
+        uint8_t body_len;                      // Длина шаблона
+        uint8_t ptr_start;                     // Смещение первого указателя (после STX)
+        uint8_t ptr_end;                       // Смещение ETX
+        uint8_t ptr_count;                     // Число указателей HT кан HT пар FF (0 - не объединяется)
+        uint8_t body[SP_STORAGE_FILE_SIZE - 1];
+    } req_cache_entry_t;
+
+    /**
+     * @brief Получение кадра запроса по шаблону file_id
+     *
+     * При промахе шаблон читается из flash и кадр собирается заново.
+     * Вызывается только из uart2_task.
+     *
+     * @param entry [out] кадр; действителен до следующего вызова req_cache_get()
+     * @return ESP_OK, ESP_ERR_INVALID_ARG (номер вне диапазона),
+     *         ESP_ERR_INVALID_SIZE (испорченный байт длины шаблона) или ошибка чтения flash
+     */
+    esp_err_t req_cache_get(uint8_t file_id, uint8_t dad, uint8_t sad, const req_cache_entry_t **entry);
+
+    /**
+     * @brief Кадр чтения одного параметра CMD_READ_PARAMS без шаблона во flash
+     *
+     * DataSet: HT канал HT параметр FF (номера - десятичные числа в символьном виде),
+     * DataHead пустой. Кадр пересобирается при смене адресов или номеров.
+     * Вызывается только из uart2_task.
+     */
+    esp_err_t req_cache_direct(uint8_t dad, uint8_t sad, uint16_t channel, uint16_t param,
+                               const req_cache_entry_t **entry);
+
+    /**
+     * @brief Указатели шаблона по последней сборке его кадра, без чтения flash
+     *
+     * Для отбора шаблонов в объединённый запрос: кэш кадров вмещает REQ_CACHE_SLOTS
+     * шаблонов, а сведения об указателях хранятся для всех.
+     * Вызывается только из uart2_task.
+     *
+     * @param ptr_count [out] число указателей (0 - шаблон не объединяется)
+     * @param ptr_len   [out] длина указателей в байтах
+     * @return false - кадр шаблона ещё не собирался или шаблон изменён после сборки
+     */
+    bool req_cache_pointers(uint8_t file_id, uint8_t *ptr_count, uint8_t *ptr_len);
+
+    /**
+     * @brief Сброс кадра шаблона file_id (безопасно из любой задачи)
+     */
+    void req_cache_invalidate(uint8_t file_id);
+
+    /**
+     * @brief Сброс всех кадров
+     */
+    void req_cache_invalidate_all(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _REQ_CACHE_H_
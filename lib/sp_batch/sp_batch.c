@@ -0,0 +1,128 @@
+/**
+ * Объединение шаблонов CMD_READ_PARAMS в один запрос SP.
+ *
+ * Время шины уходит в основном на заголовок, CRC, межкадровую паузу и
+ * оборот линии, а не на сами указатели. Запрос с N указателями вместо N
+ * запросов по одному указателю кратно поднимает число параметров в секунду.
+ *
+ * Ограничения объединённого запроса:
+ * - не более SP_BATCH_MAX шаблонов и не более MAX_BLOCKS/2 указателей:
+ *   ответ на каждый указатель - два блока, а parser разбирает до MAX_BLOCKS;
+ * - кадр без стаффинга не длиннее SP_BATCH_PLAIN_MAX_SIZE;
+ * - один DAD на запрос.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include "sp_batch.h"
+#include "project_config.h"
+#include "staff.h"
+#include <string.h>
+
+#define BATCH_HEADER_LEN 4 // SOH DAD SAD ISI
+
+static const sp_batch_t *batch_current = NULL;
+
+void sp_batch_begin(sp_batch_t *b, uint8_t file_id, const req_cache_entry_t *e)
+{
+    b->count = 1;
+    b->ids[0] = file_id;
+    b->ptrs[0] = e->ptr_count;
+    b->ptr_total = e->ptr_count;
+    b->len = 0;
+
+    // Заголовок и первый шаблон до ETX (FNC, DataHead, STX, указатели)
+    b->plain[0] = SOH;
+    b->plain[1] = e->dad;
+    b->plain[2] = e->sad;
+    b->plain[3] = ISI;
+    memcpy(b->plain + BATCH_HEADER_LEN, e->body, e->ptr_end);
+    b->plain_len = BATCH_HEADER_LEN + e->ptr_end;
+}
+
+bool sp_batch_fits_pointers(const sp_batch_t *b, uint8_t ptr_count, uint8_t ptr_len)
+{
+    return ptr_count > 0 &&
+           b->count < SP_BATCH_MAX &&
+           b->ptr_total + ptr_count <= MAX_BLOCKS / 2 &&
+           b->plain_len + ptr_len + 1 <= SP_BATCH_PLAIN_MAX_SIZE; // +1 - ETX
+}
+
+bool sp_batch_fits(const sp_batch_t *b, const req_cache_entry_t *e)
+{
+    return e->dad == b->plain[1] &&
+           sp_batch_fits_pointers(b, e->ptr_count, e->ptr_end - e->ptr_start);
+}
+
+bool sp_batch_contains(const sp_batch_t *b, uint8_t file_id)
+{
+    for (uint8_t i = 0; i < b->count; i++)
+    {
+        if (b->ids[i] == file_id)
+            return true;
+    }
+    return false;
+}
+
+void sp_batch_add(sp_batch_t *b, uint8_t file_id, const req_cache_entry_t *e)
+{
+    uint8_t ptr_len = e->ptr_end - e->ptr_start;
+
+    memcpy(b->plain + b->plain_len, e->body + e->ptr_start, ptr_len);
+    b->plain_len += ptr_len;
+
+    b->ids[b->count] = file_id;
+    b->ptrs[b->count] = e->ptr_count;
+    b->ptr_total += e->ptr_count;
+    b->count++;
+}
+
+bool sp_batch_finish(sp_batch_t *b)
+{
+    b->plain[b->plain_len++] = ETX;
+
+    // Стаффинг и CRC (без DLE SOH) за один проход
+    int frame_len = staff_frame(b->plain, b->plain_len, b->frame, sizeof(b->frame));
+    if (frame_len == 0)
+        return false;
+
+    b->len = frame_len;
+    return true;
+}
+
+const sp_batch_t *sp_batch_current(void)
+{
+    return batch_current;
+}
+
+void sp_batch_set_current(const sp_batch_t *b)
+{
+    batch_current = b;
+}
+
+bool sp_batch_slice(const sp_batch_t *b, uint8_t index,
+                    const uint16_t *ff, uint8_t ff_count, size_t first, size_t end,
+                    size_t *start_out, size_t *end_out)
+{
+    if (index >= b->count)
+        return false;
+
+    // Блоки указателей шаблона: [2*p0, 2*(p0+n)), блок k закрыт разделителем ff[k]
+    uint16_t p0 = 0;
+    for (uint8_t i = 0; i < index; i++)
+        p0 += b->ptrs[i];
+    uint16_t last = 2 * (p0 + b->ptrs[index]) - 1;
+
+    if (p0 > 0 && 2 * p0 - 1 >= ff_count)
+        return false;
+    *start_out = (p0 == 0) ? first : ff[2 * p0 - 1] + 1U;
+
+    if (last < ff_count)
+        *end_out = ff[last];
+    else if (last == ff_count && index == b->count - 1)
+        *end_out = end; // Последний блок закрыт ETX без FF
+    else
+        return false;
+
+    return *start_out <= *end_out;
+}
@@ -0,0 +1,94 @@
+/*=====================================================================================
+ * Description:
+ *  Объединение нескольких шаблонов CMD_READ_PARAMS в один запрос SP
+ *
+ *  Запрос:  SOH DAD SAD ISI 1Dh DataHead STX <указатели шаблона 1> ... <указатели N> ETX
+ *  Ответ:   на каждый указатель два блока, ограниченных FF: "указатель FF информация FF",
+ *           в том же порядке, поэтому ответ делится обратно по числу указателей шаблонов.
+ *  DataHead берётся из первого шаблона.
+ *====================================================================================*/
+#ifndef _SP_BATCH_H_
+#define _SP_BATCH_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "project_config.h"
+#include "req_cache.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef struct
+    {
+        uint8_t count;                            // Число шаблонов в запросе
+        uint8_t ids[SP_BATCH_MAX];                // Номера шаблонов
+        uint8_t ptrs[SP_BATCH_MAX];               // Число указателей каждого шаблона
+        uint8_t ptr_total;                        // Всего указателей
+        uint16_t plain_len;                       // Длина кадра без стаффинга
+        uint8_t plain[SP_BATCH_PLAIN_MAX_SIZE];   // Кадр без стаффинга и CRC
+        uint16_t len;                             // Длина готового кадра
+        uint8_t frame[SP_BATCH_FRAME_MAX_SIZE];   // Кадр для отправки
+    } sp_batch_t;
+
+    /**
+     * @brief Начало запроса с первого шаблона (ptr_count > 0)
+     */
+    void sp_batch_begin(sp_batch_t *b, uint8_t file_id, const req_cache_entry_t *e);
+
+    /**
+     * @brief Шаблон можно добавить: CMD_READ_PARAMS к тому же DAD и всё помещается
+     */
+    bool sp_batch_fits(const sp_batch_t *b, const req_cache_entry_t *e);
+
+    /**
+     * @brief Указатели шаблона помещаются в запрос (без проверки DAD)
+     * @param ptr_count число указателей шаблона (0 - шаблон не объединяется)
+     * @param ptr_len   длина указателей в байтах
+     */
+    bool sp_batch_fits_pointers(const sp_batch_t *b, uint8_t ptr_count, uint8_t ptr_len);
+
+    /**
+     * @brief Шаблон уже в запросе
+     */
+    bool sp_batch_contains(const sp_batch_t *b, uint8_t file_id);
+
+    /**
+     * @brief Добавление указателей шаблона (после sp_batch_fits())
+     */
+    void sp_batch_add(sp_batch_t *b, uint8_t file_id, const req_cache_entry_t *e);
+
+    /**
+     * @brief Завершение кадра: ETX, стаффинг, CRC
+     * @return false при ошибке стаффинга
+     */
+    bool sp_batch_finish(sp_batch_t *b);
+
+    /**
+     * @brief Объединённый запрос, ответ на который ожидается (NULL - одиночный запрос)
+     */
+    const sp_batch_t *sp_batch_current(void);
+
+    void sp_batch_set_current(const sp_batch_t *b);
+
+    /**
+     * @brief Границы части полезной нагрузки ответа, относящейся к шаблону index запроса
+     * @param ff        позиции разделителей FF в полезной нагрузке (по возрастанию)
+     * @param ff_count  число разделителей
+     * @param first     смещение первого байта полезной нагрузки (после STX)
+     * @param end       смещение ETX
+     * @param start_out [out] начало части
+     * @param end_out   [out] конец части (не включая)
+     * @return false, если в ответе меньше блоков, чем указателей в запросе
+     */
+    bool sp_batch_slice(const sp_batch_t *b, uint8_t index,
+                        const uint16_t *ff, uint8_t ff_count, size_t first, size_t end,
+                        size_t *start_out, size_t *end_out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _SP_BATCH_H_
@@ -2,6 +2,7 @@
 #define _SP_CRC_H_
 
 #include <stdint.h>
+#include <stddef.h>
 //#include "freertos/FreeRTOS.h"
 
 
@@ -9,6 +10,37 @@
 extern "C"
 {
 #endif
+
+    // Таблицы CRC-16 (полином 0x1021): [0] - побайтный расчёт, [0..3] - по 4 байта
+    extern const uint16_t sp_crc_table[4][256];
+
+    // Начальное значение CRC
+    static inline uint16_t sp_crc16_init(void)
+    {
+        return 0;
+    }
+
+    // Обновление CRC одним байтом - для совмещения с другими проходами по кадру
+    static inline uint16_t sp_crc16_byte(uint16_t crc, uint8_t byte)
+    {
+        return (uint16_t)(crc << 8) ^ sp_crc_table[0][(crc >> 8) ^ byte];
+    }
+
+    // Обновление CRC четырьмя байтами за один шаг
+    static inline uint16_t sp_crc16_word(uint16_t crc, const uint8_t *p)
+    {
+        return sp_crc_table[3][(crc >> 8) ^ p[0]] ^ sp_crc_table[2][(crc & 0xFF) ^ p[1]] ^
+               sp_crc_table[1][p[2]] ^ sp_crc_table[0][p[3]];
+    }
+
+    // Обновление CRC частью кадра
+    uint16_t sp_crc16_update(uint16_t crc, const uint8_t *msg, size_t len);
+
+    // Итоговое значение CRC (без финального XOR)
+    static inline uint16_t sp_crc16_final(uint16_t crc)
+    {
+        return crc;
+    }
  
     uint16_t sp_crc16(const uint8_t *msg, size_t len);
 
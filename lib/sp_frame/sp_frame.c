@@ -0,0 +1,103 @@
+/**
+ * Побайтный выделитель кадров SP.
+ *
+ * Кадр передаётся дальше в момент приёма последнего байта CRC, без ожидания
+ * межкадрового таймаута. Ответ, разбитый на несколько чтений UART, собирается
+ * целиком; ответ длиннее одного чтения (UART_BUF_SIZE) не обрезается.
+ *
+ * Синхронизация:
+ * - вне кадра ищется пара DLE SOH (с преамбулой FF FF или без неё);
+ * - внутри кадра DLE SOH - это стаффированный байт данных (например, DAD = 0x01),
+ *   поэтому перезапуск кадра выполняется только по полной последовательности
+ *   FF FF DLE SOH;
+ * - DLE ETX завершает тело, за ним следуют два байта CRC.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include "sp_frame.h"
+#include "project_config.h"
+#include <string.h>
+
+// Начало нового кадра: восстанавливаем преамбулу FF FF и DLE SOH
+static void sp_frame_start(sp_frame_decoder_t *dec)
+{
+    dec->buf[0] = 0xFF;
+    dec->buf[1] = 0xFF;
+    dec->buf[2] = DLE;
+    dec->buf[3] = SOH;
+    dec->len = 4;
+    dec->state = SP_FRAME_BODY;
+}
+
+void sp_frame_reset(sp_frame_decoder_t *dec)
+{
+    dec->state = SP_FRAME_HUNT;
+    dec->len = 0;
+}
+
+bool sp_frame_feed(sp_frame_decoder_t *dec, uint8_t byte)
+{
+    bool complete = false;
+
+    switch (dec->state)
+    {
+    case SP_FRAME_HUNT:
+        if (byte == DLE)
+            dec->state = SP_FRAME_SOH;
+        break;
+
+    case SP_FRAME_SOH:
+        if (byte == SOH)
+            sp_frame_start(dec);
+        else if (byte != DLE)
+            dec->state = SP_FRAME_HUNT;
+        break;
+
+    case SP_FRAME_BODY:
+    case SP_FRAME_DLE:
+    case SP_FRAME_CRC1:
+    case SP_FRAME_CRC2:
+        // Преамбула нового кадра посреди текущего: FF FF DLE SOH
+        if (dec->state == SP_FRAME_DLE && byte == SOH &&
+            dec->len >= 3 && dec->buf[dec->len - 3] == 0xFF && dec->buf[dec->len - 2] == 0xFF)
+        {
+            sp_frame_start(dec);
+            break;
+        }
+
+        if (dec->len >= SP_RX_FRAME_MAX_SIZE)
+        {
+            dec->overflows++;
+            sp_frame_reset(dec);
+            break;
+        }
+        dec->buf[dec->len++] = byte;
+
+        if (dec->state == SP_FRAME_BODY)
+        {
+            if (byte == DLE)
+                dec->state = SP_FRAME_DLE;
+        }
+        else if (dec->state == SP_FRAME_DLE)
+        {
+            if (byte == ETX)
+                dec->state = SP_FRAME_CRC1;
+            else if (byte != DLE)
+                dec->state = SP_FRAME_BODY;
+        }
+        else if (dec->state == SP_FRAME_CRC1)
+        {
+            dec->state = SP_FRAME_CRC2;
+        }
+        else
+        {
+            // Последний байт CRC - кадр готов
+            dec->state = SP_FRAME_HUNT;
+            complete = true;
+        }
+        break;
+    }
+
+    return complete;
+}
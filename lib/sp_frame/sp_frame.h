@@ -0,0 +1,66 @@
+/*=====================================================================================
+ * Description:
+ *  Потоковый (побайтный) выделитель кадров SP из входного потока UART2
+ *
+ *  Кадр ответа целевого прибора:
+ *      [FF FF] DLE SOH ... DLE ETX CRC1 CRC2
+ *  Преамбула FF FF необязательна, в выходном буфере она всегда восстанавливается,
+ *  чтобы кадр имел привычный для sp_exe_in() вид.
+ *====================================================================================*/
+#ifndef _SP_FRAME_H_
+#define _SP_FRAME_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "project_config.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Состояния автомата разбора
+    typedef enum
+    {
+        SP_FRAME_HUNT = 0, // Поиск DLE начала кадра
+        SP_FRAME_SOH,      // Принят DLE, ожидается SOH
+        SP_FRAME_BODY,     // Тело кадра
+        SP_FRAME_DLE,      // Принят DLE внутри тела
+        SP_FRAME_CRC1,     // Ожидается первый байт CRC
+        SP_FRAME_CRC2,     // Ожидается второй байт CRC
+    } sp_frame_state_t;
+
+    typedef struct
+    {
+        sp_frame_state_t state;
+        size_t len;                        // Длина накопленного кадра
+        uint32_t overflows;                // Счётчик отброшенных по переполнению кадров
+        uint8_t buf[SP_RX_FRAME_MAX_SIZE]; // Кадр: FF FF DLE SOH ... DLE ETX CRC1 CRC2
+    } sp_frame_decoder_t;
+
+    /**
+     * @brief Сброс автомата в состояние поиска начала кадра
+     */
+    void sp_frame_reset(sp_frame_decoder_t *dec);
+
+    /**
+     * @brief Подача очередного байта
+     * @return true, если принят последний байт CRC и в dec->buf/dec->len лежит полный кадр.
+     *         Кадр остаётся действительным до следующего вызова sp_frame_feed().
+     */
+    bool sp_frame_feed(sp_frame_decoder_t *dec, uint8_t byte);
+
+    /**
+     * @brief Автомат находится внутри кадра (принято начало, но не конец)
+     */
+    static inline bool sp_frame_in_progress(const sp_frame_decoder_t *dec)
+    {
+        return dec->state != SP_FRAME_HUNT;
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _SP_FRAME_H_
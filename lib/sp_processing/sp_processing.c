@@ -25,20 +25,22 @@
 #include "sp_storage.h"
 #include "parser.h"
 #include "data_tags.h"
+#include "sp_batch.h"
+#include "reg_seq.h"
 
 static const char *TAG = "PROCESSING";
 static const char *TAG2 = "PATTERN";
 
 extern uint16_t regs[];
 extern uint16_t file_raw; // Индекс файла с RAW-байтом
-extern uint16_t commands; // Команды для обработки
+extern uint16_t commands; // Код команды последнего запроса ([15:8])
 
  extern portMUX_TYPE tags_mutex;
 
 
 // Прототипы внутренних функций
 void parse_spt_packet(const uint8_t *packet, size_t len);
-static void parse_pack(const uint8_t *data, size_t len);
+static void parse_pack(const sp_decoder_ctx_t *ctx, const uint8_t *data, size_t len);
 static bool extract_parameter_value(const uint8_t *data, size_t data_len,
                                     const char *param_name, float *out_value);
 
@@ -51,23 +53,24 @@ static bool extract_parameter_value(const uint8_t *data, size_t data_len,
 
 /**
  * @brief Выбирает парсер по комбинации команд в запросе и ответе
+ * @param ctx Контекст разбора пакета
  * @param data Указатель на данные пакета (без CRC)
  * @param len Длина пакета
  */
-static void parse_pack(const uint8_t *data, size_t len)
+static void parse_pack(const sp_decoder_ctx_t *ctx, const uint8_t *data, size_t len)
 {
     uint8_t fnc = 0xFF;
-    switch (commands)
+    switch (ctx->commands)
     {
     case CMD_READ_PARAMS: // 0x1D03 Reading parameters
         fnc = CMD_READ_PARAMS & 0xFF;
-        handle_read_parameter(fnc, data, len);
+        handle_read_parameter(ctx, fnc, data, len);
         ESP_LOGI(TAG, "Обработка команды fnc=0x%02X", fnc);
         break;
 
     case CMD_READ_INDEX_ARRAY: // 0x0C14   Reading the elements of an index array
         fnc = CMD_READ_INDEX_ARRAY & 0xFF;
-        handle_read_elements_index_array(fnc, data, len);
+        handle_read_elements_index_array(ctx, fnc, data, len);
         ESP_LOGI(TAG, "Чтение индексного массива: fnc=0x%02X", fnc);
         break;
 
@@ -132,6 +135,9 @@ static bool extract_parameter_value(const uint8_t *data, size_t data_len,
     size_t name_len = strlen(param_name);
     ESP_LOGD(TAG2, "Поиск параметра: '%s' (длина: %d)", param_name, name_len);
 
+    if (name_len == 0 || name_len > data_len)
+        return false;
+
     // Поиск имени параметра в данных
     for (size_t i = 0; i < data_len - name_len; i++)
     {
@@ -224,9 +230,93 @@ static bool extract_parameter_value(const uint8_t *data, size_t data_len,
     return false;
 }
 
+/**
+ * @brief Извлечение значений по шаблону ответа file_id в теги с историей
+ * @param payload Часть полезной нагрузки ответа, относящаяся к запросу file_id
+ * @param payload_len Длина этой части
+ */
+static void apply_response_template(uint8_t file_id, const uint8_t *payload, size_t payload_len)
+{
+    ESP_LOGI(TAG2, "Чтение шаблона ответа (ID:%d)", file_id);
+
+    // Шаблон - прямо из отображения раздела (без копии и расшифровки при каждом ответе)
+    const uint8_t *file_data = response_view_begin(file_id);
+
+    if (file_data)
+    {
+        uint8_t template_data_len = file_data[0];
+        if (template_data_len > 0 && template_data_len != 0xFF)
+        {
+            if (template_data_len > SP_STORAGE_FILE_SIZE - 1)
+                template_data_len = SP_STORAGE_FILE_SIZE - 1;
+            ESP_LOGI(TAG2, "Шаблон ответа ID:%d (%d байт)", file_id, template_data_len);
+
+            // Указатель на начало данных шаблона (после байта длины)
+            const uint8_t *template_start = file_data + 1;
+
+            // Разбор списка параметров (разделенных нулями)
+            const uint8_t *current = template_start;
+            const uint8_t *end = template_start + template_data_len;
+
+            while (current < end)
+            {
+                // Определение длины имени параметра (последнее имя может быть без нуля)
+                size_t name_len = strnlen((const char *)current, end - current);
+                if (name_len == 0)
+                    break;
+
+                char param_name[SP_STORAGE_FILE_SIZE];
+                memcpy(param_name, current, name_len);
+                param_name[name_len] = '\0';
+                ESP_LOGI(TAG2, "Обработка параметра: %s", param_name);
+
+                // Извлечение значения параметра из данных пакета
+                float param_value;
+                if (extract_parameter_value(payload, payload_len, param_name, &param_value))
+                {
+                    // Сохранение значения в структуру
+                    ESP_LOGI(TAG2, "Сохранение параметра: %s = %f", param_name, param_value);
+
+                    // Получаем или создаем тег с историей на 100 значений
+                    DataTag *tag = get_or_create_tag(param_name, 100);
+                    if (tag)
+                    {
+                        portENTER_CRITICAL(&tags_mutex);
+                        update_tag_value(tag, param_value);
+                        portEXIT_CRITICAL(&tags_mutex);
+
+
+                        // Для отладки: вывод первого и последнего значения в истории
+                        ESP_LOGD(TAG2, "История %s: текущее=%.2f, первое=%.2f",
+                                 param_name,
+                                 tag->current_value,
+                                 tag->history[(tag->history_index + 1) % tag->history_size]);
+                    }
+                }
+                else
+                {
+                    ESP_LOGW(TAG2, "Не удалось извлечь значение параметра %s", param_name);
+                }
+
+                // Переход к следующему параметру
+                current += name_len + 1;
+            }
+        }
+        else
+        {
+            ESP_LOGW(TAG2, "Некорректная длина шаблона: %d", template_data_len);
+        }
+        response_view_end();
+    }
+    else
+    {
+        ESP_LOGE(TAG2, "Неверный индекс шаблона ответа: %d", file_id);
+    }
+}
+
 /**
  * @brief Основная функция обработки входящего пакета
- * @param data Указатель на сырые данные пакета (с CRC)
+ * @param data Указатель на сырые данные пакета (с CRC), обрабатывается на месте
  * @param data_len Длина входящего пакета
  * @param out_buf Буфер для выходных данных (регистры Modbus)
  * @param out_len Указатель на длину выходных данных (в словах)
@@ -235,8 +325,11 @@ static bool extract_parameter_value(const uint8_t *data, size_t data_len,
  * 1. Если (file_raw & 0xFF00) == 0xFF00 (старший байт = 0xFF) -
  *    RAW-режим: весь пакет после дестаффинга отправляется в регистры Modbus
  * 2. В противном случае - стандартная обработка с парсингом
+ *
+ * Проверка CRC, дестаффинг и разметка разделителей выполняются deStaff() за один
+ * проход прямо в буфере приёма, без выделения памяти и копирования.
  */
-void sp_exe_in(const uint8_t *data, size_t data_len, uint16_t *out_buf, size_t *out_len)
+void sp_exe_in(uint8_t *data, size_t data_len, uint16_t *out_buf, size_t *out_len)
 {
     // Проверка минимальной длины пакета (10 байт)
     if (data_len < 10)
@@ -247,40 +340,27 @@ void sp_exe_in(const uint8_t *data, size_t data_len, uint16_t *out_buf, size_t *
         return;
     }
 
-    // Проверка CRC пакета
     uint16_t received_crc = (data[data_len - 2] << 8) | data[data_len - 1];
-    uint16_t calculated_crc = sp_crc16(data + 4, data_len - 6);
 
-    if (received_crc != calculated_crc)
-    {
-        ESP_LOGE(TAG, "Ошибка CRC: принято %04X, вычислено %04X", received_crc, calculated_crc);
-        *out_len = 1;
-        REG_SP_ERROR = 0xFFFE; // Код ошибки: CRC
-        return;
-    }
+    // Дестаффинг без первых двух байт (FF FF) и CRC, с расчётом CRC и разметкой.
+    // Контекст разбора локальный - функция не зависит от результатов прошлых пакетов
+    sp_decoder_ctx_t ctx;
+    uint8_t *temp_buf = data + 2;
+    int destuffed_len = deStaff(&ctx, temp_buf, data_len - 4);
 
-    // Выделение буфера для дестаффинга (с запасом)
-    uint8_t *temp_buf = malloc(data_len * 2);
-    if (!temp_buf)
+    // Проверка CRC пакета
+    if (received_crc != ctx.crc)
     {
-        ESP_LOGE(TAG, "Ошибка выделения памяти для дестаффинга");
+        ESP_LOGE(TAG, "Ошибка CRC: принято %04X, вычислено %04X", received_crc, ctx.crc);
         *out_len = 1;
-        REG_SP_ERROR = 0xFFFD; // Код ошибки: память
+        REG_SP_ERROR = 0xFFFE; // Код ошибки: CRC
         return;
     }
 
-    // Копирование данных без первых двух байт (FF FF) и CRC
-    memcpy(temp_buf, data + 2, data_len - 4);
-    size_t temp_len = data_len - 4;
-
-    // Дестаффинг данных
-    size_t destuffed_len = deStaff(temp_buf, temp_len);
-
-    if (destuffed_len == -1)
+    if (destuffed_len <= 0)
     {
         ESP_LOGE(TAG, "Ошибка нахождения STX и ETX в пакете");
         REG_SP_ERROR = 0xFFFC; // Код ошибки: STX/ETX
-        free(temp_buf);
         return;
     }
 
@@ -289,9 +369,9 @@ void sp_exe_in(const uint8_t *data, size_t data_len, uint16_t *out_buf, size_t *
     // Базовая проверка структуры пакета
     parse_spt_packet(temp_buf, destuffed_len);
 
-    // Обновление кодов команд
-    commands |= temp_buf[4];
-    ESP_LOGI(TAG, "Команды запрос/ответ: 0x%04X", commands);
+    // Коды команд: запрос (старший байт) и ответ (FNC пакета)
+    ctx.commands = (commands & 0xFF00) | temp_buf[4];
+    ESP_LOGI(TAG, "Команды запрос/ответ: 0x%04X", ctx.commands);
 
     // Логика обработки на основе индекса файла
     if ((file_raw & RAW_MODE_THRESHOLD) == RAW_MODE_THRESHOLD)
@@ -321,92 +401,48 @@ void sp_exe_in(const uint8_t *data, size_t data_len, uint16_t *out_buf, size_t *
 
             out_buf[i] = (high_byte << 8) | low_byte;
         }
+        reg_seq_write_result(out_buf, *out_len);
 
         ESP_LOGI(TAG, "Отправлено %d слов в регистры Modbus", *out_len);
-        free(temp_buf);
         return;
     }
 
     // СТАНДАРТНЫЙ РЕЖИМ: парсинг пакета
     ESP_LOGI(TAG, "Стандартная обработка (file_raw=0x%04X)", file_raw);
-    parse_pack(temp_buf, destuffed_len);
+    parse_pack(&ctx, temp_buf, destuffed_len);
 
-    ESP_LOGI(TAG2, "Чтение шаблона ответа (file_raw=0x%04X)", file_raw);
+    // Поиск значений по шаблону - только в полезной нагрузке между STX и ETX
+    const uint8_t *payload = temp_buf + ctx.stx_position + 1;
+    size_t payload_len = ctx.etx_position - ctx.stx_position - 1;
 
-    uint8_t file_data[SP_STORAGE_FILE_SIZE];
-    esp_err_t err = response_read_file(file_raw, file_data);
-
-    if (err == ESP_OK)
+    // Объединённый запрос: каждый шаблон ответа применяется к своей части ответа
+    const sp_batch_t *batch = sp_batch_current();
+    if (batch && batch->count > 1)
     {
-        uint8_t template_data_len = file_data[0];
-        if (template_data_len > 0 && template_data_len != 0xFF)
+        const sp_tokens_t *tokens = &ctx.tokens;
+        for (uint8_t i = 0; i < batch->count; i++)
         {
-            ESP_LOGI(TAG2, "Шаблон ответа ID:%d (%d байт)", file_raw, template_data_len);
-
-            // Указатель на начало данных шаблона (после байта длины)
-            uint8_t *template_start = file_data + 1;
-
-            // Разбор списка параметров (разделенных нулями)
-            uint8_t *current = template_start;
-            uint8_t *end = template_start + template_data_len;
-
-            while (current < end)
+            size_t part_start, part_end;
+            if (tokens->overflow ||
+                !sp_batch_slice(batch, i, tokens->ff, tokens->ff_count,
+                                ctx.stx_position + 1, ctx.etx_position, &part_start, &part_end))
             {
-                // Определение длины имени параметра
-                size_t name_len = strlen((char *)current);
-                if (name_len == 0)
-                    break;
-
-                char *param_name = (char *)current;
-                ESP_LOGI(TAG2, "Обработка параметра: %s", param_name);
-
-                // Извлечение значения параметра из данных пакета
-                float param_value;
-                if (extract_parameter_value(temp_buf, destuffed_len, param_name, &param_value))
-                {
-                    // Сохранение значения в структуру
-                    ESP_LOGI(TAG2, "Сохранение параметра: %s = %f", param_name, param_value);
-
-                    // Получаем или создаем тег с историей на 100 значений
-                    DataTag *tag = get_or_create_tag(param_name, 100);
-                    if (tag)
-                    {
-                        portENTER_CRITICAL(&tags_mutex);
-                        update_tag_value(tag, param_value);
-                        portEXIT_CRITICAL(&tags_mutex);
-
-
-                        // Для отладки: вывод первого и последнего значения в истории
-                        ESP_LOGD(TAG2, "История %s: текущее=%.2f, первое=%.2f",
-                                 param_name,
-                                 tag->current_value,
-                                 tag->history[(tag->history_index + 1) % tag->history_size]);
-                    }
-                }
-                else
-                {
-                    ESP_LOGW(TAG2, "Не удалось извлечь значение параметра %s", param_name);
-                }
-
-                // Переход к следующему параметру
-                current += name_len + 1;
+                ESP_LOGW(TAG2, "Ответ не делится по запросам, шаблон ID:%d - по всему ответу", batch->ids[i]);
+                apply_response_template(batch->ids[i], payload, payload_len);
+                continue;
             }
-        }
-        else
-        {
-            ESP_LOGW(TAG2, "Некорректная длина шаблона: %d", template_data_len);
+            apply_response_template(batch->ids[i], temp_buf + part_start, part_end - part_start);
         }
     }
-    else
+    else if ((file_raw & SP_COMM_MODE_MASK) != SP_COMM_DIRECT) // Запрос без шаблона - без шаблона ответа
     {
-        ESP_LOGE(TAG2, "Ошибка чтения шаблона: %s", esp_err_to_name(err));
+        apply_response_template(file_raw, payload, payload_len);
     }
 
     // Возврат кода успеха (1 слово)
     *out_len = 1;
     out_buf[0] = 0x0000;
     ESP_LOGI(TAG, "Пакет успешно обработан");
-    free(temp_buf);
 }
 
 /** Ключевые изменения и особенности промышленной реализации:
@@ -433,12 +469,15 @@ void sp_exe_in(const uint8_t *data, size_t data_len, uint16_t *out_buf, size_t *
  * - Коды ошибок в регистре REG_SP_ERROR:
  *      - 0xFFFF: Слишком короткий пакет
  *      - 0xFFFE: Ошибка CRC
- *      - 0xFFFD: Ошибка выделения памяти
+ *      - 0xFFFD: Ошибка выделения памяти (не используется: обработка без выделения памяти)
  *      - 0xFFFC: Ошибка STX/ETX
+ *      - 0xFFFB: Нет ответа за SP_REPLY_TIMEOUT_MS (устанавливается в uart2_task)
  * - Информация о командах и размерах пакетов
  *
  * 5. Производительность:
- * - Эффективный алгоритм дестаффинга
+ * - Один проход по пакету: CRC + дестаффинг + разметка HT/FF (deStaff)
+ * - Обработка на месте в буфере приёма, без malloc/memcpy
+ * - Парсеры используют таблицу разметки вместо повторного сканирования
  * - Прямое преобразование "байты-слова" без промежуточных буферов
  * - Минимальные накладные расходы при обработке
  *
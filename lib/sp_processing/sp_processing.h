@@ -5,6 +5,7 @@
 #include <stddef.h>
 
 // Обработка принятых от целевого прибора данных
-void sp_exe_in(const uint8_t* data, size_t length, uint16_t* out_buf, size_t* out_len);
+// (пакет дестаффируется на месте - буфер data изменяется)
+void sp_exe_in(uint8_t* data, size_t length, uint16_t* out_buf, size_t* out_len);
 
 #endif // SP_PROCESSING_H
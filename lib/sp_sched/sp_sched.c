@@ -0,0 +1,151 @@
+/**
+ * Планировщик периодического опроса шаблонов.
+ *
+ * Выбор следующего шаблона:
+ * 1. Участвуют только шаблоны, срок опроса которых наступил.
+ * 2. Строгий приоритет: меньшее значение prio всегда обслуживается первым.
+ * 3. Внутри одного приоритета - наименьшая виртуальная метка (взвешенная
+ *    справедливая очередь с весом 1/period). При перегрузке шины все шаблоны
+ *    получают одинаковую долю от запрошенной частоты, а не поровну.
+ *    Виртуальное время у каждого приоритета своё: опросы высшего приоритета
+ *    не сбивают метки низшего.
+ *
+ * Пропущенные из-за перегрузки периоды не навёрстываются: после освобождения
+ * шины нет пачки запросов подряд.
+ *
+ * Настройка через регистры (как REG_CONFIG_OPERATION):
+ *   REG_SCHED_PERIOD = период, мс; REG_SCHED_PRIO = приоритет;
+ *   REG_SCHED_OPERATION = номер шаблона              - запись настроек
+ *   REG_SCHED_OPERATION = SCHED_OP_READ | номер       - чтение в PERIOD/PRIO
+ * После выполнения REG_SCHED_OPERATION = 0xFFFF. Записанные настройки сохраняет
+ * вызывающий (uart2_task - в раздел `config` через sp_storage_sched_set()).
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include "sp_sched.h"
+#include "project_config.h"
+#include "esp_log.h"
+#include <stddef.h>
+
+extern uint16_t regs[];
+
+static const char *TAG = "SP_SCHED";
+
+#define SCHED_OP_READ 0x8000 // [15] 1 - чтение настроек, 0 - запись
+
+typedef struct
+{
+    uint16_t period_ms; // Период опроса (0 - не опрашивается)
+    uint8_t prio;       // Приоритет (0 - высший)
+    uint32_t due_ms;    // Срок следующего опроса
+    uint32_t vtag;      // Виртуальная метка справедливой очереди
+} sp_sched_slot_t;
+
+static sp_sched_slot_t slots[SP_STORAGE_FILE_COUNT];
+static uint32_t vtime[SP_SCHED_PRIO_LEVELS]; // Метка последнего обслуженного шаблона приоритета
+
+void sp_sched_set(uint8_t file_id, uint16_t period_ms, uint8_t prio, uint32_t now_ms)
+{
+    if (file_id >= SP_STORAGE_FILE_COUNT)
+        return;
+
+    if (prio >= SP_SCHED_PRIO_LEVELS)
+        prio = SP_SCHED_PRIO_LEVELS - 1;
+
+    sp_sched_slot_t *s = &slots[file_id];
+    s->period_ms = period_ms;
+    s->prio = prio;
+    s->due_ms = now_ms;
+    s->vtag = vtime[prio];
+}
+
+void sp_sched_get(uint8_t file_id, uint16_t *period_ms, uint8_t *prio)
+{
+    if (file_id >= SP_STORAGE_FILE_COUNT)
+    {
+        *period_ms = 0;
+        *prio = 0;
+        return;
+    }
+    *period_ms = slots[file_id].period_ms;
+    *prio = slots[file_id].prio;
+}
+
+int sp_sched_next(uint32_t now_ms)
+{
+    return sp_sched_next_if(now_ms, NULL, NULL);
+}
+
+int sp_sched_next_if(uint32_t now_ms, sp_sched_filter_t accept, void *arg)
+{
+    int best = -1;
+
+    for (int i = 0; i < SP_STORAGE_FILE_COUNT; i++)
+    {
+        const sp_sched_slot_t *s = &slots[i];
+        if (s->period_ms == 0 || (int32_t)(now_ms - s->due_ms) < 0)
+            continue;
+        if (accept && !accept(i, arg))
+            continue;
+
+        if (best < 0 ||
+            s->prio < slots[best].prio ||
+            (s->prio == slots[best].prio && (int32_t)(s->vtag - slots[best].vtag) < 0))
+        {
+            best = i;
+        }
+    }
+    return best;
+}
+
+void sp_sched_done(uint8_t file_id, uint32_t start_ms)
+{
+    if (file_id >= SP_STORAGE_FILE_COUNT)
+        return;
+
+    sp_sched_slot_t *s = &slots[file_id];
+
+    // Шаблон, простаивавший в очереди, не получает накопленного преимущества
+    if ((int32_t)(s->vtag - vtime[s->prio]) < 0)
+        s->vtag = vtime[s->prio];
+    vtime[s->prio] = s->vtag;
+    s->vtag += s->period_ms;
+
+    // Следующий срок; пропущенные периоды не навёрстываются
+    s->due_ms += s->period_ms;
+    if ((int32_t)(start_ms - s->due_ms) > 0)
+        s->due_ms = start_ms;
+}
+
+int sp_sched_handle_registers(uint32_t now_ms)
+{
+    uint16_t op = REG_SCHED_OPERATION;
+    if (op == 0xFFFF)
+        return -1;
+
+    int written = -1;
+    uint8_t file_id = op & 0xFF;
+    if (file_id >= SP_STORAGE_FILE_COUNT)
+    {
+        ESP_LOGE(TAG, "Недопустимый номер шаблона: %d", file_id);
+    }
+    else if (op & SCHED_OP_READ)
+    {
+        uint16_t period_ms;
+        uint8_t prio;
+        sp_sched_get(file_id, &period_ms, &prio);
+        REG_SCHED_PERIOD = period_ms;
+        REG_SCHED_PRIO = prio;
+    }
+    else
+    {
+        sp_sched_set(file_id, REG_SCHED_PERIOD, REG_SCHED_PRIO & 0xFF, now_ms);
+        ESP_LOGI(TAG, "Шаблон %d: период %d мс, приоритет %d",
+                 file_id, REG_SCHED_PERIOD, REG_SCHED_PRIO & 0xFF);
+        written = file_id;
+    }
+
+    REG_SCHED_OPERATION = 0xFFFF;
+    return written;
+}
@@ -0,0 +1,70 @@
+/*=====================================================================================
+ * Description:
+ *  Планировщик периодического опроса шаблонов запросов по сети SP
+ *
+ *  Каждому шаблону раздела `request` можно назначить период опроса и приоритет.
+ *  Шины SP хватает на одну транзакцию за раз, поэтому планировщик только выбирает
+ *  следующий шаблон; отправку и ожидание ответа ведёт uart2_task.
+ *
+ *  Настройки хранятся только в RAM: сохранение в раздел `config` и загрузка при
+ *  включении - в sp_storage.
+ *
+ *  Время - в миллисекундах по модулю 2^32 (xTaskGetTickCount() * portTICK_PERIOD_MS).
+ *====================================================================================*/
+#ifndef _SP_SCHED_H_
+#define _SP_SCHED_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "project_config.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Назначение периода и приоритета шаблону
+     * @param period_ms период опроса, мс (0 - шаблон не опрашивается)
+     * @param prio      приоритет (0 - высший; больше SP_SCHED_PRIO_LEVELS - 1 - как последний)
+     * @param now_ms    текущее время; первый опрос - сразу
+     */
+    void sp_sched_set(uint8_t file_id, uint16_t period_ms, uint8_t prio, uint32_t now_ms);
+
+    /**
+     * @brief Чтение настроек шаблона
+     */
+    void sp_sched_get(uint8_t file_id, uint16_t *period_ms, uint8_t *prio);
+
+    /**
+     * @brief Выбор следующего шаблона для опроса
+     * @return номер шаблона или -1, если срок ни одного не наступил
+     */
+    int sp_sched_next(uint32_t now_ms);
+
+    // Отбор шаблона для sp_sched_next_if()
+    typedef bool (*sp_sched_filter_t)(uint8_t file_id, void *arg);
+
+    /**
+     * @brief Выбор следующего шаблона среди принятых фильтром
+     * @return номер шаблона или -1
+     */
+    int sp_sched_next_if(uint32_t now_ms, sp_sched_filter_t accept, void *arg);
+
+    /**
+     * @brief Учёт выполненного опроса (вызывается при отправке запроса)
+     * @param start_ms время отправки
+     */
+    void sp_sched_done(uint8_t file_id, uint32_t start_ms);
+
+    /**
+     * @brief Обработка регистров REG_SCHED_OPERATION / PERIOD / PRIO
+     * @return номер шаблона, настройки которого записаны (сохраняет вызывающий), иначе -1
+     */
+    int sp_sched_handle_registers(uint32_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _SP_SCHED_H_
@@ -1,8 +1,16 @@
 /**
- * Версия 42*96 с поддержкой трех разделов:
- *      request,  data, 0x40, 0x310000, 0x1000, encrypted
- *      response, data, 0x41, 0x311000, 0x1000, encrypted
- *      config,   data, 0x42, 0x312000, 0x1000, encrypted
+ * Хранилище шлюза: три раздела (partitions.csv):
+ *      config,   data, 0x42, 0x312000, 0x1000,  encrypted
+ *      request,  data, 0x40, 0x313000, 0x10000, encrypted
+ *      response, data, 0x41, 0x323000, 0x10000, encrypted
+ *
+ * Файлы запросов и шаблонов ответа - до SP_STORAGE_FILE_COUNT (240) в каждом
+ * разделе, до SP_STORAGE_FILE_SIZE (192) байт, включая байт длины. Разделы
+ * request/response - журналы rec_log: запись файла добавляет запись переменной
+ * длины (заголовок 16 байт и данные без нулевого хвоста, кратно 16 байтам),
+ * сектор стирается только при переходе журнала на следующий. В 64 КБ
+ * помещаются все 240 файлов наибольшего размера. При смене таблицы разделов
+ * файлы вводятся заново.
  *
  * Раздел config хранит:
  *   - WiFi конфигурацию (STA_SSID, STA_PASSWORD, AP_SSID, AP_PASSWORD)
@@ -10,14 +18,21 @@
  *   - Версию прошивки
  *   - Дату последнего обновления
  *   - Системные параметры
+ *   - Таблицу дополнительных абонентов (units)
+ *   - Расписание опроса шаблонов (период и приоритет, sp_sched)
  *
  * Промышленный контроллер ESP32. ESP-IDF v5.4
  * 12 июля 2025г.
+ * Версия от 18 октября 2025г.
  */
 
 #include "sp_storage.h"
 #include "project_config.h"
 #include "board.h"
+#include "req_cache.h"
+#include "reg_seq.h"
+#include "rec_log.h"
+#include "sp_sched.h"
 #include "esp_partition.h"
 #include "esp_log.h"
 #include "spi_flash_mmap.h"
@@ -31,6 +46,9 @@
 #define SPI_FLASH_SEC_SIZE 4096     // Размер сектора SPI flash
 #define SPI_FLASH_PAGE_SIZE 256     // Размер страницы SPI flash
 #define CONFIG_SIGNATURE 0x55AAC3D9 // Сигнатура валидной конфигурации
+#define SCHED_SIGNATURE 0x5CED0001  // Сигнатура расписания опроса в конфигурации
+
+_Static_assert(sizeof(system_config_t) <= SPI_FLASH_SEC_SIZE, "Конфигурация - в одном секторе");
 
 extern uint16_t regs[];
 extern uint8_t actual_bytes; // Актуальное количество байт данных
@@ -39,10 +57,27 @@ static const char *TAG = "STORAGE"; // Общий тег для логирова
 static const esp_partition_t *request_partition = NULL;
 static const esp_partition_t *response_partition = NULL;
 static const esp_partition_t *config_partition = NULL;
+static rec_log_t request_log;  // Журнал шаблонов запросов
+static rec_log_t response_log; // Журнал шаблонов ответов
+
+// Транзакция записи файлов (REG_SP_TXN): файлы копятся в RAM до SP_TXN_COMMIT
+typedef struct
+{
+    bool response; // Раздел `response`, иначе `request`
+    uint8_t file_id;
+    uint8_t data[SP_STORAGE_FILE_SIZE];
+} sp_txn_file_t;
+
+_Static_assert(SP_TXN_MAX_FILES <= REC_LOG_BATCH_MAX, "Файлы транзакции раздела - один пакет журнала");
+static sp_txn_file_t txn_files[SP_TXN_MAX_FILES];
+static uint8_t txn_count = 0;
+static bool txn_open = false;
 SemaphoreHandle_t reg_mutex;
+static TaskHandle_t storage_task = NULL; // Для пробуждения по записи регистра операции
 
 // Глобальная конфигурация
 static system_config_t current_config;
+static bool config_dirty = false; // Таблица приборов (0x15) или расписание опроса изменены, сохраняет storage_handler_task
 
 // Регистры конфигурации
 #define REG_CONFIG_OPERATION regs[0x1A] // Операция: [15] R/W, [14:8] тип, [7:0] индекс
@@ -60,6 +95,8 @@ static system_config_t current_config;
 #define CONFIG_TYPE_AP 0x04
 #define CONFIG_TYPE_SN 0x05
 #define CONFIG_TYPE_FW 0x06
+#define CONFIG_TYPE_UNIT 0x07 // Индекс - запись таблицы абонентов: 0x20 адрес Modbus, 0x21 DAD,
+                              // 0x22 первый шаблон, 0x23 число шаблонов
 
 // Инициализация разделов хранилища
 esp_err_t storage_init(void)
@@ -93,19 +130,19 @@ esp_err_t storage_init(void)
         return ESP_ERR_NOT_FOUND;
     }
 
-    // Проверка размеров разделов
-    if (request_partition->size < SP_STORAGE_FILE_COUNT * SP_STORAGE_FILE_SIZE)
+    // Проверка размеров разделов (журнал - не меньше REC_LOG_MIN_SECTORS секторов)
+    if (request_partition->size < REC_LOG_MIN_SECTORS * REC_LOG_SECTOR_SIZE)
     {
         ESP_LOGE(TAG, "Недостаточный размер 'request'! Требуется: %ld, доступно: %ld",
-                 (long)SP_STORAGE_FILE_COUNT * SP_STORAGE_FILE_SIZE,
+                 (long)REC_LOG_MIN_SECTORS * REC_LOG_SECTOR_SIZE,
                  (long)request_partition->size);
         return ESP_ERR_INVALID_SIZE;
     }
 
-    if (response_partition->size < SP_STORAGE_FILE_COUNT * SP_STORAGE_FILE_SIZE)
+    if (response_partition->size < REC_LOG_MIN_SECTORS * REC_LOG_SECTOR_SIZE)
     {
         ESP_LOGE(TAG, "Недостаточный размер 'response'! Требуется: %ld, доступно: %ld",
-                 (long)SP_STORAGE_FILE_COUNT * SP_STORAGE_FILE_SIZE,
+                 (long)REC_LOG_MIN_SECTORS * REC_LOG_SECTOR_SIZE,
                  (long)response_partition->size);
         return ESP_ERR_INVALID_SIZE;
     }
@@ -126,63 +163,15 @@ esp_err_t storage_init(void)
     ESP_LOGI(TAG, "'config': адрес 0x%lx, размер %ld",
              config_partition->address, config_partition->size);
 
-    return ESP_OK;
-}
-
-// Общая функция чтения файла из раздела
-static esp_err_t read_from_partition(const esp_partition_t *part, uint8_t file_id, uint8_t *data)
-{
-    if (file_id >= SP_STORAGE_FILE_COUNT || !part)
-        return ESP_ERR_INVALID_ARG;
-
-    size_t offset = file_id * SP_STORAGE_FILE_SIZE;
-    return esp_partition_read(part, offset, data, SP_STORAGE_FILE_SIZE);
-}
-
-// Общая функция записи файла в раздел
-static esp_err_t write_to_partition(const esp_partition_t *part, uint8_t file_id, const uint8_t *data)
-{
-    if (file_id >= SP_STORAGE_FILE_COUNT || !part)
-        return ESP_ERR_INVALID_ARG;
-
-    size_t offset = file_id * SP_STORAGE_FILE_SIZE;
-    uint32_t sector_offset = (offset / SPI_FLASH_SEC_SIZE) * SPI_FLASH_SEC_SIZE;
-
-    // Буфер для сектора
-    uint8_t *sector_buf = malloc(SPI_FLASH_SEC_SIZE);
-    if (!sector_buf)
-        return ESP_ERR_NO_MEM;
-
-    // Чтение сектора
-    esp_err_t err = esp_partition_read(part, sector_offset, sector_buf, SPI_FLASH_SEC_SIZE);
-    if (err != ESP_OK)
-    {
-        free(sector_buf);
-        return err;
-    }
-
-    // Обновление данных
-    size_t internal_offset = offset - sector_offset;
-    memcpy(sector_buf + internal_offset, data, SP_STORAGE_FILE_SIZE);
-
-    // Стирание сектора
-    err = esp_partition_erase_range(part, sector_offset, SPI_FLASH_SEC_SIZE);
+    // Индексы журналов шаблонов
+    esp_err_t err = rec_log_mount(&request_log, request_partition);
+    if (err == ESP_OK)
+        err = rec_log_mount(&response_log, response_partition);
+    // Транзакция, прерванная сбросом: пакет ответов - по отметке фиксации журнала запросов
+    if (err == ESP_OK)
+        err = rec_log_txn_recover(&request_log, &response_log);
     if (err != ESP_OK)
-    {
-        free(sector_buf);
-        return err;
-    }
-
-    // Постраничная запись
-    for (int i = 0; i < SPI_FLASH_SEC_SIZE; i += SPI_FLASH_PAGE_SIZE)
-    {
-        err = esp_partition_write(part, sector_offset + i,
-                                  sector_buf + i, SPI_FLASH_PAGE_SIZE);
-        if (err != ESP_OK)
-            break;
-    }
-
-    free(sector_buf);
+        ESP_LOGE(TAG, "Ошибка монтирования журнала шаблонов: 0x%x", err);
     return err;
 }
 
@@ -288,11 +277,21 @@ esp_err_t sp_storage_config_init(system_config_t *config)
 
         config->last_update = time(NULL);
         config->flags = 0;
+        config->sched_signature = SCHED_SIGNATURE;
 
         // Сохранение конфигурации
         return config_save(config);
     }
 
+    // Конфигурация, сохранённая до появления расписания: на его месте стёртый flash
+    if (config->sched_signature != SCHED_SIGNATURE)
+    {
+        config->sched_signature = SCHED_SIGNATURE;
+        memset(config->sched_period, 0, sizeof(config->sched_period));
+        memset(config->sched_prio, 0, sizeof(config->sched_prio));
+        return config_save(config);
+    }
+
     return ESP_OK;
 }
 
@@ -304,22 +303,158 @@ esp_err_t request_init(void) { return storage_init(); }
 
 esp_err_t request_read_file(uint8_t file_id, uint8_t *data)
 {
-    return read_from_partition(request_partition, file_id, data);
+    return rec_log_read(&request_log, file_id, data);
+}
+
+// Запись файла в журнал; no_erase - без стирания сектора (ESP_ERR_INVALID_STATE - нет места)
+static esp_err_t storage_log_write(bool response, uint8_t file_id, const uint8_t *data, bool no_erase)
+{
+    rec_log_t *log = response ? &response_log : &request_log;
+    esp_err_t err = no_erase ? rec_log_write_no_erase(log, file_id, data) : rec_log_write(log, file_id, data);
+
+    // Кадр запроса собран из старого шаблона. При ошибке журнал мог быть
+    // уплотнён частично - сбрасываем кадры всех шаблонов
+    if (!response && err == ESP_OK)
+        req_cache_invalidate(file_id);
+    else if (!response && err != ESP_ERR_INVALID_STATE)
+        req_cache_invalidate_all();
+
+    return err;
 }
 
 esp_err_t request_write_file(uint8_t file_id, const uint8_t *data)
 {
-    return write_to_partition(request_partition, file_id, data);
+    return storage_log_write(false, file_id, data, false);
 }
 
 esp_err_t response_read_file(uint8_t file_id, uint8_t *data)
 {
-    return read_from_partition(response_partition, file_id, data);
+    return rec_log_read(&response_log, file_id, data);
 }
 
 esp_err_t response_write_file(uint8_t file_id, const uint8_t *data)
 {
-    return write_to_partition(response_partition, file_id, data);
+    return storage_log_write(true, file_id, data, false);
+}
+
+const uint8_t *request_view_begin(uint8_t file_id)
+{
+    return rec_log_view_begin(&request_log, file_id);
+}
+
+void request_view_end(void)
+{
+    rec_log_view_end(&request_log);
+}
+
+const uint8_t *response_view_begin(uint8_t file_id)
+{
+    return rec_log_view_begin(&response_log, file_id);
+}
+
+void response_view_end(void)
+{
+    rec_log_view_end(&response_log);
+}
+
+// Запись файла: в транзакции - в RAM (повторная запись файла заменяет прежнюю).
+// no_erase - см. storage_log_write()
+static esp_err_t storage_write_file(bool response, uint8_t file_id, const uint8_t *data, bool no_erase)
+{
+    if (!txn_open)
+        return storage_log_write(response, file_id, data, no_erase);
+
+    int i = 0;
+    while (i < txn_count && (txn_files[i].response != response || txn_files[i].file_id != file_id))
+        i++;
+    if (i == SP_TXN_MAX_FILES)
+    {
+        ESP_LOGE(TAG, "Транзакция: больше %d файлов - отменена", SP_TXN_MAX_FILES);
+        txn_open = false;
+        txn_count = 0;
+        REG_SP_TXN = SP_TXN_ERROR;
+        return ESP_ERR_NO_MEM;
+    }
+    if (i == txn_count)
+        txn_count++;
+
+    txn_files[i].response = response;
+    txn_files[i].file_id = file_id;
+    memcpy(txn_files[i].data, data, SP_STORAGE_FILE_SIZE);
+    REG_SP_TXN = SP_TXN_OPEN | txn_count;
+    return ESP_OK;
+}
+
+// Файл, накопленный в открытой транзакции, или NULL
+static const uint8_t *storage_txn_file(bool response, uint8_t file_id)
+{
+    for (int i = 0; txn_open && i < txn_count; i++)
+        if (txn_files[i].response == response && txn_files[i].file_id == file_id)
+            return txn_files[i].data;
+    return NULL;
+}
+
+// Запись накопленных файлов: пакеты обоих журналов одной транзакцией rec_log -
+// после сбоя питания применяются оба или ни один
+static esp_err_t storage_txn_flush(void)
+{
+    uint8_t ids[2][SP_TXN_MAX_FILES];
+    uint8_t n[2] = {0, 0};
+    uint8_t *data = malloc(2 * SP_TXN_MAX_FILES * SP_STORAGE_FILE_SIZE);
+    if (!data)
+        return ESP_ERR_NO_MEM;
+
+    for (int i = 0; i < txn_count; i++)
+    {
+        int half = txn_files[i].response ? 1 : 0;
+        ids[half][n[half]] = txn_files[i].file_id;
+        memcpy(data + (half * SP_TXN_MAX_FILES + n[half]) * SP_STORAGE_FILE_SIZE, txn_files[i].data,
+               SP_STORAGE_FILE_SIZE);
+        n[half]++;
+    }
+
+    esp_err_t err = ESP_OK;
+    if (n[0] + n[1] > 0)
+        err = rec_log_write_txn(&request_log, ids[0], data, n[0], &response_log, ids[1],
+                                data + SP_TXN_MAX_FILES * SP_STORAGE_FILE_SIZE, n[1]);
+    free(data);
+
+    // Кадры запросов собраны из старых шаблонов
+    if (n[0] > 0)
+    {
+        if (err == ESP_OK)
+            for (uint8_t k = 0; k < n[0]; k++)
+                req_cache_invalidate(ids[0][k]);
+        else
+            req_cache_invalidate_all();
+    }
+    return err;
+}
+
+// Команда REG_SP_TXN
+static void storage_txn_handle(void)
+{
+    uint16_t cmd = REG_SP_TXN;
+    if (cmd == SP_TXN_BEGIN)
+    {
+        txn_open = true;
+        txn_count = 0;
+        REG_SP_TXN = SP_TXN_OPEN;
+    }
+    else if (cmd == SP_TXN_COMMIT && txn_open)
+    {
+        esp_err_t err = storage_txn_flush();
+        ESP_LOGI(TAG, "Транзакция: %d файлов, 0x%x", txn_count, err);
+        txn_open = false;
+        txn_count = 0;
+        REG_SP_TXN = err == ESP_OK ? 0xFFFF : SP_TXN_ERROR;
+    }
+    else if (cmd == SP_TXN_ABORT || cmd == SP_TXN_COMMIT)
+    {
+        txn_open = false;
+        txn_count = 0;
+        REG_SP_TXN = 0xFFFF;
+    }
 }
 
 // Обработчик операций с хранилищем
@@ -330,6 +465,13 @@ void storage_handler_task(void *arg)
     {
         ESP_LOGE(TAG, "Ошибка инициализации конфигурации");
     }
+    for (int i = 0; i < SP_UNIT_COUNT; i++)
+        sp_units_set(i, &current_config.units[i]);
+    uint32_t now_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    for (int i = 0; i < SP_STORAGE_FILE_COUNT; i++)
+        if (current_config.sched_period[i])
+            sp_sched_set(i, current_config.sched_period[i], current_config.sched_prio[i], now_ms);
+    REG_SP_TXN = 0xFFFF;
 
     while (1)
     {
@@ -347,7 +489,8 @@ void storage_handler_task(void *arg)
 
                 if (is_read)
                 {
-                    // Операция чтения конфигурации
+                    // Операция чтения конфигурации (окно регистров - одной записью)
+                    reg_seq_write_begin();
                     switch (config_type)
                     {
                     case CONFIG_TYPE_STA0:
@@ -415,7 +558,21 @@ void storage_handler_task(void *arg)
                         }
                         break;
                     }
+
+                    case CONFIG_TYPE_UNIT:
+                    {
+                        if (config_idx < SP_UNIT_COUNT)
+                        {
+                            const sp_unit_cfg_t *u = &current_config.units[config_idx];
+                            regs[HLD_CONFIG_DATA_REG + 0] = u->mb_addr;
+                            regs[HLD_CONFIG_DATA_REG + 1] = u->dad;
+                            regs[HLD_CONFIG_DATA_REG + 2] = u->file_first;
+                            regs[HLD_CONFIG_DATA_REG + 3] = u->file_count;
+                        }
+                        break;
+                    }
                     }
+                    reg_seq_write_result_end();
                 }
                 else
                 {
@@ -503,6 +660,22 @@ void storage_handler_task(void *arg)
                         ESP_LOGI(TAG, "Updated SN: %s", serial);
                         break;
                     }
+
+                    case CONFIG_TYPE_UNIT:
+                    {
+                        if (config_idx < SP_UNIT_COUNT)
+                        {
+                            sp_unit_cfg_t *u = &current_config.units[config_idx];
+                            u->mb_addr = regs[HLD_CONFIG_DATA_REG + 0];
+                            u->dad = regs[HLD_CONFIG_DATA_REG + 1];
+                            u->file_first = regs[HLD_CONFIG_DATA_REG + 2];
+                            u->file_count = regs[HLD_CONFIG_DATA_REG + 3];
+                            sp_units_set(config_idx, u);
+                            ESP_LOGI(TAG, "Updated unit %d: MB=%d DAD=%d files %d+%d", config_idx,
+                                     u->mb_addr, u->dad, u->file_first, u->file_count);
+                        }
+                        break;
+                    }
                     }
 
                     // Обновление метки времени
@@ -511,6 +684,7 @@ void storage_handler_task(void *arg)
                     // Сохранение конфигурации
                     if (config_save(&current_config) == ESP_OK)
                     {
+                        config_dirty = false;
                         ESP_LOGI(TAG, "Configuration saved");
                     }
                     else
@@ -524,6 +698,10 @@ void storage_handler_task(void *arg)
                 REG_CONFIG_INDEX = 0xFFFF;
             }
 
+            // --- Транзакция записи файлов: начало - до записи файлов этого прохода ---
+            if (REG_SP_TXN == SP_TXN_BEGIN)
+                storage_txn_handle();
+
             // --- Обработка разделов request/response ---
             // Обработка чтения REQUEST
             if (REG_SP_READ_REQ != 0xFFFF)
@@ -555,10 +733,12 @@ void storage_handler_task(void *arg)
                         }
 
                         // Упаковка в регистры
+                        reg_seq_write_begin();
                         for (int i = 0; i < SP_STORAGE_FILE_SIZE / 2; i++)
                         {
                             regs[HLD_READ_REG + i] = (file_buf[i * 2] << 8) | file_buf[i * 2 + 1];
                         }
+                        reg_seq_write_result_end();
                     }
                 }
                 REG_SP_READ_REQ = 0xFFFF; // Сброс флага
@@ -580,11 +760,11 @@ void storage_handler_task(void *arg)
                     }
 
                     // Форматирование данных: [длина][данные]
-                    // Не обнуляем хвост - сохраняем как есть (0xFF после стирания)
+                    // Хвост после данных - нули: в журнал он не записывается (rec_log)
                     uint8_t *write_buf = malloc(SP_STORAGE_FILE_SIZE);
                     if (write_buf)
                     {
-                        memset(write_buf, 0xFF, SP_STORAGE_FILE_SIZE); // Заполняем 0xFF
+                        memset(write_buf, 0, SP_STORAGE_FILE_SIZE);    // Заполняем нулями
                         write_buf[0] = actual_bytes;                   // Байт длины
 
                         // Копируем только актуальные данные
@@ -593,7 +773,7 @@ void storage_handler_task(void *arg)
                             memcpy(write_buf + 1, file_buf, actual_bytes);
                         }
 
-                        request_write_file(file_id, write_buf);
+                        storage_write_file(false, file_id, write_buf, false);
                         free(write_buf);
                     }
                 }
@@ -630,10 +810,12 @@ void storage_handler_task(void *arg)
                         }
 
                         // Упаковка в регистры
+                        reg_seq_write_begin();
                         for (int i = 0; i < SP_STORAGE_FILE_SIZE / 2; i++)
                         {
                             regs[HLD_READ_RESP_REG + i] = (file_buf[i * 2] << 8) | file_buf[i * 2 + 1];
                         }
+                        reg_seq_write_result_end();
                     }
                 }
                 REG_SP_READ_RESP = 0xFFFF; // Сброс флага
@@ -655,11 +837,11 @@ void storage_handler_task(void *arg)
                     }
 
                     // Форматирование данных: [длина][данные]
-                    // Не обнуляем хвост - сохраняем как есть (0xFF после стирания)
+                    // Хвост после данных - нули: в журнал он не записывается (rec_log)
                     uint8_t *write_buf = malloc(SP_STORAGE_FILE_SIZE);
                     if (write_buf)
                     {
-                        memset(write_buf, 0xFF, SP_STORAGE_FILE_SIZE); // Заполняем 0xFF
+                        memset(write_buf, 0, SP_STORAGE_FILE_SIZE);    // Заполняем нулями
                         write_buf[0] = actual_bytes;                   // Байт длины
 
                         // Копируем только актуальные данные
@@ -668,19 +850,160 @@ void storage_handler_task(void *arg)
                             memcpy(write_buf + 1, file_buf, actual_bytes);
                         }
 
-                        response_write_file(file_id, write_buf);
+                        storage_write_file(true, file_id, write_buf, false);
                         free(write_buf);
                     }
                 }
                 REG_SP_WRITE_RESP = 0xFFFF; // Сброс флага
             }
 
+            // --- Фиксация/отмена транзакции - после записи файлов этого прохода ---
+            if (REG_SP_TXN == SP_TXN_COMMIT || REG_SP_TXN == SP_TXN_ABORT)
+                storage_txn_handle();
+
+            // Место в рабочем секторе журналов: запись 0x15 (sp_storage_file_put) не стирает
+            // сектор, пока мастер ждёт ответа, - переход на следующий сектор делается здесь
+            rec_log_make_room(&request_log);
+            rec_log_make_room(&response_log);
+
+            // Таблица приборов, записанная функцией 0x15, и расписание опроса: сохранение со
+            // стиранием сектора - здесь, мастер получил ответ сразу после изменения в RAM.
+            // При ошибке - повтор
+            if (config_dirty && config_save(&current_config) == ESP_OK)
+            {
+                config_dirty = false;
+                ESP_LOGI(TAG, "Configuration saved");
+            }
+
             xSemaphoreGive(reg_mutex);
         }
-        vTaskDelay(50 / portTICK_PERIOD_MS);
+        // Операция - по записи регистра (sp_storage_notify) или не позже чем через 50 мс
+        ulTaskNotifyTake(pdTRUE, 50 / portTICK_PERIOD_MS);
     }
 }
 
+void sp_storage_notify(void)
+{
+    if (storage_task)
+        xTaskNotifyGive(storage_task);
+}
+
+esp_err_t sp_storage_file_get(bool response, uint8_t file_id, uint8_t offset, uint8_t *dst, uint8_t len)
+{
+    if (file_id >= SP_STORAGE_FILE_COUNT || offset + len > SP_STORAGE_FILE_SIZE)
+        return ESP_ERR_INVALID_ARG;
+    if (!reg_mutex)
+        return ESP_ERR_INVALID_STATE;
+    if (!xSemaphoreTake(reg_mutex, pdMS_TO_TICKS(SP_STORAGE_LOCK_MS)))
+        return ESP_ERR_TIMEOUT;
+
+    // Файл в журнале может быть короче SP_STORAGE_FILE_SIZE - чтение с дополнением нулями
+    uint8_t buf[SP_STORAGE_FILE_SIZE];
+    esp_err_t err = ESP_OK;
+    const uint8_t *staged = storage_txn_file(response, file_id);
+    if (staged)
+        memcpy(buf, staged, SP_STORAGE_FILE_SIZE);
+    else
+        err = response ? response_read_file(file_id, buf) : request_read_file(file_id, buf);
+    if (err == ESP_OK)
+        memcpy(dst, buf + offset, len);
+
+    xSemaphoreGive(reg_mutex);
+    return err;
+}
+
+esp_err_t sp_storage_file_put(bool response, uint8_t file_id, uint8_t offset, const uint8_t *src, uint8_t len)
+{
+    if (file_id >= SP_STORAGE_FILE_COUNT || offset + len > SP_STORAGE_FILE_SIZE)
+        return ESP_ERR_INVALID_ARG;
+    if (!reg_mutex)
+        return ESP_ERR_INVALID_STATE;
+    if (!xSemaphoreTake(reg_mutex, pdMS_TO_TICKS(SP_STORAGE_LOCK_MS)))
+        return ESP_ERR_TIMEOUT;
+
+    // Часть файла: остальное - из транзакции или из журнала
+    uint8_t buf[SP_STORAGE_FILE_SIZE];
+    esp_err_t err = ESP_OK;
+    const uint8_t *staged = storage_txn_file(response, file_id);
+    if (staged)
+        memcpy(buf, staged, SP_STORAGE_FILE_SIZE);
+    else if (len < SP_STORAGE_FILE_SIZE)
+        err = response ? response_read_file(file_id, buf) : request_read_file(file_id, buf);
+
+    if (err == ESP_OK)
+    {
+        memcpy(buf + offset, src, len);
+        err = storage_write_file(response, file_id, buf, true);
+    }
+    if (err == ESP_ERR_INVALID_STATE)
+    {
+        // Рабочий сектор журнала заполнен: переход - в storage_handler_task, мастер повторит
+        ESP_LOGW(TAG, "Файл %d: журнал переходит на новый сектор - повторите запись", file_id);
+        sp_storage_notify();
+        err = ESP_ERR_TIMEOUT;
+    }
+
+    xSemaphoreGive(reg_mutex);
+    return err;
+}
+
+esp_err_t sp_storage_unit_get(uint8_t slot, sp_unit_cfg_t *cfg)
+{
+    if (slot >= SP_UNIT_COUNT)
+        return ESP_ERR_INVALID_ARG;
+    if (!reg_mutex)
+        return ESP_ERR_INVALID_STATE;
+    if (!xSemaphoreTake(reg_mutex, pdMS_TO_TICKS(SP_STORAGE_LOCK_MS)))
+        return ESP_ERR_TIMEOUT;
+
+    *cfg = current_config.units[slot];
+
+    xSemaphoreGive(reg_mutex);
+    return ESP_OK;
+}
+
+esp_err_t sp_storage_unit_set(uint8_t slot, const sp_unit_cfg_t *cfg)
+{
+    if (slot >= SP_UNIT_COUNT)
+        return ESP_ERR_INVALID_ARG;
+    if (!reg_mutex)
+        return ESP_ERR_INVALID_STATE;
+    if (!xSemaphoreTake(reg_mutex, pdMS_TO_TICKS(SP_STORAGE_LOCK_MS)))
+        return ESP_ERR_TIMEOUT;
+
+    // Запись - только в RAM: раздел `config` сохраняет storage_handler_task
+    current_config.units[slot] = *cfg;
+    sp_units_set(slot, cfg);
+    current_config.last_update = time(NULL);
+    config_dirty = true;
+    ESP_LOGI(TAG, "Updated unit %d: MB=%d DAD=%d files %d+%d", slot,
+             cfg->mb_addr, cfg->dad, cfg->file_first, cfg->file_count);
+
+    xSemaphoreGive(reg_mutex);
+    sp_storage_notify();
+    return ESP_OK;
+}
+
+esp_err_t sp_storage_sched_set(uint8_t file_id, uint16_t period_ms, uint8_t prio)
+{
+    if (file_id >= SP_STORAGE_FILE_COUNT)
+        return ESP_ERR_INVALID_ARG;
+    if (!reg_mutex)
+        return ESP_ERR_INVALID_STATE;
+    if (!xSemaphoreTake(reg_mutex, pdMS_TO_TICKS(SP_STORAGE_LOCK_MS)))
+        return ESP_ERR_TIMEOUT;
+
+    // Запись - только в RAM: раздел `config` сохраняет storage_handler_task
+    current_config.sched_period[file_id] = period_ms;
+    current_config.sched_prio[file_id] = prio;
+    current_config.last_update = time(NULL);
+    config_dirty = true;
+
+    xSemaphoreGive(reg_mutex);
+    sp_storage_notify();
+    return ESP_OK;
+}
+
 /* Основная функция инициализации хранилищ */
 void start_storage_task()
 {
@@ -714,7 +1037,7 @@ void start_storage_task()
                 5120,
                 NULL,
                 configMAX_PRIORITIES - 2,
-                NULL);
+                &storage_task);
 }
 
 /**
@@ -2,8 +2,10 @@
 #define SP_STORAGE_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "esp_err.h"
 #include "time.h"
+#include "sp_units.h"
 
 // Структура конфигурации
 typedef struct
@@ -17,10 +19,17 @@ typedef struct
     char firmware_version[16]; // Версия прошивки
     time_t last_update;        // Время последнего обновления
     uint32_t flags;            // Флаги конфигурации
+    sp_unit_cfg_t units[SP_UNIT_COUNT]; // Дополнительные адреса Modbus (стёртый flash - не используются)
+    uint32_t sched_signature;                      // SCHED_SIGNATURE - расписание опроса записано
+    uint16_t sched_period[SP_STORAGE_FILE_COUNT];  // Период опроса шаблона, мс (0 - не опрашивается)
+    uint8_t sched_prio[SP_STORAGE_FILE_COUNT];     // Приоритет опроса шаблона
 } system_config_t;
 
 void start_storage_task(void);
 
+// Пробуждение storage_handler_task после записи регистра операции (0x0C-0x0F, 0x1A)
+void sp_storage_notify(void);
+
 esp_err_t sp_storage_config_init(system_config_t *config);
 
 esp_err_t request_read_file(uint8_t file_id, uint8_t *data);
@@ -31,4 +40,28 @@ esp_err_t response_read_file(uint8_t file_id, uint8_t *data);
 
 esp_err_t response_write_file(uint8_t file_id, const uint8_t *data);
 
+// Файл без копирования (отображение раздела в память): указатель действителен
+// до *_view_end(), запись раздела в это время ждёт. NULL - неверный индекс.
+// Доступны 1 + data[0] байт (файл в журнале хранится без нулевого хвоста)
+const uint8_t *request_view_begin(uint8_t file_id);
+void request_view_end(void);
+const uint8_t *response_view_begin(uint8_t file_id);
+void response_view_end(void);
+
+// Доступ из других задач (Modbus 0x14/0x15) - под мьютексом прохода storage_handler_task.
+// Часть файла [offset, offset + len); в открытой транзакции (REG_SP_TXN) - её копия файла.
+// ESP_ERR_TIMEOUT - проход не завершился за SP_STORAGE_LOCK_MS или (запись) рабочий сектор
+// журнала заполнен: запись не стирает flash, переход на новый сектор - в следующем проходе
+esp_err_t sp_storage_file_get(bool response, uint8_t file_id, uint8_t offset, uint8_t *dst, uint8_t len);
+esp_err_t sp_storage_file_put(bool response, uint8_t file_id, uint8_t offset, const uint8_t *src, uint8_t len);
+
+// Запись таблицы абонентов: применение сразу, раздел `config` сохраняет следующий проход
+// storage_handler_task (стирание сектора - не в задаче, ждущей ответа)
+esp_err_t sp_storage_unit_get(uint8_t slot, sp_unit_cfg_t *cfg);
+esp_err_t sp_storage_unit_set(uint8_t slot, const sp_unit_cfg_t *cfg);
+
+// Расписание опроса шаблона (0x1C-0x1E): применяет sp_sched, сохранение в раздел `config` -
+// так же, следующим проходом storage_handler_task
+esp_err_t sp_storage_sched_set(uint8_t file_id, uint16_t period_ms, uint8_t prio);
+
 #endif // SP_STORAGE_H
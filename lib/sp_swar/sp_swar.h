@@ -0,0 +1,78 @@
+/*=====================================================================================
+ * Description:
+ *  Поиск управляющих байтов SP по 4 байта за шаг (SWAR - SIMD within a register)
+ *
+ *  В ответах СПТ961 управляющие байты редки: значения и единицы - печатные символы.
+ *  Функции возвращают длину начального участка без искомых байтов (кратную 4),
+ *  этот участок копируется целиком; байты вокруг управляющих обрабатываются
+ *  побайтно. Загрузка слова через memcpy - без невыровненного доступа на Xtensa.
+ *====================================================================================*/
+#ifndef _SP_SWAR_H_
+#define _SP_SWAR_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "project_config.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SP_SWAR_ONES 0x01010101u
+#define SP_SWAR_HIGHS 0x80808080u
+
+    static inline uint32_t sp_swar_load(const uint8_t *p)
+    {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    // Не 0, если в слове есть байт меньше n (n <= 128)
+    static inline uint32_t sp_swar_less(uint32_t v, uint8_t n)
+    {
+        return (v - SP_SWAR_ONES * n) & ~v & SP_SWAR_HIGHS;
+    }
+
+    // Не 0, если в слове есть байт b
+    static inline uint32_t sp_swar_has(uint32_t v, uint8_t b)
+    {
+        return sp_swar_less(v ^ (SP_SWAR_ONES * b), 1);
+    }
+
+    // Точная маска байтов, равных b: старший бит каждого такого байта (без ложных срабатываний)
+    static inline uint32_t sp_swar_eq_mask(uint32_t v, uint8_t b)
+    {
+        uint32_t x = v ^ (SP_SWAR_ONES * b);
+        return ~(((x & ~SP_SWAR_HIGHS) + ~SP_SWAR_HIGHS) | x) & SP_SWAR_HIGHS;
+    }
+
+    // Номер байта слова по биту маски (порядок байтов little-endian: ESP32 и x86)
+    static inline unsigned sp_swar_byte_index(uint32_t mask)
+    {
+        return (unsigned)__builtin_ctz(mask) >> 3;
+    }
+
+    /**
+     * @brief Участок без байтов, требующих стаффинга (SOH STX ETX - все меньше 4, ISI)
+     */
+    static inline size_t sp_swar_clean_staff(const uint8_t *p, size_t len)
+    {
+        size_t i = 0;
+        while (i + 4 <= len)
+        {
+            uint32_t v = sp_swar_load(p + i);
+            if (sp_swar_less(v, ETX + 1) | sp_swar_has(v, ISI))
+                break;
+            i += 4;
+        }
+        return i;
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _SP_SWAR_H_
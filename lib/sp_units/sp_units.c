@@ -0,0 +1,93 @@
+/**
+ * Дополнительные адреса Modbus шлюза.
+ *
+ * Таблица небольшая (SP_UNIT_COUNT), поиск - линейный. Запись - из
+ * storage_handler_task (загрузка и изменение конфигурации), чтение - из
+ * uart1_task (адрес кадра) и uart2_task (DAD и шаблоны транзакции) под portMUX.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include "sp_units.h"
+#include "freertos/FreeRTOS.h"
+
+extern uint16_t regs[];
+
+static sp_unit_cfg_t sp_units[SP_UNIT_COUNT];
+static portMUX_TYPE sp_units_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static bool sp_unit_used(const sp_unit_cfg_t *u)
+{
+    return u->mb_addr >= 1 && u->mb_addr <= 247;
+}
+
+void sp_units_set(uint8_t slot, const sp_unit_cfg_t *cfg)
+{
+    if (slot >= SP_UNIT_COUNT)
+        return;
+
+    portENTER_CRITICAL(&sp_units_mux);
+    sp_units[slot] = *cfg;
+    portEXIT_CRITICAL(&sp_units_mux);
+}
+
+int sp_unit_find(uint8_t mb_addr)
+{
+    if (mb_addr == REG_MODBUS_SLAVE_ADDR)
+        return SP_UNIT_PRIMARY;
+
+    int unit = -1;
+    portENTER_CRITICAL(&sp_units_mux);
+    for (int i = 0; i < SP_UNIT_COUNT; i++)
+    {
+        if (sp_unit_used(&sp_units[i]) && sp_units[i].mb_addr == mb_addr)
+        {
+            unit = i + 1;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&sp_units_mux);
+    return unit;
+}
+
+uint8_t sp_unit_dad(int unit)
+{
+    if (unit <= SP_UNIT_PRIMARY || unit > SP_UNIT_COUNT)
+        return REG_SP_DAD_ADDR;
+
+    portENTER_CRITICAL(&sp_units_mux);
+    uint8_t dad = sp_units[unit - 1].dad;
+    portEXIT_CRITICAL(&sp_units_mux);
+    return dad;
+}
+
+int sp_unit_file(int unit, uint8_t id)
+{
+    if (unit <= SP_UNIT_PRIMARY || unit > SP_UNIT_COUNT)
+        return id;
+
+    portENTER_CRITICAL(&sp_units_mux);
+    sp_unit_cfg_t u = sp_units[unit - 1];
+    portEXIT_CRITICAL(&sp_units_mux);
+
+    if (id >= u.file_count || u.file_first + id >= SP_STORAGE_FILE_COUNT)
+        return -1;
+    return u.file_first + id;
+}
+
+int sp_unit_of_file(uint8_t file_id)
+{
+    int unit = SP_UNIT_PRIMARY;
+    portENTER_CRITICAL(&sp_units_mux);
+    for (int i = 0; i < SP_UNIT_COUNT; i++)
+    {
+        const sp_unit_cfg_t *u = &sp_units[i];
+        if (sp_unit_used(u) && file_id >= u->file_first && file_id - u->file_first < u->file_count)
+        {
+            unit = i + 1;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&sp_units_mux);
+    return unit;
+}
@@ -0,0 +1,66 @@
+/*=====================================================================================
+ * Description:
+ *  Дополнительные адреса Modbus шлюза (несколько приборов на одном сегменте SP)
+ *
+ *  Абонент 0 (SP_UNIT_PRIMARY) - адрес REG_MODBUS_SLAVE_ADDR, прибор REG_SP_DAD_ADDR,
+ *  все шаблоны, окно результата в regs[]. Абоненты 1 ... SP_UNIT_COUNT - из таблицы
+ *  в разделе `config` (тип CONFIG_TYPE_UNIT): свой адрес Modbus, свой DAD, свой набор
+ *  шаблонов (индексы file_first ... file_first + file_count - 1) и своё окно результата
+ *  (reg_seq_read_unit). Обмен всех абонентов идёт через один порт SP по очереди.
+ *====================================================================================*/
+#ifndef _SP_UNITS_H_
+#define _SP_UNITS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "project_config.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SP_UNIT_PRIMARY 0 // Основной адрес шлюза
+
+    // Запись таблицы абонентов (хранится в system_config_t)
+    typedef struct
+    {
+        uint8_t mb_addr;    // Адрес Modbus 1 ... 247 (иное - запись не используется)
+        uint8_t dad;        // Магистральный адрес прибора в сети SP
+        uint8_t file_first; // Первый шаблон набора абонента
+        uint8_t file_count; // Число шаблонов набора (0 - только запросы без шаблона)
+    } sp_unit_cfg_t;
+
+    /**
+     * @brief Загрузка/изменение записи таблицы (абонент slot + 1)
+     * @param slot 0 ... SP_UNIT_COUNT - 1
+     */
+    void sp_units_set(uint8_t slot, const sp_unit_cfg_t *cfg);
+
+    /**
+     * @brief Абонент по адресу Modbus
+     * @return SP_UNIT_PRIMARY, 1 ... SP_UNIT_COUNT или -1 - адрес не шлюза
+     */
+    int sp_unit_find(uint8_t mb_addr);
+
+    /**
+     * @brief Магистральный адрес прибора абонента
+     */
+    uint8_t sp_unit_dad(int unit);
+
+    /**
+     * @brief Индекс шаблона по номеру id в наборе абонента
+     * @return индекс файла или -1 - id вне набора
+     */
+    int sp_unit_file(int unit, uint8_t id);
+
+    /**
+     * @brief Абонент, в набор которого входит шаблон (периодический опрос)
+     */
+    int sp_unit_of_file(uint8_t file_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _SP_UNITS_H_
@@ -1,6 +1,9 @@
 #include "staff.h"
 #include "project_config.h"
+#include "sp_crc.h"
+#include "sp_swar.h"
 #include <stdint.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -16,6 +19,18 @@ int staff(const uint8_t *input, size_t input_len, uint8_t *output, size_t output
     size_t j = 0;
     for (size_t i = 0; i < input_len; i++)
     {
+        // Участок без управляющих байтов - одним копированием
+        size_t run = sp_swar_clean_staff(input + i, input_len - i);
+        if (run > 0)
+        {
+            if (j + run > output_max_len)
+                return 0;
+            memcpy(output + j, input + i, run);
+            j += run;
+            i += run - 1;
+            continue;
+        }
+
         // Определяем, сколько байт нужно записать
         size_t required = (input[i] == SOH || input[i] == ISI || input[i] == STX || input[i] == ETX) ? 2 : 1;
 
@@ -58,3 +73,51 @@ int staff(const uint8_t *input, size_t input_len, uint8_t *output, size_t output
 
     return j;
 }
+
+int staff_frame(const uint8_t *input, size_t input_len, uint8_t *output, size_t output_max_len)
+{
+    // Первый байт - SOH: DLE SOH в CRC не входят
+    if (input_len == 0 || input[0] != SOH || output_max_len < 4)
+        return 0;
+
+    output[0] = DLE;
+    output[1] = SOH;
+    size_t j = 2;
+    uint16_t crc = sp_crc16_init();
+
+    for (size_t i = 1; i < input_len; i++)
+    {
+        // Участок без управляющих байтов - копирование и CRC одним блоком
+        size_t run = sp_swar_clean_staff(input + i, input_len - i);
+        if (run > 0)
+        {
+            if (j + run + 2 > output_max_len)
+                return 0;
+            memcpy(output + j, input + i, run);
+            crc = sp_crc16_update(crc, input + i, run);
+            j += run;
+            i += run - 1;
+            continue;
+        }
+
+        uint8_t byte = input[i];
+        bool escape = (byte == SOH || byte == ISI || byte == STX || byte == ETX);
+
+        // Место под байты и два байта CRC
+        if (j + (escape ? 2 : 1) + 2 > output_max_len)
+            return 0;
+
+        if (escape)
+        {
+            output[j++] = DLE;
+            crc = sp_crc16_byte(crc, DLE);
+        }
+        output[j++] = byte;
+        crc = sp_crc16_byte(crc, byte);
+    }
+
+    crc = sp_crc16_final(crc);
+    output[j++] = crc >> 8;
+    output[j++] = crc & 0xFF;
+    return j;
+}
@@ -24,6 +24,13 @@ extern "C"
 
     int staff(const uint8_t *input, size_t input_len, uint8_t *output, size_t output_max_len);
 
+    /**
+     * Стаффинг кадра запроса (input начинается с SOH) с расчётом CRC за тот же проход:
+     * DLE SOH ... CRC1 CRC2, CRC - по всем байтам после DLE SOH.
+     * return - длина кадра с CRC или 0, если кадр не помещается в output
+     */
+    int staff_frame(const uint8_t *input, size_t input_len, uint8_t *output, size_t output_max_len);
+
 #ifdef __cplusplus
 }
 #endif
@@ -15,17 +15,25 @@
 #include "freertos/queue.h"
 #include "driver/uart.h"
 #include "mb_crc.h"
+#include "mb_frame.h"
 #include "gw_nvs.h"
+#include "reg_seq.h"
+#include "mb_regions.h"
+#include "uart2_task.h"
+#include "sp_units.h"
+#include "mb_file.h"
 
 // Теги для логов
 static const char *TAG = "UART1 Gateway";
 
 static SemaphoreHandle_t uart1_mutex = NULL;
 
-extern uint16_t regs[]; // Внешний массив holding-регистров
+extern uint16_t regs[];              // Внешний массив holding-регистров
+extern QueueHandle_t mb_uart_queue;  // Очередь событий драйвера UART1 (gw_nvs.c)
 
 /* Глобальные переменные для хранения данных запроса */
 uint8_t mb_addr = 0x00;
+static int mb_unit = SP_UNIT_PRIMARY; // Абонент (sp_units), которому адресован кадр
 uint8_t mb_func = 0x00;
 uint16_t mb_reg = 0x0000;
 uint16_t mb_regs = 0x0000;
@@ -57,20 +65,86 @@ static void generate_error(uint8_t error_code)
     printf("\n");
 }
 
-// Отправка данных holding-регистров (функция 0x03)
-static void send_register_data(uint8_t slave_addr, uint16_t start_reg, uint16_t count)
+// Готовый ответ 0x03: повторный опрос неизменившегося диапазона отправляется как есть
+typedef struct
 {
+    bool valid;
+    uint32_t gen;                                // reg_seq_gen() до снимка (области tracked)
+    uint8_t slave_addr;
+    uint8_t func;                                // 0x03 или 0x17
+    uint16_t start_reg;
+    uint16_t count;
+    uint16_t snapshot[MB_READ_CACHE_MAX_REGS];  // Регистры, из которых собран кадр
+    uint8_t frame[5 + 2 * MB_READ_CACHE_MAX_REGS];
+} mb_read_cache_t;
+
+static mb_read_cache_t mb_read_cache[MB_READ_CACHE_SLOTS];
+static uint8_t mb_read_cache_next = 0; // Слот для следующего нового диапазона
+
+static mb_read_cache_t *mb_read_cache_slot(uint8_t slave_addr, uint8_t func, uint16_t start_reg, uint16_t count)
+{
+    if (count > MB_READ_CACHE_MAX_REGS)
+        return NULL;
+
+    for (int i = 0; i < MB_READ_CACHE_SLOTS; i++)
+    {
+        mb_read_cache_t *c = &mb_read_cache[i];
+        if (c->valid && c->slave_addr == slave_addr && c->func == func &&
+            c->start_reg == start_reg && c->count == count)
+            return c;
+    }
+
+    mb_read_cache_t *c = &mb_read_cache[mb_read_cache_next];
+    mb_read_cache_next = (mb_read_cache_next + 1) % MB_READ_CACHE_SLOTS;
+    c->valid = false;
+    c->slave_addr = slave_addr;
+    c->func = func;
+    c->start_reg = start_reg;
+    c->count = count;
+    return c;
+}
+
+// Отправка данных holding-регистров (функции 0x03 и 0x17 - ответы одного формата)
+static void send_register_data(uint8_t slave_addr, uint8_t func, uint16_t start_reg, uint16_t count)
+{
+    mb_read_cache_t *cache = mb_read_cache_slot(slave_addr, func, start_reg, count);
+
+    // Окна результата и записи: поколение не изменилось - кадр с CRC уже собран, снимок не нужен
+    bool tracked = mb_region_tracked(start_reg, count);
+    uint32_t gen = tracked ? reg_seq_gen(start_reg, count) : 0;
+    bool hit = cache && cache->valid && tracked && cache->gen == gen;
+
+    // Согласованный снимок регистров (без половины старого и половины нового ответа)
+    uint16_t snapshot[count];
+    if (!hit)
+    {
+        reg_seq_read_unit(mb_unit, start_reg, snapshot, count);
+
+        // Управление и диагностика: регистры не изменились с прошлого опроса
+        hit = cache && cache->valid && !tracked && memcmp(cache->snapshot, snapshot, count * sizeof(uint16_t)) == 0;
+    }
+    if (hit)
+    {
+        REG_DIAG_MB_READ_HIT++;
+        xSemaphoreTake(uart1_mutex, portMAX_DELAY);
+        uart_write_bytes(MB_PORT_NUM, cache->frame, 5 + 2 * count);
+        xSemaphoreGive(uart1_mutex);
+        return;
+    }
+    REG_DIAG_MB_READ_MISS++;
+
     // Размер ответа: адрес(1) + функция(1) + счетчик байт(1) + данные(2*count) + CRC(2)
-    uint8_t response[5 + 2 * count];
+    uint8_t response_buf[cache ? 1 : 5 + 2 * count];
+    uint8_t *response = cache ? cache->frame : response_buf;
+    size_t response_len = 5 + 2 * count;
 
     response[0] = slave_addr;
-    response[1] = 0x03;
+    response[1] = func;
     response[2] = 2 * count; // Количество байт данных
 
-    // Копирование данных из регистров
     for (int i = 0; i < count; i++)
     {
-        uint16_t value = regs[start_reg + i];
+        uint16_t value = snapshot[i];
         response[3 + 2 * i] = (value >> 8) & 0xFF; // Старший байт
         response[4 + 2 * i] = value & 0xFF;        // Младший байт
     }
@@ -80,261 +154,406 @@ static void send_register_data(uint8_t slave_addr, uint16_t start_reg, uint16_t
     response[3 + 2 * count] = crc & 0xFF; // Младший байт CRC
     response[4 + 2 * count] = crc >> 8;   // Старший байт CRC
 
+    if (cache)
+    {
+        if (tracked)
+            cache->gen = gen; // Запись после чтения поколения даст промах в следующий раз
+        else
+            memcpy(cache->snapshot, snapshot, count * sizeof(uint16_t));
+        cache->valid = true;
+    }
+
     // Отправка с защитой мьютексом
     xSemaphoreTake(uart1_mutex, portMAX_DELAY);
-    uart_write_bytes(MB_PORT_NUM, response, sizeof(response));
+    uart_write_bytes(MB_PORT_NUM, response, response_len);
     xSemaphoreGive(uart1_mutex);
 }
 
-/* Задача обработки UART1 (Modbus slave) */
-void uart1_task(void *arg)
+// Вычисление актуального количества байтов в буфере при вводе лишнего нуля в младший байт последнего регистра
+static uint8_t mb_actual_bytes(const uint8_t *data_buf, uint16_t data_len, uint8_t byte_count)
 {
-    // Применяем настройки тайм-аута
-    uint16_t mb_frame_time_out = REG_MODBUS_TIME_OUT;
-    ESP_LOGI(TAG, "Modbus time-out %d ms", (unsigned int)mb_frame_time_out);
+    /* "Хвост" пакета может быть таким: `0x0C03 CRC` или `0x0C03 0x00 CRC` - с лишним нулём */
+    if (data_buf[data_len - 5] == 0x0C && data_buf[data_len - 4] == 0x03)
+        return byte_count - 1;
+    return byte_count;
+}
 
-    // Создание мьютекса для доступа к UART
-    uart1_mutex = xSemaphoreCreateMutex();
-    if (!uart1_mutex)
+/* Обработка принятого кадра Modbus RTU
+ * rx_crc - CRC всего кадра вместе с полем CRC, накопленный при приёме (у целого кадра 0) */
+static void mb_process_frame(const uint8_t *data_buf, uint16_t data_len, uint16_t rx_crc)
+{
+    // Проверка минимальной длины фрейма (адрес + функция + CRC)
+    if (data_len < 4)
     {
-        ESP_LOGE(TAG, "Ошибка создания мьютекса UART1");
-        vTaskDelete(NULL);
+        ESP_LOGE(TAG, "Недопустимая длина фрейма: %d", data_len);
         return;
     }
 
-    uint8_t *data_buf = NULL;  // Буфер для сбора пакета
-    uint16_t data_len = 0;     // Длина собранных данных
-    uint32_t last_rx_time = 0; // Время последнего приема
-    const uint16_t timeout_ticks = pdMS_TO_TICKS(mb_frame_time_out);
+    // Проверка адреса устройства: основной или дополнительного абонента (sp_units)
+    int unit = sp_unit_find(data_buf[0]);
+    if (unit < 0)
+    {
+        ESP_LOGW(TAG, "Несовпадение адреса: 0x%02X", data_buf[0]);
+        return;
+    }
 
-    while (1)
+    // Проверка CRC (рассчитан по мере приёма байтов)
+    if (mb_crc16_final(rx_crc) != 0)
     {
-        uint8_t temp_buf[UART_BUF_SIZE];
-        int len = uart_read_bytes(MB_PORT_NUM, temp_buf, sizeof(temp_buf), pdMS_TO_TICKS(20));
+        uint16_t received_crc = (data_buf[data_len - 1] << 8) | data_buf[data_len - 2];
+        ESP_LOGE(TAG, "Ошибка CRC: %04X != %04X", received_crc, mb_crc16(data_buf, data_len - 2));
+        return;
+    }
+
+    // Сохранение основных параметров запроса
+    mb_addr = data_buf[0];
+    mb_unit = unit;
+    mb_func = data_buf[1];
+    mb_reg = (data_buf[2] << 8) | data_buf[3];  // Начальный регистр
+    mb_regs = (data_buf[4] << 8) | data_buf[5]; // Число регистров
+
+    // Обработка в зависимости от функции Modbus
+    switch (mb_func)
+    {
+    case 0x03: // Чтение holding-регистров
+        // Число регистров: счётчик байт ответа (2 * число) должен поместиться в байт
+        if (mb_regs == 0 || mb_regs > MB_READ_MAX_REGS)
+        {
+            generate_error(0x03); // Недопустимое значение данных
+            xSemaphoreTake(uart1_mutex, portMAX_DELAY);
+            uart_write_bytes(MB_PORT_NUM, error_mb, error_mb_len);
+            xSemaphoreGive(uart1_mutex);
+        }
+        // Проверка допустимости диапазона регистров (таблица областей mb_regions)
+        else if (!mb_region_allowed(mb_reg, mb_regs, MB_ACCESS_READ))
+        {
+            generate_error(0x02); // Недопустимый адрес данных
+            xSemaphoreTake(uart1_mutex, portMAX_DELAY);
+            uart_write_bytes(MB_PORT_NUM, error_mb, error_mb_len);
+            xSemaphoreGive(uart1_mutex);
+        }
+        else
+        {
+            mb_region_before_read(mb_reg, mb_regs);
+            send_register_data(mb_addr, 0x03, mb_reg, mb_regs);
+        }
+        break;
 
-        // Обработка принятых данных
-        if (len > 0)
+    case 0x06: // Запись одного holding-регистра
+        // Запись разрешена в регистры управления и окно записи (таблица областей mb_regions)
+        if (!mb_region_allowed(mb_reg, 1, MB_ACCESS_WRITE_SINGLE))
+        {
+            generate_error(0x02); // Недопустимый адрес данных
+            xSemaphoreTake(uart1_mutex, portMAX_DELAY);
+            uart_write_bytes(MB_PORT_NUM, error_mb, error_mb_len);
+            xSemaphoreGive(uart1_mutex);
+        }
+        else
         {
-            // Инициализация буфера при начале нового фрейма
-            if (data_buf == NULL)
+            uint16_t value = (data_buf[4] << 8) | data_buf[5];
+            if (&regs[mb_reg] == &REG_SP_COMM)
+                sp_comm_set_unit(mb_unit);
+            regs[mb_reg] = value;
+
+            // Формирование ответа (эхо запроса)
+            uint8_t response[8];
+            memcpy(response, data_buf, 6); // Копирование заголовка
+            uint16_t crc = mb_crc16(response, 6);
+            response[6] = crc & 0xFF;
+            response[7] = crc >> 8;
+
+            xSemaphoreTake(uart1_mutex, portMAX_DELAY);
+            uart_write_bytes(MB_PORT_NUM, response, sizeof(response));
+            xSemaphoreGive(uart1_mutex);
+
+            // Сохранение в NVS, запуск обмена по SP или операции с файлами
+            mb_region_after_write(mb_reg, 1);
+        }
+        break;
+
+    case 0x10: // Запись нескольких holding-регистров
+        // Запись разрешена в окна результата и записи (таблица областей mb_regions)
+        if (!mb_region_allowed(mb_reg, 1, MB_ACCESS_WRITE_MULTI))
+        {
+            generate_error(0x02); // Недопустимый адрес данных
+            xSemaphoreTake(uart1_mutex, portMAX_DELAY);
+            uart_write_bytes(MB_PORT_NUM, error_mb, error_mb_len);
+            xSemaphoreGive(uart1_mutex);
+        }
+        // Проверка количества регистров и байт данных
+        else if (!mb_region_allowed(mb_reg, mb_regs, MB_ACCESS_WRITE_MULTI) ||
+                 data_buf[6] != 2 * mb_regs)
+        {
+            generate_error(0x03); // Недопустимое значение данных
+            xSemaphoreTake(uart1_mutex, portMAX_DELAY);
+            uart_write_bytes(MB_PORT_NUM, error_mb, error_mb_len);
+            xSemaphoreGive(uart1_mutex);
+        }
+        else
+        {
+            // Неактуализированное количество байт в введённом пакете
+            mb_bytes = data_buf[6];
+
+            reg_seq_write_begin();
+            for (int i = 0; i < mb_regs; i++)
             {
-                data_buf = malloc(MAX_PDU_LENGTH);
-                if (!data_buf)
+                // Корректная индексация данных в буфере
+                uint16_t value = (data_buf[7 + 2 * i] << 8) | data_buf[8 + 2 * i];
+                regs[mb_reg + i] = value; // Запись в правильный регистр
+                // Введённые по команде 0x10 данные в nvs не записываются:
+                // write_parameter_to_nvs(mb_reg + i, value); // - отменено
+            }
+            reg_seq_write_end();
+
+            // // Формирование ответа
+            // uint8_t response[8];
+            // response[0] = mb_addr;
+            // response[1] = 0x10;
+            // response[2] = data_buf[2]; // Старший байт адреса
+            // response[3] = data_buf[3]; // Младший байт адреса
+            // response[4] = data_buf[4]; // Старший байт количества регистров
+            // response[5] = data_buf[5]; // Младший байт количества регистров
+
+            actual_bytes = mb_actual_bytes(data_buf, data_len, data_buf[6]);
+            ESP_LOGI(TAG, "В MB пакете (%d bytes):", actual_bytes);
+
+
+            // Формирование MB ответа
+            uint8_t response[8];
+            response[0] = mb_addr;
+            response[1] = 0x10;
+            response[2] = data_buf[2]; // Старший байт адреса
+            response[3] = data_buf[3]; // Младший байт адреса
+            response[4] = data_buf[4]; // Старший байт количества регистров
+            response[5] = data_buf[5]; // Младший байт количества регистров
+            uint16_t crc = mb_crc16(response, 6);
+            response[6] = crc & 0xFF;
+            response[7] = crc >> 8;
+
+            xSemaphoreTake(uart1_mutex, portMAX_DELAY);
+            uart_write_bytes(MB_PORT_NUM, response, sizeof(response));
+            xSemaphoreGive(uart1_mutex);
+
+            mb_region_after_write(mb_reg, mb_regs);
+        }
+        break;
+
+    case 0x17: // Запись и чтение нескольких holding-регистров одним запросом
+    {
+        /* Запрос: адрес, 0x17, чтение (начало, число), запись (начало, число), байт, данные, CRC.
+           Сначала запись (например, канал, параметр и команда REG_SP_COMM), затем чтение
+           (например, окно результата 0x20+). При REG_MB_HOLD_MS != 0 и записи команды
+           ответ удерживается до завершения обмена по SP, но не дольше REG_MB_HOLD_MS. */
+        uint16_t wr_reg = 0, wr_regs = 0;
+        if (data_len >= 13)
+        {
+            wr_reg = (data_buf[6] << 8) | data_buf[7];
+            wr_regs = (data_buf[8] << 8) | data_buf[9];
+        }
+
+        if (data_len < 13 || mb_regs == 0 || mb_regs > MB_READ_MAX_REGS || wr_regs == 0 || wr_regs > MB_RW_WRITE_MAX_REGS ||
+            data_buf[10] != 2 * wr_regs || data_len != 13 + 2 * wr_regs)
+        {
+            generate_error(0x03); // Недопустимое значение данных
+            xSemaphoreTake(uart1_mutex, portMAX_DELAY);
+            uart_write_bytes(MB_PORT_NUM, error_mb, error_mb_len);
+            xSemaphoreGive(uart1_mutex);
+        }
+        else if (!mb_region_allowed(mb_reg, mb_regs, MB_ACCESS_READ) ||
+                 !mb_region_allowed(wr_reg, wr_regs, MB_ACCESS_WRITE_RW))
+        {
+            generate_error(0x02); // Недопустимый адрес данных
+            xSemaphoreTake(uart1_mutex, portMAX_DELAY);
+            uart_write_bytes(MB_PORT_NUM, error_mb, error_mb_len);
+            xSemaphoreGive(uart1_mutex);
+        }
+        else
+        {
+            // Команда обмена записывается последней - после канала, параметра и т.п.
+            bool comm_written = false;
+            uint16_t comm = 0xFFFF;
+
+            reg_seq_write_begin();
+            for (int i = 0; i < wr_regs; i++)
+            {
+                uint16_t value = (data_buf[11 + 2 * i] << 8) | data_buf[12 + 2 * i];
+                if (&regs[wr_reg + i] == &REG_SP_COMM)
                 {
-                    ESP_LOGE(TAG, "Ошибка выделения памяти");
+                    comm_written = true;
+                    comm = value;
                     continue;
                 }
-                data_len = 0;
+                regs[wr_reg + i] = value;
             }
+            reg_seq_write_end();
 
-            // Проверка переполнения буфера
-            if (data_len + len > MAX_PDU_LENGTH)
+            if (comm_written)
+                sp_comm_set_unit(mb_unit);
+            uint32_t ticket = comm_written ? sp_comm_submit(comm) : 0;
+
+            if (wr_reg >= HLD_WRITE_REG)
+                actual_bytes = mb_actual_bytes(data_buf, data_len, data_buf[10]);
+
+            // Сохранение в NVS, запуск обмена по SP или операции с файлами
+            mb_region_after_write(wr_reg, wr_regs);
+
+            if (comm_written && comm != 0xFFFF && REG_MB_HOLD_MS != 0)
             {
-                ESP_LOGE(TAG, "Переполнение буфера! Сброс фрейма");
-                free(data_buf);
-                data_buf = NULL;
-                data_len = 0;
-                continue;
+                if (!sp_comm_wait(ticket, pdMS_TO_TICKS(REG_MB_HOLD_MS)))
+                    ESP_LOGW(TAG, "0x17: команда 0x%04X не завершена за %d мс", comm, REG_MB_HOLD_MS);
             }
 
-            // Копирование данных в буфер
-            memcpy(data_buf + data_len, temp_buf, len);
-            data_len += len;
-            last_rx_time = xTaskGetTickCount();
+            mb_region_before_read(mb_reg, mb_regs);
+            send_register_data(mb_addr, 0x17, mb_reg, mb_regs);
         }
+        break;
+    }
 
-        // Проверка завершения фрейма по таймауту
-        if (data_buf && (xTaskGetTickCount() - last_rx_time > timeout_ticks))
+    case 0x14: // Чтение записей файлов (шаблоны, таблица абонентов)
+    {
+        static uint8_t response[MB_FILE_RESP_MAX_SIZE];
+        uint16_t response_len = 0;
+        uint8_t ex = mb_file_read(data_buf, data_len - 2, response, &response_len);
+        if (ex)
         {
-            // Проверка минимальной длины фрейма (адрес + функция + CRC)
-            if (data_len < 4)
-            {
-                ESP_LOGE(TAG, "Недопустимая длина фрейма: %d", data_len);
-                free(data_buf);
-                data_buf = NULL;
-                data_len = 0;
-                continue;
-            }
+            generate_error(ex);
+            xSemaphoreTake(uart1_mutex, portMAX_DELAY);
+            uart_write_bytes(MB_PORT_NUM, error_mb, error_mb_len);
+            xSemaphoreGive(uart1_mutex);
+        }
+        else
+        {
+            uint16_t crc = mb_crc16(response, response_len);
+            response[response_len++] = crc & 0xFF;
+            response[response_len++] = crc >> 8;
 
-            // Проверка адреса устройства
-            if (data_buf[0] != REG_MODBUS_SLAVE_ADDR)
-            {
-                ESP_LOGW(TAG, "Несовпадение адреса: 0x%02X", data_buf[0]);
-                free(data_buf);
-                data_buf = NULL;
-                data_len = 0;
-                continue;
-            }
+            xSemaphoreTake(uart1_mutex, portMAX_DELAY);
+            uart_write_bytes(MB_PORT_NUM, response, response_len);
+            xSemaphoreGive(uart1_mutex);
+        }
+        break;
+    }
 
-            // Проверка CRC
-            uint16_t received_crc = (data_buf[data_len - 1] << 8) | data_buf[data_len - 2];
-            uint16_t calculated_crc = mb_crc16(data_buf, data_len - 2);
+    case 0x15: // Запись записей файлов: сразу в sp_storage, ответ - после записи
+    {
+        uint8_t ex = mb_file_write(data_buf, data_len - 2);
+        if (ex)
+        {
+            generate_error(ex);
+            xSemaphoreTake(uart1_mutex, portMAX_DELAY);
+            uart_write_bytes(MB_PORT_NUM, error_mb, error_mb_len);
+            xSemaphoreGive(uart1_mutex);
+        }
+        else
+        {
+            // Ответ - эхо запроса (CRC кадра тот же)
+            xSemaphoreTake(uart1_mutex, portMAX_DELAY);
+            uart_write_bytes(MB_PORT_NUM, data_buf, data_len);
+            xSemaphoreGive(uart1_mutex);
+        }
+        break;
+    }
 
-            if (received_crc != calculated_crc)
-            {
-                ESP_LOGE(TAG, "Ошибка CRC: %04X != %04X", received_crc, calculated_crc);
-                free(data_buf);
-                data_buf = NULL;
-                data_len = 0;
-                continue;
-            }
+    default: // Недопустимая функция
+        generate_error(0x01);
+        xSemaphoreTake(uart1_mutex, portMAX_DELAY);
+        uart_write_bytes(MB_PORT_NUM, error_mb, error_mb_len);
+        xSemaphoreGive(uart1_mutex);
+        break;
+    }
+}
 
-            // Сохранение основных параметров запроса
-            mb_addr = data_buf[0];
-            mb_func = data_buf[1];
-            mb_reg = (data_buf[2] << 8) | data_buf[3];  // Начальный регистр
-            mb_regs = (data_buf[4] << 8) | data_buf[5]; // Число регистров
+/* Задача обработки UART1 (Modbus slave) */
+void uart1_task(void *arg)
+{
+    /* Конец кадра определяет аппаратный RX-таймаут UART (T3.5, см. mb_uart1_init()).
+       REG_MODBUS_TIME_OUT используется только как страховочный интервал на случай,
+       если событие с флагом таймаута не пришло (кадр кратен порогу заполнения FIFO). */
+    uint16_t mb_frame_time_out = REG_MODBUS_TIME_OUT;
+    ESP_LOGI(TAG, "Modbus time-out %d ms", (unsigned int)mb_frame_time_out);
 
-            // Обработка в зависимости от функции Modbus
-            switch (mb_func)
-            {
-            case 0x03: // Чтение holding-регистров
-                // Проверка допустимости диапазона регистров
+    // Создание мьютекса для доступа к UART
+    uart1_mutex = xSemaphoreCreateMutex();
+    if (!uart1_mutex)
+    {
+        ESP_LOGE(TAG, "Ошибка создания мьютекса UART1");
+        vTaskDelete(NULL);
+        return;
+    }
 
-      //  ESP_LOGI(TAG, "mb_reg: %02X mb_reg+s: %02X MAX: %02X", mb_reg, (mb_reg + mb_regs), MAX_REGS);
+    if (!mb_uart_queue)
+    {
+        ESP_LOGE(TAG, "Очередь событий UART1 не создана");
+        vTaskDelete(NULL);
+        return;
+    }
 
+    static mb_frame_t frame; // Собираемый кадр
+    mb_frame_reset(&frame);
+    const TickType_t idle_ticks = pdMS_TO_TICKS(mb_frame_time_out) + 1;
 
-                if (mb_reg >= MAX_REGS ||
-                    mb_reg + mb_regs > MAX_REGS ||
-                    mb_regs == 0)
-                {
-                    generate_error(0x02); // Недопустимый адрес данных
-                    xSemaphoreTake(uart1_mutex, portMAX_DELAY);
-                    uart_write_bytes(MB_PORT_NUM, error_mb, error_mb_len);
-                    xSemaphoreGive(uart1_mutex);
-                }
-                else
-                {
-                    send_register_data(mb_addr, mb_reg, mb_regs);
-                }
-                break;
-
-            case 0x06: // Запись одного holding-регистра
-                /** Проверка допустимости записи в регистры:
-                 *  - 0x00 ... 0x1F - разрешено
-                 *  - 0x20 ... 0x7F - запрещено
-                 *  - 0x80 ... 0xDF - разрешено
-                 */
-                if ((mb_reg >= MAX_CONTROL_REGS &&
-                     mb_reg < (MAX_REGS - MAX_WRITE_REGS)) ||
-                    mb_reg > MAX_REGS -1)
-                {
-                    generate_error(0x02); // Недопустимый адрес данных
-                    xSemaphoreTake(uart1_mutex, portMAX_DELAY);
-                    uart_write_bytes(MB_PORT_NUM, error_mb, error_mb_len);
-                    xSemaphoreGive(uart1_mutex);
-                }
-                else
-                {
-                    uint16_t value = (data_buf[4] << 8) | data_buf[5];
-                    regs[mb_reg] = value;
-
-                    /* Проверка допустимости адреса регистра для записи в NVS
-                       (регистры управления в NVS не записываются) */
-                    if (mb_reg < MAX_PARAM_INDEX)    //   MAX_CONTROL_REGS)
-                    {
-                        write_parameter_to_nvs(mb_reg, value);
-                    }
-
-                    // Формирование ответа (эхо запроса)
-                    uint8_t response[8];
-                    memcpy(response, data_buf, 6); // Копирование заголовка
-                    uint16_t crc = mb_crc16(response, 6);
-                    response[6] = crc & 0xFF;
-                    response[7] = crc >> 8;
-
-                    xSemaphoreTake(uart1_mutex, portMAX_DELAY);
-                    uart_write_bytes(MB_PORT_NUM, response, sizeof(response));
-                    xSemaphoreGive(uart1_mutex);
-                }
-                break;
-
-            case 0x10: // Запись нескольких holding-регистров
-                /** Проверка допустимости записи в регистры :
-                 *  - 0x00 ... 0x1F - запрещено
-                 *  - 0x20 ... 0x7F - разрешено
-                 *  - 0x80 ... 0xDF - разрешено
-                 */
-                if ((mb_reg < MAX_CONTROL_REGS) ||
-                    mb_reg > MAX_REGS -1)
-                {
-                    generate_error(0x02); // Недопустимый адрес данных
-                    xSemaphoreTake(uart1_mutex, portMAX_DELAY);
-                    uart_write_bytes(MB_PORT_NUM, error_mb, error_mb_len);
-                    xSemaphoreGive(uart1_mutex);
-                }
-                // Проверка количества регистров и байт данных
-                else if (mb_regs == 0 ||
-                         mb_regs > MAX_REGS ||
-                         data_buf[6] != 2 * mb_regs)
-                {
-                    generate_error(0x03); // Недопустимое значение данных
-                    xSemaphoreTake(uart1_mutex, portMAX_DELAY);
-                    uart_write_bytes(MB_PORT_NUM, error_mb, error_mb_len);
-                    xSemaphoreGive(uart1_mutex);
-                }
-                else
-                {
-                    // Неактуализированное количество байт в введённом пакете
-                    mb_bytes = data_buf[6];
-
-                    for (int i = 0; i < mb_regs; i++)
-                    {
-                        // Корректная индексация данных в буфере
-                        uint16_t value = (data_buf[7 + 2 * i] << 8) | data_buf[8 + 2 * i];
-                        regs[mb_reg + i] = value; // Запись в правильный регистр
-                        // Введённые по команде 0x10 данные в nvs не записываются:
-                        // write_parameter_to_nvs(mb_reg + i, value); // - отменено
-                    }
-
-                    // // Формирование ответа
-                    // uint8_t response[8];
-                    // response[0] = mb_addr;
-                    // response[1] = 0x10;
-                    // response[2] = data_buf[2]; // Старший байт адреса
-                    // response[3] = data_buf[3]; // Младший байт адреса
-                    // response[4] = data_buf[4]; // Старший байт количества регистров
-                    // response[5] = data_buf[5]; // Младший байт количества регистров
-
-                    // Вычисление актуального количества байтов в буфере при вводе лишнего нуля в младший байт последнего регистра
-                    actual_bytes = data_buf[6];
-
-                    /* "Хвост" пакета может быть таким: `0x0C03 CRC` или `0x0C03 0x00 CRC` - с лишним нулём */
-                    if (data_buf[data_len - 5] == 0x0C && data_buf[data_len - 4] == 0x03)
-                        actual_bytes -= 1;
-                    ESP_LOGI(TAG, "В MB пакете (%d bytes):", actual_bytes);
-
-
-                    // Формирование MB ответа
-                    uint8_t response[8];
-                    response[0] = mb_addr;
-                    response[1] = 0x10;
-                    response[2] = data_buf[2]; // Старший байт адреса
-                    response[3] = data_buf[3]; // Младший байт адреса
-                    response[4] = data_buf[4]; // Старший байт количества регистров
-                    response[5] = data_buf[5]; // Младший байт количества регистров
-                    uint16_t crc = mb_crc16(response, 6);
-                    response[6] = crc & 0xFF;
-                    response[7] = crc >> 8;
-
-                    xSemaphoreTake(uart1_mutex, portMAX_DELAY);
-                    uart_write_bytes(MB_PORT_NUM, response, sizeof(response));
-                    xSemaphoreGive(uart1_mutex);
-                }
-                break;
-
-            default: // Недопустимая функция
-                generate_error(0x01);
-                xSemaphoreTake(uart1_mutex, portMAX_DELAY);
-                uart_write_bytes(MB_PORT_NUM, error_mb, error_mb_len);
-                xSemaphoreGive(uart1_mutex);
-                break;
+    while (1)
+    {
+        uart_event_t event;
+
+        // Пока кадр не начат - ждём событие без ограничения времени
+        if (xQueueReceive(mb_uart_queue, &event, frame.len ? idle_ticks : portMAX_DELAY) != pdTRUE)
+        {
+            // Страховка: событие с флагом таймаута не пришло, а линия молчит
+            if (mb_frame_complete(&frame))
+                mb_process_frame(frame.buf, frame.len, frame.crc);
+            mb_frame_reset(&frame);
+            continue;
+        }
+
+        switch (event.type)
+        {
+        case UART_DATA:
+        {
+            // Проверка переполнения буфера
+            bool frame_error = frame.error;
+            uint8_t *dst = mb_frame_reserve(&frame, event.size);
+            if (!dst)
+            {
+                if (!frame_error)
+                    ESP_LOGE(TAG, "Переполнение буфера! Сброс фрейма");
+                uint8_t drop_buf[UART_BUF_SIZE];
+                uart_read_bytes(MB_PORT_NUM, drop_buf, event.size, 0);
+            }
+            else
+            {
+                int len = uart_read_bytes(MB_PORT_NUM, dst, event.size, 0);
+                if (len > 0)
+                    mb_frame_commit(&frame, len);
             }
 
-            // Очистка буфера после обработки
-            free(data_buf);
-            data_buf = NULL;
-            data_len = 0;
+            // RX-таймаут: после последнего байта прошло T3.5 - кадр завершён
+            if (event.timeout_flag)
+            {
+                if (mb_frame_complete(&frame))
+                    mb_process_frame(frame.buf, frame.len, frame.crc);
+                mb_frame_reset(&frame);
+            }
+            break;
+        }
+
+        case UART_FIFO_OVF:
+        case UART_BUFFER_FULL:
+            ESP_LOGW(TAG, "Переполнение приёмника UART1, сброс");
+            uart_flush_input(MB_PORT_NUM);
+            xQueueReset(mb_uart_queue);
+            mb_frame_reset(&frame);
+            break;
+
+        case UART_FRAME_ERR:
+        case UART_PARITY_ERR:
+        case UART_BREAK:
+            // Кадр с ошибкой линии отбрасывается целиком по следующему таймауту
+            mb_frame_error(&frame);
+            break;
+
+        default:
+            break;
         }
     }
 }
@@ -349,9 +568,16 @@ void uart1_task(void *arg)
  *   байты DLE (префикс), DAD (адрес приёмника), SAD (адрес источника) и FNC (байт кода функции)
  *   вводить не надо, они вводятся автоматически. Завершение пакета кодами `0x0C` (FF - перевод строки) и 
  *   `0x03` (ETX, конец тела сообщения) - обязательно.
+ * - 0x17 (Read/Write Multiple Registers) - запись (например, канал, параметр и REG_SP_COMM)
+ *   и чтение (например, окна результата) одним запросом; ответ может удерживаться
+ *   до завершения обмена по SP (REG_MB_HOLD_MS).
+ * - 0x14/0x15 (Read/Write File Record) - шаблоны запросов/ответов и таблица абонентов
+ *   напрямую в sp_storage, без окон 0x20/0x80 и регистров операций (mb_file).
  *
  * 2. Механизм приема пакетов:
- * - Сбор пакетов по таймауту между символами
+ * - Кадрирование по событиям драйвера UART (mb_frame): конец кадра - аппаратный
+ *   RX-таймаут, равный T3.5 для текущей скорости (baud_table[REG_MODBUS_BAUD_INDEX])
+ * - Ответ формируется сразу по событию таймаута, без опроса тиков FreeRTOS
  * - Проверка целостности (CRC16)
  * - Проверка адреса устройства
  *
@@ -370,7 +596,7 @@ void uart1_task(void *arg)
  * - Функция write_parameter_to_nvs() для сохранения значений
  *
  * 6. Оптимизации:
- * - Динамическое выделение памяти только при начале приема пакета
+ * - Статический буфер кадра, без выделения памяти на каждый запрос
  * - Минимальное использование буферов
  * - Эффективная работа с CRC
  * - Строгая проверка границ регистров
@@ -19,6 +19,7 @@
 #include "sdkconfig.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "freertos/event_groups.h"
 #include "driver/uart.h"
 #include "mb_crc.h"
 #include "sp_crc.h"
@@ -27,6 +28,14 @@
 #include "sp_storage.h"
 #include "staff.h"
 #include "sp_processing.h"
+#include "sp_frame.h"
+#include "req_cache.h"
+#include "sp_sched.h"
+#include "sp_batch.h"
+#include "val_cache.h"
+#include "parser.h"
+#include "reg_seq.h"
+#include "sp_units.h"
 #include "repeat.h" // Функция обработки параметра
 #include <ctype.h>  // Для работы с символами
 
@@ -42,6 +51,9 @@ uint16_t commands = 0xFFFF;
 uint16_t file_id = 0xFFFF;
 uint16_t file_raw = 0xFFFF;
 
+// Выделитель кадров ответа (состояние сохраняется между чтениями UART)
+static sp_frame_decoder_t sp_rx;
+
 // Макросы для удобства (Заданы в project_config.h)
 // #define REG_REPEAT        regs[0x17]    // Регистр периодичности (в секундах)
 // #define REG_SP_COMM       regs[0x0B]    // Регистр инициализации обмена с целевым прибором
@@ -52,6 +64,322 @@ uint16_t file_raw = 0xFFFF;
 // #define HLD_READ_REG      0x20          // Начальный адрес регистров для чтения
 // #define MAX_OUT_BUF_REGS  96            // Макс. размер выходного буфера (в словах)
 
+// Задача обмена по SP - для пробуждения из uart1_task
+static TaskHandle_t sp_task = NULL;
+
+void sp_comm_notify(void)
+{
+    if (sp_task)
+        xTaskNotifyGive(sp_task);
+}
+
+// Завершение команд REG_SP_COMM - для удержания ответа Modbus 0x17 в uart1_task
+#define SP_EVT_COMM_DONE BIT0
+static EventGroupHandle_t sp_events = NULL;
+static portMUX_TYPE sp_comm_mux = portMUX_INITIALIZER_UNLOCKED;
+static volatile uint32_t sp_comm_taken = 0; // Команд REG_SP_COMM принято к выполнению
+static volatile uint32_t sp_comm_done = 0;  // Из них завершено (ответ, ошибка, нет ответа, кэш)
+static volatile int sp_comm_unit = SP_UNIT_PRIMARY; // Абонент, записавший REG_SP_COMM
+
+// Абонент текущей транзакции: DAD, набор шаблонов и окно результата
+static int sp_tx_unit = SP_UNIT_PRIMARY;
+
+void sp_comm_set_unit(int unit)
+{
+    portENTER_CRITICAL(&sp_comm_mux);
+    sp_comm_unit = unit;
+    portEXIT_CRITICAL(&sp_comm_mux);
+}
+
+// Транзакция от имени абонента: ответ - в его окно результата
+static void sp_tx_set_unit(int unit)
+{
+    sp_tx_unit = unit;
+    reg_seq_set_result_unit(unit);
+}
+
+uint32_t sp_comm_submit(uint16_t raw)
+{
+    // Номер и запись - атомарно относительно приёма команды в uart2_task
+    portENTER_CRITICAL(&sp_comm_mux);
+    REG_SP_COMM = raw;
+    uint32_t ticket = sp_comm_taken + 1;
+    portEXIT_CRITICAL(&sp_comm_mux);
+    return ticket;
+}
+
+bool sp_comm_wait(uint32_t ticket, TickType_t timeout)
+{
+    if (!sp_events)
+        return false;
+
+    TickType_t start = xTaskGetTickCount();
+    while ((int32_t)(sp_comm_done - ticket) < 0)
+    {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout)
+            return false;
+        xEventGroupWaitBits(sp_events, SP_EVT_COMM_DONE, pdTRUE, pdFALSE, timeout - elapsed);
+    }
+    return true;
+}
+
+bool sp_comm_in_flight(uint32_t *ticket)
+{
+    bool busy = true;
+    portENTER_CRITICAL(&sp_comm_mux);
+    if (REG_SP_COMM != 0xFFFF)
+        *ticket = sp_comm_taken + 1; // Записана, ещё не принята
+    else if (sp_comm_done != sp_comm_taken)
+        *ticket = sp_comm_taken; // Выполняется
+    else
+        busy = false;
+    portEXIT_CRITICAL(&sp_comm_mux);
+    return busy;
+}
+
+static void sp_comm_finish(void)
+{
+    sp_comm_done++;
+    xEventGroupSetBits(sp_events, SP_EVT_COMM_DONE);
+}
+
+// Объединённый запрос CMD_READ_PARAMS (ответ на него ожидается, пока sp_batch_current() != NULL)
+static sp_batch_t sp_tx_batch;
+
+// Отправка запроса по шаблону (старший байт raw - режим обработки ответа)
+// от имени абонента sp_tx_unit: младший байт raw - номер шаблона в его наборе
+static bool sp_send_request(uint16_t raw)
+{
+    uint8_t dad = sp_unit_dad(sp_tx_unit);
+    file_raw = raw;
+    file_id = raw & 0xFF;
+    sp_batch_set_current(NULL);
+
+    // Готовый кадр запроса: по номерам канала/параметра или по шаблону
+    // (при промахе собирается из шаблона во flash)
+    const req_cache_entry_t *req = NULL;
+    esp_err_t err;
+    if ((raw & SP_COMM_MODE_MASK) == SP_COMM_DIRECT)
+    {
+        err = req_cache_direct(dad, REG_SP_SAD_ADDR, REG_SP_CHANNEL, REG_SP_PARAM, &req);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Ошибка сборки запроса параметра %d/%d: 0x%04X", REG_SP_CHANNEL, REG_SP_PARAM, err);
+            return false;
+        }
+    }
+    else
+    {
+        int unit_file = sp_unit_file(sp_tx_unit, file_id);
+        if (unit_file < 0)
+        {
+            ESP_LOGE(TAG, "Шаблон %d вне набора абонента %d", file_id, sp_tx_unit);
+            return false;
+        }
+        file_id = unit_file;
+        file_raw = (raw & 0xFF00) | file_id;
+
+        err = req_cache_get(file_id, dad, REG_SP_SAD_ADDR, &req);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Ошибка чтения файла %d: 0x%04X", file_id, err);
+            return false;
+        }
+    }
+
+    REG_SP_ERROR = 0x0000;
+
+    // Извлечение кода команды
+    commands = (req->fnc << 8) & 0xFF00;
+
+    // Отправка данных
+    uart_write_bytes(UART_NUM_2, (const char *)req->frame, req->len);
+    if (REG_SP_FLAGS & SP_FLAG_LATENCY_PROBE)
+        flagB();
+    ESP_LOGI(TAG, "Отправлено %d байт (ID:%d, код команды: %04X)", req->len, file_id, commands);
+    return true;
+}
+
+// Счётчики кэша значений для доли попаданий (регистры - 16 бит)
+static uint32_t val_cache_hits;
+static uint32_t val_cache_misses;
+
+// Идущее по шине чтение параметра без шаблона (команда REG_SP_COMM): такие же
+// команды, записанные во время обмена, завершаются его ответом
+static bool sp_direct_active = false;
+static uint16_t sp_direct_channel;
+static uint16_t sp_direct_param;
+static uint32_t sp_direct_joined = 0; // Присоединённых команд
+
+static void sp_val_cache_count(bool hit, uint32_t age_ms)
+{
+    if (hit)
+    {
+        val_cache_hits++;
+        REG_DIAG_VAL_CACHE_HIT++;
+        REG_DIAG_VAL_CACHE_AGE = age_ms > 0xFFFF ? 0xFFFF : age_ms;
+    }
+    else
+    {
+        val_cache_misses++;
+        REG_DIAG_VAL_CACHE_MISS++;
+    }
+    REG_DIAG_VAL_CACHE_RATIO = (uint64_t)val_cache_hits * 100 / (val_cache_hits + val_cache_misses);
+}
+
+/**
+ * Чтение параметра без шаблона из кэша значений: значение не старше
+ * REG_VAL_CACHE_TTL записывается в регистры 0x20+ без обмена по шине SP.
+ * @return true - запрос обслужен из кэша
+ */
+static bool sp_serve_cached(uint16_t raw, uint32_t now_ms)
+{
+    if ((raw & SP_COMM_MODE_MASK) != SP_COMM_DIRECT || REG_VAL_CACHE_TTL == 0)
+        return false;
+
+    uint8_t value[SP_VAL_CACHE_VALUE_SIZE];
+    size_t len = 0;
+    uint32_t age_ms = 0;
+    bool hit = val_cache_lookup(sp_unit_dad(sp_tx_unit), REG_SP_CHANNEL, REG_SP_PARAM, REG_VAL_CACHE_TTL,
+                                now_ms, value, &len, &age_ms);
+    sp_val_cache_count(hit, age_ms);
+    if (!hit)
+        return false;
+
+    file_raw = raw;
+    handle_cached_parameter(REG_SP_CHANNEL, value, len);
+    REG_SP_ERROR = 0x0000;
+    reg_seq_write_begin();
+    REG_DIAG_SP_LAST_ID = raw;
+    REG_DIAG_SP_BATCH = 1;
+    regs[HLD_DIAG_SP_BATCH_IDS] = raw;
+    for (int k = 1; k < SP_BATCH_MAX; k++)
+        regs[HLD_DIAG_SP_BATCH_IDS + k] = 0xFFFF;
+    reg_seq_write_end();
+    ESP_LOGI(TAG, "Параметр %d/%d из кэша (возраст %lu мс)",
+             REG_SP_CHANNEL, REG_SP_PARAM, (unsigned long)age_ms);
+    return true;
+}
+
+// Запрос без шаблона отправлен по команде REG_SP_COMM: к нему можно присоединяться
+static void sp_direct_begin(uint16_t raw, bool from_comm)
+{
+    sp_direct_active = from_comm && (raw & SP_COMM_MODE_MASK) == SP_COMM_DIRECT;
+    sp_direct_channel = REG_SP_CHANNEL;
+    sp_direct_param = REG_SP_PARAM;
+    sp_direct_joined = 0;
+}
+
+/**
+ * Команда чтения того же параметра, что сейчас на шине, принимается без второго
+ * обмена: ответ придёт в то же окно результата (абонент тот же), команда
+ * завершится вместе с текущей (sp_direct_end). Как и кэш, только при
+ * REG_VAL_CACHE_TTL != 0.
+ */
+static void sp_direct_join(void)
+{
+    if (!sp_direct_active || REG_VAL_CACHE_TTL == 0)
+        return;
+
+    bool joined = false;
+    portENTER_CRITICAL(&sp_comm_mux);
+    if (REG_SP_COMM != 0xFFFF &&
+        (REG_SP_COMM & SP_COMM_MODE_MASK) == SP_COMM_DIRECT &&
+        sp_comm_unit == sp_tx_unit &&
+        REG_SP_CHANNEL == sp_direct_channel &&
+        REG_SP_PARAM == sp_direct_param)
+    {
+        REG_SP_COMM = 0xFFFF;
+        sp_comm_unit = SP_UNIT_PRIMARY;
+        sp_comm_taken++;
+        joined = true;
+    }
+    portEXIT_CRITICAL(&sp_comm_mux);
+
+    if (joined)
+    {
+        sp_direct_joined++;
+        sp_val_cache_count(true, 0);
+        ESP_LOGI(TAG, "Параметр %d/%d уже запрошен, ожидание того же ответа",
+                 sp_direct_channel, sp_direct_param);
+    }
+}
+
+// Транзакция завершена (ответ или его отсутствие): завершение присоединённых команд
+static void sp_direct_end(void)
+{
+    for (; sp_direct_joined > 0; sp_direct_joined--)
+        sp_comm_finish();
+    sp_direct_active = false;
+}
+
+// Шаблон можно присоединить к собираемому запросу (тот же абонент - тот же прибор).
+// Отбор - по разметке указателей без сборки кадра: sp_sched_next_if() проверяет
+// каждый шаблон со сроком опроса на каждом шаге, а кэш кадров вмещает
+// REQ_CACHE_SLOTS из SP_STORAGE_FILE_COUNT. Шаблон, кадр которого ещё не
+// собирался, опрашивается сначала отдельно
+static bool sp_batch_accept(uint8_t id, void *arg)
+{
+    const sp_batch_t *b = arg;
+    uint8_t ptr_count, ptr_len;
+    return sp_unit_of_file(id) == sp_tx_unit &&
+           !sp_batch_contains(b, id) &&
+           req_cache_pointers(id, &ptr_count, &ptr_len) &&
+           sp_batch_fits_pointers(b, ptr_count, ptr_len);
+}
+
+/**
+ * Периодический опрос шаблона first_id с присоединением других шаблонов
+ * CMD_READ_PARAMS, срок опроса которых тоже наступил.
+ * @return false - объединять нечего, отправляется одиночный запрос
+ */
+static bool sp_send_batch(uint8_t first_id, uint32_t now_ms)
+{
+    const req_cache_entry_t *e = NULL;
+    uint8_t dad = sp_unit_dad(sp_tx_unit);
+    if (req_cache_get(first_id, dad, REG_SP_SAD_ADDR, &e) != ESP_OK || e->ptr_count == 0)
+        return false;
+
+    sp_batch_t *b = &sp_tx_batch;
+    sp_batch_begin(b, first_id, e);
+
+    // Срок опроса присоединённых шаблонов сдвигается только после сборки кадра:
+    // при ошибке уходит одиночный запрос first_id, остальные ждут следующего прохода
+    int id;
+    while ((id = sp_sched_next_if(now_ms, sp_batch_accept, b)) >= 0)
+    {
+        if (req_cache_get(id, dad, REG_SP_SAD_ADDR, &e) != ESP_OK || !sp_batch_fits(b, e))
+            break;
+        sp_batch_add(b, id, e);
+    }
+
+    if (b->count == 1)
+        return false; // Готовый кадр шаблона уже есть в кэше
+
+    if (!sp_batch_finish(b))
+    {
+        ESP_LOGE(TAG, "Ошибка стаффинга объединённого запроса");
+        return false;
+    }
+
+    for (uint8_t i = 1; i < b->count; i++)
+    {
+        sp_sched_done(b->ids[i], now_ms);
+        REG_DIAG_SP_POLLS++;
+    }
+
+    file_raw = first_id;
+    file_id = first_id;
+    commands = CMD_READ_PARAMS & 0xFF00;
+    REG_SP_ERROR = 0x0000;
+    sp_batch_set_current(b);
+
+    uart_write_bytes(UART_NUM_2, (const char *)b->frame, b->len);
+    ESP_LOGI(TAG, "Отправлено %d байт: %d шаблонов, %d указателей", b->len, b->count, b->ptr_total);
+    return true;
+}
+
 // Задача обработки UART2
 void uart2_task(void *pvParameters)
 {
@@ -62,16 +390,45 @@ void uart2_task(void *pvParameters)
         vTaskDelete(NULL);
     }
 
-    // Настройка тайм-аута
+    // Настройка тайм-аута (не меньше одного тика, иначе чтение не блокирует)
     uint16_t sp_frame_time_out = REG_SP_TIME_OUT;
+    TickType_t rx_wait = pdMS_TO_TICKS(sp_frame_time_out);
+    if (rx_wait == 0)
+        rx_wait = 1;
     ESP_LOGI(TAG, "SP time-out %d ms", (unsigned int)sp_frame_time_out);
 
     // Переменные для периодической отправки
     uint32_t last_send_time = 0;
     uint16_t last_file_raw = 0xFFFF;
+    int last_unit = SP_UNIT_PRIMARY;
+
+    // Транзакция на шине: запрос отправлен, ответ ещё не получен
+    bool sp_busy = false;
+    bool sp_comm_active = false; // Транзакция по команде REG_SP_COMM
+    uint32_t sp_tx_ms = 0;   // Время отправки запроса
+    uint32_t sp_idle_ms = 0; // Время освобождения шины
+
+    sp_frame_reset(&sp_rx);
+    REG_SCHED_OPERATION = 0xFFFF;
+    sp_events = xEventGroupCreate();
+    sp_task = xTaskGetCurrentTaskHandle();
 
     while (1)
     {
+        uint32_t now_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+
+        // Настройка планировщика опроса: записанная - сохраняется и после перезагрузки
+        int sched_set = sp_sched_handle_registers(now_ms);
+        if (sched_set >= 0)
+        {
+            uint16_t period_ms;
+            uint8_t prio;
+            sp_sched_get(sched_set, &period_ms, &prio);
+            esp_err_t err = sp_storage_sched_set(sched_set, period_ms, prio);
+            if (err != ESP_OK)
+                ESP_LOGE(TAG, "Расписание шаблона %d не сохранено: 0x%x", sched_set, err);
+        }
+
         // Периодическая отправка команды
         uint16_t repeat_period = REG_REPEAT;
         if (repeat_period >= 5)
@@ -83,6 +440,7 @@ void uart2_task(void *pvParameters)
             {
                 if (REG_SP_COMM == 0xFFFF && last_file_raw != 0xFFFF)
                 {
+                    sp_comm_set_unit(last_unit);
                     REG_SP_COMM = last_file_raw;
                     ESP_LOGI(TAG, "Автозапуск команды 0x%04X", last_file_raw);
                 }
@@ -90,106 +448,181 @@ void uart2_task(void *pvParameters)
             }
         }
 
-        // Обработка команды передачи
-        if (REG_SP_COMM != 0xFFFF)
+        // Ответ не получен за SP_REPLY_TIMEOUT_MS - шина свободна
+        if (sp_busy && now_ms - sp_tx_ms >= SP_REPLY_TIMEOUT_MS)
         {
-            file_raw = REG_SP_COMM;
-            file_id = REG_SP_COMM & 0xFF;
-            uint8_t file_data[SP_STORAGE_FILE_SIZE];
-
-            // Запоминаем команду для периодической отправки
-            last_file_raw = file_raw;
-            last_send_time = xTaskGetTickCount();
-
-            ESP_LOGI(TAG, "File ID 0x%02X To the Buff %d bytes", file_id, SP_STORAGE_FILE_SIZE);
-
-            // Чтение шаблона запроса из хранилища
-            esp_err_t err = request_read_file(file_id, file_data);
-            if (err == ESP_OK)
+            ESP_LOGW(TAG, "Нет ответа на запрос 0x%04X", file_raw);
+            REG_SP_ERROR = 0xFFFB; // Код ошибки: нет ответа
+            REG_DIAG_SP_TIMEOUTS++;
+            sp_batch_set_current(NULL);
+            sp_busy = false;
+            sp_idle_ms = now_ms;
+            if (sp_comm_active)
             {
-                uint8_t data_len = file_data[0];
-                ESP_LOGI(TAG, "Считан файл %d, длина: %d байт", file_id, data_len);
+                sp_comm_active = false;
+                sp_comm_finish();
+            }
+            sp_direct_end();
+        }
 
-                REG_SP_ERROR = 0x0000;
+        // Чтение параметра, уже идущее по шине, - повторная команда ждёт его ответа
+        if (sp_busy && sp_comm_active)
+            sp_direct_join();
 
-// Формирование заголовка пакета
-#define HEADER_LEN 4
-                uint8_t header[] = {SOH, REG_SP_DAD_ADDR, REG_SP_SAD_ADDR, ISI};
-                uint16_t extended_len = HEADER_LEN + data_len;
-                uint8_t *extended_data = malloc(extended_len);
+        // Шина свободна и выдержана пауза между пакетами: команда REG_SP_COMM
+        // вытесняет периодический опрос
+        if (!sp_busy && now_ms - sp_idle_ms >= REG_SP_TIME_OUT)
+        {
+            uint16_t raw = 0xFFFF;
+            bool from_comm = false;
 
-                if (!extended_data)
+            if (REG_SP_COMM != 0xFFFF)
+            {
+                int unit;
+                portENTER_CRITICAL(&sp_comm_mux);
+                raw = REG_SP_COMM;
+                REG_SP_COMM = 0xFFFF; // Сброс команды
+                unit = sp_comm_unit;
+                sp_comm_unit = SP_UNIT_PRIMARY;
+                sp_comm_taken++;
+                portEXIT_CRITICAL(&sp_comm_mux);
+                from_comm = true;
+                sp_tx_set_unit(unit);
+
+                // Запоминаем команду для периодической отправки
+                last_file_raw = raw;
+                last_unit = unit;
+                last_send_time = xTaskGetTickCount();
+
+                // Свежее значение параметра уже есть - шина не нужна
+                if (sp_serve_cached(raw, now_ms))
                 {
-                    ESP_LOGE(TAG, "Ошибка выделения памяти");
-                    REG_SP_COMM = 0xFFFF;
-                    continue;
+                    raw = 0xFFFF;
+                    sp_comm_finish();
                 }
-
-                memcpy(extended_data, header, HEADER_LEN);
-                memcpy(extended_data + 4, file_data + 1, data_len);
-                data_len = extended_len;
-
-                // Извлечение кода команды
-                commands = (file_data[1] << 8) & 0xFF00;
-                ESP_LOGI(TAG, "Код команды: %04X", commands);
-
-                // Стаффинг данных
-                uint8_t *staffed_buf = malloc(2 * data_len);
-                if (!staffed_buf)
+            }
+            else
+            {
+                int sched_id = sp_sched_next(now_ms);
+                if (sched_id >= 0)
                 {
-                    ESP_LOGE(TAG, "Ошибка выделения памяти");
-                    free(extended_data);
-                    REG_SP_COMM = 0xFFFF;
-                    continue;
+                    // Шаблон из набора абонента - номер в наборе (первый шаблон - sp_unit_file(unit, 0))
+                    int unit = sp_unit_of_file(sched_id);
+                    sp_tx_set_unit(unit);
+                    raw = sched_id - sp_unit_file(unit, 0);
+                    sp_sched_done(sched_id, now_ms);
+                    REG_DIAG_SP_POLLS++;
+
+                    // Несколько шаблонов CMD_READ_PARAMS - одним запросом
+                    if (sp_send_batch(sched_id, now_ms))
+                    {
+                        raw = 0xFFFF;
+                        sp_busy = true;
+                        sp_tx_ms = now_ms;
+                    }
                 }
+            }
 
-                int staffed_len = staff(extended_data, data_len, staffed_buf, 2 * data_len);
-                free(extended_data);
-
-                if (staffed_len < 0)
+            if (raw != 0xFFFF)
+            {
+                if (sp_send_request(raw))
                 {
-                    ESP_LOGE(TAG, "Ошибка стаффинга");
-                    free(staffed_buf);
-                    REG_SP_COMM = 0xFFFF;
-                    continue;
+                    sp_busy = true;
+                    sp_tx_ms = now_ms;
+                    sp_comm_active = from_comm;
+                    sp_direct_begin(raw, from_comm);
+                }
+                else if (from_comm)
+                {
+                    sp_comm_finish(); // Ошибка сборки запроса - ждать нечего
                 }
-
-                // Расчет и добавление CRC
-                uint16_t crc = sp_crc16(staffed_buf + 2, staffed_len - 2);
-                staffed_buf[staffed_len] = crc >> 8;
-                staffed_buf[staffed_len + 1] = crc & 0xFF;
-                uint16_t final_len = staffed_len + 2;
-
-                // Отправка данных
-                uart_write_bytes(UART_NUM_2, (const char *)staffed_buf, final_len);
-                ESP_LOGI(TAG, "Отправлено %d байт (ID:%d)", final_len, file_id);
-                free(staffed_buf);
             }
-            else
+        }
+
+        // Шина свободна и ответа не ждём: сон до записи команды (sp_comm_notify)
+        // или до следующей проверки планировщика и паузы между пакетами
+        if (!sp_busy && !sp_frame_in_progress(&sp_rx))
+        {
+            size_t pending = 0;
+            uart_get_buffered_data_len(UART_NUM_2, &pending);
+            if (pending == 0)
             {
-                ESP_LOGE(TAG, "Ошибка чтения файла %d: 0x%04X", file_id, err);
+                ulTaskNotifyTake(pdTRUE, rx_wait);
+                continue;
             }
-
-            REG_SP_COMM = 0xFFFF; // Сброс команды
         }
 
-        // Обработка входящих данных
+        // Обработка входящих данных: ждём первый байт не дольше sp_frame_time_out,
+        // затем забираем всё, что уже накоплено драйвером
         int rx_len = uart_read_bytes(
             UART_NUM_2,
             rx_data,
-            UART_BUF_SIZE,
-            pdMS_TO_TICKS(sp_frame_time_out));
+            1,
+            rx_wait);
 
         if (rx_len > 0)
         {
-            uint16_t result_buf[MAX_OUT_BUF_REGS];
-            size_t result_len = 0;
+            size_t buffered = 0;
+            uart_get_buffered_data_len(UART_NUM_2, &buffered);
+            if (buffered > UART_BUF_SIZE - 1)
+                buffered = UART_BUF_SIZE - 1;
+            if (buffered > 0)
+            {
+                int more = uart_read_bytes(UART_NUM_2, rx_data + 1, buffered, 0);
+                if (more > 0)
+                    rx_len += more;
+            }
 
-            // Обработка полученных данных
-            sp_exe_in(rx_data, rx_len, result_buf, &result_len);
+            // Побайтная сборка кадра: обработка сразу после последнего байта CRC
+            for (int i = 0; i < rx_len; i++)
+            {
+                if (sp_frame_feed(&sp_rx, rx_data[i]))
+                {
+                    uint16_t result_buf[MAX_OUT_BUF_REGS];
+                    size_t result_len = 0;
+
+                    // Обработка полученных данных
+                    sp_exe_in(sp_rx.buf, sp_rx.len, result_buf, &result_len);
+
+                    // Транзакция завершена, в окне результата - ответ на file_raw
+                    // (для объединённого запроса - на все его шаблоны по порядку)
+                    const sp_batch_t *batch = sp_batch_current();
+                    reg_seq_write_begin();
+                    REG_DIAG_SP_LAST_ID = file_raw;
+                    for (int k = 0; k < SP_BATCH_MAX; k++)
+                        regs[HLD_DIAG_SP_BATCH_IDS + k] = 0xFFFF;
+                    if (batch)
+                    {
+                        REG_DIAG_SP_BATCH = batch->count;
+                        for (int k = 0; k < batch->count; k++)
+                            regs[HLD_DIAG_SP_BATCH_IDS + k] = batch->ids[k];
+                    }
+                    else
+                    {
+                        REG_DIAG_SP_BATCH = 1;
+                        regs[HLD_DIAG_SP_BATCH_IDS] = file_raw;
+                    }
+                    reg_seq_write_end();
+                    sp_batch_set_current(NULL);
+                    sp_busy = false;
+                    sp_idle_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+                    if (sp_comm_active)
+                    {
+                        sp_comm_active = false;
+                        sp_comm_finish();
+                    }
+                    sp_direct_end();
+                }
+            }
+            continue; // Данные ещё могут поступать - без паузы
         }
 
-        vTaskDelay(pdMS_TO_TICKS(10)); // Освобождение ЦП
+        // Линия молчит дольше sp_frame_time_out посреди кадра - кадр оборван
+        if (sp_frame_in_progress(&sp_rx))
+        {
+            ESP_LOGW(TAG, "Обрыв кадра ответа (%d байт), сброс", sp_rx.len);
+            sp_frame_reset(&sp_rx);
+        }
     }
 
     free(rx_data);
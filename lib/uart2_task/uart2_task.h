@@ -7,6 +7,10 @@
 #ifndef _UART2_TASK_H_
 #define _UART2_TASK_H_
 
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -14,6 +18,36 @@ extern "C"
 
     void uart2_task(void* arg);
 
+    /**
+     * @brief Пробуждение uart2_task после записи REG_SP_COMM / REG_SCHED_OPERATION
+     * @note  Без вызова команда будет замечена не позже чем через REG_SP_TIME_OUT (не меньше тика)
+     */
+    void sp_comm_notify(void);
+
+    /**
+     * @brief Запись команды в REG_SP_COMM
+     * @return номер команды для sp_comm_wait()
+     */
+    uint32_t sp_comm_submit(uint16_t raw);
+
+    /**
+     * @brief Ожидание завершения команды: ответ обработан, ошибка или нет ответа
+     * @return false - не завершена за timeout
+     */
+    bool sp_comm_wait(uint32_t ticket, TickType_t timeout);
+
+    /**
+     * @brief Есть незавершённая команда REG_SP_COMM (записана или выполняется)
+     * @param ticket [out] номер последней команды для sp_comm_wait()
+     */
+    bool sp_comm_in_flight(uint32_t *ticket);
+
+    /**
+     * @brief Абонент (sp_units), от имени которого записывается REG_SP_COMM
+     * @note  Вызывается до записи регистра; команда выполняется с DAD и шаблонами абонента
+     */
+    void sp_comm_set_unit(int unit);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,125 @@
+/**
+ * Кэш значений параметров.
+ *
+ * Несколько мастеров Modbus и HTTP-сервер, запрашивающие одно и то же значение,
+ * раньше каждый раз стоили полного обмена по шине SP. Теперь:
+ * - значение, полученное любым запросом, сохраняется с отметкой времени;
+ * - запрос, пришедший в пределах TTL, обслуживается из кэша;
+ * - повторный запрос того же значения во время обмена присоединяется к нему
+ *   (uart2_task) и завершается тем же ответом - обмен выполняется один раз.
+ *
+ * Значение длиннее SP_VAL_CACHE_VALUE_SIZE не кэшируется: такой запрос всегда
+ * идёт на шину.
+ *
+ * Таблица небольшая (SP_VAL_CACHE_SIZE), поиск - линейный, вытеснение - самой
+ * старой записи. Запись - из uart2_task, чтение - из любой задачи под portMUX.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include "val_cache.h"
+#include "project_config.h"
+#include "freertos/FreeRTOS.h"
+#include <string.h>
+
+typedef struct
+{
+    bool used;
+    uint8_t dad;
+    uint16_t channel;
+    uint16_t param;
+    uint32_t stamp_ms;                      // Время получения значения
+    uint8_t len;
+    uint8_t value[SP_VAL_CACHE_VALUE_SIZE];
+} val_cache_entry_t;
+
+static val_cache_entry_t val_cache[SP_VAL_CACHE_SIZE];
+static portMUX_TYPE val_cache_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static val_cache_entry_t *val_cache_find(uint8_t dad, uint16_t channel, uint16_t param)
+{
+    for (int i = 0; i < SP_VAL_CACHE_SIZE; i++)
+    {
+        val_cache_entry_t *e = &val_cache[i];
+        if (e->used && e->dad == dad && e->channel == channel && e->param == param)
+            return e;
+    }
+    return NULL;
+}
+
+void val_cache_store(uint8_t dad, uint16_t channel, uint16_t param,
+                     const uint8_t *value, size_t len, uint32_t now_ms)
+{
+    portENTER_CRITICAL(&val_cache_mux);
+
+    val_cache_entry_t *e = val_cache_find(dad, channel, param);
+    if (len > SP_VAL_CACHE_VALUE_SIZE)
+    {
+        // Не помещается - прежнее значение устарело, нового нет
+        if (e)
+            e->used = false;
+        portEXIT_CRITICAL(&val_cache_mux);
+        return;
+    }
+
+    if (!e)
+    {
+        // Свободная или самая старая запись
+        e = &val_cache[0];
+        for (int i = 0; i < SP_VAL_CACHE_SIZE && e->used; i++)
+        {
+            if (!val_cache[i].used || (int32_t)(val_cache[i].stamp_ms - e->stamp_ms) < 0)
+                e = &val_cache[i];
+        }
+        e->used = true;
+        e->dad = dad;
+        e->channel = channel;
+        e->param = param;
+    }
+
+    e->stamp_ms = now_ms;
+    e->len = len;
+    memcpy(e->value, value, len);
+
+    portEXIT_CRITICAL(&val_cache_mux);
+}
+
+bool val_cache_lookup(uint8_t dad, uint16_t channel, uint16_t param, uint32_t max_age_ms,
+                      uint32_t now_ms, uint8_t *value, size_t *len, uint32_t *age_ms)
+{
+    bool found = false;
+
+    portENTER_CRITICAL(&val_cache_mux);
+
+    const val_cache_entry_t *e = val_cache_find(dad, channel, param);
+    if (e && now_ms - e->stamp_ms <= max_age_ms)
+    {
+        memcpy(value, e->value, e->len);
+        *len = e->len;
+        if (age_ms)
+            *age_ms = now_ms - e->stamp_ms;
+        found = true;
+    }
+
+    portEXIT_CRITICAL(&val_cache_mux);
+    return found;
+}
+
+bool val_cache_parse_number(const uint8_t *text, size_t len, uint16_t *out)
+{
+    if (len == 0 || len > 5)
+        return false;
+
+    uint32_t n = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (text[i] < '0' || text[i] > '9')
+            return false;
+        n = n * 10 + (text[i] - '0');
+    }
+    if (n > 0xFFFF)
+        return false;
+
+    *out = n;
+    return true;
+}
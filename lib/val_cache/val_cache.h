@@ -0,0 +1,54 @@
+/*=====================================================================================
+ * Description:
+ *  Кэш значений параметров целевых приборов, ключ - (DAD, канал, параметр)
+ *
+ *  Заполняется из каждого ответа CMD_READ_PARAMS (запросы по шаблонам, периодический
+ *  опрос, объединённые запросы, запросы без шаблона). Запрос без шаблона, значение
+ *  которого моложе REG_VAL_CACHE_TTL, обслуживается из кэша без обмена по шине SP.
+ *
+ *  Время - в миллисекундах по модулю 2^32 (xTaskGetTickCount() * portTICK_PERIOD_MS).
+ *====================================================================================*/
+#ifndef _VAL_CACHE_H_
+#define _VAL_CACHE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "project_config.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Сохранение значения (вытесняется самая старая запись)
+     * @param value значение в символьном формате лицевой панели прибора
+     * @note  Значение длиннее SP_VAL_CACHE_VALUE_SIZE не сохраняется, прежнее
+     *        значение того же параметра удаляется: обрезанное значение из кэша
+     *        отличалось бы от ответа прибора
+     */
+    void val_cache_store(uint8_t dad, uint16_t channel, uint16_t param,
+                         const uint8_t *value, size_t len, uint32_t now_ms);
+
+    /**
+     * @brief Поиск значения не старше max_age_ms (безопасно из любой задачи)
+     * @param value  [out] буфер не меньше SP_VAL_CACHE_VALUE_SIZE байт
+     * @param len    [out] длина значения
+     * @param age_ms [out] возраст значения, мс (может быть NULL)
+     * @return true - значение найдено и не устарело
+     */
+    bool val_cache_lookup(uint8_t dad, uint16_t channel, uint16_t param, uint32_t max_age_ms,
+                          uint32_t now_ms, uint8_t *value, size_t *len, uint32_t *age_ms);
+
+    /**
+     * @brief Разбор номера канала/параметра из символьного поля указателя
+     * @return false - поле пустое, длиннее 5 цифр или содержит не цифры
+     */
+    bool val_cache_parse_number(const uint8_t *text, size_t len, uint16_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _VAL_CACHE_H_
@@ -0,0 +1,38 @@
+/**
+ * Счётчик для бенчмарков на ПК: такты процессора (x86, rdtsc) или наносекунды.
+ *
+ * Версия от 18 октября 2025г.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+
+#define BENCH_UNIT "cycle"
+
+static inline uint64_t bench_now(void)
+{
+    return __rdtsc();
+}
+
+#else
+#include <time.h>
+
+#define BENCH_UNIT "ns"
+
+static inline uint64_t bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+#endif
+
+// Не даёт компилятору выбросить результат измеряемого кода
+static inline void bench_keep(const void *p)
+{
+    __asm__ volatile("" : : "g"(p) : "memory");
+}
@@ -0,0 +1,72 @@
+/**
+ * Кадры SP из include/commands.h.txt для тестов на ПК.
+ *
+ * - ответ на запрос 332 (канал 0, параметр 3, СП4 = 2060100005) - как записан,
+ *   с FF FF и CRC;
+ * - запрос 332 - без преамбулы FF FF;
+ * - ответ на чтение элементов индексного массива - в файле записан без DLE и CRC
+ *   (дамп регистров), кадр восстанавливается со стаффингом и CRC.
+ *
+ * Версия от 18 октября 2025г.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "project_config.h"
+#include "sp_crc.h"
+
+static const uint8_t sp_sample_reply_332[] = {
+    0xFF, 0xFF, 0x10, 0x01, 0x86, 0x00, 0x10, 0x1F, 0x03, 0x33, 0x33, 0x32, 0x10, 0x02, 0x09, 0x30,
+    0x09, 0x30, 0x30, 0x33, 0x0C, 0x09, 0x32, 0x30, 0x36, 0x30, 0x31, 0x30, 0x30, 0x30, 0x30, 0x35,
+    0x09, 0x20, 0x0C, 0x10, 0x03, 0x32, 0x61};
+
+static const uint8_t sp_sample_request_332[] = {
+    0x10, 0x01, 0x00, 0x86, 0x10, 0x1F, 0x1D, 0x33, 0x33, 0x32, 0x10, 0x02, 0x09, 0x30, 0x30, 0x30,
+    0x09, 0x30, 0x30, 0x33, 0x0C, 0x10, 0x03, 0x42, 0x16};
+
+// Ответ на чтение элементов индексного массива: SOH DAD SAD ISI FNC DataHead STX ... ETX
+static const uint8_t sp_sample_index_head[] = {SOH, 0x80, 0x00, ISI, 0x14, 0x32, STX};
+static const uint8_t sp_sample_index_data[] = {
+    0x09, 0x30, 0x09, 0x35, 0x09, 0x30, 0x09, 0x36, 0x0C, 0x09, 0x3C, 0x43, 0x52, 0x3E, 0x3C, 0x4C,
+    0x46, 0x3E, 0x09, 0x20, 0x0C, 0x09, 0x8D, 0xA5, 0xE2, 0x20, 0xA4, 0xA0, 0xAD, 0xAD, 0xEB, 0xE5,
+    0x3F, 0x0C, 0x09, 0x41, 0x54, 0x3C, 0x43, 0x52, 0x3E, 0x3C, 0x4C, 0x46, 0x3E, 0x09, 0x20, 0x0C,
+    0x09, 0x4F, 0x4B, 0x3C, 0x43, 0x52, 0x3E, 0x3C, 0x4C, 0x46, 0x3E, 0x09, 0x20, 0x0C, 0x09, 0x41,
+    0x54, 0x2A, 0x45, 0x32, 0x49, 0x50, 0x41, 0x3D, 0x31, 0x2C, 0x31, 0x3C, 0x43, 0x52, 0x3E, 0x3C,
+    0x4C, 0x46, 0x3E, 0x09, 0x20, 0x0C, 0x09, 0x4F, 0x4B, 0x3C, 0x43, 0x52, 0x3E, 0x3C, 0x4C, 0x46,
+    0x3E, 0x09, 0x20, 0x0C};
+
+#define SP_SAMPLE_REPLY_INDEX_MAX_SIZE (2 + 2 * (sizeof(sp_sample_index_head) + sizeof(sp_sample_index_data)) + 4)
+
+// Кадр FF FF DLE SOH ... DLE ETX CRC1 CRC2 из байтов без стаффинга (SOH ... ETX), возвращает длину
+static inline size_t sp_sample_frame(const uint8_t *plain, size_t plain_len, uint8_t *out)
+{
+    size_t n = 0;
+    out[n++] = 0xFF;
+    out[n++] = 0xFF;
+    for (size_t i = 0; i < plain_len; i++)
+    {
+        uint8_t b = plain[i];
+        if (b == SOH || b == ISI || b == STX || b == ETX)
+            out[n++] = DLE;
+        out[n++] = b;
+    }
+    uint16_t crc = sp_crc16(out + 4, n - 4);
+    out[n++] = crc >> 8;
+    out[n++] = crc & 0xFF;
+    return n;
+}
+
+// Ответ на чтение элементов индексного массива (out - SP_SAMPLE_REPLY_INDEX_MAX_SIZE байт)
+static inline size_t sp_sample_reply_index(uint8_t *out)
+{
+    uint8_t plain[sizeof(sp_sample_index_head) + sizeof(sp_sample_index_data) + 2];
+    size_t n = 0;
+    memcpy(plain + n, sp_sample_index_head, sizeof(sp_sample_index_head));
+    n += sizeof(sp_sample_index_head);
+    memcpy(plain + n, sp_sample_index_data, sizeof(sp_sample_index_data));
+    n += sizeof(sp_sample_index_data);
+    plain[n++] = ETX;
+    return sp_sample_frame(plain, n, out);
+}
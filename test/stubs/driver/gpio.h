@@ -0,0 +1,4 @@
+/* Заглушка ESP-IDF для тестов на ПК (pio test -e native) */
+#pragma once
+
+typedef int gpio_num_t;
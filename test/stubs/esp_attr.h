@@ -0,0 +1,5 @@
+/* Заглушка ESP-IDF для тестов на ПК: размещение в IRAM/DRAM не имеет смысла */
+#pragma once
+
+#define IRAM_ATTR
+#define DRAM_ATTR
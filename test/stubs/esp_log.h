@@ -0,0 +1,8 @@
+/* Заглушка ESP-IDF для тестов на ПК: журнал не выводится */
+#pragma once
+
+#define ESP_LOGE(tag, ...) ((void)(tag))
+#define ESP_LOGW(tag, ...) ((void)(tag))
+#define ESP_LOGI(tag, ...) ((void)(tag))
+#define ESP_LOGD(tag, ...) ((void)(tag))
+#define ESP_LOGV(tag, ...) ((void)(tag))
@@ -0,0 +1,4 @@
+/* Заглушка ESP-IDF для тестов на ПК (pio test -e native) */
+#pragma once
+
+#include "esp_err.h"
@@ -0,0 +1,7 @@
+/* Заглушка ESP-IDF для тестов на ПК (pio test -e native) */
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+#define ESP_TASK_PRIO_MAX (configMAX_PRIORITIES)
+#define ESP_TASK_PRIO_MIN (0)
@@ -0,0 +1,39 @@
+/* Заглушка FreeRTOS для тестов на ПК: типы и макросы, тик - 10 мс */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFF)
+#define portTICK_PERIOD_MS 10
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms) / portTICK_PERIOD_MS)
+#define configMAX_PRIORITIES 25
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+/* Критическая секция ESP-IDF (portMUX) - спинлок: тесты с потоками pthread */
+typedef struct
+{
+    volatile int locked;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+
+static inline void portENTER_CRITICAL(portMUX_TYPE *mux)
+{
+    while (__atomic_exchange_n(&mux->locked, 1, __ATOMIC_ACQUIRE))
+        ;
+}
+
+static inline void portEXIT_CRITICAL(portMUX_TYPE *mux)
+{
+    __atomic_store_n(&mux->locked, 0, __ATOMIC_RELEASE);
+}
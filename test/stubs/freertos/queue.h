@@ -0,0 +1,6 @@
+/* Заглушка FreeRTOS для тестов на ПК (pio test -e native) */
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef void *QueueHandle_t;
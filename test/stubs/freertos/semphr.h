@@ -0,0 +1,28 @@
+/* Заглушка FreeRTOS для тестов на ПК (pio test -e native): мьютекс - pthread */
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+typedef pthread_mutex_t *SemaphoreHandle_t;
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    SemaphoreHandle_t m = malloc(sizeof(pthread_mutex_t));
+    if (m)
+        pthread_mutex_init(m, NULL);
+    return m;
+}
+
+/* Ожидание без тайм-аута: в тестах мьютекс не удерживается долго */
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t m, TickType_t ticks)
+{
+    (void)ticks;
+    return pthread_mutex_lock(m) == 0 ? pdTRUE : pdFALSE;
+}
+
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t m)
+{
+    return pthread_mutex_unlock(m) == 0 ? pdTRUE : pdFALSE;
+}
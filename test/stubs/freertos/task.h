@@ -0,0 +1,16 @@
+/* Заглушка FreeRTOS для тестов на ПК (pio test -e native) */
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef void *TaskHandle_t;
+
+#include <time.h>
+
+/* Счётчик тиков - по монотонным часам ПК */
+static inline TickType_t xTaskGetTickCount(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (TickType_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000) / portTICK_PERIOD_MS;
+}
@@ -0,0 +1,30 @@
+/**
+ * Расчёт CRC Modbus RTU до табличного (user-014): 8 сдвигов на байт.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include "baseline.h"
+
+uint16_t baseline_mb_crc16(const uint8_t *buffer, size_t length)
+{
+    uint16_t crc = 0xFFFF; // Инициализация CRC
+
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= (uint16_t)buffer[i]; // XOR с текущим байтом
+
+        for (uint8_t j = 0; j < 8; j++)
+        {
+            if (crc & 0x0001) // Если младший бит равен 1
+            {
+                crc = (crc >> 1) ^ 0xA001; // Полином 0x8005 (отраженный)
+            }
+            else
+            {
+                crc >>= 1;
+            }
+        }
+    }
+    return crc;
+}
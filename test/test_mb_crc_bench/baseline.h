@@ -0,0 +1,16 @@
+/**
+ * Расчёт CRC Modbus RTU до табличного (user-014) и вариант с таблицей полубайтов -
+ * для сравнения.
+ *
+ * Версия от 18 октября 2025г.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Побитовый расчёт, как mb_crc16() до табличного
+uint16_t baseline_mb_crc16(const uint8_t *buffer, size_t length);
+
+// mb_crc16_update() из lib/mb_crc, собранный с MB_CRC_NIBBLE_TABLE
+uint16_t nibble_mb_crc16_update(uint16_t crc, const uint8_t *buffer, size_t length);
@@ -0,0 +1,11 @@
+/**
+ * lib/mb_crc/mb_crc.c с таблицей полубайтов (MB_CRC_NIBBLE_TABLE) рядом с основной
+ * сборкой: функции переименованы, чтобы оба варианта были в одной программе.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#define MB_CRC_NIBBLE_TABLE
+#define mb_crc16_update nibble_mb_crc16_update
+#define mb_crc16 nibble_mb_crc16
+#include "../../lib/mb_crc/mb_crc.c"
@@ -0,0 +1,155 @@
+/**
+ * CRC Modbus RTU: побитовый расчёт (до user-014), таблица 256 слов (сборка по
+ * умолчанию) и таблица 16 слов (MB_CRC_NIBBLE_TABLE).
+ *
+ * Сначала все варианты сверяются с побитовым на контрольной строке и на
+ * случайных данных случайной длины - целиком и по частям, как при приёме
+ * (mb_crc16_update по мере поступления байтов). Затем измеряется время расчёта
+ * кадров 8, 64 и 256 байт в тактах на байт (на x86; на других ПК - в наносекундах).
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "mb_crc.h"
+#include "bench.h"
+#include "baseline.h"
+
+#define CHECK_INPUTS 200000 // Случайных входов в сверке
+#define CHECK_MAX_LEN 256
+#define BENCH_BYTES (4u * 1024 * 1024) // Байт на один замер
+#define BENCH_RUNS 5                   // Лучший из замеров
+
+static uint32_t rnd_state = 2025;
+
+static uint32_t rnd(void)
+{
+    rnd_state = rnd_state * 1103515245u + 12345u;
+    return rnd_state >> 16;
+}
+
+static uint16_t table16_crc16(const uint8_t *buffer, size_t length)
+{
+    return mb_crc16_final(nibble_mb_crc16_update(mb_crc16_init(), buffer, length));
+}
+
+typedef uint16_t (*crc_fn_t)(const uint8_t *buffer, size_t length);
+
+static const struct
+{
+    const char *name;
+    crc_fn_t fn;
+} variants[] = {
+    {"bitwise", baseline_mb_crc16},
+    {"table256", mb_crc16},
+    {"table16", table16_crc16},
+};
+static const int variant_count = sizeof(variants) / sizeof(variants[0]);
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+// Контрольное значение CRC-16/MODBUS и остаток кадра с CRC
+static void test_check_value(void)
+{
+    static const uint8_t check[] = "123456789";
+    for (int v = 0; v < variant_count; v++)
+        TEST_ASSERT_EQUAL_HEX16_MESSAGE(0x4B37, variants[v].fn(check, 9), variants[v].name);
+
+    uint8_t frame[8] = {0x01, 0x03, 0x00, 0x20, 0x00, 0x10};
+    uint16_t crc = mb_crc16(frame, 6);
+    frame[6] = crc & 0xFF;
+    frame[7] = crc >> 8;
+    TEST_ASSERT_EQUAL_HEX16(0, mb_crc16(frame, sizeof(frame)));
+}
+
+// Случайные входы: оба табличных варианта совпадают с побитовым, целиком и по частям
+static void test_random_inputs_match_bitwise(void)
+{
+    uint8_t buf[CHECK_MAX_LEN];
+    for (int n = 0; n < CHECK_INPUTS; n++)
+    {
+        size_t len = rnd() % (CHECK_MAX_LEN + 1);
+        for (size_t i = 0; i < len; i++)
+            buf[i] = rnd();
+
+        uint16_t expected = baseline_mb_crc16(buf, len);
+        char msg[48];
+        snprintf(msg, sizeof(msg), "input %d, %u bytes", n, (unsigned)len);
+        TEST_ASSERT_EQUAL_HEX16_MESSAGE(expected, mb_crc16(buf, len), msg);
+        TEST_ASSERT_EQUAL_HEX16_MESSAGE(expected, table16_crc16(buf, len), msg);
+
+        // Части случайной длины, как чтения UART
+        uint16_t crc = mb_crc16_init(), crc_nibble = mb_crc16_init();
+        for (size_t pos = 0; pos < len;)
+        {
+            size_t part = 1 + rnd() % 32;
+            if (part > len - pos)
+                part = len - pos;
+            crc = mb_crc16_update(crc, buf + pos, part);
+            crc_nibble = nibble_mb_crc16_update(crc_nibble, buf + pos, part);
+            pos += part;
+        }
+        TEST_ASSERT_EQUAL_HEX16_MESSAGE(expected, mb_crc16_final(crc), msg);
+        TEST_ASSERT_EQUAL_HEX16_MESSAGE(expected, mb_crc16_final(crc_nibble), msg);
+    }
+}
+
+static uint64_t bench(crc_fn_t fn, uint8_t *buf, size_t len, unsigned iterations)
+{
+    uint64_t best = UINT64_MAX;
+    for (int run = 0; run < BENCH_RUNS; run++)
+    {
+        uint16_t sum = 0;
+        uint64_t t0 = bench_now();
+        for (unsigned i = 0; i < iterations; i++)
+        {
+            buf[0] = sum; // Кадр зависит от предыдущего: вызовы не перекрываются
+            sum += fn(buf, len);
+        }
+        uint64_t t = bench_now() - t0;
+        bench_keep(&sum);
+        if (t < best)
+            best = t;
+    }
+    return best;
+}
+
+// Такты на байт для кадров 8, 64 и 256 байт
+static void test_bench_frame_sizes(void)
+{
+    static const size_t sizes[] = {8, 64, 256};
+    uint8_t buf[256];
+    for (size_t i = 0; i < sizeof(buf); i++)
+        buf[i] = rnd();
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        unsigned iterations = BENCH_BYTES / sizes[s];
+        double per_byte[3];
+        for (int v = 0; v < variant_count; v++)
+            per_byte[v] = (double)bench(variants[v].fn, buf, sizes[s], iterations) / ((double)iterations * sizes[s]);
+
+        char msg[160];
+        snprintf(msg, sizeof(msg), "%3u B: bitwise %.2f, table256 %.2f (x%.1f), table16 %.2f (x%.1f) %s/B",
+                 (unsigned)sizes[s], per_byte[0], per_byte[1], per_byte[0] / per_byte[1],
+                 per_byte[2], per_byte[0] / per_byte[2], BENCH_UNIT);
+        TEST_MESSAGE(msg);
+    }
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_check_value);
+    RUN_TEST(test_random_inputs_match_bitwise);
+    RUN_TEST(test_bench_frame_sizes);
+    return UNITY_END();
+}
@@ -0,0 +1,413 @@
+/**
+ * Функции Modbus 0x14/0x15 (mb_file) на заглушках хранилища.
+ *
+ * Тест сам реализует sp_storage_file_get/put и sp_storage_unit_get/set поверх
+ * массивов в RAM и считает обращения к ним. Проверяется:
+ * - ответ 0x14 и запись 0x15 для шаблонов запроса, ответа и таблицы абонентов;
+ * - границы числа байт, шаг подзапроса 7 байт, диапазон записи + длина, тип ссылки;
+ * - при исключениях 0x02/0x03 хранилище не читается и ни один подзапрос не записан;
+ * - ошибки хранилища: занято - 0x06, прочие - 0x04.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include <unity.h>
+#include <string.h>
+#include "mb_file.h"
+#include "sp_storage.h"
+#include "sp_units.h"
+
+uint16_t regs[TOTAL_REGS];
+
+#define SLAVE 0x11
+
+// Хранилище в RAM
+static uint8_t files[2][SP_STORAGE_FILE_COUNT][SP_STORAGE_FILE_SIZE];
+static sp_unit_cfg_t units[SP_UNIT_COUNT];
+static int get_calls, put_calls, unit_get_calls, unit_set_calls;
+static esp_err_t storage_err; // Ответ хранилища на следующие обращения
+
+esp_err_t sp_storage_file_get(bool response, uint8_t file_id, uint8_t offset, uint8_t *dst, uint8_t len)
+{
+    get_calls++;
+    TEST_ASSERT_TRUE(file_id < SP_STORAGE_FILE_COUNT && offset + len <= SP_STORAGE_FILE_SIZE);
+    if (storage_err != ESP_OK)
+        return storage_err;
+    memcpy(dst, files[response][file_id] + offset, len);
+    return ESP_OK;
+}
+
+esp_err_t sp_storage_file_put(bool response, uint8_t file_id, uint8_t offset, const uint8_t *src, uint8_t len)
+{
+    put_calls++;
+    TEST_ASSERT_TRUE(file_id < SP_STORAGE_FILE_COUNT && offset + len <= SP_STORAGE_FILE_SIZE);
+    if (storage_err != ESP_OK)
+        return storage_err;
+    memcpy(files[response][file_id] + offset, src, len);
+    return ESP_OK;
+}
+
+esp_err_t sp_storage_unit_get(uint8_t slot, sp_unit_cfg_t *cfg)
+{
+    unit_get_calls++;
+    TEST_ASSERT_TRUE(slot < SP_UNIT_COUNT);
+    if (storage_err != ESP_OK)
+        return storage_err;
+    *cfg = units[slot];
+    return ESP_OK;
+}
+
+esp_err_t sp_storage_unit_set(uint8_t slot, const sp_unit_cfg_t *cfg)
+{
+    unit_set_calls++;
+    TEST_ASSERT_TRUE(slot < SP_UNIT_COUNT);
+    if (storage_err != ESP_OK)
+        return storage_err;
+    units[slot] = *cfg;
+    return ESP_OK;
+}
+
+// Кадр без CRC: адрес, функция, число байт, подзапросы
+typedef struct
+{
+    uint8_t buf[260];
+    uint16_t len;
+} frame_t;
+
+static void frame_begin(frame_t *f, uint8_t fn)
+{
+    f->buf[0] = SLAVE;
+    f->buf[1] = fn;
+    f->buf[2] = 0;
+    f->len = 3;
+}
+
+// Подзапрос; data - count регистров (только для 0x15)
+static void frame_sub(frame_t *f, uint8_t ref, uint16_t file, uint16_t record, uint16_t count,
+                      const uint8_t *data)
+{
+    uint8_t *p = f->buf + f->len;
+    p[0] = ref;
+    p[1] = file >> 8;
+    p[2] = file;
+    p[3] = record >> 8;
+    p[4] = record;
+    p[5] = count >> 8;
+    p[6] = count;
+    f->len += 7;
+    if (data)
+    {
+        memcpy(f->buf + f->len, data, 2 * count);
+        f->len += 2 * count;
+    }
+    f->buf[2] = f->len - 3;
+}
+
+static uint8_t read_frame(const frame_t *f, uint8_t *resp, uint16_t *resp_len)
+{
+    return mb_file_read(f->buf, f->len, resp, resp_len);
+}
+
+static uint8_t write_frame(const frame_t *f)
+{
+    return mb_file_write(f->buf, f->len);
+}
+
+// Ни одного обращения к хранилищу
+static void assert_untouched(void)
+{
+    TEST_ASSERT_EQUAL_INT(0, get_calls);
+    TEST_ASSERT_EQUAL_INT(0, put_calls);
+    TEST_ASSERT_EQUAL_INT(0, unit_get_calls);
+    TEST_ASSERT_EQUAL_INT(0, unit_set_calls);
+}
+
+void setUp(void)
+{
+    for (int r = 0; r < 2; r++)
+        for (int i = 0; i < SP_STORAGE_FILE_COUNT; i++)
+            for (int j = 0; j < SP_STORAGE_FILE_SIZE; j++)
+                files[r][i][j] = (uint8_t)(r * 0x80 + i + j);
+    for (int i = 0; i < SP_UNIT_COUNT; i++)
+        units[i] = (sp_unit_cfg_t){.mb_addr = 20 + i, .dad = 0x80 + i, .file_first = 10 * i, .file_count = 2};
+    get_calls = put_calls = unit_get_calls = unit_set_calls = 0;
+    storage_err = ESP_OK;
+}
+
+void tearDown(void)
+{
+}
+
+// 0x14: шаблон запроса, шаблон ответа и часть таблицы абонентов в одном кадре
+static void test_read_accept(void)
+{
+    frame_t f;
+    uint8_t resp[MB_FILE_RESP_MAX_SIZE];
+    uint16_t resp_len = 0;
+
+    frame_begin(&f, 0x14);
+    frame_sub(&f, MB_FILE_REF_TYPE, MB_FILE_REQUEST + 5, 0, 3, NULL);
+    frame_sub(&f, MB_FILE_REF_TYPE, MB_FILE_RESPONSE + SP_STORAGE_FILE_COUNT - 1,
+              SP_STORAGE_FILE_SIZE / 2 - 1, 1, NULL);
+    frame_sub(&f, MB_FILE_REF_TYPE, MB_FILE_UNITS, 3, 3, NULL); // Поле 3 абонента 0, поля 0-1 абонента 1
+    TEST_ASSERT_EQUAL_UINT8(0, read_frame(&f, resp, &resp_len));
+
+    uint16_t expect_len = 3 + (2 + 6) + (2 + 2) + (2 + 6);
+    TEST_ASSERT_EQUAL_UINT16(expect_len, resp_len);
+    TEST_ASSERT_EQUAL_UINT8(SLAVE, resp[0]);
+    TEST_ASSERT_EQUAL_UINT8(0x14, resp[1]);
+    TEST_ASSERT_EQUAL_UINT8(expect_len - 3, resp[2]);
+
+    const uint8_t *p = resp + 3;
+    TEST_ASSERT_EQUAL_UINT8(7, p[0]);
+    TEST_ASSERT_EQUAL_UINT8(MB_FILE_REF_TYPE, p[1]);
+    TEST_ASSERT_EQUAL_MEMORY(files[0][5], p + 2, 6);
+    p += 8;
+    TEST_ASSERT_EQUAL_UINT8(3, p[0]);
+    TEST_ASSERT_EQUAL_MEMORY(files[1][SP_STORAGE_FILE_COUNT - 1] + SP_STORAGE_FILE_SIZE - 2, p + 2, 2);
+    p += 4;
+    static const uint8_t unit_regs[] = {0, 2, 0, 21, 0, 0x81};
+    TEST_ASSERT_EQUAL_UINT8(7, p[0]);
+    TEST_ASSERT_EQUAL_MEMORY(unit_regs, p + 2, sizeof(unit_regs));
+
+    TEST_ASSERT_EQUAL_INT(2, get_calls);
+    TEST_ASSERT_EQUAL_INT(0, put_calls);
+    TEST_ASSERT_EQUAL_INT(0, unit_set_calls);
+}
+
+// 0x14: отказы до обращения к хранилищу
+static void test_read_reject(void)
+{
+    frame_t f;
+    uint8_t resp[MB_FILE_RESP_MAX_SIZE];
+    uint16_t resp_len;
+
+    // Число байт: нет подзапросов
+    frame_begin(&f, 0x14);
+    TEST_ASSERT_EQUAL_UINT8(0x03, read_frame(&f, resp, &resp_len));
+    TEST_ASSERT_EQUAL_UINT8(0x03, mb_file_read(f.buf, 2, resp, &resp_len));
+
+    // Не кратно 7 байтам подзапроса
+    frame_begin(&f, 0x14);
+    frame_sub(&f, MB_FILE_REF_TYPE, MB_FILE_REQUEST, 0, 1, NULL);
+    f.buf[f.len++] = 0;
+    f.buf[2] = f.len - 3;
+    TEST_ASSERT_EQUAL_UINT8(0x03, read_frame(&f, resp, &resp_len));
+
+    // Число байт не совпадает с длиной кадра
+    frame_begin(&f, 0x14);
+    frame_sub(&f, MB_FILE_REF_TYPE, MB_FILE_REQUEST, 0, 1, NULL);
+    TEST_ASSERT_EQUAL_UINT8(0x03, mb_file_read(f.buf, f.len - 1, resp, &resp_len));
+    TEST_ASSERT_EQUAL_UINT8(0x03, mb_file_read(f.buf, f.len + 7, resp, &resp_len));
+
+    // Больше 0xF5 байт (36 подзапросов по 7)
+    frame_begin(&f, 0x14);
+    for (int i = 0; i < 36; i++)
+        frame_sub(&f, MB_FILE_REF_TYPE, MB_FILE_REQUEST, 0, 1, NULL);
+    TEST_ASSERT_EQUAL_UINT8(0x03, read_frame(&f, resp, &resp_len));
+
+    // Ответ не помещается в кадр RTU
+    frame_begin(&f, 0x14);
+    frame_sub(&f, MB_FILE_REF_TYPE, MB_FILE_REQUEST, 0, SP_STORAGE_FILE_SIZE / 2, NULL);
+    frame_sub(&f, MB_FILE_REF_TYPE, MB_FILE_RESPONSE, 0, SP_STORAGE_FILE_SIZE / 2, NULL);
+    TEST_ASSERT_EQUAL_UINT8(0x03, read_frame(&f, resp, &resp_len));
+
+    // Тип ссылки, номер файла, запись + длина за концом файла, длина 0
+    static const struct
+    {
+        uint8_t ref;
+        uint16_t file, record, count;
+    } bad[] = {
+        {MB_FILE_REF_TYPE - 1, MB_FILE_REQUEST, 0, 1},
+        {MB_FILE_REF_TYPE, 0x0000, 0, 1},
+        {MB_FILE_REF_TYPE, 0x0400, 0, 1},
+        {MB_FILE_REF_TYPE, MB_FILE_UNITS + 1, 0, 1},
+        {MB_FILE_REF_TYPE, MB_FILE_REQUEST + SP_STORAGE_FILE_COUNT, 0, 1},
+        {MB_FILE_REF_TYPE, MB_FILE_RESPONSE, SP_STORAGE_FILE_SIZE / 2, 1},
+        {MB_FILE_REF_TYPE, MB_FILE_RESPONSE, SP_STORAGE_FILE_SIZE / 2 - 6, 7},
+        {MB_FILE_REF_TYPE, MB_FILE_REQUEST, 0xFFFF, 2},
+        {MB_FILE_REF_TYPE, MB_FILE_UNITS, 4 * SP_UNIT_COUNT, 1},
+        {MB_FILE_REF_TYPE, MB_FILE_UNITS, 4 * SP_UNIT_COUNT - 2, 3},
+        {MB_FILE_REF_TYPE, MB_FILE_REQUEST, 0, 0},
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+    {
+        // Плохой подзапрос - вторым: первый, правильный, тоже не читается
+        frame_begin(&f, 0x14);
+        frame_sub(&f, MB_FILE_REF_TYPE, MB_FILE_REQUEST, 0, 1, NULL);
+        frame_sub(&f, bad[i].ref, bad[i].file, bad[i].record, bad[i].count, NULL);
+        TEST_ASSERT_EQUAL_UINT8_MESSAGE(0x02, read_frame(&f, resp, &resp_len), "отказ по подзапросу bad[i]");
+    }
+
+    assert_untouched();
+
+    // Последние записи - в пределах
+    frame_begin(&f, 0x14);
+    frame_sub(&f, MB_FILE_REF_TYPE, MB_FILE_RESPONSE, SP_STORAGE_FILE_SIZE / 2 - 6, 6, NULL);
+    frame_sub(&f, MB_FILE_REF_TYPE, MB_FILE_UNITS, 4 * SP_UNIT_COUNT - 1, 1, NULL);
+    TEST_ASSERT_EQUAL_UINT8(0, read_frame(&f, resp, &resp_len));
+}
+
+// 0x14: ошибки хранилища
+static void test_read_storage_errors(void)
+{
+    frame_t f;
+    uint8_t resp[MB_FILE_RESP_MAX_SIZE];
+    uint16_t resp_len;
+
+    frame_begin(&f, 0x14);
+    frame_sub(&f, MB_FILE_REF_TYPE, MB_FILE_REQUEST, 0, 1, NULL);
+    storage_err = ESP_ERR_TIMEOUT;
+    TEST_ASSERT_EQUAL_UINT8(0x06, read_frame(&f, resp, &resp_len));
+    storage_err = ESP_FAIL;
+    TEST_ASSERT_EQUAL_UINT8(0x04, read_frame(&f, resp, &resp_len));
+
+    frame_begin(&f, 0x14);
+    frame_sub(&f, MB_FILE_REF_TYPE, MB_FILE_UNITS, 0, 1, NULL);
+    storage_err = ESP_ERR_TIMEOUT;
+    TEST_ASSERT_EQUAL_UINT8(0x06, read_frame(&f, resp, &resp_len));
+}
+
+// 0x15: часть шаблона и записи таблицы через границу абонентов
+static void test_write_accept(void)
+{
+    frame_t f;
+    static const uint8_t tpl[] = {0xDE, 0xAD, 0xBE, 0xEF};
+    static const uint8_t unit_regs[] = {0, 7, 0, 9, 0, 31, 0, 0x90}; // Поля 2-3 абонента 1, 0-1 абонента 2
+    uint8_t before[SP_STORAGE_FILE_SIZE];
+    memcpy(before, files[1][7], sizeof(before));
+
+    frame_begin(&f, 0x15);
+    frame_sub(&f, MB_FILE_REF_TYPE, MB_FILE_RESPONSE + 7, 2, 2, tpl);
+    frame_sub(&f, MB_FILE_REF_TYPE, MB_FILE_UNITS, 6, 4, unit_regs);
+    TEST_ASSERT_EQUAL_UINT8(0, write_frame(&f));
+
+    // Остальные байты файла сохранены
+    memcpy(before + 4, tpl, sizeof(tpl));
+    TEST_ASSERT_EQUAL_MEMORY(before, files[1][7], sizeof(before));
+    TEST_ASSERT_EQUAL_INT(1, put_calls);
+
+    // Каждая затронутая запись таблицы - одно чтение и одна запись
+    TEST_ASSERT_EQUAL_INT(2, unit_set_calls);
+    TEST_ASSERT_EQUAL_UINT8(21, units[1].mb_addr);
+    TEST_ASSERT_EQUAL_UINT8(0x81, units[1].dad);
+    TEST_ASSERT_EQUAL_UINT8(7, units[1].file_first);
+    TEST_ASSERT_EQUAL_UINT8(9, units[1].file_count);
+    TEST_ASSERT_EQUAL_UINT8(31, units[2].mb_addr);
+    TEST_ASSERT_EQUAL_UINT8(0x90, units[2].dad);
+    TEST_ASSERT_EQUAL_UINT8(20, units[2].file_first);
+    TEST_ASSERT_EQUAL_UINT8(2, units[2].file_count);
+    TEST_ASSERT_EQUAL_UINT8(20, units[0].mb_addr);
+}
+
+// 0x15: отказы - ни один подзапрос не записан
+static void test_write_reject(void)
+{
+    frame_t f;
+    uint8_t data[2 * (SP_STORAGE_FILE_SIZE / 2 + 1)];
+    memset(data, 0x55, sizeof(data));
+
+    // Меньше одного подзапроса с регистром
+    frame_begin(&f, 0x15);
+    frame_sub(&f, MB_FILE_REF_TYPE, MB_FILE_REQUEST, 0, 1, NULL);
+    f.buf[f.len++] = 0x55;
+    f.buf[2] = f.len - 3;
+    TEST_ASSERT_EQUAL_UINT8(0x03, write_frame(&f));
+    TEST_ASSERT_EQUAL_UINT8(0x03, mb_file_write(f.buf, 2));
+
+    // Больше 0xFB байт
+    frame_begin(&f, 0x15);
+    frame_sub(&f, MB_FILE_REF_TYPE, MB_FILE_REQUEST, 0, SP_STORAGE_FILE_SIZE / 2, data);
+    frame_sub(&f, MB_FILE_REF_TYPE, MB_FILE_REQUEST + 1, 0, 23, data);
+    TEST_ASSERT_EQUAL_UINT8(0xFC, f.buf[2]);
+    TEST_ASSERT_EQUAL_UINT8(0x03, write_frame(&f));
+
+    // Число байт не совпадает с длиной кадра
+    frame_begin(&f, 0x15);
+    frame_sub(&f, MB_FILE_REF_TYPE, MB_FILE_REQUEST, 0, 1, data);
+    TEST_ASSERT_EQUAL_UINT8(0x03, mb_file_write(f.buf, f.len - 1));
+
+    // Длина записи больше данных кадра
+    frame_begin(&f, 0x15);
+    frame_sub(&f, MB_FILE_REF_TYPE, MB_FILE_REQUEST, 0, 2, data);
+    f.buf[3 + 6] = 3;
+    TEST_ASSERT_EQUAL_UINT8(0x03, write_frame(&f));
+
+    // Остаток кадра короче заголовка подзапроса
+    frame_begin(&f, 0x15);
+    frame_sub(&f, MB_FILE_REF_TYPE, MB_FILE_REQUEST, 0, 1, data);
+    memset(f.buf + f.len, 0, 6);
+    f.len += 6;
+    f.buf[2] = f.len - 3;
+    TEST_ASSERT_EQUAL_UINT8(0x03, write_frame(&f));
+
+    // Длина записи 0
+    frame_begin(&f, 0x15);
+    frame_sub(&f, MB_FILE_REF_TYPE, MB_FILE_REQUEST, 0, 1, data);
+    frame_sub(&f, MB_FILE_REF_TYPE, MB_FILE_REQUEST, 0, 1, data);
+    f.buf[3 + 9 + 6] = 0;
+    TEST_ASSERT_EQUAL_UINT8(0x03, write_frame(&f));
+
+    // Тип ссылки, номер файла, запись + длина - второй подзапрос, первый не записан
+    static const struct
+    {
+        uint8_t ref;
+        uint16_t file, record, count;
+    } bad[] = {
+        {0, MB_FILE_RESPONSE, 0, 1},
+        {MB_FILE_REF_TYPE, 0x0500, 0, 1},
+        {MB_FILE_REF_TYPE, MB_FILE_RESPONSE + SP_STORAGE_FILE_COUNT, 0, 1},
+        {MB_FILE_REF_TYPE, MB_FILE_RESPONSE, SP_STORAGE_FILE_SIZE / 2 - 1, 2},
+        {MB_FILE_REF_TYPE, MB_FILE_UNITS, 4 * SP_UNIT_COUNT - 1, 2},
+        {MB_FILE_REF_TYPE, MB_FILE_UNITS, 4 * SP_UNIT_COUNT, 1},
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+    {
+        frame_begin(&f, 0x15);
+        frame_sub(&f, MB_FILE_REF_TYPE, MB_FILE_UNITS, 0, 1, data);
+        frame_sub(&f, bad[i].ref, bad[i].file, bad[i].record, bad[i].count, data);
+        TEST_ASSERT_EQUAL_UINT8_MESSAGE(0x02, write_frame(&f), "отказ по подзапросу bad[i]");
+    }
+
+    assert_untouched();
+    TEST_ASSERT_EQUAL_UINT8(20, units[0].mb_addr);
+
+    // Последние записи - в пределах
+    frame_begin(&f, 0x15);
+    frame_sub(&f, MB_FILE_REF_TYPE, MB_FILE_RESPONSE, SP_STORAGE_FILE_SIZE / 2 - 1, 1, data);
+    frame_sub(&f, MB_FILE_REF_TYPE, MB_FILE_UNITS, 4 * SP_UNIT_COUNT - 1, 1, data);
+    TEST_ASSERT_EQUAL_UINT8(0, write_frame(&f));
+    TEST_ASSERT_EQUAL_UINT8(0x55, units[SP_UNIT_COUNT - 1].file_count);
+}
+
+// 0x15: ошибки хранилища
+static void test_write_storage_errors(void)
+{
+    frame_t f;
+    static const uint8_t data[] = {0, 1};
+
+    frame_begin(&f, 0x15);
+    frame_sub(&f, MB_FILE_REF_TYPE, MB_FILE_REQUEST, 0, 1, data);
+    storage_err = ESP_ERR_TIMEOUT;
+    TEST_ASSERT_EQUAL_UINT8(0x06, write_frame(&f));
+    storage_err = ESP_ERR_NO_MEM;
+    TEST_ASSERT_EQUAL_UINT8(0x04, write_frame(&f));
+
+    frame_begin(&f, 0x15);
+    frame_sub(&f, MB_FILE_REF_TYPE, MB_FILE_UNITS, 0, 1, data);
+    storage_err = ESP_ERR_TIMEOUT;
+    TEST_ASSERT_EQUAL_UINT8(0x06, write_frame(&f));
+    TEST_ASSERT_EQUAL_INT(0, unit_set_calls);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_read_accept);
+    RUN_TEST(test_read_reject);
+    RUN_TEST(test_read_storage_errors);
+    RUN_TEST(test_write_accept);
+    RUN_TEST(test_write_reject);
+    RUN_TEST(test_write_storage_errors);
+    return UNITY_END();
+}
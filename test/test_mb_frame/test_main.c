@@ -0,0 +1,276 @@
+/**
+ * Границы кадров Modbus RTU на смоделированном потоке байтов.
+ *
+ * Модель приёмника UART ESP32: FIFO с порогом заполнения (событие без флага
+ * таймаута) и RX-таймаутом mb_frame_rx_timeout() символов тишины (событие с
+ * флагом). Если кадр кратен порогу FIFO, событие таймаута не приходит и кадр
+ * завершает страховочный интервал uart1_task (REG_MODBUS_TIME_OUT).
+ * Обработка событий повторяет цикл uart1_task().
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include <unity.h>
+#include <string.h>
+#include "mb_frame.h"
+#include "mb_crc.h"
+
+#define SIM_FIFO_FULL 120    // Порог заполнения FIFO драйвера UART (UART_FULL_THRESH_DEFAULT)
+#define SIM_TIME_OUT_MS 4    // REG_MODBUS_TIME_OUT по умолчанию
+#define SIM_LINE_MAX 2048    // Байтов в моделируемом потоке
+#define SIM_FRAMES_MAX 16    // Кадров, переданных на разбор
+
+static const uint32_t sim_bauds[] = {300, 600, 1200, 2400, 4800, 9600, 19200, 38400, 57600, 115200};
+
+typedef struct
+{
+    uint64_t start_us; // Начало стартового бита
+    uint8_t byte;
+    bool line_error;   // После байта - событие ошибки линии (UART_FRAME_ERR)
+} sim_byte_t;
+
+typedef struct
+{
+    uint32_t char_us;
+    uint32_t tout_us; // RX-таймаут UART
+    uint32_t idle_us; // Страховочный интервал ожидания события в uart1_task
+    sim_byte_t line[SIM_LINE_MAX];
+    size_t line_len;
+    uint64_t now_us;  // Конец последнего добавленного байта
+
+    // Приёмник
+    uint8_t fifo[SIM_FIFO_FULL];
+    size_t fifo_len;
+    mb_frame_t frame;
+
+    // Кадры, переданные на разбор (mb_process_frame)
+    uint8_t out[SIM_FRAMES_MAX][MAX_PDU_LENGTH];
+    uint16_t out_len[SIM_FRAMES_MAX];
+    uint16_t out_crc[SIM_FRAMES_MAX];
+    int out_count;
+} sim_t;
+
+static sim_t sim;
+
+static void sim_init(uint32_t baud)
+{
+    memset(&sim, 0, sizeof(sim));
+    sim.char_us = mb_frame_char_us(baud);
+    sim.tout_us = mb_frame_rx_timeout(baud) * sim.char_us;
+    sim.idle_us = (pdMS_TO_TICKS(SIM_TIME_OUT_MS) + 1) * portTICK_PERIOD_MS * 1000;
+    mb_frame_reset(&sim.frame);
+}
+
+// Добавление байтов в поток: первый - через gap_us тишины, остальные - подряд
+static void sim_send(const uint8_t *data, size_t len, uint32_t gap_us)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        TEST_ASSERT_LESS_THAN(SIM_LINE_MAX, sim.line_len);
+        sim_byte_t *b = &sim.line[sim.line_len++];
+        b->start_us = sim.now_us + (i == 0 ? gap_us : 0);
+        b->byte = data[i];
+        b->line_error = false;
+        sim.now_us = b->start_us + sim.char_us;
+    }
+}
+
+static void sim_deliver(void)
+{
+    if (!mb_frame_complete(&sim.frame))
+        return;
+    TEST_ASSERT_LESS_THAN(SIM_FRAMES_MAX, sim.out_count);
+    memcpy(sim.out[sim.out_count], sim.frame.buf, sim.frame.len);
+    sim.out_len[sim.out_count] = sim.frame.len;
+    sim.out_crc[sim.out_count] = sim.frame.crc;
+    sim.out_count++;
+}
+
+// Событие UART_DATA: содержимое FIFO читается в кадр
+static void sim_event(bool timeout_flag)
+{
+    uint8_t *dst = mb_frame_reserve(&sim.frame, sim.fifo_len);
+    if (dst)
+        memcpy(dst, sim.fifo, sim.fifo_len);
+    if (dst && sim.fifo_len)
+        mb_frame_commit(&sim.frame, sim.fifo_len);
+    sim.fifo_len = 0;
+
+    if (timeout_flag)
+    {
+        sim_deliver();
+        mb_frame_reset(&sim.frame);
+    }
+}
+
+static void sim_run(void)
+{
+    for (size_t k = 0; k < sim.line_len; k++)
+    {
+        sim.fifo[sim.fifo_len++] = sim.line[k].byte;
+        if (sim.fifo_len == SIM_FIFO_FULL)
+            sim_event(false);
+        if (sim.line[k].line_error)
+            mb_frame_error(&sim.frame);
+
+        uint64_t end = sim.line[k].start_us + sim.char_us;
+        uint64_t gap = k + 1 < sim.line_len ? sim.line[k + 1].start_us - end : UINT64_MAX;
+        if (sim.fifo_len > 0 && gap >= sim.tout_us)
+            sim_event(true);
+        else if (sim.fifo_len == 0 && sim.frame.len > 0 && gap >= sim.idle_us)
+        {
+            // Событие не пришло - кадр завершает страховочный интервал
+            sim_deliver();
+            mb_frame_reset(&sim.frame);
+        }
+    }
+}
+
+// Кадр: адрес, функция, n байт данных (от seed), CRC
+static size_t build_frame(uint8_t *buf, uint8_t addr, uint8_t func, size_t n, uint8_t seed)
+{
+    buf[0] = addr;
+    buf[1] = func;
+    for (size_t i = 0; i < n; i++)
+        buf[2 + i] = (uint8_t)(seed + i * 7);
+    uint16_t crc = mb_crc16(buf, 2 + n);
+    buf[2 + n] = crc & 0xFF;
+    buf[3 + n] = crc >> 8;
+    return 4 + n;
+}
+
+static void assert_frame(int index, const uint8_t *frame, size_t len)
+{
+    TEST_ASSERT_EQUAL_UINT16(len, sim.out_len[index]);
+    TEST_ASSERT_EQUAL_MEMORY(frame, sim.out[index], len);
+    TEST_ASSERT_EQUAL_HEX16(0, mb_crc16_final(sim.out_crc[index]));
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+// Порог таймаута не короче T3.5 и длиннее него меньше чем на символ
+static void test_rx_timeout_covers_t35(void)
+{
+    for (size_t i = 0; i < sizeof(sim_bauds) / sizeof(sim_bauds[0]); i++)
+    {
+        uint32_t baud = sim_bauds[i];
+        uint32_t char_us = mb_frame_char_us(baud);
+        uint32_t tout_us = mb_frame_rx_timeout(baud) * char_us;
+        uint32_t t35_us = mb_frame_t35_us(baud);
+
+        TEST_ASSERT_GREATER_OR_EQUAL_UINT32(t35_us, tout_us);
+        TEST_ASSERT_LESS_THAN_UINT32(t35_us + char_us, tout_us);
+        if (baud > MB_FIXED_TIMING_BAUD)
+            TEST_ASSERT_EQUAL_UINT32(MB_T35_FIXED_US, t35_us);
+    }
+}
+
+// Кадры через паузу в порог таймаута разделяются, паузы короче - нет
+static void test_frames_split_on_rx_timeout(void)
+{
+    static const uint32_t bauds[] = {300, 9600, 19200, 115200};
+    for (size_t b = 0; b < sizeof(bauds) / sizeof(bauds[0]); b++)
+    {
+        sim_init(bauds[b]);
+        uint8_t read[8], write[MAX_PDU_LENGTH], single[8];
+        size_t read_len = build_frame(read, 0x06, 0x03, 4, 1);
+        size_t write_len = build_frame(write, 0x06, 0x10, 205, 2); // Больше порога FIFO
+        size_t single_len = build_frame(single, 0x06, 0x06, 4, 3);
+
+        sim_send(read, read_len, 0);
+        sim_send(write, 100, sim.tout_us);
+        // Разрыв внутри кадра короче таймаута кадр не делит
+        sim_send(write + 100, write_len - 100, sim.tout_us - sim.char_us);
+        sim_send(single, single_len, sim.tout_us);
+        sim_run();
+
+        TEST_ASSERT_EQUAL_INT(3, sim.out_count);
+        assert_frame(0, read, read_len);
+        assert_frame(1, write, write_len);
+        assert_frame(2, single, single_len);
+    }
+}
+
+// Кадр кратен порогу FIFO: события таймаута нет, кадр завершает страховочный интервал
+static void test_fifo_multiple_frame_ends_by_idle(void)
+{
+    sim_init(115200);
+    uint8_t big[MAX_PDU_LENGTH], next[8];
+    size_t big_len = build_frame(big, 0x06, 0x10, MAX_PDU_LENGTH - 4, 4);
+    size_t next_len = build_frame(next, 0x06, 0x03, 4, 5);
+    TEST_ASSERT_EQUAL_UINT32(2 * SIM_FIFO_FULL, big_len);
+
+    sim_send(big, big_len, 0);
+    sim_send(next, next_len, sim.idle_us);
+    sim_run();
+
+    TEST_ASSERT_EQUAL_INT(2, sim.out_count);
+    assert_frame(0, big, big_len);
+    assert_frame(1, next, next_len);
+}
+
+// Кадр длиннее буфера отбрасывается целиком, следующий принимается
+static void test_oversized_frame_dropped(void)
+{
+    sim_init(19200);
+    uint8_t big[MAX_PDU_LENGTH + 16], next[8];
+    size_t big_len = build_frame(big, 0x06, 0x10, MAX_PDU_LENGTH + 12, 6);
+    size_t next_len = build_frame(next, 0x06, 0x03, 4, 7);
+
+    sim_send(big, big_len, 0);
+    sim_send(next, next_len, sim.tout_us);
+    sim_run();
+
+    TEST_ASSERT_EQUAL_INT(1, sim.out_count);
+    assert_frame(0, next, next_len);
+}
+
+// Ошибка линии внутри кадра - кадр отбрасывается до таймаута, следующий принимается
+static void test_line_error_drops_frame(void)
+{
+    sim_init(9600);
+    uint8_t bad[8], next[8];
+    size_t bad_len = build_frame(bad, 0x06, 0x03, 4, 8);
+    size_t next_len = build_frame(next, 0x06, 0x03, 4, 9);
+
+    sim_send(bad, bad_len, 0);
+    sim.line[3].line_error = true;
+    sim_send(next, next_len, sim.tout_us);
+    sim_run();
+
+    TEST_ASSERT_EQUAL_INT(1, sim.out_count);
+    assert_frame(0, next, next_len);
+}
+
+// Искажённый байт: кадр передаётся на разбор, накопленный CRC не равен нулю
+static void test_corrupted_frame_crc(void)
+{
+    sim_init(115200);
+    uint8_t frame[8];
+    size_t len = build_frame(frame, 0x06, 0x03, 4, 10);
+    frame[4] ^= 0x01;
+
+    sim_send(frame, len, 0);
+    sim_run();
+
+    TEST_ASSERT_EQUAL_INT(1, sim.out_count);
+    TEST_ASSERT_NOT_EQUAL(0, mb_crc16_final(sim.out_crc[0]));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_rx_timeout_covers_t35);
+    RUN_TEST(test_frames_split_on_rx_timeout);
+    RUN_TEST(test_fifo_multiple_frame_ends_by_idle);
+    RUN_TEST(test_oversized_frame_dropped);
+    RUN_TEST(test_line_error_drops_frame);
+    RUN_TEST(test_corrupted_frame_crc);
+    return UNITY_END();
+}
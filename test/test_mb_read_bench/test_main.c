@@ -0,0 +1,173 @@
+/**
+ * Повторный опрос 0x03 неизменившегося диапазона: проверка попадания в готовый
+ * ответ снимком и сравнением (прежний путь send_register_data) и поколением
+ * reg_seq_gen().
+ *
+ * Сначала проверяется, что поколение меняется при каждом виде записи в диапазон
+ * и не меняется при записи в другие блоки, затем измеряется стоимость одной
+ * проверки в тактах (на x86; на других ПК - в наносекундах). Поиск слота и
+ * mb_region_tracked() (индекс в таблице) одинаковы для обоих путей и в замер
+ * не входят.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "reg_seq.h"
+#include "bench.h"
+
+#define BENCH_ITERATIONS 200000
+#define BENCH_RUNS 5 // Лучший из замеров
+
+uint16_t regs[TOTAL_REGS];
+
+typedef struct
+{
+    const char *name;
+    int unit;
+    uint16_t start_reg;
+    uint16_t count;
+} range_t;
+
+static const range_t ranges[] = {
+    {"result window", 0, HLD_READ_REG, MAX_READ_REGS},
+    {"unit 1 window", 1, HLD_READ_REG, MAX_READ_REGS},
+    {"write window", 0, HLD_WRITE_REG, 32},
+    {"result, 8 regs", 0, HLD_READ_REG, 8},
+};
+static const int range_count = sizeof(ranges) / sizeof(ranges[0]);
+
+// Прежняя проверка: согласованный снимок и сравнение с кадром в кеше
+static bool hit_by_snapshot(const range_t *r, const uint16_t *cached)
+{
+    uint16_t snapshot[r->count];
+    reg_seq_read_unit(r->unit, r->start_reg, snapshot, r->count);
+    return memcmp(cached, snapshot, r->count * sizeof(uint16_t)) == 0;
+}
+
+static bool hit_by_gen(const range_t *r, uint32_t cached_gen)
+{
+    return reg_seq_gen(r->start_reg, r->count) == cached_gen;
+}
+
+void setUp(void)
+{
+    reg_seq_set_result_unit(0);
+}
+
+void tearDown(void)
+{
+}
+
+// Каждый вид записи в диапазон меняет его поколение, запись в другие блоки - нет
+static void test_gen_follows_writers(void)
+{
+    uint16_t window[MAX_READ_REGS] = {1};
+    uint16_t block[4] = {7, 7, 7, 7};
+    uint32_t result_gen, write_gen;
+
+    // Результат обмена по SP (основной абонент и дополнительный)
+    result_gen = reg_seq_gen(HLD_READ_REG, MAX_READ_REGS);
+    write_gen = reg_seq_gen(HLD_WRITE_REG, 32);
+    reg_seq_write_result(window, MAX_READ_REGS);
+    TEST_ASSERT_NOT_EQUAL(result_gen, reg_seq_gen(HLD_READ_REG, MAX_READ_REGS));
+    TEST_ASSERT_EQUAL_UINT32(write_gen, reg_seq_gen(HLD_WRITE_REG, 32));
+
+    result_gen = reg_seq_gen(HLD_READ_REG, 8);
+    reg_seq_set_result_unit(1);
+    reg_seq_write_result(window, MAX_READ_REGS);
+    reg_seq_set_result_unit(0);
+    TEST_ASSERT_NOT_EQUAL(result_gen, reg_seq_gen(HLD_READ_REG, 8));
+
+    // Запись 0x10 / 0x17 в окно записи: только его блок
+    result_gen = reg_seq_gen(HLD_READ_REG, MAX_READ_REGS);
+    write_gen = reg_seq_gen(HLD_WRITE_REG + 40, 4);
+    reg_seq_write(HLD_WRITE_REG + 40, block, 4);
+    TEST_ASSERT_NOT_EQUAL(write_gen, reg_seq_gen(HLD_WRITE_REG + 40, 4));
+    TEST_ASSERT_EQUAL_UINT32(result_gen, reg_seq_gen(HLD_READ_REG, MAX_READ_REGS));
+
+    // Группа begin/end без диапазона (файлы, конфигурация, 0x10): все блоки
+    result_gen = reg_seq_gen(HLD_READ_REG, MAX_READ_REGS);
+    write_gen = reg_seq_gen(HLD_WRITE_REG, 32);
+    reg_seq_write_begin();
+    regs[HLD_WRITE_REG] = 3;
+    reg_seq_write_end();
+    TEST_ASSERT_NOT_EQUAL(result_gen, reg_seq_gen(HLD_READ_REG, MAX_READ_REGS));
+    TEST_ASSERT_NOT_EQUAL(write_gen, reg_seq_gen(HLD_WRITE_REG, 32));
+
+    result_gen = reg_seq_gen(HLD_READ_REG, MAX_READ_REGS);
+    reg_seq_write_begin();
+    regs[HLD_READ_REG] = 5;
+    reg_seq_write_result_end();
+    TEST_ASSERT_NOT_EQUAL(result_gen, reg_seq_gen(HLD_READ_REG, MAX_READ_REGS));
+
+    // Запись 0x06 присваиванием и учёт в mb_region_after_write()
+    write_gen = reg_seq_gen(HLD_WRITE_REG, 32);
+    result_gen = reg_seq_gen(HLD_READ_REG, MAX_READ_REGS);
+    regs[HLD_WRITE_REG + 1] = 9;
+    reg_seq_touch(HLD_WRITE_REG + 1, 1);
+    TEST_ASSERT_NOT_EQUAL(write_gen, reg_seq_gen(HLD_WRITE_REG, 32));
+    TEST_ASSERT_EQUAL_UINT32(result_gen, reg_seq_gen(HLD_READ_REG, MAX_READ_REGS));
+}
+
+static uint64_t bench_snapshot(const range_t *r)
+{
+    uint16_t cached[MAX_READ_REGS];
+    reg_seq_read_unit(r->unit, r->start_reg, cached, r->count);
+    uint64_t best = UINT64_MAX;
+    for (int run = 0; run < BENCH_RUNS; run++)
+    {
+        unsigned hits = 0;
+        uint64_t t0 = bench_now();
+        for (unsigned i = 0; i < BENCH_ITERATIONS; i++)
+            hits += hit_by_snapshot(r, cached);
+        uint64_t t = bench_now() - t0;
+        TEST_ASSERT_EQUAL_UINT(BENCH_ITERATIONS, hits);
+        if (t < best)
+            best = t;
+    }
+    return best;
+}
+
+static uint64_t bench_gen(const range_t *r)
+{
+    uint32_t cached_gen = reg_seq_gen(r->start_reg, r->count);
+    uint64_t best = UINT64_MAX;
+    for (int run = 0; run < BENCH_RUNS; run++)
+    {
+        unsigned hits = 0;
+        uint64_t t0 = bench_now();
+        for (unsigned i = 0; i < BENCH_ITERATIONS; i++)
+            hits += hit_by_gen(r, cached_gen);
+        uint64_t t = bench_now() - t0;
+        TEST_ASSERT_EQUAL_UINT(BENCH_ITERATIONS, hits);
+        if (t < best)
+            best = t;
+    }
+    return best;
+}
+
+// Стоимость проверки попадания до и после
+static void test_bench_hit_check(void)
+{
+    for (int i = 0; i < range_count; i++)
+    {
+        double before = (double)bench_snapshot(&ranges[i]) / BENCH_ITERATIONS;
+        double after = (double)bench_gen(&ranges[i]) / BENCH_ITERATIONS;
+
+        char msg[160];
+        snprintf(msg, sizeof(msg), "%-15s %3u regs: snapshot+memcmp %6.1f %s/hit, generation %5.1f %s/hit, x%.1f",
+                 ranges[i].name, ranges[i].count, before, BENCH_UNIT, after, BENCH_UNIT, before / after);
+        TEST_MESSAGE(msg);
+    }
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_gen_follows_writers);
+    RUN_TEST(test_bench_hit_check);
+    return UNITY_END();
+}
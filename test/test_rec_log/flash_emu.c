@@ -0,0 +1,172 @@
+/**
+ * Модель NOR flash для тестов журнала (rec_log) на ПК.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include "flash_emu.h"
+#include <string.h>
+
+const esp_partition_t flash_emu_part = {
+    .address = 0x313000,
+    .size = FLASH_EMU_SIZE,
+    .erase_size = FLASH_EMU_SECTOR_SIZE,
+    .label = "request",
+    .encrypted = true,
+};
+
+const esp_partition_t flash_emu_response_part = {
+    .address = 0x323000,
+    .size = FLASH_EMU_SIZE,
+    .erase_size = FLASH_EMU_SECTOR_SIZE,
+    .label = "response",
+    .encrypted = true,
+};
+
+flash_emu_stats_t flash_emu_stats;
+
+static uint8_t flash[2 * FLASH_EMU_SIZE]; // Разделы request и response
+static bool mmap_enabled = true;
+static bool cut_planned;
+static uint32_t cut_ops; // Операций до обрыва
+static bool powered_off;
+static bool cut_happened;
+static uint32_t rnd_state = 77;
+
+static uint32_t rnd(void)
+{
+    rnd_state = rnd_state * 1103515245u + 12345u;
+    return rnd_state >> 16;
+}
+
+void flash_emu_fill(uint8_t value)
+{
+    memset(flash, value, sizeof(flash));
+    flash_emu_reset_stats();
+}
+
+void flash_emu_reset_stats(void)
+{
+    memset(&flash_emu_stats, 0, sizeof(flash_emu_stats));
+}
+
+void flash_emu_set_mmap(bool enabled)
+{
+    mmap_enabled = enabled;
+}
+
+void flash_emu_cut_after(uint32_t ops)
+{
+    cut_planned = true;
+    cut_ops = ops;
+}
+
+bool flash_emu_cut_happened(void)
+{
+    return cut_happened;
+}
+
+void flash_emu_power_on(void)
+{
+    cut_planned = false;
+    powered_off = false;
+    cut_happened = false;
+}
+
+static bool in_range(size_t offset, size_t size)
+{
+    return offset <= FLASH_EMU_SIZE && size <= FLASH_EMU_SIZE - offset;
+}
+
+// Начало раздела в модели
+static uint8_t *part_base(const esp_partition_t *partition)
+{
+    return flash + (partition->address == flash_emu_response_part.address ? FLASH_EMU_SIZE : 0);
+}
+
+// Очередная операция: false - питания нет; *partial - выполнить частично и отключить питание
+static bool flash_emu_op(bool *partial)
+{
+    *partial = false;
+    if (powered_off)
+        return false;
+    if (cut_planned && cut_ops-- == 0)
+    {
+        cut_planned = false;
+        powered_off = true;
+        cut_happened = true;
+        *partial = true;
+    }
+    return true;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+    if (!in_range(src_offset, size))
+        return ESP_ERR_INVALID_SIZE;
+    memcpy(dst, part_base(partition) + src_offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_read_raw(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+    return esp_partition_read(partition, src_offset, dst, size);
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size)
+{
+    bool partial;
+    if (!in_range(dst_offset, size))
+        return ESP_ERR_INVALID_SIZE;
+    if (!flash_emu_op(&partial))
+        return ESP_FAIL;
+
+    uint8_t *base = part_base(partition);
+    size_t n = partial ? rnd() % (size + 1) : size;
+    const uint8_t *data = src;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (base[dst_offset + i] != 0xFF)
+            flash_emu_stats.overwrites++;
+        base[dst_offset + i] &= data[i];
+    }
+    if (partial)
+        return ESP_FAIL;
+    flash_emu_stats.writes++;
+    flash_emu_stats.bytes_written += size;
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    bool partial;
+    if (!in_range(offset, size) || offset % FLASH_EMU_SECTOR_SIZE || size % FLASH_EMU_SECTOR_SIZE)
+        return ESP_ERR_INVALID_SIZE;
+    if (!flash_emu_op(&partial))
+        return ESP_FAIL;
+
+    memset(part_base(partition) + offset, 0xFF, partial ? rnd() % (size + 1) : size);
+    if (partial)
+        return ESP_FAIL;
+    flash_emu_stats.erases += size / FLASH_EMU_SECTOR_SIZE;
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t *partition, size_t offset, size_t size,
+                             esp_partition_mmap_memory_t memory, const void **out_ptr,
+                             esp_partition_mmap_handle_t *out_handle)
+{
+    (void)memory;
+    if (!mmap_enabled)
+        return ESP_ERR_NOT_SUPPORTED;
+    if (!in_range(offset, size))
+        return ESP_ERR_INVALID_SIZE;
+    *out_ptr = part_base(partition) + offset;
+    *out_handle = 1;
+    return ESP_OK;
+}
+
+void esp_partition_munmap(esp_partition_mmap_handle_t handle)
+{
+    (void)handle;
+}
@@ -0,0 +1,49 @@
+/**
+ * Модель NOR flash для тестов журнала (rec_log) на ПК: разделы request и response
+ * в RAM с функциями esp_partition_*.
+ *
+ * Стирание - сектор в 0xFF, запись - побитовое И (бит 0 не возвращается в 1 без
+ * стирания). Считаются стирания, операции и байты записи, а также записи в уже
+ * записанные байты. Обрыв питания: после заданного числа операций записи и
+ * стирания очередная выполняется частично (случайная начальная часть), все
+ * следующие завершаются ошибкой до flash_emu_power_on().
+ *
+ * Версия от 18 октября 2025г.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_partition.h"
+
+#define FLASH_EMU_SIZE 0x10000 // Как разделы request и response в partitions.csv
+#define FLASH_EMU_SECTOR_SIZE 4096
+
+typedef struct
+{
+    uint32_t erases;        // Стёрто секторов
+    uint32_t writes;        // Вызовов esp_partition_write
+    uint32_t bytes_written; // Записано байт
+    uint32_t overwrites;    // Записано байт поверх не стёртых
+} flash_emu_stats_t;
+
+extern const esp_partition_t flash_emu_part;          // request
+extern const esp_partition_t flash_emu_response_part; // response (транзакция двух журналов)
+extern flash_emu_stats_t flash_emu_stats;
+
+// Содержимое обоих разделов (раздел другого формата, мусор); счётчики сбрасываются
+void flash_emu_fill(uint8_t value);
+
+void flash_emu_reset_stats(void);
+
+// Раздел отображается в память (esp_partition_mmap) или нет
+void flash_emu_set_mmap(bool enabled);
+
+// Обрыв питания на операции номер ops (0 - на следующей) записи или стирания
+void flash_emu_cut_after(uint32_t ops);
+
+// Питание было оборвано с последнего flash_emu_power_on()
+bool flash_emu_cut_happened(void);
+
+// Включение питания: операции снова выполняются, обрыв не запланирован
+void flash_emu_power_on(void);
@@ -0,0 +1,526 @@
+/**
+ * Журнал файлов (rec_log) на модели NOR flash (flash_emu): стоимость записи
+ * шаблонов в стираниях и байтах и целостность после обрыва питания.
+ *
+ * Прежняя запись шаблона (write_to_partition) стирала и переписывала сектор
+ * целиком: 1 стирание и 4096 байт на файл. Здесь считаются стирания и байты
+ * журнала при загрузке набора шаблонов и при потоке обновлений, содержимое
+ * сверяется с моделью файлов в RAM. Обрыв питания - на случайной операции
+ * записи или стирания (одиночная запись, пакет, перенос записей при переходе
+ * сектора и восстановление при монтировании): после повторного монтирования
+ * файл содержит прежние или новые данные, пакет виден целиком или не виден,
+ * остальные файлы не изменились. Транзакция двух журналов (request и response)
+ * после обрыва видна в обоих целиком или не видна ни в одном.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "rec_log.h"
+#include "flash_emu.h"
+
+#define TEMPLATE_COUNT 42     // Шаблонов в типовой конфигурации
+#define TEMPLATE_MAX_LEN 60   // Наибольшая длина шаблона в наборе
+#define UPDATES 20000         // Обновлений шаблонов
+#define POWER_CUT_RUNS 4000   // Обрывов питания (поровну одиночных записей и пакетов)
+#define TXN_RUNS 3000         // Транзакций двух журналов с обрывом питания
+#define OLD_ERASES_PER_FILE 1 // Прежняя запись: сектор на файл
+#define OLD_BYTES_PER_FILE REC_LOG_SECTOR_SIZE
+
+static rec_log_t log_;
+static rec_log_t resp_log; // Второй журнал транзакции
+static uint8_t resp_files[SP_STORAGE_FILE_COUNT][SP_STORAGE_FILE_SIZE];
+static unsigned power_cuts; // Обрывов, пришедшихся на операцию записи или стирания
+static uint8_t files[SP_STORAGE_FILE_COUNT][SP_STORAGE_FILE_SIZE]; // Ожидаемое содержимое
+
+static uint32_t rnd_state = 2025;
+
+static uint32_t rnd(void)
+{
+    rnd_state = rnd_state * 1103515245u + 12345u;
+    return rnd_state >> 16;
+}
+
+// Файл: байт длины и шаблон из ненулевых байтов, дальше нули
+static void make_file(uint8_t *data, uint8_t template_len)
+{
+    memset(data, 0, SP_STORAGE_FILE_SIZE);
+    data[0] = template_len;
+    for (int i = 1; i <= template_len; i++)
+        data[i] = 1 + rnd() % 255;
+}
+
+static uint8_t random_template_len(void)
+{
+    return 8 + rnd() % (TEMPLATE_MAX_LEN - 7);
+}
+
+// Байт flash под записью файла
+static uint32_t record_size(const uint8_t *data)
+{
+    uint16_t len = SP_STORAGE_FILE_SIZE;
+    while (len > 1 && data[len - 1] == 0)
+        len--;
+    if (len < data[0] + 1)
+        len = data[0] + 1;
+    return REC_LOG_HDR_SIZE + (len + REC_LOG_ALIGN - 1) / REC_LOG_ALIGN * REC_LOG_ALIGN;
+}
+
+static bool log_file_equal(rec_log_t *log, uint8_t file_id, const uint8_t *expected)
+{
+    uint8_t data[SP_STORAGE_FILE_SIZE];
+    return rec_log_read(log, file_id, data) == ESP_OK && memcmp(data, expected, SP_STORAGE_FILE_SIZE) == 0;
+}
+
+static bool file_equal(uint8_t file_id, const uint8_t *expected)
+{
+    return log_file_equal(&log_, file_id, expected);
+}
+
+static void assert_log_files(rec_log_t *log, uint8_t expected[][SP_STORAGE_FILE_SIZE], const char *where)
+{
+    for (int f = 0; f < SP_STORAGE_FILE_COUNT; f++)
+    {
+        char msg[80];
+        snprintf(msg, sizeof(msg), "%s, %s file %d", where, log->part->label, f);
+        TEST_ASSERT_TRUE_MESSAGE(log_file_equal(log, f, expected[f]), msg);
+    }
+}
+
+static void assert_files(const char *where)
+{
+    assert_log_files(&log_, files, where);
+}
+
+// Включение питания и монтирование; обрыв при восстановлении - ещё одно включение
+static void power_on_mount(bool cut_in_mount)
+{
+    flash_emu_power_on();
+    if (cut_in_mount)
+    {
+        flash_emu_cut_after(rnd() % 4);
+        rec_log_mount(&log_, &flash_emu_part);
+        power_cuts += flash_emu_cut_happened();
+        flash_emu_power_on();
+    }
+    TEST_ASSERT_EQUAL_INT(ESP_OK, rec_log_mount(&log_, &flash_emu_part));
+}
+
+// Чистый раздел и набор из TEMPLATE_COUNT шаблонов
+static void provision(void)
+{
+    flash_emu_fill(0xFF);
+    TEST_ASSERT_EQUAL_INT(ESP_OK, rec_log_mount(&log_, &flash_emu_part));
+    memset(files, 0, sizeof(files));
+    for (int f = 0; f < TEMPLATE_COUNT; f++)
+    {
+        make_file(files[f], random_template_len());
+        TEST_ASSERT_EQUAL_INT(ESP_OK, rec_log_write(&log_, f, files[f]));
+    }
+}
+
+void setUp(void)
+{
+    flash_emu_set_mmap(true);
+    flash_emu_power_on();
+}
+
+void tearDown(void)
+{
+}
+
+// Раздел прежнего формата (не журнал) очищается при монтировании, файлов нет
+static void test_mount_formats_foreign_partition(void)
+{
+    flash_emu_fill(0xA5);
+    TEST_ASSERT_EQUAL_INT(ESP_OK, rec_log_mount(&log_, &flash_emu_part));
+    TEST_ASSERT_EQUAL_UINT32(FLASH_EMU_SIZE / FLASH_EMU_SECTOR_SIZE, flash_emu_stats.erases);
+    memset(files, 0, sizeof(files));
+    assert_files("formatted");
+
+    TEST_ASSERT_EQUAL_INT(ESP_OK, rec_log_mount(&log_, &flash_emu_part)); // Пустой журнал
+    assert_files("remounted");
+}
+
+// Чистый раздел (журнал без файлов) и частично записанный мусор: стираются только
+// записанные сектора, повторное монтирование не стирает ничего
+static void test_mount_blank_partition_no_erase(void)
+{
+    flash_emu_fill(0xFF);
+    TEST_ASSERT_EQUAL_INT(ESP_OK, rec_log_mount(&log_, &flash_emu_part));
+    TEST_ASSERT_EQUAL_UINT32(0, flash_emu_stats.erases);
+
+    // Мусор в двух секторах
+    static const uint8_t junk[32] = {0x12, 0x34};
+    TEST_ASSERT_EQUAL_INT(ESP_OK, esp_partition_write(&flash_emu_part, 3 * FLASH_EMU_SECTOR_SIZE + 100, junk, sizeof(junk)));
+    TEST_ASSERT_EQUAL_INT(ESP_OK, esp_partition_write(&flash_emu_part, 9 * FLASH_EMU_SECTOR_SIZE, junk, sizeof(junk)));
+    flash_emu_reset_stats();
+    TEST_ASSERT_EQUAL_INT(ESP_OK, rec_log_mount(&log_, &flash_emu_part));
+    TEST_ASSERT_EQUAL_UINT32(2, flash_emu_stats.erases);
+
+    flash_emu_reset_stats();
+    TEST_ASSERT_EQUAL_INT(ESP_OK, rec_log_mount(&log_, &flash_emu_part));
+    TEST_ASSERT_EQUAL_UINT32(0, flash_emu_stats.erases);
+    memset(files, 0, sizeof(files));
+    assert_files("blank");
+
+    // Журнал после этого работает как обычно
+    make_file(files[1], 20);
+    TEST_ASSERT_EQUAL_INT(ESP_OK, rec_log_write(&log_, 1, files[1]));
+    TEST_ASSERT_EQUAL_INT(ESP_OK, rec_log_mount(&log_, &flash_emu_part));
+    assert_files("written");
+}
+
+// Загрузка набора шаблонов: байты - только записи файлов, без стираний
+static void test_provisioning_cost(void)
+{
+    flash_emu_fill(0xFF);
+    TEST_ASSERT_EQUAL_INT(ESP_OK, rec_log_mount(&log_, &flash_emu_part));
+    flash_emu_reset_stats();
+
+    uint32_t bytes = 0;
+    memset(files, 0, sizeof(files));
+    for (int f = 0; f < TEMPLATE_COUNT; f++)
+    {
+        make_file(files[f], random_template_len());
+        bytes += record_size(files[f]);
+        TEST_ASSERT_EQUAL_INT(ESP_OK, rec_log_write(&log_, f, files[f]));
+    }
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%d templates: %u erases, %u bytes written (before: %u erases, %u bytes)",
+             TEMPLATE_COUNT, (unsigned)flash_emu_stats.erases, (unsigned)flash_emu_stats.bytes_written,
+             TEMPLATE_COUNT * OLD_ERASES_PER_FILE, TEMPLATE_COUNT * OLD_BYTES_PER_FILE);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(bytes / REC_LOG_SECTOR_SIZE, flash_emu_stats.erases);
+    TEST_ASSERT_EQUAL_UINT32(bytes, flash_emu_stats.bytes_written);
+    TEST_ASSERT_EQUAL_UINT32(TEMPLATE_COUNT, flash_emu_stats.writes);
+    TEST_ASSERT_EQUAL_UINT32(0, flash_emu_stats.overwrites);
+    assert_files("provisioned");
+}
+
+// Поток обновлений: чаще всего меняются несколько шаблонов, иногда - любой из набора
+static void test_update_cost(void)
+{
+    provision();
+    flash_emu_reset_stats();
+
+    for (int n = 0; n < UPDATES; n++)
+    {
+        int f = (rnd() % 4) ? rnd() % 6 : rnd() % TEMPLATE_COUNT;
+        make_file(files[f], random_template_len());
+        TEST_ASSERT_EQUAL_INT(ESP_OK, rec_log_write(&log_, f, files[f]));
+    }
+    assert_files("updated");
+
+    double erases = (double)flash_emu_stats.erases / UPDATES;
+    double bytes = (double)flash_emu_stats.bytes_written / UPDATES;
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%d updates: %.3f erases, %.0f bytes per update (before: %d erase, %d bytes)",
+             UPDATES, erases, bytes, OLD_ERASES_PER_FILE, OLD_BYTES_PER_FILE);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(erases < 0.05);
+    TEST_ASSERT_TRUE(bytes < OLD_BYTES_PER_FILE / 16);
+    TEST_ASSERT_EQUAL_UINT32(0, flash_emu_stats.overwrites);
+
+    TEST_ASSERT_EQUAL_INT(ESP_OK, rec_log_mount(&log_, &flash_emu_part));
+    assert_files("remounted");
+}
+
+// Без отображения в память (чтение копией) - то же содержимое
+static void test_read_without_mmap(void)
+{
+    provision();
+    flash_emu_set_mmap(false);
+    TEST_ASSERT_EQUAL_INT(ESP_OK, rec_log_mount(&log_, &flash_emu_part));
+    TEST_ASSERT_NULL(log_.map);
+    assert_files("copy");
+
+    const uint8_t *view = rec_log_view_begin(&log_, 0);
+    TEST_ASSERT_NOT_NULL(view);
+    TEST_ASSERT_EQUAL_MEMORY(files[0], view, 1 + files[0][0]);
+    rec_log_view_end(&log_);
+    TEST_ASSERT_NULL(rec_log_view_begin(&log_, SP_STORAGE_FILE_COUNT));
+}
+
+// Раздел из REC_LOG_MIN_SECTORS + 1 секторов, файлы наибольшей длины: отказ
+// ESP_ERR_NO_MEM без изменения файлов (в 64 КБ все SP_STORAGE_FILE_COUNT помещаются)
+static void test_full_partition_rejects(void)
+{
+    esp_partition_t small = flash_emu_part;
+    small.size = (REC_LOG_MIN_SECTORS + 1) * FLASH_EMU_SECTOR_SIZE;
+    flash_emu_fill(0xFF);
+    TEST_ASSERT_EQUAL_INT(ESP_OK, rec_log_mount(&log_, &small));
+    memset(files, 0, sizeof(files));
+
+    uint8_t data[SP_STORAGE_FILE_SIZE];
+    int f = 0;
+    esp_err_t err = ESP_OK;
+    for (; f < SP_STORAGE_FILE_COUNT; f++)
+    {
+        make_file(data, SP_STORAGE_FILE_SIZE - 1);
+        err = rec_log_write(&log_, f, data);
+        if (err != ESP_OK)
+            break;
+        memcpy(files[f], data, sizeof(data));
+    }
+    char msg[96];
+    snprintf(msg, sizeof(msg), "%d files of %d bytes fit, %u erases", f, SP_STORAGE_FILE_SIZE,
+             (unsigned)flash_emu_stats.erases);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_EQUAL_INT(ESP_ERR_NO_MEM, err);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(log_.capacity, log_.live);
+    assert_files("full");
+
+    // Замена файла той же длины помещается
+    make_file(files[0], SP_STORAGE_FILE_SIZE - 1);
+    TEST_ASSERT_EQUAL_INT(ESP_OK, rec_log_write(&log_, 0, files[0]));
+    TEST_ASSERT_EQUAL_INT(ESP_OK, rec_log_mount(&log_, &small));
+    assert_files("remounted");
+}
+
+// Запись без стирания (0x15): одна операция записи на файл; рабочий сектор заполнен -
+// ESP_ERR_INVALID_STATE без изменений, после rec_log_make_room() запись проходит
+static void test_write_no_erase(void)
+{
+    provision();
+    flash_emu_reset_stats();
+
+    uint8_t data[SP_STORAGE_FILE_SIZE];
+    int written = 0;
+    esp_err_t err = ESP_OK;
+    while (err == ESP_OK)
+    {
+        int f = rnd() % TEMPLATE_COUNT;
+        make_file(data, random_template_len());
+        err = rec_log_write_no_erase(&log_, f, data);
+        if (err == ESP_OK)
+        {
+            memcpy(files[f], data, sizeof(data));
+            written++;
+        }
+    }
+    TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_STATE, err);
+    TEST_ASSERT_EQUAL_UINT32(0, flash_emu_stats.erases);
+    TEST_ASSERT_EQUAL_UINT32(written, flash_emu_stats.writes);
+    assert_files("head full");
+
+    TEST_ASSERT_EQUAL_INT(ESP_OK, rec_log_make_room(&log_));
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(1, flash_emu_stats.erases);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(REC_LOG_REC_MAX, REC_LOG_SECTOR_SIZE - log_.head_pos);
+    uint32_t erases = flash_emu_stats.erases;
+    TEST_ASSERT_EQUAL_INT(ESP_OK, rec_log_make_room(&log_)); // Место есть - без стирания
+    TEST_ASSERT_EQUAL_UINT32(erases, flash_emu_stats.erases);
+
+    make_file(files[0], SP_STORAGE_FILE_SIZE - 1);
+    TEST_ASSERT_EQUAL_INT(ESP_OK, rec_log_write_no_erase(&log_, 0, files[0]));
+    TEST_ASSERT_EQUAL_UINT32(erases, flash_emu_stats.erases);
+    TEST_ASSERT_EQUAL_INT(ESP_OK, rec_log_mount(&log_, &flash_emu_part));
+    assert_files("remounted");
+}
+
+// Обрыв питания при одиночной записи: файл прежний или новый, остальные не изменились
+static void power_cut_single(int run)
+{
+    int f = (rnd() % 2) ? rnd() % 6 : rnd() % TEMPLATE_COUNT;
+    uint8_t data[SP_STORAGE_FILE_SIZE];
+    make_file(data, random_template_len());
+
+    flash_emu_cut_after(rnd() % 3);
+    esp_err_t err = rec_log_write(&log_, f, data);
+    bool cut = flash_emu_cut_happened();
+    power_cuts += cut;
+    char msg[64];
+    snprintf(msg, sizeof(msg), "single write, run %d, file %d", run, f);
+    if (!cut)
+    {
+        TEST_ASSERT_EQUAL_INT_MESSAGE(ESP_OK, err, msg);
+        memcpy(files[f], data, sizeof(data));
+        return;
+    }
+
+    power_on_mount(rnd() % 4 == 0);
+    if (file_equal(f, data))
+        memcpy(files[f], data, sizeof(data));
+    TEST_ASSERT_TRUE_MESSAGE(file_equal(f, files[f]), msg); // Иначе - не прежний и не новый
+    assert_files(msg);
+}
+
+// Обрыв питания при записи пакета: виден весь пакет или ни один его файл
+static void power_cut_batch(int run)
+{
+    uint8_t ids[8];
+    uint8_t data[8][SP_STORAGE_FILE_SIZE];
+    uint8_t count = 2 + rnd() % 7;
+    uint8_t first = rnd() % (TEMPLATE_COUNT - count + 1);
+    for (uint8_t k = 0; k < count; k++)
+    {
+        ids[k] = first + k;
+        make_file(data[k], random_template_len());
+    }
+
+    flash_emu_cut_after(rnd() % (count + 2));
+    esp_err_t err = rec_log_write_batch(&log_, ids, &data[0][0], count);
+    bool cut = flash_emu_cut_happened();
+    power_cuts += cut;
+    char msg[64];
+    snprintf(msg, sizeof(msg), "batch of %d, run %d", count, run);
+    if (cut)
+        power_on_mount(rnd() % 4 == 0);
+    else
+        TEST_ASSERT_EQUAL_INT_MESSAGE(ESP_OK, err, msg);
+
+    int applied = 0;
+    for (uint8_t k = 0; k < count; k++)
+        applied += file_equal(ids[k], data[k]);
+    TEST_ASSERT_TRUE_MESSAGE(applied == 0 || applied == count, msg);
+    if (applied)
+        for (uint8_t k = 0; k < count; k++)
+            memcpy(files[ids[k]], data[k], SP_STORAGE_FILE_SIZE);
+    assert_files(msg);
+}
+
+static void test_power_cuts(void)
+{
+    provision();
+    flash_emu_reset_stats();
+    power_cuts = 0;
+    for (int run = 0; run < POWER_CUT_RUNS; run++)
+    {
+        if (run % 2)
+            power_cut_batch(run);
+        else
+            power_cut_single(run);
+        flash_emu_power_on();
+    }
+
+    char msg[96];
+    snprintf(msg, sizeof(msg), "%d runs, %u power cuts, %u erases, %u overwritten bytes", POWER_CUT_RUNS,
+             power_cuts, (unsigned)flash_emu_stats.erases, (unsigned)flash_emu_stats.overwrites);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_GREATER_THAN_UINT32(POWER_CUT_RUNS / 2, power_cuts);
+    TEST_ASSERT_EQUAL_UINT32(0, flash_emu_stats.overwrites);
+}
+
+// Случайный пакет транзакции: count разных файлов из первых TEMPLATE_COUNT
+static void make_txn_half(uint8_t *ids, uint8_t data[][SP_STORAGE_FILE_SIZE], uint8_t count)
+{
+    uint8_t first = rnd() % (TEMPLATE_COUNT - count + 1);
+    for (uint8_t k = 0; k < count; k++)
+    {
+        ids[k] = first + k;
+        make_file(data[k], random_template_len());
+    }
+}
+
+// Файлов пакета с новыми данными: 0 или count, иначе - ошибка
+static uint8_t txn_half_applied(rec_log_t *log, const uint8_t *ids, uint8_t data[][SP_STORAGE_FILE_SIZE],
+                                uint8_t count, const char *msg)
+{
+    uint8_t applied = 0;
+    for (uint8_t k = 0; k < count; k++)
+        applied += log_file_equal(log, ids[k], data[k]);
+    TEST_ASSERT_TRUE_MESSAGE(applied == 0 || applied == count, msg);
+    return applied;
+}
+
+// Транзакция двух журналов с обрывом питания на любой операции, в том числе при
+// завершении после перезапуска: новые файлы видны в обоих журналах или ни в одном
+static void test_txn_power_cuts(void)
+{
+    provision();
+    TEST_ASSERT_EQUAL_INT(ESP_OK, rec_log_mount(&resp_log, &flash_emu_response_part));
+    memset(resp_files, 0, sizeof(resp_files));
+    for (int f = 0; f < TEMPLATE_COUNT; f++)
+    {
+        make_file(resp_files[f], random_template_len());
+        TEST_ASSERT_EQUAL_INT(ESP_OK, rec_log_write(&resp_log, f, resp_files[f]));
+    }
+    flash_emu_reset_stats();
+
+    unsigned cuts = 0, completed = 0; // Обрывов; транзакций, завершённых после перезапуска
+    for (int run = 0; run < TXN_RUNS; run++)
+    {
+        uint8_t req_ids[8], resp_ids[8];
+        uint8_t req_data[8][SP_STORAGE_FILE_SIZE], resp_data[8][SP_STORAGE_FILE_SIZE];
+        uint8_t req_count = rnd() % 9;
+        uint8_t resp_count = (req_count == 0 ? 1 : 0) + rnd() % 8;
+        make_txn_half(req_ids, req_data, req_count);
+        make_txn_half(resp_ids, resp_data, resp_count);
+
+        flash_emu_cut_after(rnd() % (req_count + resp_count + 6));
+        esp_err_t err = rec_log_write_txn(&log_, req_ids, &req_data[0][0], req_count,
+                                          &resp_log, resp_ids, &resp_data[0][0], resp_count);
+        bool cut = flash_emu_cut_happened();
+        char msg[80];
+        snprintf(msg, sizeof(msg), "txn %d+%d, run %d", req_count, resp_count, run);
+        if (cut)
+        {
+            cuts++;
+            flash_emu_power_on();
+            if (rnd() % 4 == 0)
+            {
+                // Ещё один обрыв - при монтировании или завершении транзакции
+                flash_emu_cut_after(rnd() % 3);
+                if (rec_log_mount(&log_, &flash_emu_part) == ESP_OK &&
+                    rec_log_mount(&resp_log, &flash_emu_response_part) == ESP_OK)
+                    rec_log_txn_recover(&log_, &resp_log);
+                flash_emu_power_on();
+            }
+            TEST_ASSERT_EQUAL_INT_MESSAGE(ESP_OK, rec_log_mount(&log_, &flash_emu_part), msg);
+            TEST_ASSERT_EQUAL_INT_MESSAGE(ESP_OK, rec_log_mount(&resp_log, &flash_emu_response_part), msg);
+            completed += resp_log.txn_pending && resp_log.txn_pending_id == log_.txn;
+            TEST_ASSERT_EQUAL_INT_MESSAGE(ESP_OK, rec_log_txn_recover(&log_, &resp_log), msg);
+        }
+        else
+        {
+            TEST_ASSERT_EQUAL_INT_MESSAGE(ESP_OK, err, msg);
+        }
+
+        uint8_t applied = txn_half_applied(&log_, req_ids, req_data, req_count, msg) +
+                          txn_half_applied(&resp_log, resp_ids, resp_data, resp_count, msg);
+        TEST_ASSERT_TRUE_MESSAGE(applied == 0 || applied == req_count + resp_count, msg);
+        TEST_ASSERT_TRUE_MESSAGE(cut || applied, msg);
+        if (applied)
+        {
+            for (uint8_t k = 0; k < req_count; k++)
+                memcpy(files[req_ids[k]], req_data[k], SP_STORAGE_FILE_SIZE);
+            for (uint8_t k = 0; k < resp_count; k++)
+                memcpy(resp_files[resp_ids[k]], resp_data[k], SP_STORAGE_FILE_SIZE);
+        }
+        assert_log_files(&log_, files, msg);
+        assert_log_files(&resp_log, resp_files, msg);
+    }
+
+    // Файлы держатся и после ещё одного монтирования
+    TEST_ASSERT_EQUAL_INT(ESP_OK, rec_log_mount(&log_, &flash_emu_part));
+    TEST_ASSERT_EQUAL_INT(ESP_OK, rec_log_mount(&resp_log, &flash_emu_response_part));
+    TEST_ASSERT_EQUAL_INT(ESP_OK, rec_log_txn_recover(&log_, &resp_log));
+    assert_log_files(&log_, files, "remounted");
+    assert_log_files(&resp_log, resp_files, "remounted");
+
+    char msg[96];
+    snprintf(msg, sizeof(msg), "%d transactions, %u power cuts, %u completed after restart", TXN_RUNS, cuts,
+             completed);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_GREATER_THAN_UINT32(TXN_RUNS / 2, cuts);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, completed);
+    TEST_ASSERT_EQUAL_UINT32(0, flash_emu_stats.overwrites);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_mount_formats_foreign_partition);
+    RUN_TEST(test_mount_blank_partition_no_erase);
+    RUN_TEST(test_provisioning_cost);
+    RUN_TEST(test_update_cost);
+    RUN_TEST(test_read_without_mmap);
+    RUN_TEST(test_full_partition_rejects);
+    RUN_TEST(test_write_no_erase);
+    RUN_TEST(test_power_cuts);
+    RUN_TEST(test_txn_power_cuts);
+    return UNITY_END();
+}
@@ -0,0 +1,209 @@
+/**
+ * Согласованные снимки регистров (reg_seq) под нагрузкой из нескольких потоков.
+ *
+ * Писатели:
+ * - результат в окно 0x20+ (reg_seq_write_result): в каждом результате меняется
+ *   случайный набор блоков, все слова изменённого блока - номер результата;
+ * - групповая запись блока регистров запроса (reg_seq_write и begin/end): все
+ *   слова - номер записи.
+ * Читатели снимают регистры без пауз и проверяют каждый снимок:
+ * - слова одного блока одинаковы (запись не застана посередине);
+ * - бит REG_RESULT_CHANGED установлен ровно у блоков с номером REG_RESULT_GEN
+ *   (счётчик, карта и окно - из одного результата).
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include <unity.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include "reg_seq.h"
+
+#define STRESS_RESULTS 200000 // Результатов в окно 0x20+
+#define STRESS_BLOCK_REG HLD_WRITE_REG
+#define STRESS_BLOCK_LEN 32
+
+uint16_t regs[TOTAL_REGS];
+
+static volatile int stress_done;
+
+typedef struct
+{
+    pthread_t thread;
+    unsigned snapshots;
+    unsigned torn;        // Слова блока из разных записей
+    unsigned mismatched;  // Карта изменений не соответствует окну
+    char first_error[96];
+} reader_t;
+
+static uint32_t rnd(uint32_t *state)
+{
+    *state = *state * 1103515245u + 12345u;
+    return *state >> 16;
+}
+
+static void *result_writer(void *arg)
+{
+    (void)arg;
+    uint16_t window[MAX_READ_REGS];
+    uint32_t state = 1;
+    memset(window, 0, sizeof(window));
+
+    for (uint32_t k = 1; k <= STRESS_RESULTS; k++)
+    {
+        uint16_t changed = rnd(&state) | 1; // Хотя бы один блок
+        for (int b = 0; b < 16; b++)
+        {
+            if (changed & (1u << b))
+            {
+                for (int i = 0; i < RESULT_BLOCK_REGS; i++)
+                    window[b * RESULT_BLOCK_REGS + i] = (uint16_t)k;
+            }
+        }
+        reg_seq_write_result(window, MAX_READ_REGS);
+    }
+    return NULL;
+}
+
+static void *block_writer(void *arg)
+{
+    (void)arg;
+    uint16_t block[STRESS_BLOCK_LEN];
+    for (uint16_t n = 1; !__atomic_load_n(&stress_done, __ATOMIC_ACQUIRE); n++)
+    {
+        if (n & 1)
+        {
+            for (int i = 0; i < STRESS_BLOCK_LEN; i++)
+                block[i] = n;
+            reg_seq_write(STRESS_BLOCK_REG, block, STRESS_BLOCK_LEN);
+        }
+        else
+        {
+            reg_seq_write_begin();
+            for (int i = 0; i < STRESS_BLOCK_LEN; i++)
+                regs[STRESS_BLOCK_REG + i] = n;
+            reg_seq_write_end();
+        }
+    }
+    return NULL;
+}
+
+static void reader_error(reader_t *r, const char *what, unsigned *counter)
+{
+    if (r->torn + r->mismatched == 0)
+        snprintf(r->first_error, sizeof(r->first_error), "%s, snapshot %u", what, r->snapshots);
+    (*counter)++;
+}
+
+// Снимок REG_RESULT_GEN, REG_RESULT_CHANGED и окна 0x20+ одним чтением
+static void *result_reader(void *arg)
+{
+    reader_t *r = arg;
+    const uint16_t first = &REG_RESULT_GEN - regs;
+    const uint16_t count = HLD_READ_REG + MAX_READ_REGS - first;
+    uint16_t snap[HLD_READ_REG + MAX_READ_REGS];
+
+    while (!__atomic_load_n(&stress_done, __ATOMIC_ACQUIRE))
+    {
+        reg_seq_read(first, snap, count);
+        r->snapshots++;
+
+        uint16_t gen = snap[0];
+        uint16_t changed = snap[&REG_RESULT_CHANGED - regs - first];
+        const uint16_t *window = &snap[HLD_READ_REG - first];
+        if (gen == 0)
+            continue; // Результатов ещё не было
+
+        for (int b = 0; b < 16; b++)
+        {
+            const uint16_t *block = &window[b * RESULT_BLOCK_REGS];
+            bool uniform = true;
+            for (int i = 1; i < RESULT_BLOCK_REGS; i++)
+                uniform &= block[i] == block[0];
+            if (!uniform)
+            {
+                reader_error(r, "window block torn", &r->torn);
+                break;
+            }
+            if (((changed >> b) & 1) != (block[0] == gen))
+            {
+                reader_error(r, "REG_RESULT_CHANGED does not match window", &r->mismatched);
+                break;
+            }
+        }
+    }
+    return NULL;
+}
+
+static void *block_reader(void *arg)
+{
+    reader_t *r = arg;
+    uint16_t block[STRESS_BLOCK_LEN];
+
+    while (!__atomic_load_n(&stress_done, __ATOMIC_ACQUIRE))
+    {
+        reg_seq_read(STRESS_BLOCK_REG, block, STRESS_BLOCK_LEN);
+        r->snapshots++;
+        for (int i = 1; i < STRESS_BLOCK_LEN; i++)
+        {
+            if (block[i] != block[0])
+            {
+                reader_error(r, "request block torn", &r->torn);
+                break;
+            }
+        }
+    }
+    return NULL;
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+// Два писателя и три читателя одновременно: ни одного разорванного снимка
+static void test_concurrent_writers_and_readers(void)
+{
+    pthread_t writer, block_writer_thread;
+    reader_t readers[3];
+    memset(readers, 0, sizeof(readers));
+    stress_done = 0;
+
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&readers[0].thread, NULL, result_reader, &readers[0]));
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&readers[1].thread, NULL, result_reader, &readers[1]));
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&readers[2].thread, NULL, block_reader, &readers[2]));
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&block_writer_thread, NULL, block_writer, NULL));
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&writer, NULL, result_writer, NULL));
+
+    pthread_join(writer, NULL);
+    __atomic_store_n(&stress_done, 1, __ATOMIC_RELEASE);
+    pthread_join(block_writer_thread, NULL);
+    for (int i = 0; i < 3; i++)
+        pthread_join(readers[i].thread, NULL);
+
+    for (int i = 0; i < 3; i++)
+    {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "reader %d: %u snapshots, %u torn, %u mismatched",
+                 i, readers[i].snapshots, readers[i].torn, readers[i].mismatched);
+        TEST_MESSAGE(msg);
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        TEST_ASSERT_GREATER_THAN_UINT32(0, readers[i].snapshots);
+        TEST_ASSERT_EQUAL_UINT_MESSAGE(0, readers[i].torn, readers[i].first_error);
+        TEST_ASSERT_EQUAL_UINT_MESSAGE(0, readers[i].mismatched, readers[i].first_error);
+    }
+    TEST_ASSERT_EQUAL_UINT16((uint16_t)STRESS_RESULTS, REG_RESULT_GEN);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_concurrent_writers_and_readers);
+    return UNITY_END();
+}
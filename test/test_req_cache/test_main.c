@@ -0,0 +1,267 @@
+/**
+ * Кэш кадров запроса SP (req_cache) без flash.
+ *
+ * Шаблоны раздела `request` подставляются из RAM: тест сам реализует
+ * request_view_begin/end и считает обращения к ним - каждое обращение означает
+ * сборку кадра из шаблона. Проверяется:
+ * - кадр совпадает с собранным staff_frame() из SOH DAD SAD ISI <шаблон>;
+ * - повторная отправка - из кэша, счётчики 0xE0/0xE1;
+ * - смена DAD/SAD и сброс шаблона (req_cache_invalidate, _all) - пересборка;
+ * - вытеснение кадра, к которому дольше всего не обращались;
+ * - разметка указателей (req_cache_pointers) и её устаревание;
+ * - отказ при номере вне диапазона и испорченном байте длины.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include <unity.h>
+#include <string.h>
+#include "req_cache.h"
+#include "sp_storage.h"
+#include "staff.h"
+
+uint16_t regs[TOTAL_REGS];
+
+// Раздел `request` в RAM: байт длины и шаблон
+static uint8_t templates[SP_STORAGE_FILE_COUNT][SP_STORAGE_FILE_SIZE];
+static int view_count; // Обращения к шаблонам (сборки кадров)
+static int view_open;  // Незакрытые отображения
+
+const uint8_t *request_view_begin(uint8_t file_id)
+{
+    if (file_id >= SP_STORAGE_FILE_COUNT)
+        return NULL;
+    view_count++;
+    view_open++;
+    return templates[file_id];
+}
+
+void request_view_end(void)
+{
+    view_open--;
+}
+
+static void template_set(uint8_t file_id, const uint8_t *body, uint8_t len)
+{
+    memset(templates[file_id], 0xFF, SP_STORAGE_FILE_SIZE);
+    templates[file_id][0] = len;
+    memcpy(templates[file_id] + 1, body, len);
+}
+
+// CMD_READ_PARAMS: DataHead "0", указатели HT 0 HT 100 FF HT 1 HT 16 FF
+static const uint8_t body_params[] = {
+    CMD_READ_PARAMS >> 8, HT, '0', STX,
+    HT, '0', HT, '1', '0', '0', FF,
+    HT, '1', HT, '1', '6', FF,
+    ETX};
+
+// Шаблон другой функции - не объединяется; DLE в данных проверяет стаффинг
+static const uint8_t body_other[] = {0x3F, HT, '0', DLE, STX, HT, '5', FF, ETX};
+
+static void check_frame(const req_cache_entry_t *e, uint8_t dad, uint8_t sad,
+                        const uint8_t *body, uint8_t len)
+{
+    uint8_t plain[4 + SP_STORAGE_FILE_SIZE] = {SOH, dad, sad, ISI};
+    uint8_t frame[SP_REQ_FRAME_MAX_SIZE];
+    memcpy(plain + 4, body, len);
+    int frame_len = staff_frame(plain, 4 + len, frame, sizeof(frame));
+
+    TEST_ASSERT_TRUE(frame_len > 0);
+    TEST_ASSERT_EQUAL_UINT16(frame_len, e->len);
+    TEST_ASSERT_EQUAL_MEMORY(frame, e->frame, frame_len);
+    TEST_ASSERT_EQUAL_UINT8(dad, e->dad);
+    TEST_ASSERT_EQUAL_UINT8(sad, e->sad);
+    TEST_ASSERT_EQUAL_UINT8(body[0], e->fnc);
+}
+
+void setUp(void)
+{
+    for (int i = 0; i < SP_STORAGE_FILE_COUNT; i++)
+        template_set(i, body_other, sizeof(body_other));
+    req_cache_invalidate_all();
+    memset(regs, 0, sizeof(regs));
+    view_count = 0;
+    view_open = 0;
+}
+
+void tearDown(void)
+{
+    TEST_ASSERT_EQUAL_INT(0, view_open);
+}
+
+// Первая отправка собирает кадр, повторная - из кэша
+static void test_hit_after_build(void)
+{
+    const req_cache_entry_t *e;
+    template_set(5, body_params, sizeof(body_params));
+
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(5, 0x80, 0x00, &e));
+    check_frame(e, 0x80, 0x00, body_params, sizeof(body_params));
+    TEST_ASSERT_EQUAL_INT(1, view_count);
+
+    const req_cache_entry_t *again;
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(5, 0x80, 0x00, &again));
+    TEST_ASSERT_EQUAL_PTR(e, again);
+    TEST_ASSERT_EQUAL_INT(1, view_count);
+
+    TEST_ASSERT_EQUAL_UINT16(1, REG_DIAG_REQ_CACHE_HIT);
+    TEST_ASSERT_EQUAL_UINT16(1, REG_DIAG_REQ_CACHE_MISS);
+}
+
+// Смена адресов пересобирает кадр в том же месте
+static void test_address_change_rebuilds(void)
+{
+    const req_cache_entry_t *e;
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(7, 0x80, 0x00, &e));
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(7, 0x81, 0x00, &e));
+    check_frame(e, 0x81, 0x00, body_other, sizeof(body_other));
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(7, 0x81, 0x10, &e));
+    check_frame(e, 0x81, 0x10, body_other, sizeof(body_other));
+    TEST_ASSERT_EQUAL_INT(3, view_count);
+
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(7, 0x81, 0x10, &e));
+    TEST_ASSERT_EQUAL_INT(3, view_count);
+    TEST_ASSERT_EQUAL_UINT16(1, REG_DIAG_REQ_CACHE_HIT);
+    TEST_ASSERT_EQUAL_UINT16(3, REG_DIAG_REQ_CACHE_MISS);
+}
+
+// Перезапись шаблона: кадр собирается из новых данных, соседние не затронуты
+static void test_invalidate_rebuilds(void)
+{
+    const req_cache_entry_t *e;
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(3, 0x80, 0x00, &e));
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(4, 0x80, 0x00, &e));
+
+    template_set(3, body_params, sizeof(body_params));
+    req_cache_invalidate(3);
+
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(3, 0x80, 0x00, &e));
+    check_frame(e, 0x80, 0x00, body_params, sizeof(body_params));
+    TEST_ASSERT_EQUAL_INT(3, view_count);
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(4, 0x80, 0x00, &e));
+    TEST_ASSERT_EQUAL_INT(3, view_count);
+
+    req_cache_invalidate_all();
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(3, 0x80, 0x00, &e));
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(4, 0x80, 0x00, &e));
+    TEST_ASSERT_EQUAL_INT(5, view_count);
+}
+
+// Полный кэш: вытесняется кадр, к которому дольше всего не обращались
+static void test_lru_eviction(void)
+{
+    const req_cache_entry_t *e;
+    for (int i = 0; i < REQ_CACHE_SLOTS; i++)
+        TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(i, 0x80, 0x00, &e));
+    TEST_ASSERT_EQUAL_INT(REQ_CACHE_SLOTS, view_count);
+
+    // Шаблон 0 - самый старый по сборке, но к нему обратились недавно
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(0, 0x80, 0x00, &e));
+    TEST_ASSERT_EQUAL_INT(REQ_CACHE_SLOTS, view_count);
+
+    // Новый шаблон вытесняет шаблон 1
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(REQ_CACHE_SLOTS, 0x80, 0x00, &e));
+    TEST_ASSERT_EQUAL_UINT8(REQ_CACHE_SLOTS, e->file_id);
+    TEST_ASSERT_EQUAL_INT(REQ_CACHE_SLOTS + 1, view_count);
+
+    for (int i = 0; i < REQ_CACHE_SLOTS + 1; i++)
+    {
+        if (i == 1)
+            continue;
+        TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(i, 0x80, 0x00, &e));
+    }
+    TEST_ASSERT_EQUAL_INT(REQ_CACHE_SLOTS + 1, view_count);
+
+    // Шаблон 1 собирается заново и вытесняет первый в этом обходе - 0
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(1, 0x80, 0x00, &e));
+    TEST_ASSERT_EQUAL_INT(REQ_CACHE_SLOTS + 2, view_count);
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(2, 0x80, 0x00, &e));
+    TEST_ASSERT_EQUAL_INT(REQ_CACHE_SLOTS + 2, view_count);
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(0, 0x80, 0x00, &e));
+    TEST_ASSERT_EQUAL_INT(REQ_CACHE_SLOTS + 3, view_count);
+}
+
+// Разметка указателей известна только после сборки и до перезаписи шаблона
+static void test_pointers_staleness(void)
+{
+    const req_cache_entry_t *e;
+    uint8_t count = 0xAA, len = 0xAA;
+    template_set(9, body_params, sizeof(body_params));
+
+    TEST_ASSERT_FALSE(req_cache_pointers(9, &count, &len));
+
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(9, 0x80, 0x00, &e));
+    TEST_ASSERT_TRUE(req_cache_pointers(9, &count, &len));
+    TEST_ASSERT_EQUAL_UINT8(2, count);
+    TEST_ASSERT_EQUAL_UINT8(13, len); // HT 0 HT 100 FF HT 1 HT 16 FF
+    TEST_ASSERT_EQUAL_UINT8(2, e->ptr_count);
+    TEST_ASSERT_EQUAL_UINT8(ETX, e->body[e->ptr_end]);
+
+    // Разметка переживает вытеснение кадра
+    for (int i = 10; i < 10 + REQ_CACHE_SLOTS; i++)
+        TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(i, 0x80, 0x00, &e));
+    TEST_ASSERT_TRUE(req_cache_pointers(9, &count, &len));
+    TEST_ASSERT_EQUAL_UINT8(2, count);
+
+    req_cache_invalidate(9);
+    TEST_ASSERT_FALSE(req_cache_pointers(9, &count, &len));
+
+    // Шаблон другой функции не объединяется
+    TEST_ASSERT_TRUE(req_cache_pointers(10, &count, &len));
+    TEST_ASSERT_EQUAL_UINT8(0, count);
+    TEST_ASSERT_EQUAL_UINT8(0, len);
+
+    req_cache_invalidate_all();
+    TEST_ASSERT_FALSE(req_cache_pointers(10, &count, &len));
+    TEST_ASSERT_FALSE(req_cache_pointers(SP_STORAGE_FILE_COUNT, &count, &len));
+}
+
+static void test_rejects(void)
+{
+    const req_cache_entry_t *e;
+    TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_ARG, req_cache_get(SP_STORAGE_FILE_COUNT, 0x80, 0x00, &e));
+
+    templates[11][0] = SP_STORAGE_FILE_SIZE; // Байт длины больше места под шаблон
+    uint8_t count, len;
+    TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_SIZE, req_cache_get(11, 0x80, 0x00, &e));
+    TEST_ASSERT_FALSE(req_cache_pointers(11, &count, &len));
+
+    // Испорченный кадр не остаётся в кэше: исправленный шаблон собирается заново
+    template_set(11, body_other, sizeof(body_other));
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(11, 0x80, 0x00, &e));
+    check_frame(e, 0x80, 0x00, body_other, sizeof(body_other));
+}
+
+// Запрос параметра без шаблона: flash не читается, повтор - тот же кадр
+static void test_direct(void)
+{
+    const req_cache_entry_t *e;
+    static const uint8_t body[] = {CMD_READ_PARAMS >> 8, STX, HT, '2', HT, '1', '6', '0', FF, ETX};
+
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_direct(0x80, 0x00, 2, 160, &e));
+    check_frame(e, 0x80, 0x00, body, sizeof(body));
+    TEST_ASSERT_EQUAL_UINT8(1, e->ptr_count);
+
+    const req_cache_entry_t *again;
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_direct(0x80, 0x00, 2, 160, &again));
+    TEST_ASSERT_EQUAL_PTR(e, again);
+    TEST_ASSERT_EQUAL_MEMORY(e->frame, again->frame, e->len);
+
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_direct(0x80, 0x00, 3, 7, &e));
+    static const uint8_t body2[] = {CMD_READ_PARAMS >> 8, STX, HT, '3', HT, '7', FF, ETX};
+    check_frame(e, 0x80, 0x00, body2, sizeof(body2));
+    TEST_ASSERT_EQUAL_INT(0, view_count);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_hit_after_build);
+    RUN_TEST(test_address_change_rebuilds);
+    RUN_TEST(test_invalidate_rebuilds);
+    RUN_TEST(test_lru_eviction);
+    RUN_TEST(test_pointers_staleness);
+    RUN_TEST(test_rejects);
+    RUN_TEST(test_direct);
+    return UNITY_END();
+}
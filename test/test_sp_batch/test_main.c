@@ -0,0 +1,381 @@
+/**
+ * Объединённый запрос CMD_READ_PARAMS (sp_batch) на кадрах из commands.h.txt.
+ *
+ * Шаблоны - запрос 332 (канал 0, параметр 3) и такие же с другими указателями,
+ * раздел `request` подставляется из RAM (request_view_begin/end), разметку
+ * указателей делает req_cache. Ответ собирается блоками "указатель FF информация
+ * FF", как в ответе на 332, и проходит deStaff(). Проверяется:
+ * - кадр запроса: заголовок и DataHead первого шаблона, указатели всех по порядку;
+ *   запрос из одного шаблона совпадает с кадром 332 из commands.h.txt;
+ * - каждая часть ответа (sp_batch_slice) - ровно блоки указателей своего шаблона,
+ *   в том числе последний блок без FF перед ETX и образцовый ответ на 332;
+ * - короткий ответ и ответ-отказ не делятся: части без своих блоков не выдаются;
+ * - ограничения sp_batch_fits / sp_batch_fits_pointers.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include <unity.h>
+#include <string.h>
+#include "sp_batch.h"
+#include "req_cache.h"
+#include "destaff.h"
+#include "staff.h"
+#include "sp_samples.h"
+
+uint16_t regs[TOTAL_REGS];
+
+#define DAD_332 0x00 // Адреса запроса 332: DAD 00, SAD 86
+#define SAD_332 0x86
+
+// Раздел `request` в RAM: байт длины и шаблон
+static uint8_t templates[SP_STORAGE_FILE_COUNT][SP_STORAGE_FILE_SIZE];
+
+const uint8_t *request_view_begin(uint8_t file_id)
+{
+    if (file_id >= SP_STORAGE_FILE_COUNT)
+        return NULL;
+    return templates[file_id];
+}
+
+void request_view_end(void)
+{
+}
+
+#define T_003 0  // 332: HT 000 HT 003 FF
+#define T_PAIR 1 // HT 000 HT 004 FF HT 001 HT 016 FF
+#define T_005 2  // HT 000 HT 005 FF
+#define T_MANY 3 // 8 указателей
+#define T_OTHER 4 // Не CMD_READ_PARAMS
+
+// Указатели шаблонов по порядку: так же они повторяются в ответе
+static const char *const ptrs_003[] = {"\t000\t003"};
+static const char *const ptrs_pair[] = {"\t000\t004", "\t001\t016"};
+static const char *const ptrs_005[] = {"\t000\t005"};
+
+// Шаблон CMD_READ_PARAMS с DataHead "332" (как в запросе 332)
+static void template_params(uint8_t file_id, const char *const *ptrs, int count)
+{
+    uint8_t *t = templates[file_id];
+    memset(t, 0xFF, SP_STORAGE_FILE_SIZE);
+    uint8_t n = 1;
+    t[n++] = CMD_READ_PARAMS >> 8;
+    t[n++] = '3';
+    t[n++] = '3';
+    t[n++] = '2';
+    t[n++] = STX;
+    for (int i = 0; i < count; i++)
+    {
+        memcpy(t + n, ptrs[i], strlen(ptrs[i]));
+        n += strlen(ptrs[i]);
+        t[n++] = FF;
+    }
+    t[n++] = ETX;
+    t[0] = n - 1;
+}
+
+// Ответ без стаффинга: SOH DAD SAD ISI 03 "332" STX (указатель FF информация FF)... ETX
+typedef struct
+{
+    uint8_t plain[SP_BATCH_PLAIN_MAX_SIZE];
+    size_t len;
+    size_t part_start[SP_BATCH_MAX]; // Ожидаемые части шаблонов
+    size_t part_end[SP_BATCH_MAX];
+} reply_t;
+
+static void reply_begin(reply_t *r)
+{
+    static const uint8_t head[] = {SOH, SAD_332, DAD_332, ISI, 0x03, '3', '3', '2', STX};
+    memcpy(r->plain, head, sizeof(head));
+    r->len = sizeof(head);
+}
+
+static void reply_put(reply_t *r, const char *s)
+{
+    memcpy(r->plain + r->len, s, strlen(s));
+    r->len += strlen(s);
+}
+
+// Блоки ответа на указатели шаблона index: значение - номер параметра с префиксом
+static void reply_template(reply_t *r, uint8_t index, const char *const *ptrs, int count)
+{
+    r->part_start[index] = r->len;
+    for (int i = 0; i < count; i++)
+    {
+        if (i > 0)
+            r->plain[r->len++] = FF;
+        reply_put(r, ptrs[i]);
+        r->plain[r->len++] = FF;
+        reply_put(r, "\t20601000");
+        reply_put(r, ptrs[i] + 5);
+        reply_put(r, "\t ");
+    }
+    r->part_end[index] = r->len;
+    r->plain[r->len++] = FF;
+}
+
+// Кадр FF FF ... CRC через deStaff(): разметка в ctx, дестаффированный пакет в buf
+static int reply_decode(const reply_t *r, sp_decoder_ctx_t *ctx, uint8_t *buf)
+{
+    size_t frame_len = sp_sample_frame(r->plain, r->len, buf);
+    uint16_t crc = (buf[frame_len - 2] << 8) | buf[frame_len - 1];
+    int len = deStaff(ctx, buf + 2, frame_len - 4);
+    TEST_ASSERT_EQUAL_HEX16(crc, ctx->crc);
+    memmove(buf, buf + 2, len > 0 ? len : 0);
+    return len;
+}
+
+// Объединённый запрос, как его собирает uart2_task
+static void batch_build(sp_batch_t *b, const uint8_t *ids, int count)
+{
+    const req_cache_entry_t *e;
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(ids[0], DAD_332, SAD_332, &e));
+    sp_batch_begin(b, ids[0], e);
+    for (int i = 1; i < count; i++)
+    {
+        TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(ids[i], DAD_332, SAD_332, &e));
+        TEST_ASSERT_TRUE(sp_batch_fits(b, e));
+        sp_batch_add(b, ids[i], e);
+    }
+    TEST_ASSERT_TRUE(sp_batch_finish(b));
+}
+
+static sp_batch_t batch;
+static reply_t reply;
+static uint8_t buf[2 * SP_BATCH_PLAIN_MAX_SIZE + 4];
+
+void setUp(void)
+{
+    static const char *const ptrs_many[] = {"\t000\t010", "\t000\t011", "\t000\t012", "\t000\t013",
+                                            "\t000\t014", "\t000\t015", "\t000\t016", "\t000\t017"};
+    static const uint8_t other[] = {5, 0x3F, '0', STX, '1', ETX};
+
+    req_cache_invalidate_all();
+    template_params(T_003, ptrs_003, 1);
+    template_params(T_PAIR, ptrs_pair, 2);
+    template_params(T_005, ptrs_005, 1);
+    template_params(T_MANY, ptrs_many, 8);
+    memset(templates[T_OTHER], 0xFF, SP_STORAGE_FILE_SIZE);
+    memcpy(templates[T_OTHER], other, sizeof(other));
+    memset(&batch, 0, sizeof(batch));
+    memset(&reply, 0, sizeof(reply));
+}
+
+void tearDown(void)
+{
+}
+
+// Кадр: заголовок и DataHead первого шаблона, указатели трёх шаблонов, ETX
+static void test_request_frame(void)
+{
+    static const uint8_t ids[] = {T_003, T_PAIR, T_005};
+    batch_build(&batch, ids, 3);
+
+    TEST_ASSERT_EQUAL_UINT8(3, batch.count);
+    TEST_ASSERT_EQUAL_UINT8(4, batch.ptr_total);
+    TEST_ASSERT_EQUAL_UINT8(1, batch.ptrs[0]);
+    TEST_ASSERT_EQUAL_UINT8(2, batch.ptrs[1]);
+    TEST_ASSERT_EQUAL_UINT8(1, batch.ptrs[2]);
+
+    static const uint8_t expected[] = {
+        SOH, DAD_332, SAD_332, ISI, 0x1D, '3', '3', '2', STX,
+        HT, '0', '0', '0', HT, '0', '0', '3', FF,
+        HT, '0', '0', '0', HT, '0', '0', '4', FF, HT, '0', '0', '1', HT, '0', '1', '6', FF,
+        HT, '0', '0', '0', HT, '0', '0', '5', FF, ETX};
+    TEST_ASSERT_EQUAL_UINT16(sizeof(expected), batch.plain_len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, batch.plain, sizeof(expected));
+
+    uint8_t frame[SP_BATCH_FRAME_MAX_SIZE];
+    int len = staff_frame(expected, sizeof(expected), frame, sizeof(frame));
+    TEST_ASSERT_EQUAL_INT(len, batch.len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(frame, batch.frame, len);
+}
+
+// Запрос из одного шаблона 332 - кадр из commands.h.txt
+static void test_single_template_is_332(void)
+{
+    static const uint8_t ids[] = {T_003};
+    batch_build(&batch, ids, 1);
+    TEST_ASSERT_EQUAL_INT(sizeof(sp_sample_request_332), batch.len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(sp_sample_request_332, batch.frame, sizeof(sp_sample_request_332));
+}
+
+static void assert_slices(const sp_decoder_ctx_t *ctx, const uint8_t *destuffed)
+{
+    for (uint8_t i = 0; i < batch.count; i++)
+    {
+        size_t start, end;
+        TEST_ASSERT_TRUE(sp_batch_slice(&batch, i, ctx->tokens.ff, ctx->tokens.ff_count,
+                                        ctx->stx_position + 1, ctx->etx_position, &start, &end));
+        TEST_ASSERT_EQUAL_UINT32(reply.part_end[i] - reply.part_start[i], end - start);
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(reply.plain + reply.part_start[i], destuffed + start, end - start);
+    }
+}
+
+// Ответ делится по шаблонам: у каждого - блоки его указателей без последнего FF
+static void test_reply_slices(void)
+{
+    static const uint8_t ids[] = {T_003, T_PAIR, T_005};
+    batch_build(&batch, ids, 3);
+
+    reply_begin(&reply);
+    reply_template(&reply, 0, ptrs_003, 1);
+    reply_template(&reply, 1, ptrs_pair, 2);
+    reply_template(&reply, 2, ptrs_005, 1);
+    reply.plain[reply.len++] = ETX;
+
+    sp_decoder_ctx_t ctx;
+    TEST_ASSERT_EQUAL_INT(reply.len, reply_decode(&reply, &ctx, buf));
+    TEST_ASSERT_EQUAL_UINT8(8, ctx.tokens.ff_count);
+    assert_slices(&ctx, buf);
+}
+
+// Последний блок закрыт ETX без FF: часть последнего шаблона - до ETX
+static void test_reply_last_block_without_ff(void)
+{
+    static const uint8_t ids[] = {T_PAIR, T_003};
+    batch_build(&batch, ids, 2);
+
+    reply_begin(&reply);
+    reply_template(&reply, 0, ptrs_pair, 2);
+    reply_template(&reply, 1, ptrs_003, 1);
+    reply.plain[reply.len - 1] = ETX; // Вместо последнего FF
+
+    sp_decoder_ctx_t ctx;
+    TEST_ASSERT_EQUAL_INT(reply.len, reply_decode(&reply, &ctx, buf));
+    TEST_ASSERT_EQUAL_UINT8(5, ctx.tokens.ff_count);
+    assert_slices(&ctx, buf);
+}
+
+// Образцовый ответ на 332 (commands.h.txt) - часть единственного шаблона
+static void test_sample_reply_332(void)
+{
+    static const uint8_t ids[] = {T_003};
+    batch_build(&batch, ids, 1);
+
+    memcpy(buf, sp_sample_reply_332, sizeof(sp_sample_reply_332));
+    sp_decoder_ctx_t ctx;
+    int len = deStaff(&ctx, buf + 2, sizeof(sp_sample_reply_332) - 4);
+    TEST_ASSERT_GREATER_THAN_INT(0, len);
+    TEST_ASSERT_EQUAL_HEX16((sp_sample_reply_332[sizeof(sp_sample_reply_332) - 2] << 8) |
+                                sp_sample_reply_332[sizeof(sp_sample_reply_332) - 1],
+                            ctx.crc);
+
+    size_t start, end;
+    TEST_ASSERT_TRUE(sp_batch_slice(&batch, 0, ctx.tokens.ff, ctx.tokens.ff_count,
+                                    ctx.stx_position + 1, ctx.etx_position, &start, &end));
+    static const char part[] = "\t0\t003\x0C\t2060100005\t ";
+    TEST_ASSERT_EQUAL_UINT32(sizeof(part) - 1, end - start);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(part, buf + 2 + start, end - start);
+}
+
+// Прибор ответил не на все указатели: части без своих блоков не выдаются
+static void test_short_reply(void)
+{
+    static const uint8_t ids[] = {T_003, T_PAIR, T_005};
+    batch_build(&batch, ids, 3);
+
+    reply_begin(&reply);
+    reply_template(&reply, 0, ptrs_003, 1);
+    reply_template(&reply, 1, ptrs_pair, 2);
+    reply.plain[reply.len++] = ETX;
+
+    sp_decoder_ctx_t ctx;
+    TEST_ASSERT_EQUAL_INT(reply.len, reply_decode(&reply, &ctx, buf));
+
+    size_t start, end;
+    for (uint8_t i = 0; i < 2; i++)
+    {
+        TEST_ASSERT_TRUE(sp_batch_slice(&batch, i, ctx.tokens.ff, ctx.tokens.ff_count,
+                                        ctx.stx_position + 1, ctx.etx_position, &start, &end));
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(reply.plain + reply.part_start[i], buf + start, end - start);
+    }
+    TEST_ASSERT_FALSE(sp_batch_slice(&batch, 2, ctx.tokens.ff, ctx.tokens.ff_count,
+                                     ctx.stx_position + 1, ctx.etx_position, &start, &end));
+    TEST_ASSERT_FALSE(sp_batch_slice(&batch, 3, ctx.tokens.ff, ctx.tokens.ff_count,
+                                     ctx.stx_position + 1, ctx.etx_position, &start, &end));
+}
+
+// Отказ: вместо блоков - один диагностический текст. Ни одна часть не выдаётся
+static void test_error_reply(void)
+{
+    static const uint8_t ids[] = {T_003, T_PAIR, T_005};
+    batch_build(&batch, ids, 3);
+
+    reply_begin(&reply);
+    reply_put(&reply, "\tNo data\x0C");
+    reply.plain[reply.len++] = ETX;
+
+    sp_decoder_ctx_t ctx;
+    TEST_ASSERT_EQUAL_INT(reply.len, reply_decode(&reply, &ctx, buf));
+    TEST_ASSERT_EQUAL_UINT8(1, ctx.tokens.ff_count);
+
+    size_t start, end;
+    for (uint8_t i = 0; i < batch.count; i++)
+        TEST_ASSERT_FALSE(sp_batch_slice(&batch, i, ctx.tokens.ff, ctx.tokens.ff_count,
+                                         ctx.stx_position + 1, ctx.etx_position, &start, &end));
+
+    // Пустая полезная нагрузка
+    reply_begin(&reply);
+    reply.plain[reply.len++] = ETX;
+    TEST_ASSERT_EQUAL_INT(reply.len, reply_decode(&reply, &ctx, buf));
+    for (uint8_t i = 0; i < batch.count; i++)
+        TEST_ASSERT_FALSE(sp_batch_slice(&batch, i, ctx.tokens.ff, ctx.tokens.ff_count,
+                                         ctx.stx_position + 1, ctx.etx_position, &start, &end));
+}
+
+// Ограничения: DAD, функция, число шаблонов, указателей и длина кадра
+static void test_fits(void)
+{
+    const req_cache_entry_t *e;
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(T_PAIR, DAD_332, SAD_332, &e));
+    sp_batch_begin(&batch, T_PAIR, e);
+
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(T_003, DAD_332 + 1, SAD_332, &e));
+    TEST_ASSERT_FALSE(sp_batch_fits(&batch, e)); // Другой прибор
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(T_OTHER, DAD_332, SAD_332, &e));
+    TEST_ASSERT_EQUAL_UINT8(0, e->ptr_count);
+    TEST_ASSERT_FALSE(sp_batch_fits(&batch, e)); // Не CMD_READ_PARAMS
+
+    TEST_ASSERT_FALSE(sp_batch_fits_pointers(&batch, 0, 0));
+
+    // Кадр без стаффинга с ETX - не длиннее SP_BATCH_PLAIN_MAX_SIZE
+    sp_batch_t full = {.count = 1, .ptrs = {1}, .ptr_total = 1, .plain_len = SP_BATCH_PLAIN_MAX_SIZE - 100};
+    TEST_ASSERT_TRUE(sp_batch_fits_pointers(&full, 1, 99));
+    TEST_ASSERT_FALSE(sp_batch_fits_pointers(&full, 1, 100));
+
+    // Указателей не больше MAX_BLOCKS / 2: ответ на каждый - два блока
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(T_MANY, DAD_332, SAD_332, &e));
+    TEST_ASSERT_TRUE(sp_batch_fits(&batch, e));
+    sp_batch_add(&batch, T_MANY, e);
+    TEST_ASSERT_EQUAL_UINT8(MAX_BLOCKS / 2, batch.ptr_total);
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(T_003, DAD_332, SAD_332, &e));
+    TEST_ASSERT_FALSE(sp_batch_fits(&batch, e));
+    TEST_ASSERT_TRUE(sp_batch_contains(&batch, T_MANY));
+    TEST_ASSERT_FALSE(sp_batch_contains(&batch, T_003));
+
+    // Шаблонов не больше SP_BATCH_MAX
+    TEST_ASSERT_EQUAL_INT(ESP_OK, req_cache_get(T_003, DAD_332, SAD_332, &e));
+    sp_batch_begin(&batch, T_003, e);
+    for (int i = 1; i < SP_BATCH_MAX; i++)
+    {
+        TEST_ASSERT_TRUE(sp_batch_fits_pointers(&batch, 1, 9));
+        sp_batch_add(&batch, T_003, e);
+    }
+    TEST_ASSERT_EQUAL_UINT8(SP_BATCH_MAX, batch.count);
+    TEST_ASSERT_FALSE(sp_batch_fits_pointers(&batch, 1, 9));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_request_frame);
+    RUN_TEST(test_single_template_is_332);
+    RUN_TEST(test_reply_slices);
+    RUN_TEST(test_reply_last_block_without_ff);
+    RUN_TEST(test_sample_reply_332);
+    RUN_TEST(test_short_reply);
+    RUN_TEST(test_error_reply);
+    RUN_TEST(test_fits);
+    return UNITY_END();
+}
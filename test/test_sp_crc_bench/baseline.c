@@ -0,0 +1,24 @@
+/**
+ * CRC кадров SP до табличного расчёта (user-015): 8 сдвигов на байт.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include "baseline.h"
+
+uint16_t baseline_sp_crc16(const uint8_t *msg, size_t len)
+{
+    int j, crc = 0;
+    while (len-- > 0)
+    {
+        crc = crc ^ (int)*msg++ << 8;
+        for (j = 0; j < 8; j++)
+        {
+            if (crc & 0x8000)
+                crc = (crc << 1) ^ 0x1021;
+            else
+                crc <<= 1;
+        }
+    }
+    return (uint16_t)crc;
+}
@@ -0,0 +1,12 @@
+/**
+ * CRC кадров SP до табличного расчёта (user-015) - для сравнения.
+ *
+ * Версия от 18 октября 2025г.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Побитовый CRC-16 (полином 0x1021), как sp_crc16() до табличного расчёта
+uint16_t baseline_sp_crc16(const uint8_t *msg, size_t len);
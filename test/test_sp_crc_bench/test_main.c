@@ -0,0 +1,239 @@
+/**
+ * CRC кадров SP: побитовый расчёт (до user-015), таблица по байту
+ * (sp_crc16_byte) и slice-by-4 (sp_crc16, sp_crc16_update).
+ *
+ * Сначала табличный расчёт сверяется с побитовым на контрольной строке и на
+ * случайных данных случайной длины - целиком, по частям и по байту, а
+ * staff_frame() - со staff() и отдельным расчётом CRC. Затем измеряется время
+ * расчёта в тактах на байт (на x86; на других ПК - в наносекундах) и время сборки
+ * объединённого запроса на SP_BATCH_MAX параметров.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "sp_crc.h"
+#include "staff.h"
+#include "project_config.h"
+#include "bench.h"
+#include "baseline.h"
+
+#define CHECK_INPUTS 200000 // Случайных входов в сверке
+#define CHECK_MAX_LEN 300
+#define BENCH_BYTES (4u * 1024 * 1024) // Байт на один замер
+#define BENCH_RUNS 5                   // Лучший из замеров
+
+static uint32_t rnd_state = 2025;
+
+static uint32_t rnd(void)
+{
+    rnd_state = rnd_state * 1103515245u + 12345u;
+    return rnd_state >> 16;
+}
+
+// Прежняя сборка кадра запроса: стаффинг, затем CRC отдельным проходом
+static int baseline_staff_frame(const uint8_t *input, size_t input_len, uint8_t *output, size_t output_max_len)
+{
+    int len = staff(input, input_len, output, output_max_len - 2);
+    if (len < 2)
+        return 0;
+    uint16_t crc = baseline_sp_crc16(output + 2, len - 2);
+    output[len++] = crc >> 8;
+    output[len++] = crc & 0xFF;
+    return len;
+}
+
+static uint16_t bytewise_sp_crc16(const uint8_t *msg, size_t len)
+{
+    uint16_t crc = sp_crc16_init();
+    while (len-- > 0)
+        crc = sp_crc16_byte(crc, *msg++);
+    return sp_crc16_final(crc);
+}
+
+typedef uint16_t (*crc_fn_t)(const uint8_t *msg, size_t len);
+
+static const struct
+{
+    const char *name;
+    crc_fn_t fn;
+} variants[] = {
+    {"bitwise", baseline_sp_crc16},
+    {"table", bytewise_sp_crc16},
+    {"slice-by-4", sp_crc16},
+};
+static const int variant_count = sizeof(variants) / sizeof(variants[0]);
+
+// Запрос на SP_BATCH_MAX параметров без стаффинга: SOH ... STX {HT 0 HT 1xx FF} ETX
+static size_t build_batch_request(uint8_t *out)
+{
+    static const uint8_t head[] = {SOH, 0x00, 0x86, ISI, 0x1D, STX};
+    size_t n = 0;
+    memcpy(out, head, sizeof(head));
+    n += sizeof(head);
+    for (int i = 0; i < SP_BATCH_MAX; i++)
+        n += sprintf((char *)out + n, "\t0\t1%02d\f", i);
+    out[n++] = ETX;
+    return n;
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+// Контрольное значение CRC-16/XMODEM
+static void test_check_value(void)
+{
+    static const uint8_t check[] = "123456789";
+    for (int v = 0; v < variant_count; v++)
+        TEST_ASSERT_EQUAL_HEX16_MESSAGE(0x31C3, variants[v].fn(check, 9), variants[v].name);
+}
+
+// Случайные входы: табличный расчёт совпадает с побитовым при любом разбиении
+static void test_random_inputs_match_bitwise(void)
+{
+    uint8_t buf[CHECK_MAX_LEN];
+    for (int n = 0; n < CHECK_INPUTS; n++)
+    {
+        size_t len = rnd() % (CHECK_MAX_LEN + 1);
+        for (size_t i = 0; i < len; i++)
+            buf[i] = rnd();
+
+        uint16_t expected = baseline_sp_crc16(buf, len);
+        char msg[48];
+        snprintf(msg, sizeof(msg), "input %d, %u bytes", n, (unsigned)len);
+        TEST_ASSERT_EQUAL_HEX16_MESSAGE(expected, sp_crc16(buf, len), msg);
+        TEST_ASSERT_EQUAL_HEX16_MESSAGE(expected, bytewise_sp_crc16(buf, len), msg);
+
+        // Части случайной длины, как в staff_frame() между управляющими байтами
+        uint16_t crc = sp_crc16_init();
+        for (size_t pos = 0; pos < len;)
+        {
+            size_t part = 1 + rnd() % 16;
+            if (part > len - pos)
+                part = len - pos;
+            crc = sp_crc16_update(crc, buf + pos, part);
+            pos += part;
+        }
+        TEST_ASSERT_EQUAL_HEX16_MESSAGE(expected, sp_crc16_final(crc), msg);
+    }
+}
+
+// Случайные запросы (с управляющими байтами): staff_frame() == staff() + CRC
+static void test_staff_frame_matches_staff_and_crc(void)
+{
+    uint8_t plain[CHECK_MAX_LEN], expected[2 * CHECK_MAX_LEN + 4], got[2 * CHECK_MAX_LEN + 4];
+    static const uint8_t special[] = {SOH, ISI, STX, ETX, DLE, HT, FF};
+    for (int n = 0; n < CHECK_INPUTS / 10; n++)
+    {
+        size_t len = 1 + rnd() % CHECK_MAX_LEN;
+        plain[0] = SOH;
+        for (size_t i = 1; i < len; i++)
+            plain[i] = (rnd() % 8 == 0) ? special[rnd() % sizeof(special)] : rnd();
+
+        int expected_len = baseline_staff_frame(plain, len, expected, sizeof(expected));
+        int len_got = staff_frame(plain, len, got, sizeof(got));
+        char msg[48];
+        snprintf(msg, sizeof(msg), "input %d, %u bytes", n, (unsigned)len);
+        TEST_ASSERT_GREATER_THAN_MESSAGE(0, expected_len, msg);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(expected_len, len_got, msg);
+        TEST_ASSERT_EQUAL_MEMORY_MESSAGE(expected, got, expected_len, msg);
+        TEST_ASSERT_EQUAL_HEX16_MESSAGE(0, sp_crc16(got + 2, len_got - 2), msg); // CRC кадра вместе с CRC
+    }
+}
+
+static uint64_t bench_crc(crc_fn_t fn, uint8_t *buf, size_t len, unsigned iterations)
+{
+    uint64_t best = UINT64_MAX;
+    for (int run = 0; run < BENCH_RUNS; run++)
+    {
+        uint16_t sum = 0;
+        uint64_t t0 = bench_now();
+        for (unsigned i = 0; i < iterations; i++)
+        {
+            buf[0] = sum; // Кадр зависит от предыдущего: вызовы не перекрываются
+            sum += fn(buf, len);
+        }
+        uint64_t t = bench_now() - t0;
+        bench_keep(&sum);
+        if (t < best)
+            best = t;
+    }
+    return best;
+}
+
+// Такты на байт для 16, 96 и 256 байт
+static void test_bench_crc(void)
+{
+    static const size_t sizes[] = {16, 96, 256};
+    uint8_t buf[256];
+    for (size_t i = 0; i < sizeof(buf); i++)
+        buf[i] = rnd();
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        unsigned iterations = BENCH_BYTES / sizes[s];
+        double per_byte[3];
+        for (int v = 0; v < variant_count; v++)
+            per_byte[v] = (double)bench_crc(variants[v].fn, buf, sizes[s], iterations) / ((double)iterations * sizes[s]);
+
+        char msg[160];
+        snprintf(msg, sizeof(msg), "%3u B: bitwise %.2f, table %.2f (x%.1f), slice-by-4 %.2f (x%.1f) %s/B",
+                 (unsigned)sizes[s], per_byte[0], per_byte[1], per_byte[0] / per_byte[1],
+                 per_byte[2], per_byte[0] / per_byte[2], BENCH_UNIT);
+        TEST_MESSAGE(msg);
+    }
+}
+
+typedef int (*frame_fn_t)(const uint8_t *input, size_t input_len, uint8_t *output, size_t output_max_len);
+
+static uint64_t bench_frame(frame_fn_t fn, const uint8_t *plain, size_t len, unsigned iterations)
+{
+    uint8_t out[2 * SP_RX_FRAME_MAX_SIZE];
+    uint64_t best = UINT64_MAX;
+    for (int run = 0; run < BENCH_RUNS; run++)
+    {
+        uint64_t t0 = bench_now();
+        for (unsigned i = 0; i < iterations; i++)
+        {
+            fn(plain, len, out, sizeof(out));
+            bench_keep(out);
+        }
+        uint64_t t = bench_now() - t0;
+        if (t < best)
+            best = t;
+    }
+    return best;
+}
+
+// Сборка кадра запроса: стаффинг и CRC двумя проходами и одним
+static void test_bench_request_frame(void)
+{
+    uint8_t plain[SP_RX_FRAME_MAX_SIZE];
+    size_t len = build_batch_request(plain);
+    unsigned iterations = BENCH_BYTES / len;
+    double before = (double)bench_frame(baseline_staff_frame, plain, len, iterations) / iterations;
+    double after = (double)bench_frame(staff_frame, plain, len, iterations) / iterations;
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "batch request %u B: staff + bitwise CRC %.0f %s, staff_frame %.0f %s, x%.1f",
+             (unsigned)len, before, BENCH_UNIT, after, BENCH_UNIT, before / after);
+    TEST_MESSAGE(msg);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_check_value);
+    RUN_TEST(test_random_inputs_match_bitwise);
+    RUN_TEST(test_staff_frame_matches_staff_and_crc);
+    RUN_TEST(test_bench_crc);
+    RUN_TEST(test_bench_request_frame);
+    return UNITY_END();
+}
@@ -0,0 +1,99 @@
+/**
+ * Разбор ответа SP до объединения проходов (user-003) - для сравнения.
+ * Код sp_crc16(), deStaff() и sp_exe_in() того времени, без журнала.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include "baseline.h"
+#include "project_config.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int stx_position = -1;
+static int etx_position = -1;
+
+uint16_t baseline_sp_crc16(const uint8_t *msg, size_t len)
+{
+    int j, crc = 0;
+    while (len-- > 0)
+    {
+        crc = crc ^ (int)*msg++ << 8;
+        for (j = 0; j < 8; j++)
+        {
+            if (crc & 0x8000)
+                crc = (crc << 1) ^ 0x1021;
+            else
+                crc <<= 1;
+        }
+    }
+    return crc;
+}
+
+static int baseline_deStaff(uint8_t *input, size_t len)
+{
+    size_t read_idx = 0;
+    size_t write_idx = 0;
+
+    while (read_idx < len)
+    {
+        if (input[read_idx] == DLE && (read_idx + 1 < len))
+        {
+            uint8_t next_byte = input[read_idx + 1];
+            bool should_remove = (next_byte == SOH || next_byte == STX ||
+                                  next_byte == ETX || next_byte == ISI);
+            if (should_remove)
+            {
+                if (next_byte == STX)
+                    stx_position = (int)(write_idx);
+                if (next_byte == ETX)
+                    etx_position = (int)(write_idx);
+                read_idx++;
+                continue;
+            }
+        }
+        input[write_idx] = input[read_idx];
+        write_idx++;
+        read_idx++;
+    }
+
+    if (stx_position == -1 || etx_position == -1 || stx_position >= etx_position)
+        return -1;
+    return write_idx;
+}
+
+int baseline_decode(const uint8_t *frame, size_t len, uint8_t *out, sp_tokens_t *tokens)
+{
+    uint16_t received_crc = (frame[len - 2] << 8) | frame[len - 1];
+    if (received_crc != baseline_sp_crc16(frame + 4, len - 6))
+        return BASELINE_ERR_CRC;
+
+    uint8_t *temp_buf = malloc(len * 2);
+    if (!temp_buf)
+        return -1;
+    memcpy(temp_buf, frame + 2, len - 4);
+
+    stx_position = -1;
+    etx_position = -1;
+    int destuffed_len = baseline_deStaff(temp_buf, len - 4);
+    if (destuffed_len > 0)
+    {
+        // Разделители полезной нагрузки - повторным проходом
+        tokens->ht_count = 0;
+        tokens->ff_count = 0;
+        tokens->overflow = false;
+        for (int i = stx_position + 1; i < etx_position; i++)
+        {
+            if (temp_buf[i] == HT && tokens->ht_count < SP_MAX_TOKENS)
+                tokens->ht[tokens->ht_count++] = i;
+            else if (temp_buf[i] == FF && tokens->ff_count < SP_MAX_TOKENS)
+                tokens->ff[tokens->ff_count++] = i;
+        }
+        if (out)
+            memcpy(out, temp_buf, destuffed_len);
+    }
+
+    free(temp_buf);
+    return destuffed_len;
+}
@@ -0,0 +1,23 @@
+/**
+ * Разбор ответа SP до объединения проходов (user-003) - для сравнения.
+ *
+ * Версия от 18 октября 2025г.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "destaff.h"
+
+#define BASELINE_ERR_CRC -2
+
+// Побитовый CRC-16 (полином 0x1021), как sp_crc16() до табличного расчёта
+uint16_t baseline_sp_crc16(const uint8_t *msg, size_t len);
+
+/**
+ * Прежний sp_exe_in() до разбора полей: CRC отдельным проходом, копия кадра в кучу,
+ * дестаффинг со сдвигами, поиск HT/FF полезной нагрузки повторным проходом
+ * (как прежние парсеры). out - дестаффированный пакет (NULL - не нужен).
+ * @return Длина пакета, -1 (нет STX/ETX) или BASELINE_ERR_CRC
+ */
+int baseline_decode(const uint8_t *frame, size_t len, uint8_t *out, sp_tokens_t *tokens);
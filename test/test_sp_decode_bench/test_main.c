@@ -0,0 +1,172 @@
+/**
+ * Разбор ответа SP: прежний конвейер (CRC, копия в кучу, дестаффинг, повторный
+ * поиск разделителей) и deStaff() за один проход.
+ *
+ * Сначала проверяется, что оба дают один и тот же пакет, CRC и разметку, затем
+ * измеряется пропускная способность в байтах кадра на такт (на x86; на других
+ * ПК - на наносекунду). Кадры - test/sp_samples.h и объединённый ответ на
+ * SP_BATCH_MAX параметров того же вида.
+ *
+ * В замер deStaff() входит восстановление кадра (memcpy) перед каждым вызовом -
+ * в прошивке его нет, поэтому выигрыш занижен.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "destaff.h"
+#include "sp_crc.h"
+#include "sp_samples.h"
+#include "bench.h"
+#include "baseline.h"
+
+#define BENCH_BYTES (8u * 1024 * 1024) // Байт кадров на один замер
+#define BENCH_RUNS 5                   // Лучший из замеров
+
+typedef struct
+{
+    const char *name;
+    uint8_t frame[SP_RX_FRAME_MAX_SIZE];
+    size_t len;
+} sample_t;
+
+static sample_t samples[3];
+static const int sample_count = sizeof(samples) / sizeof(samples[0]);
+
+// Объединённый ответ: SP_BATCH_MAX блоков "HT 0 HT 1xx FF HT значение HT единицы FF"
+static size_t build_batch_reply(uint8_t *out)
+{
+    uint8_t plain[SP_RX_FRAME_MAX_SIZE / 2];
+    size_t n = 0;
+    static const uint8_t head[] = {SOH, 0x86, 0x00, ISI, 0x03, '3', '3', '2', STX};
+    memcpy(plain, head, sizeof(head));
+    n += sizeof(head);
+    for (int i = 0; i < SP_BATCH_MAX; i++)
+        n += sprintf((char *)plain + n, "\t0\t1%02d\f\t%d.%03d\tm3/h\f", i, 100 + i * 7, i * 13);
+    plain[n++] = ETX;
+    return sp_sample_frame(plain, n, out);
+}
+
+// Разбор deStaff() так, как в sp_exe_in(): пакет от DLE SOH до DLE ETX в том же буфере
+static int fused_decode(const uint8_t *frame, size_t len, uint8_t *work, sp_decoder_ctx_t *ctx, bool *crc_ok)
+{
+    memcpy(work, frame, len);
+    int n = deStaff(ctx, work + 2, len - 4);
+    *crc_ok = ctx->crc == ((frame[len - 2] << 8) | frame[len - 1]);
+    return n;
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+// Один проход даёт тот же пакет, CRC и разметку, что и прежний конвейер
+static void test_fused_matches_baseline(void)
+{
+    for (int s = 0; s < sample_count; s++)
+    {
+        uint8_t expected[SP_RX_FRAME_MAX_SIZE], work[SP_RX_FRAME_MAX_SIZE];
+        sp_tokens_t tokens;
+        sp_decoder_ctx_t ctx;
+        bool crc_ok;
+
+        int base_len = baseline_decode(samples[s].frame, samples[s].len, expected, &tokens);
+        int len = fused_decode(samples[s].frame, samples[s].len, work, &ctx, &crc_ok);
+
+        TEST_ASSERT_GREATER_THAN_MESSAGE(0, base_len, samples[s].name);
+        TEST_ASSERT_TRUE_MESSAGE(crc_ok, samples[s].name);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(base_len, len, samples[s].name);
+        TEST_ASSERT_EQUAL_MEMORY_MESSAGE(expected, work + 2, len, samples[s].name);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(tokens.ht_count, ctx.tokens.ht_count, samples[s].name);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(tokens.ff_count, ctx.tokens.ff_count, samples[s].name);
+        TEST_ASSERT_EQUAL_MEMORY_MESSAGE(tokens.ht, ctx.tokens.ht, tokens.ht_count * sizeof(uint16_t), samples[s].name);
+        TEST_ASSERT_EQUAL_MEMORY_MESSAGE(tokens.ff, ctx.tokens.ff, tokens.ff_count * sizeof(uint16_t), samples[s].name);
+
+        // Искажённый байт: оба отклоняют кадр по CRC
+        uint8_t bad[SP_RX_FRAME_MAX_SIZE];
+        memcpy(bad, samples[s].frame, samples[s].len);
+        bad[samples[s].len / 2] ^= 0x40;
+        TEST_ASSERT_EQUAL_INT_MESSAGE(BASELINE_ERR_CRC, baseline_decode(bad, samples[s].len, NULL, &tokens), samples[s].name);
+        fused_decode(bad, samples[s].len, work, &ctx, &crc_ok);
+        TEST_ASSERT_FALSE_MESSAGE(crc_ok, samples[s].name);
+    }
+}
+
+static uint64_t bench_baseline(const sample_t *s, unsigned iterations)
+{
+    sp_tokens_t tokens;
+    uint64_t best = UINT64_MAX;
+    for (int run = 0; run < BENCH_RUNS; run++)
+    {
+        uint64_t t0 = bench_now();
+        for (unsigned i = 0; i < iterations; i++)
+        {
+            baseline_decode(s->frame, s->len, NULL, &tokens);
+            bench_keep(&tokens);
+        }
+        uint64_t t = bench_now() - t0;
+        if (t < best)
+            best = t;
+    }
+    return best;
+}
+
+static uint64_t bench_fused(const sample_t *s, unsigned iterations)
+{
+    uint8_t work[SP_RX_FRAME_MAX_SIZE];
+    sp_decoder_ctx_t ctx;
+    bool crc_ok;
+    uint64_t best = UINT64_MAX;
+    for (int run = 0; run < BENCH_RUNS; run++)
+    {
+        uint64_t t0 = bench_now();
+        for (unsigned i = 0; i < iterations; i++)
+        {
+            fused_decode(s->frame, s->len, work, &ctx, &crc_ok);
+            bench_keep(&ctx);
+        }
+        uint64_t t = bench_now() - t0;
+        if (t < best)
+            best = t;
+    }
+    return best;
+}
+
+// Байт кадра на такт до и после
+static void test_bench_bytes_per_cycle(void)
+{
+    for (int s = 0; s < sample_count; s++)
+    {
+        unsigned iterations = BENCH_BYTES / samples[s].len;
+        double bytes = (double)iterations * samples[s].len;
+        double before = bytes / bench_baseline(&samples[s], iterations);
+        double after = bytes / bench_fused(&samples[s], iterations);
+
+        char msg[160];
+        snprintf(msg, sizeof(msg), "%-12s %3u B: before %.3f B/%s, after %.3f B/%s, x%.1f",
+                 samples[s].name, (unsigned)samples[s].len, before, BENCH_UNIT, after, BENCH_UNIT, after / before);
+        TEST_MESSAGE(msg);
+    }
+}
+
+int main(void)
+{
+    samples[0].name = "reply_332";
+    memcpy(samples[0].frame, sp_sample_reply_332, sizeof(sp_sample_reply_332));
+    samples[0].len = sizeof(sp_sample_reply_332);
+    samples[1].name = "reply_index";
+    samples[1].len = sp_sample_reply_index(samples[1].frame);
+    samples[2].name = "reply_batch";
+    samples[2].len = build_batch_reply(samples[2].frame);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_fused_matches_baseline);
+    RUN_TEST(test_bench_bytes_per_cycle);
+    return UNITY_END();
+}
@@ -0,0 +1,262 @@
+/**
+ * Разбор ответов SP из нескольких потоков одновременно.
+ *
+ * Каждый поток - свой sp_decoder_ctx_t и свой буфер, кадры чередуются со
+ * сдвигом по номеру потока: в один момент разбираются разные ответы. Разметка,
+ * CRC и пакет после deStaff() сравниваются с эталоном однопоточного разбора,
+ * результат обработчика parser публикуется в общее окно 0x20+. Поток-читатель
+ * всё это время снимает окно через reg_seq_read() и проверяет, что снимок -
+ * результат одного из кадров целиком.
+ *
+ * На время нагрузки вывод обработчиков в терминал (printf) отключается.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include <unity.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "destaff.h"
+#include "parser.h"
+#include "reg_seq.h"
+#include "sp_samples.h"
+
+#define STRESS_THREADS 4
+#define STRESS_ITERATIONS 20000 // Кадров на поток
+
+uint16_t regs[TOTAL_REGS];
+
+typedef struct
+{
+    const char *name;
+    uint8_t frame[SP_RX_FRAME_MAX_SIZE];
+    size_t len;
+    uint8_t fnc;
+
+    // Эталон однопоточного разбора
+    int destuffed_len;
+    uint8_t destuffed[SP_RX_FRAME_MAX_SIZE];
+    sp_decoder_ctx_t ctx;
+    uint16_t window[MAX_READ_REGS]; // Окно 0x20+ после обработчика
+    uint16_t window_len;
+} sample_t;
+
+static sample_t samples[4];
+static const int sample_count = sizeof(samples) / sizeof(samples[0]);
+
+typedef struct
+{
+    pthread_t thread;
+    int id;
+    unsigned mismatches; // Разбор не совпал с эталоном
+    char first_error[96];
+} worker_t;
+
+static volatile int stress_done;
+static unsigned torn_snapshots;
+static unsigned snapshots;
+
+// Объединённый ответ на SP_BATCH_MAX параметров, значения зависят от seed
+static size_t build_batch_reply(uint8_t *out, int seed)
+{
+    uint8_t plain[SP_RX_FRAME_MAX_SIZE / 2];
+    size_t n = 0;
+    static const uint8_t head[] = {SOH, 0x86, 0x00, ISI, 0x03, '3', '3', '2', STX};
+    memcpy(plain, head, sizeof(head));
+    n += sizeof(head);
+    for (int i = 0; i < SP_BATCH_MAX; i++)
+        n += sprintf((char *)plain + n, "\t0\t1%02d\f\t%d.%03d\tm3/h\f", i, seed + i * 7, i * 13);
+    plain[n++] = ETX;
+    return sp_sample_frame(plain, n, out);
+}
+
+// Разбор так, как в sp_exe_in(): пакет от DLE SOH до DLE ETX в том же буфере
+static int decode(const sample_t *s, uint8_t *work, sp_decoder_ctx_t *ctx)
+{
+    memcpy(work, s->frame, s->len);
+    int n = deStaff(ctx, work + 2, s->len - 4);
+    ctx->commands = (s->fnc == 0x14) ? CMD_READ_INDEX_ARRAY : CMD_READ_PARAMS;
+    return n;
+}
+
+static void handle(const sample_t *s, const sp_decoder_ctx_t *ctx, const uint8_t *data, int len)
+{
+    if (s->fnc == 0x14)
+        handle_read_elements_index_array(ctx, s->fnc, data, len);
+    else
+        handle_read_parameter(ctx, s->fnc, data, len);
+}
+
+static bool ctx_equal(const sp_decoder_ctx_t *a, const sp_decoder_ctx_t *b)
+{
+    return a->stx_position == b->stx_position && a->etx_position == b->etx_position &&
+           a->crc == b->crc && a->tokens.ht_count == b->tokens.ht_count &&
+           a->tokens.ff_count == b->tokens.ff_count && a->tokens.overflow == b->tokens.overflow &&
+           memcmp(a->tokens.ht, b->tokens.ht, a->tokens.ht_count * sizeof(a->tokens.ht[0])) == 0 &&
+           memcmp(a->tokens.ff, b->tokens.ff, a->tokens.ff_count * sizeof(a->tokens.ff[0])) == 0;
+}
+
+static void *worker(void *arg)
+{
+    worker_t *w = arg;
+    uint8_t work[SP_RX_FRAME_MAX_SIZE];
+    sp_decoder_ctx_t ctx;
+
+    for (int i = 0; i < STRESS_ITERATIONS; i++)
+    {
+        const sample_t *s = &samples[(w->id + i) % sample_count];
+        int n = decode(s, work, &ctx);
+        bool ok = n == s->destuffed_len && ctx_equal(&ctx, &s->ctx) &&
+                  memcmp(work + 2, s->destuffed, n) == 0;
+        if (ok)
+        {
+            handle(s, &ctx, work + 2, n);
+            ok = ctx_equal(&ctx, &s->ctx); // Обработчик контекст не меняет
+        }
+        if (!ok && w->mismatches++ == 0)
+            snprintf(w->first_error, sizeof(w->first_error), "thread %d, iteration %d, %s", w->id, i, s->name);
+    }
+    return NULL;
+}
+
+// Снимок окна - результат одного из кадров (хвост окна после короткого результата не проверяется)
+static bool window_is_result(const uint16_t *window)
+{
+    for (int s = 0; s < sample_count; s++)
+    {
+        if (memcmp(window, samples[s].window, samples[s].window_len * sizeof(uint16_t)) == 0)
+            return true;
+    }
+    return false;
+}
+
+static void *reader(void *arg)
+{
+    (void)arg;
+    uint16_t window[MAX_READ_REGS];
+    while (!__atomic_load_n(&stress_done, __ATOMIC_ACQUIRE))
+    {
+        reg_seq_read(HLD_READ_REG, window, MAX_READ_REGS);
+        snapshots++;
+        if (!window_is_result(window))
+            torn_snapshots++;
+    }
+    return NULL;
+}
+
+// Вывод обработчиков в терминал на время нагрузки - в /dev/null
+static int stdout_mute(void)
+{
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+    return saved;
+}
+
+static void stdout_restore(int saved)
+{
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+// Эталоны различимы: у каждого кадра свой результат в окне
+static void test_samples_distinct(void)
+{
+    for (int a = 0; a < sample_count; a++)
+    {
+        TEST_ASSERT_GREATER_THAN_MESSAGE(0, samples[a].destuffed_len, samples[a].name);
+        TEST_ASSERT_EQUAL_HEX16_MESSAGE((samples[a].frame[samples[a].len - 2] << 8) | samples[a].frame[samples[a].len - 1],
+                                        samples[a].ctx.crc, samples[a].name);
+        TEST_ASSERT_GREATER_THAN_MESSAGE(1, samples[a].window_len, samples[a].name);
+        for (int b = 0; b < a; b++)
+            TEST_ASSERT_FALSE_MESSAGE(samples[a].window_len == samples[b].window_len &&
+                                          memcmp(samples[a].window, samples[b].window, samples[a].window_len * 2) == 0,
+                                      samples[a].name);
+    }
+}
+
+// Потоки с отдельными контекстами: разбор совпадает с эталоном, окно не рвётся
+static void test_threads_decode_interleaved_frames(void)
+{
+    worker_t workers[STRESS_THREADS];
+    pthread_t reader_thread;
+
+    int saved = stdout_mute();
+    stress_done = 0;
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&reader_thread, NULL, reader, NULL));
+    for (int t = 0; t < STRESS_THREADS; t++)
+    {
+        memset(&workers[t], 0, sizeof(workers[t]));
+        workers[t].id = t;
+        TEST_ASSERT_EQUAL_INT(0, pthread_create(&workers[t].thread, NULL, worker, &workers[t]));
+    }
+    for (int t = 0; t < STRESS_THREADS; t++)
+        pthread_join(workers[t].thread, NULL);
+    __atomic_store_n(&stress_done, 1, __ATOMIC_RELEASE);
+    pthread_join(reader_thread, NULL);
+    stdout_restore(saved);
+
+    for (int t = 0; t < STRESS_THREADS; t++)
+        TEST_ASSERT_EQUAL_UINT_MESSAGE(0, workers[t].mismatches, workers[t].first_error);
+    TEST_ASSERT_EQUAL_UINT(0, torn_snapshots);
+    TEST_ASSERT_GREATER_THAN_UINT(0, snapshots);
+
+    char msg[96];
+    snprintf(msg, sizeof(msg), "%d threads x %d frames, %u window snapshots",
+             STRESS_THREADS, STRESS_ITERATIONS, snapshots);
+    TEST_MESSAGE(msg);
+}
+
+int main(void)
+{
+    samples[0].name = "reply_332";
+    memcpy(samples[0].frame, sp_sample_reply_332, sizeof(sp_sample_reply_332));
+    samples[0].len = sizeof(sp_sample_reply_332);
+    samples[0].fnc = 0x03;
+    samples[1].name = "reply_index";
+    samples[1].len = sp_sample_reply_index(samples[1].frame);
+    samples[1].fnc = 0x14;
+    samples[2].name = "reply_batch_a";
+    samples[2].len = build_batch_reply(samples[2].frame, 100);
+    samples[2].fnc = 0x03;
+    samples[3].name = "reply_batch_b";
+    samples[3].len = build_batch_reply(samples[3].frame, 500);
+    samples[3].fnc = 0x03;
+
+    // Эталоны - в одном потоке
+    int saved = stdout_mute();
+    for (int s = 0; s < sample_count; s++)
+    {
+        uint8_t work[SP_RX_FRAME_MAX_SIZE];
+        samples[s].destuffed_len = decode(&samples[s], work, &samples[s].ctx);
+        if (samples[s].destuffed_len > 0)
+            memcpy(samples[s].destuffed, work + 2, samples[s].destuffed_len);
+        handle(&samples[s], &samples[s].ctx, work + 2, samples[s].destuffed_len);
+        reg_seq_read(HLD_READ_REG, samples[s].window, MAX_READ_REGS);
+        // Длина результата: счётчик полей, у каждого поля - длина и значение
+        uint16_t i = 1;
+        for (uint16_t f = 0; f < samples[s].window[0] && i < MAX_READ_REGS; f++)
+            i += 1 + (samples[s].window[i] + 1) / 2;
+        samples[s].window_len = i;
+    }
+    stdout_restore(saved);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_samples_distinct);
+    RUN_TEST(test_threads_decode_interleaved_frames);
+    return UNITY_END();
+}
@@ -0,0 +1,196 @@
+/**
+ * Выделитель кадров SP на кадрах из include/commands.h.txt при любом разбиении
+ * входного потока на чтения UART.
+ *
+ * Кадры - test/sp_samples.h.
+ *
+ * Поток начинается с мусора и оборванного кадра, каждое разбиение должно дать
+ * те же кадры. Обработка повторяет цикл uart2_task(): чтение до UART_BUF_SIZE
+ * байт, побайтная подача, кадр забирается сразу по готовности.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "sp_frame.h"
+#include "sp_crc.h"
+#include "sp_samples.h"
+
+#define STREAM_MAX 1024
+#define FRAMES_MAX 8
+#define RANDOM_SPLITS 2000
+
+static uint8_t reply_index[SP_SAMPLE_REPLY_INDEX_MAX_SIZE];
+static size_t reply_index_len;
+
+// Входной поток и кадры, которые он должен дать
+static uint8_t stream[STREAM_MAX];
+static size_t stream_len;
+static uint8_t expected[FRAMES_MAX][SP_RX_FRAME_MAX_SIZE];
+static size_t expected_len[FRAMES_MAX];
+static int expected_count;
+
+// Кадры, выделенные при очередном разбиении
+static sp_frame_decoder_t dec;
+static uint8_t got[FRAMES_MAX][SP_RX_FRAME_MAX_SIZE];
+static size_t got_len[FRAMES_MAX];
+static int got_count;
+
+static uint32_t rnd_state = 12345;
+
+static uint32_t rnd(void)
+{
+    rnd_state = rnd_state * 1103515245u + 12345u;
+    return rnd_state >> 16;
+}
+
+static void put(uint8_t *buf, size_t *len, const uint8_t *data, size_t n)
+{
+    memcpy(buf + *len, data, n);
+    *len += n;
+}
+
+static void expect(const uint8_t *frame, size_t len, bool preamble)
+{
+    static const uint8_t ff[] = {0xFF, 0xFF};
+    expected_len[expected_count] = 0;
+    if (!preamble)
+        put(expected[expected_count], &expected_len[expected_count], ff, sizeof(ff));
+    put(expected[expected_count], &expected_len[expected_count], frame, len);
+    expected_count++;
+}
+
+// Поток: мусор, оборванный кадр, кадры из файла подряд
+static void build_stream(void)
+{
+    static const uint8_t junk[] = {0x55, DLE, STX, 'j', 'u', 'n', 'k', 0xFF};
+    stream_len = 0;
+    expected_count = 0;
+
+    put(stream, &stream_len, junk, sizeof(junk));
+    put(stream, &stream_len, sp_sample_reply_332, 20); // Ответ оборван, следующий начинается с FF FF
+    put(stream, &stream_len, sp_sample_reply_332, sizeof(sp_sample_reply_332));
+    expect(sp_sample_reply_332, sizeof(sp_sample_reply_332), true);
+    put(stream, &stream_len, reply_index, reply_index_len);
+    expect(reply_index, reply_index_len, true);
+    put(stream, &stream_len, sp_sample_request_332, sizeof(sp_sample_request_332));
+    expect(sp_sample_request_332, sizeof(sp_sample_request_332), false);
+    put(stream, &stream_len, sp_sample_reply_332 + 2, sizeof(sp_sample_reply_332) - 2);
+    expect(sp_sample_reply_332 + 2, sizeof(sp_sample_reply_332) - 2, false);
+    put(stream, &stream_len, sp_sample_reply_332, sizeof(sp_sample_reply_332));
+    expect(sp_sample_reply_332, sizeof(sp_sample_reply_332), true);
+}
+
+// Одно чтение UART: побайтная подача, готовый кадр забирается сразу
+static void feed_chunk(const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        if (sp_frame_feed(&dec, data[i]))
+        {
+            TEST_ASSERT_LESS_THAN(FRAMES_MAX, got_count);
+            memcpy(got[got_count], dec.buf, dec.len);
+            got_len[got_count] = dec.len;
+            got_count++;
+        }
+    }
+}
+
+static void assert_frames(const char *split)
+{
+    TEST_ASSERT_EQUAL_INT_MESSAGE(expected_count, got_count, split);
+    for (int i = 0; i < expected_count; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(expected_len[i], got_len[i], split);
+        TEST_ASSERT_EQUAL_MEMORY_MESSAGE(expected[i], got[i], expected_len[i], split);
+    }
+}
+
+void setUp(void)
+{
+    sp_frame_reset(&dec);
+    got_count = 0;
+}
+
+void tearDown(void)
+{
+}
+
+// Кадры из файла целы: CRC по байтам после DLE SOH вместе с CRC равен 0
+static void test_sample_frames_valid(void)
+{
+    TEST_ASSERT_EQUAL_HEX16(0, sp_crc16(sp_sample_reply_332 + 4, sizeof(sp_sample_reply_332) - 4));
+    TEST_ASSERT_EQUAL_HEX16(0, sp_crc16(sp_sample_request_332 + 2, sizeof(sp_sample_request_332) - 2));
+    TEST_ASSERT_EQUAL_HEX16(0, sp_crc16(reply_index + 4, reply_index_len - 4));
+    TEST_ASSERT_GREATER_THAN(UART_BUF_SIZE / 2, stream_len);
+}
+
+// Чтения одинакового размера: 1 ... весь поток
+static void test_fixed_chunk_sizes(void)
+{
+    for (size_t chunk = 1; chunk <= stream_len; chunk++)
+    {
+        char split[32];
+        snprintf(split, sizeof(split), "chunk %u", (unsigned)chunk);
+
+        sp_frame_reset(&dec);
+        got_count = 0;
+        for (size_t pos = 0; pos < stream_len; pos += chunk)
+            feed_chunk(stream + pos, stream_len - pos < chunk ? stream_len - pos : chunk);
+        assert_frames(split);
+    }
+}
+
+// Случайные границы чтений (не больше UART_BUF_SIZE, как в uart2_task)
+static void test_random_split_points(void)
+{
+    for (int run = 0; run < RANDOM_SPLITS; run++)
+    {
+        char split[32];
+        snprintf(split, sizeof(split), "random run %d", run);
+
+        sp_frame_reset(&dec);
+        got_count = 0;
+        size_t pos = 0;
+        while (pos < stream_len)
+        {
+            size_t chunk = 1 + rnd() % (run % 2 ? 16 : UART_BUF_SIZE);
+            if (chunk > stream_len - pos)
+                chunk = stream_len - pos;
+            feed_chunk(stream + pos, chunk);
+            pos += chunk;
+        }
+        assert_frames(split);
+    }
+}
+
+// Кадр длиннее SP_RX_FRAME_MAX_SIZE отбрасывается, следующий выделяется
+static void test_oversized_frame_dropped(void)
+{
+    static uint8_t big[SP_RX_FRAME_MAX_SIZE + 16];
+    memcpy(big, sp_sample_reply_332, 14);
+    memset(big + 14, '7', sizeof(big) - 14);
+
+    feed_chunk(big, sizeof(big));
+    feed_chunk(sp_sample_reply_332, sizeof(sp_sample_reply_332));
+
+    TEST_ASSERT_EQUAL_UINT32(1, dec.overflows);
+    TEST_ASSERT_EQUAL_INT(1, got_count);
+    TEST_ASSERT_EQUAL_UINT32(sizeof(sp_sample_reply_332), got_len[0]);
+    TEST_ASSERT_EQUAL_MEMORY(sp_sample_reply_332, got[0], sizeof(sp_sample_reply_332));
+}
+
+int main(void)
+{
+    reply_index_len = sp_sample_reply_index(reply_index);
+    build_stream();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_sample_frames_valid);
+    RUN_TEST(test_fixed_chunk_sizes);
+    RUN_TEST(test_random_split_points);
+    RUN_TEST(test_oversized_frame_dropped);
+    return UNITY_END();
+}
@@ -0,0 +1,228 @@
+/**
+ * Планировщик опроса шаблонов на модели шины SP.
+ *
+ * Модель повторяет цикл uart2_task(): шина свободна - sp_sched_next(), опрос
+ * занимает шину на время транзакции (запрос, ответ, пауза), срок не наступил ни
+ * у одного шаблона - следующая проверка через цикл ожидания. Запросы мастера
+ * (REG_SP_COMM) вклиниваются с заданным периодом и тоже занимают шину.
+ *
+ * Для каждого шаблона выводятся запрошенная и достигнутая частоты опроса.
+ * Проверяется: без перегрузки - частота равна запрошенной; при перегрузке все
+ * шаблоны одного приоритета получают одинаковую долю запрошенной частоты, а
+ * высший приоритет - полную частоту. Запись настроек регистрами сообщает номер
+ * шаблона для сохранения в раздел `config`.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "sp_sched.h"
+
+#define SIM_TEMPLATES 20
+#define SIM_DURATION_MS 600000u // 10 минут модельного времени
+#define SIM_IDLE_STEP_MS 10     // Цикл uart2_task без событий
+
+uint16_t regs[TOTAL_REGS];
+
+typedef struct
+{
+    const char *name;
+    uint16_t period_ms[SIM_TEMPLATES];
+    uint8_t prio[SIM_TEMPLATES];
+    uint32_t txn_ms;       // Шина занята одним опросом
+    uint32_t on_demand_ms; // Период запросов мастера (0 - нет)
+
+    // Результат
+    uint32_t polls[SIM_TEMPLATES];
+    uint32_t on_demand;
+} sim_t;
+
+static double requested_rate(const sim_t *sim, int id)
+{
+    return 1000.0 / sim->period_ms[id];
+}
+
+static double achieved_rate(const sim_t *sim, int id)
+{
+    return sim->polls[id] * 1000.0 / SIM_DURATION_MS;
+}
+
+// Доля запрошенной частоты, полученная шаблоном
+static double share(const sim_t *sim, int id)
+{
+    return achieved_rate(sim, id) / requested_rate(sim, id);
+}
+
+static void sim_run(sim_t *sim)
+{
+    for (int i = 0; i < SP_STORAGE_FILE_COUNT; i++)
+        sp_sched_set(i, 0, 0, 0);
+    for (int i = 0; i < SIM_TEMPLATES; i++)
+        sp_sched_set(i, sim->period_ms[i], sim->prio[i], 0);
+    memset(sim->polls, 0, sizeof(sim->polls));
+    sim->on_demand = 0;
+
+    uint32_t now = 0;
+    uint32_t next_on_demand = sim->on_demand_ms;
+    while (now < SIM_DURATION_MS)
+    {
+        if (sim->on_demand_ms && (int32_t)(now - next_on_demand) >= 0)
+        {
+            sim->on_demand++;
+            next_on_demand += sim->on_demand_ms;
+            now += sim->txn_ms;
+            continue;
+        }
+
+        int id = sp_sched_next(now);
+        if (id < 0)
+        {
+            now += SIM_IDLE_STEP_MS;
+            continue;
+        }
+        sp_sched_done(id, now);
+        sim->polls[id]++;
+        now += sim->txn_ms;
+    }
+}
+
+static void sim_report(const sim_t *sim)
+{
+    char msg[128];
+    double requested = 0, achieved = 0;
+    for (int i = 0; i < SIM_TEMPLATES; i++)
+    {
+        requested += requested_rate(sim, i);
+        achieved += achieved_rate(sim, i);
+    }
+    snprintf(msg, sizeof(msg), "%s: txn %u ms, bus %.1f/s, requested %.1f/s, achieved %.1f/s, master %.1f/s",
+             sim->name, (unsigned)sim->txn_ms, 1000.0 / sim->txn_ms, requested, achieved,
+             sim->on_demand * 1000.0 / SIM_DURATION_MS);
+    TEST_MESSAGE(msg);
+    for (int i = 0; i < SIM_TEMPLATES; i++)
+    {
+        snprintf(msg, sizeof(msg), "  #%-2d prio %u period %4u ms: requested %5.2f/s, achieved %5.2f/s (%3.0f%%)",
+                 i, sim->prio[i], sim->period_ms[i], requested_rate(sim, i), achieved_rate(sim, i),
+                 100.0 * share(sim, i));
+        TEST_MESSAGE(msg);
+    }
+}
+
+// Периоды 200 ... 2100 мс, приоритет у всех один
+static void sim_init(sim_t *sim, const char *name, uint32_t txn_ms, uint32_t on_demand_ms)
+{
+    memset(sim, 0, sizeof(*sim));
+    sim->name = name;
+    sim->txn_ms = txn_ms;
+    sim->on_demand_ms = on_demand_ms;
+    for (int i = 0; i < SIM_TEMPLATES; i++)
+        sim->period_ms[i] = 200 + i * 100;
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+// Шины хватает: каждый шаблон опрашивается с запрошенной частотой
+static void test_underload_meets_requested_rates(void)
+{
+    static sim_t sim;
+    sim_init(&sim, "underload", 30, 0);
+    sim_run(&sim);
+    sim_report(&sim);
+
+    for (int i = 0; i < SIM_TEMPLATES; i++)
+    {
+        TEST_ASSERT_GREATER_OR_EQUAL_UINT32(SIM_DURATION_MS / sim.period_ms[i] - 1, sim.polls[i]);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(SIM_DURATION_MS / sim.period_ms[i] + 1, sim.polls[i]);
+    }
+}
+
+// Перегрузка: шина занята полностью, доли одного приоритета равны
+static void test_overload_equal_shares(void)
+{
+    static sim_t sim;
+    sim_init(&sim, "overload", 150, 0);
+    sim_run(&sim);
+    sim_report(&sim);
+
+    uint32_t total = 0;
+    for (int i = 0; i < SIM_TEMPLATES; i++)
+        total += sim.polls[i];
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(SIM_DURATION_MS / sim.txn_ms - 1, total);
+
+    double mean = 0;
+    for (int i = 0; i < SIM_TEMPLATES; i++)
+        mean += share(&sim, i) / SIM_TEMPLATES;
+    TEST_ASSERT_TRUE(mean < 0.5);
+    for (int i = 0; i < SIM_TEMPLATES; i++)
+        TEST_ASSERT_FLOAT_WITHIN(mean * 0.1, mean, share(&sim, i));
+}
+
+// Перегрузка и запросы мастера: высший приоритет получает полную частоту
+static void test_overload_strict_priority(void)
+{
+    static sim_t sim;
+    sim_init(&sim, "overload, #0-2 prio 0, master every 1 s", 150, 1000);
+    for (int i = 0; i < 3; i++)
+        sim.period_ms[i] = 1000 + i * 500;
+    for (int i = 3; i < SIM_TEMPLATES; i++)
+        sim.prio[i] = 1;
+    sim_run(&sim);
+    sim_report(&sim);
+
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(SIM_DURATION_MS / sim.on_demand_ms - 1, sim.on_demand);
+    for (int i = 0; i < 3; i++)
+        TEST_ASSERT_GREATER_OR_EQUAL_UINT32(SIM_DURATION_MS / sim.period_ms[i] - 1, sim.polls[i]);
+
+    double mean = 0;
+    for (int i = 3; i < SIM_TEMPLATES; i++)
+        mean += share(&sim, i) / (SIM_TEMPLATES - 3);
+    TEST_ASSERT_TRUE(mean < 0.5);
+    for (int i = 3; i < SIM_TEMPLATES; i++)
+        TEST_ASSERT_FLOAT_WITHIN(mean * 0.1, mean, share(&sim, i));
+}
+
+// Регистры 0x1C-0x1E: запись сообщает номер шаблона для сохранения, чтение и ошибка - нет
+static void test_registers_report_written(void)
+{
+    REG_SCHED_PERIOD = 2500;
+    REG_SCHED_PRIO = 0x0009;
+    REG_SCHED_OPERATION = 7;
+    TEST_ASSERT_EQUAL_INT(7, sp_sched_handle_registers(0));
+    TEST_ASSERT_EQUAL_HEX16(0xFFFF, REG_SCHED_OPERATION);
+
+    uint16_t period_ms;
+    uint8_t prio;
+    sp_sched_get(7, &period_ms, &prio);
+    TEST_ASSERT_EQUAL_UINT16(2500, period_ms);
+    TEST_ASSERT_EQUAL_UINT8(SP_SCHED_PRIO_LEVELS - 1, prio);
+
+    REG_SCHED_PERIOD = 0;
+    REG_SCHED_PRIO = 0;
+    REG_SCHED_OPERATION = 0x8000 | 7;
+    TEST_ASSERT_EQUAL_INT(-1, sp_sched_handle_registers(0));
+    TEST_ASSERT_EQUAL_UINT16(2500, REG_SCHED_PERIOD);
+    TEST_ASSERT_EQUAL_UINT16(SP_SCHED_PRIO_LEVELS - 1, REG_SCHED_PRIO);
+
+    REG_SCHED_OPERATION = SP_STORAGE_FILE_COUNT;
+    TEST_ASSERT_EQUAL_INT(-1, sp_sched_handle_registers(0));
+    REG_SCHED_OPERATION = 0xFFFF;
+    TEST_ASSERT_EQUAL_INT(-1, sp_sched_handle_registers(0));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_underload_meets_requested_rates);
+    RUN_TEST(test_overload_equal_shares);
+    RUN_TEST(test_overload_strict_priority);
+    RUN_TEST(test_registers_report_written);
+    return UNITY_END();
+}
@@ -0,0 +1,156 @@
+/**
+ * Стаффинг и дестаффинг SP до SWAR-ядер (user-016): staff(), staff_frame() и
+ * deStaff() того времени, без журнала. CRC - побайтно по таблице.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include "baseline.h"
+#include "project_config.h"
+#include "sp_crc.h"
+#include <stdbool.h>
+
+int baseline_staff(const uint8_t *input, size_t input_len, uint8_t *output, size_t output_max_len)
+{
+    size_t j = 0;
+    for (size_t i = 0; i < input_len; i++)
+    {
+        size_t required = (input[i] == SOH || input[i] == ISI || input[i] == STX || input[i] == ETX) ? 2 : 1;
+        if (j + required > output_max_len)
+            return 0;
+
+        switch (input[i])
+        {
+        case SOH:
+            output[j++] = DLE;
+            output[j++] = SOH;
+            break;
+        case ISI:
+            output[j++] = DLE;
+            output[j++] = ISI;
+            break;
+        case STX:
+            output[j++] = DLE;
+            output[j++] = STX;
+            break;
+        case ETX:
+            output[j++] = DLE;
+            output[j++] = ETX;
+            break;
+        default:
+            output[j++] = input[i];
+        }
+    }
+    return j;
+}
+
+int baseline_staff_frame(const uint8_t *input, size_t input_len, uint8_t *output, size_t output_max_len)
+{
+    if (input_len == 0 || input[0] != SOH || output_max_len < 4)
+        return 0;
+
+    output[0] = DLE;
+    output[1] = SOH;
+    size_t j = 2;
+    uint16_t crc = sp_crc16_init();
+
+    for (size_t i = 1; i < input_len; i++)
+    {
+        uint8_t byte = input[i];
+        bool escape = (byte == SOH || byte == ISI || byte == STX || byte == ETX);
+        if (j + (escape ? 2 : 1) + 2 > output_max_len)
+            return 0;
+
+        if (escape)
+        {
+            output[j++] = DLE;
+            crc = sp_crc16_byte(crc, DLE);
+        }
+        output[j++] = byte;
+        crc = sp_crc16_byte(crc, byte);
+    }
+
+    crc = sp_crc16_final(crc);
+    output[j++] = crc >> 8;
+    output[j++] = crc & 0xFF;
+    return j;
+}
+
+int baseline_deStaff(sp_decoder_ctx_t *ctx, uint8_t *input, size_t len)
+{
+    if (ctx == NULL)
+        return 0;
+
+    sp_tokens_t *tokens = &ctx->tokens;
+    ctx->stx_position = -1;
+    ctx->etx_position = -1;
+    ctx->crc = 0;
+    tokens->ht_count = 0;
+    tokens->ff_count = 0;
+    tokens->overflow = false;
+
+    if (input == NULL || len == 0)
+        return 0;
+    if (len < BUF_MIN_SIZE || len > UART_BUF_SIZE * 2)
+        return 0;
+
+    size_t read_idx = 0;
+    size_t write_idx = 0;
+    uint16_t crc = 0;
+    bool in_payload = false; // Между STX и ETX
+
+    while (read_idx < len)
+    {
+        uint8_t byte = input[read_idx];
+        if (read_idx >= 2)
+            crc = sp_crc16_byte(crc, byte);
+
+        if (byte == DLE && (read_idx + 1 < len))
+        {
+            uint8_t next_byte = input[read_idx + 1];
+            if (next_byte == SOH || next_byte == STX || next_byte == ETX || next_byte == ISI)
+            {
+                if (next_byte == STX)
+                {
+                    ctx->stx_position = (int)(write_idx);
+                    in_payload = true;
+                }
+                if (next_byte == ETX)
+                {
+                    ctx->etx_position = (int)(write_idx);
+                    in_payload = false;
+                }
+                read_idx++;
+                continue;
+            }
+        }
+
+        if (in_payload)
+        {
+            if (byte == HT)
+            {
+                if (tokens->ht_count < SP_MAX_TOKENS)
+                    tokens->ht[tokens->ht_count++] = (uint16_t)write_idx;
+                else
+                    tokens->overflow = true;
+            }
+            else if (byte == FF)
+            {
+                if (tokens->ff_count < SP_MAX_TOKENS)
+                    tokens->ff[tokens->ff_count++] = (uint16_t)write_idx;
+                else
+                    tokens->overflow = true;
+            }
+        }
+
+        input[write_idx] = byte;
+        write_idx++;
+        read_idx++;
+    }
+
+    ctx->crc = crc;
+
+    if (ctx->stx_position == -1 || ctx->etx_position == -1 || ctx->stx_position >= ctx->etx_position)
+        return -1;
+    return write_idx;
+}
@@ -0,0 +1,14 @@
+/**
+ * Стаффинг и дестаффинг SP до SWAR-ядер (user-016): побайтные циклы - для сравнения.
+ *
+ * Версия от 18 октября 2025г.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "destaff.h"
+
+int baseline_staff(const uint8_t *input, size_t input_len, uint8_t *output, size_t output_max_len);
+int baseline_staff_frame(const uint8_t *input, size_t input_len, uint8_t *output, size_t output_max_len);
+int baseline_deStaff(sp_decoder_ctx_t *ctx, uint8_t *input, size_t len);
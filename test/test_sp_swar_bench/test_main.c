@@ -0,0 +1,224 @@
+/**
+ * Стаффинг и дестаффинг SP: побайтные циклы (до user-016) и SWAR-ядра sp_swar
+ * (4 байта за шаг, участки без управляющих байтов - одним копированием).
+ *
+ * Сначала staff(), staff_frame() и deStaff() сверяются с побайтными на
+ * случайных кадрах с частыми управляющими байтами: выход, длина, отказ при
+ * малом буфере, CRC, STX/ETX и таблица HT/FF. Затем измеряется время на
+ * ответах CMD_READ_PARAMS того вида, что присылает СПТ961 (1, 4 и SP_BATCH_MAX
+ * указателей), в тактах (на x86; на других ПК - в наносекундах).
+ *
+ * В замер deStaff() обоих вариантов входит восстановление кадра (memcpy).
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "staff.h"
+#include "destaff.h"
+#include "sp_samples.h"
+#include "bench.h"
+#include "baseline.h"
+
+#define CHECK_INPUTS 200000 // Случайных кадров в сверке
+#define CHECK_MAX_LEN 230   // Байт без стаффинга: после стаффинга не длиннее UART_BUF_SIZE * 2
+#define BENCH_BYTES (4u * 1024 * 1024) // Байт кадров на один замер
+#define BENCH_RUNS 5                   // Лучший из замеров
+
+typedef struct
+{
+    const char *name;
+    uint8_t plain[SP_RX_FRAME_MAX_SIZE]; // SOH ... ETX без стаффинга
+    size_t plain_len;
+    uint8_t frame[2 * SP_RX_FRAME_MAX_SIZE]; // FF FF DLE SOH ... DLE ETX CRC1 CRC2
+    size_t len;
+} sample_t;
+
+static sample_t samples[3];
+static const int sample_count = sizeof(samples) / sizeof(samples[0]);
+
+static uint32_t rnd_state = 2025;
+
+static uint32_t rnd(void)
+{
+    rnd_state = rnd_state * 1103515245u + 12345u;
+    return rnd_state >> 16;
+}
+
+// Ответ на pointers параметров: блоки "HT 0 HT 1xx FF HT значение HT единицы FF"
+static void build_reply(sample_t *s, const char *name, int pointers)
+{
+    static const uint8_t head[] = {SOH, 0x86, 0x00, ISI, 0x03, '3', '3', '2', STX};
+    size_t n = 0;
+    memcpy(s->plain, head, sizeof(head));
+    n += sizeof(head);
+    for (int i = 0; i < pointers; i++)
+        n += sprintf((char *)s->plain + n, "\t0\t1%02d\f\t%d.%03d\tm3/h\f", i, 2060100 + i * 7, i * 13);
+    s->plain[n++] = ETX;
+    s->name = name;
+    s->plain_len = n;
+    s->len = sp_sample_frame(s->plain, n, s->frame);
+}
+
+// Кадр без стаффинга: SOH, затем случайные байты, каждый восьмой - управляющий
+static size_t random_plain(uint8_t *plain)
+{
+    static const uint8_t special[] = {SOH, ISI, STX, ETX, DLE, HT, FF};
+    size_t len = 1 + rnd() % CHECK_MAX_LEN;
+    plain[0] = SOH;
+    for (size_t i = 1; i < len; i++)
+        plain[i] = (rnd() % 8 == 0) ? special[rnd() % sizeof(special)] : rnd();
+    return len;
+}
+
+static bool ctx_equal(const sp_decoder_ctx_t *a, const sp_decoder_ctx_t *b)
+{
+    return a->stx_position == b->stx_position && a->etx_position == b->etx_position &&
+           a->crc == b->crc && a->tokens.ht_count == b->tokens.ht_count &&
+           a->tokens.ff_count == b->tokens.ff_count && a->tokens.overflow == b->tokens.overflow &&
+           memcmp(a->tokens.ht, b->tokens.ht, a->tokens.ht_count * sizeof(a->tokens.ht[0])) == 0 &&
+           memcmp(a->tokens.ff, b->tokens.ff, a->tokens.ff_count * sizeof(a->tokens.ff[0])) == 0;
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+// Случайные кадры: SWAR-ядра дают тот же результат, что и побайтные циклы
+static void test_random_frames_match_byte_path(void)
+{
+    uint8_t plain[CHECK_MAX_LEN];
+    uint8_t expected[2 * CHECK_MAX_LEN + 4], got[2 * CHECK_MAX_LEN + 4];
+    for (int n = 0; n < CHECK_INPUTS; n++)
+    {
+        size_t len = random_plain(plain);
+        size_t out_max = (rnd() % 4 == 0) ? rnd() % (2 * len + 4) : sizeof(got); // Иногда буфер мал
+        char msg[64];
+        snprintf(msg, sizeof(msg), "input %d, %u bytes, output %u", n, (unsigned)len, (unsigned)out_max);
+
+        int expected_len = baseline_staff(plain, len, expected, out_max);
+        int got_len = staff(plain, len, got, out_max);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(expected_len, got_len, msg);
+        TEST_ASSERT_EQUAL_MEMORY_MESSAGE(expected, got, expected_len, msg);
+
+        expected_len = baseline_staff_frame(plain, len, expected, out_max);
+        got_len = staff_frame(plain, len, got, out_max);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(expected_len, got_len, msg);
+        TEST_ASSERT_EQUAL_MEMORY_MESSAGE(expected, got, expected_len, msg);
+
+        // Дестаффинг кадра DLE SOH ... без CRC (как в sp_exe_in); сбой STX/ETX - тоже совпадение
+        int framed_len = baseline_staff(plain, len, expected, sizeof(expected));
+        memcpy(got, expected, framed_len);
+        sp_decoder_ctx_t expected_ctx, got_ctx;
+        expected_len = baseline_deStaff(&expected_ctx, expected, framed_len);
+        got_len = deStaff(&got_ctx, got, framed_len);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(expected_len, got_len, msg);
+        TEST_ASSERT_TRUE_MESSAGE(ctx_equal(&expected_ctx, &got_ctx), msg);
+        if (expected_len > 0)
+            TEST_ASSERT_EQUAL_MEMORY_MESSAGE(expected, got, expected_len, msg);
+    }
+}
+
+// Ответы прибора разбираются, HT/FF найдены на тех же местах
+static void test_samples_decode(void)
+{
+    for (int s = 0; s < sample_count; s++)
+    {
+        uint8_t a[2 * SP_RX_FRAME_MAX_SIZE], b[2 * SP_RX_FRAME_MAX_SIZE];
+        sp_decoder_ctx_t ctx_a, ctx_b;
+        memcpy(a, samples[s].frame, samples[s].len);
+        memcpy(b, samples[s].frame, samples[s].len);
+        int len_a = baseline_deStaff(&ctx_a, a + 2, samples[s].len - 4);
+        int len_b = deStaff(&ctx_b, b + 2, samples[s].len - 4);
+
+        TEST_ASSERT_GREATER_THAN_MESSAGE(0, len_b, samples[s].name);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(len_a, len_b, samples[s].name);
+        TEST_ASSERT_TRUE_MESSAGE(ctx_equal(&ctx_a, &ctx_b), samples[s].name);
+        TEST_ASSERT_EQUAL_MEMORY_MESSAGE(samples[s].plain, b + 2, len_b, samples[s].name);
+        TEST_ASSERT_EQUAL_HEX16_MESSAGE((samples[s].frame[samples[s].len - 2] << 8) | samples[s].frame[samples[s].len - 1],
+                                        ctx_b.crc, samples[s].name);
+    }
+}
+
+typedef int (*staff_fn_t)(const uint8_t *input, size_t input_len, uint8_t *output, size_t output_max_len);
+typedef int (*destaff_fn_t)(sp_decoder_ctx_t *ctx, uint8_t *input, size_t len);
+
+static uint64_t bench_staff(staff_fn_t fn, const sample_t *s, unsigned iterations)
+{
+    uint8_t out[2 * SP_RX_FRAME_MAX_SIZE];
+    uint64_t best = UINT64_MAX;
+    for (int run = 0; run < BENCH_RUNS; run++)
+    {
+        uint64_t t0 = bench_now();
+        for (unsigned i = 0; i < iterations; i++)
+        {
+            fn(s->plain, s->plain_len, out, sizeof(out));
+            bench_keep(out);
+        }
+        uint64_t t = bench_now() - t0;
+        if (t < best)
+            best = t;
+    }
+    return best;
+}
+
+static uint64_t bench_destaff(destaff_fn_t fn, const sample_t *s, unsigned iterations)
+{
+    uint8_t work[2 * SP_RX_FRAME_MAX_SIZE];
+    sp_decoder_ctx_t ctx;
+    uint64_t best = UINT64_MAX;
+    for (int run = 0; run < BENCH_RUNS; run++)
+    {
+        uint64_t t0 = bench_now();
+        for (unsigned i = 0; i < iterations; i++)
+        {
+            memcpy(work, s->frame, s->len);
+            fn(&ctx, work + 2, s->len - 4);
+            bench_keep(&ctx);
+        }
+        uint64_t t = bench_now() - t0;
+        if (t < best)
+            best = t;
+    }
+    return best;
+}
+
+// Время на кадр до и после
+static void test_bench_replies(void)
+{
+    for (int s = 0; s < sample_count; s++)
+    {
+        unsigned iterations = BENCH_BYTES / samples[s].len;
+        double staff_before = (double)bench_staff(baseline_staff, &samples[s], iterations) / iterations;
+        double staff_after = (double)bench_staff(staff, &samples[s], iterations) / iterations;
+        double frame_before = (double)bench_staff(baseline_staff_frame, &samples[s], iterations) / iterations;
+        double frame_after = (double)bench_staff(staff_frame, &samples[s], iterations) / iterations;
+        double destaff_before = (double)bench_destaff(baseline_deStaff, &samples[s], iterations) / iterations;
+        double destaff_after = (double)bench_destaff(deStaff, &samples[s], iterations) / iterations;
+
+        char msg[200];
+        snprintf(msg, sizeof(msg), "%-12s %3u B, %s: staff %.0f -> %.0f, staff_frame %.0f -> %.0f, deStaff %.0f -> %.0f",
+                 samples[s].name, (unsigned)samples[s].len, BENCH_UNIT, staff_before, staff_after,
+                 frame_before, frame_after, destaff_before, destaff_after);
+        TEST_MESSAGE(msg);
+    }
+}
+
+int main(void)
+{
+    build_reply(&samples[0], "1 pointer", 1);
+    build_reply(&samples[1], "4 pointers", 4);
+    build_reply(&samples[2], "10 pointers", SP_BATCH_MAX);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_random_frames_match_byte_path);
+    RUN_TEST(test_samples_decode);
+    RUN_TEST(test_bench_replies);
+    return UNITY_END();
+}
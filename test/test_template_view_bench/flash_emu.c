@@ -0,0 +1,7 @@
+/**
+ * Модель NOR flash из test_rec_log: раздел с шаблонами для замера.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include "../test_rec_log/flash_emu.c"
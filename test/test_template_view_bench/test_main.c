@@ -0,0 +1,246 @@
+/**
+ * Доступ к шаблонам во flash: копия на стек (esp_partition_read, до user-022) и
+ * указатель в отображение раздела (rec_log_view_begin).
+ *
+ * Шаблоны лежат в журнале rec_log на модели flash из test_rec_log. Время
+ * измеряется в тактах (на x86; на других ПК - в наносекундах) для самого
+ * доступа и для того, что с шаблоном делают на каждой транзакции:
+ * - req_cache_build: заголовок, шаблон запроса, стаффинг и CRC (staff_frame);
+ * - apply_response_template: разбор имён параметров шаблона ответа (поиск
+ *   значений в ответе одинаков для обоих путей и в замер не входит).
+ * Отдельно - просмотр без отображения (esp_partition_mmap недоступен).
+ *
+ * На ПК esp_partition_read - это memcpy. На устройстве при каждом чтении
+ * зашифрованного раздела добавляются чтение flash и расшифровка, так что
+ * выигрыш здесь - нижняя граница.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "rec_log.h"
+#include "staff.h"
+#include "bench.h"
+#include "../test_rec_log/flash_emu.h"
+
+#define REQUEST_ID 5
+#define RESPONSE_ID 6
+#define BENCH_ITERATIONS 200000
+#define BENCH_RUNS 5 // Лучший из замеров
+
+static rec_log_t log_;
+static rec_log_t log_copy; // Тот же раздел без отображения в память
+
+typedef const uint8_t *(*view_begin_fn_t)(uint8_t file_id, uint8_t *buf);
+typedef void (*view_end_fn_t)(void);
+
+// Прежнее чтение (request_read_file / response_read_file): копия файла на стек
+static const uint8_t *copy_begin(uint8_t file_id, uint8_t *buf)
+{
+    xSemaphoreTake(log_.lock, portMAX_DELAY);
+    esp_partition_read(log_.part, log_.index[file_id] + REC_LOG_HDR_SIZE, buf, SP_STORAGE_FILE_SIZE);
+    xSemaphoreGive(log_.lock);
+    return buf;
+}
+
+static void copy_end(void)
+{
+}
+
+static const uint8_t *view_begin(uint8_t file_id, uint8_t *buf)
+{
+    (void)buf;
+    return rec_log_view_begin(&log_, file_id);
+}
+
+static void view_end(void)
+{
+    rec_log_view_end(&log_);
+}
+
+static const uint8_t *fallback_begin(uint8_t file_id, uint8_t *buf)
+{
+    (void)buf;
+    return rec_log_view_begin(&log_copy, file_id);
+}
+
+static void fallback_end(void)
+{
+    rec_log_view_end(&log_copy);
+}
+
+static const struct
+{
+    const char *name;
+    view_begin_fn_t begin;
+    view_end_fn_t end;
+} variants[] = {
+    {"copy", copy_begin, copy_end},
+    {"view", view_begin, view_end},
+    {"view, no mmap", fallback_begin, fallback_end},
+};
+static const int variant_count = sizeof(variants) / sizeof(variants[0]);
+
+// Шаблон запроса CMD_READ_PARAMS на 4 параметра: FNC DataHead STX {HT 0 HT 1xx FF} ETX
+static void make_request_template(uint8_t *file)
+{
+    uint8_t *body = file + 1;
+    size_t n = 0;
+    body[n++] = CMD_READ_PARAMS >> 8;
+    body[n++] = STX;
+    for (int i = 0; i < 4; i++)
+        n += sprintf((char *)body + n, "\t0\t1%02d\f", 60 + i);
+    body[n++] = ETX;
+    file[0] = n;
+}
+
+// Шаблон ответа: имена параметров через нули
+static void make_response_template(uint8_t *file)
+{
+    static const char names[] = "Qm\0Qo\0Vm\0Vo\0P\0T\0dP\0Tn\0W\0Q";
+    file[0] = sizeof(names) - 1;
+    memcpy(file + 1, names, sizeof(names) - 1);
+}
+
+// Кадр запроса из шаблона, как req_frame_build()
+static int build_request(const uint8_t *file_data, uint8_t *frame)
+{
+    uint8_t plain[4 + SP_STORAGE_FILE_SIZE - 1] = {SOH, 0x00, 0x86, ISI};
+    memcpy(plain + 4, file_data + 1, file_data[0]);
+    return staff_frame(plain, 4 + file_data[0], frame, SP_REQ_FRAME_MAX_SIZE);
+}
+
+// Разбор имён параметров, как apply_response_template()
+static unsigned walk_response(const uint8_t *file_data)
+{
+    const uint8_t *current = file_data + 1;
+    const uint8_t *end = current + file_data[0];
+    unsigned names = 0;
+    while (current < end)
+    {
+        size_t name_len = strnlen((const char *)current, end - current);
+        if (name_len == 0)
+            break;
+        char param_name[SP_STORAGE_FILE_SIZE];
+        memcpy(param_name, current, name_len);
+        param_name[name_len] = '\0';
+        bench_keep(param_name);
+        names++;
+        current += name_len + 1;
+    }
+    return names;
+}
+
+typedef enum
+{
+    WORK_NONE,
+    WORK_REQUEST,
+    WORK_RESPONSE,
+} work_t;
+
+static uint64_t bench(int v, uint8_t file_id, work_t work)
+{
+    uint8_t buf[SP_STORAGE_FILE_SIZE];
+    uint8_t frame[SP_REQ_FRAME_MAX_SIZE];
+    uint64_t best = UINT64_MAX;
+    for (int run = 0; run < BENCH_RUNS; run++)
+    {
+        unsigned sum = 0;
+        uint64_t t0 = bench_now();
+        for (unsigned i = 0; i < BENCH_ITERATIONS; i++)
+        {
+            const uint8_t *file_data = variants[v].begin(file_id, buf);
+            if (work == WORK_REQUEST)
+                sum += build_request(file_data, frame);
+            else if (work == WORK_RESPONSE)
+                sum += walk_response(file_data);
+            else
+                sum += file_data[1];
+            variants[v].end();
+            bench_keep(frame);
+        }
+        uint64_t t = bench_now() - t0;
+        bench_keep(&sum);
+        if (t < best)
+            best = t;
+    }
+    return best;
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+// Все пути дают одни и те же данные шаблона
+static void test_paths_agree(void)
+{
+    uint8_t buf[SP_STORAGE_FILE_SIZE];
+    uint8_t expected[SP_STORAGE_FILE_SIZE] = {0};
+    uint8_t frame[SP_REQ_FRAME_MAX_SIZE], expected_frame[SP_REQ_FRAME_MAX_SIZE];
+
+    make_request_template(expected);
+    int expected_len = build_request(expected, expected_frame);
+    TEST_ASSERT_GREATER_THAN(0, expected_len);
+    for (int v = 0; v < variant_count; v++)
+    {
+        const uint8_t *data = variants[v].begin(REQUEST_ID, buf);
+        TEST_ASSERT_EQUAL_MEMORY_MESSAGE(expected, data, 1 + expected[0], variants[v].name);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(expected_len, build_request(data, frame), variants[v].name);
+        TEST_ASSERT_EQUAL_MEMORY_MESSAGE(expected_frame, frame, expected_len, variants[v].name);
+        variants[v].end();
+
+        data = variants[v].begin(RESPONSE_ID, buf);
+        TEST_ASSERT_EQUAL_UINT_MESSAGE(10, walk_response(data), variants[v].name);
+        variants[v].end();
+    }
+}
+
+static void report(const char *what, uint8_t file_id, work_t work)
+{
+    double t[3];
+    for (int v = 0; v < variant_count; v++)
+        t[v] = (double)bench(v, file_id, work) / BENCH_ITERATIONS;
+
+    char msg[200];
+    snprintf(msg, sizeof(msg), "%-24s copy %6.1f, view %6.1f (-%.1f, x%.1f), view without mmap %6.1f %s",
+             what, t[0], t[1], t[0] - t[1], t[0] / t[1], t[2], BENCH_UNIT);
+    TEST_MESSAGE(msg);
+}
+
+// Время на транзакцию: доступ к шаблону и работа с ним
+static void test_bench_transaction(void)
+{
+    report("template access", REQUEST_ID, WORK_NONE);
+    report("req_cache_build", REQUEST_ID, WORK_REQUEST);
+    report("apply_response_template", RESPONSE_ID, WORK_RESPONSE);
+}
+
+int main(void)
+{
+    uint8_t file[SP_STORAGE_FILE_SIZE];
+    flash_emu_fill(0xFF);
+    rec_log_mount(&log_, &flash_emu_part);
+    for (int f = 0; f < 42; f++)
+    {
+        memset(file, 0, sizeof(file));
+        if (f == RESPONSE_ID)
+            make_response_template(file);
+        else
+            make_request_template(file);
+        rec_log_write(&log_, f, file);
+    }
+    flash_emu_set_mmap(false);
+    rec_log_mount(&log_copy, &flash_emu_part);
+    flash_emu_set_mmap(true);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_paths_agree);
+    RUN_TEST(test_bench_transaction);
+    return UNITY_END();
+}
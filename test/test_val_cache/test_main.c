@@ -0,0 +1,91 @@
+/**
+ * Кэш значений параметров: срок годности, вытеснение, значения длиннее
+ * SP_VAL_CACHE_VALUE_SIZE.
+ *
+ * Версия от 18 октября 2025г.
+ */
+
+#include <unity.h>
+#include <string.h>
+#include "val_cache.h"
+
+static uint8_t value[SP_VAL_CACHE_VALUE_SIZE];
+static size_t len;
+static uint32_t age;
+
+static void store_text(uint8_t dad, uint16_t channel, uint16_t param, const char *text, uint32_t now_ms)
+{
+    val_cache_store(dad, channel, param, (const uint8_t *)text, strlen(text), now_ms);
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+// Значение выдаётся, пока не старше срока
+static void test_lookup_within_ttl(void)
+{
+    store_text(1, 0, 3, "12.5", 1000);
+
+    TEST_ASSERT_TRUE(val_cache_lookup(1, 0, 3, 500, 1400, value, &len, &age));
+    TEST_ASSERT_EQUAL_UINT32(4, len);
+    TEST_ASSERT_EQUAL_MEMORY("12.5", value, 4);
+    TEST_ASSERT_EQUAL_UINT32(400, age);
+    TEST_ASSERT_FALSE(val_cache_lookup(1, 0, 3, 500, 1600, value, &len, &age));
+    TEST_ASSERT_FALSE(val_cache_lookup(2, 0, 3, 500, 1400, value, &len, &age));
+}
+
+// Вытесняется самая старая запись
+static void test_oldest_evicted(void)
+{
+    for (int i = 0; i < SP_VAL_CACHE_SIZE + 8; i++)
+        store_text(2, i, 1, "1", 2000 + i);
+
+    TEST_ASSERT_FALSE(val_cache_lookup(2, 0, 1, 100000, 3000, value, &len, NULL));
+    TEST_ASSERT_TRUE(val_cache_lookup(2, SP_VAL_CACHE_SIZE + 7, 1, 100000, 3000, value, &len, NULL));
+}
+
+// Длинное значение не сохраняется и не оставляет прежнего
+static void test_oversized_value_not_cached(void)
+{
+    char longer[SP_VAL_CACHE_VALUE_SIZE + 2];
+    memset(longer, '7', sizeof(longer) - 1);
+    longer[sizeof(longer) - 1] = '\0';
+
+    store_text(3, 1, 1, longer, 5000);
+    TEST_ASSERT_FALSE(val_cache_lookup(3, 1, 1, 1000, 5000, value, &len, NULL));
+
+    store_text(3, 1, 2, "1.0", 5000);
+    store_text(3, 1, 2, longer, 5100);
+    TEST_ASSERT_FALSE(val_cache_lookup(3, 1, 2, 1000, 5100, value, &len, NULL));
+
+    // Ровно SP_VAL_CACHE_VALUE_SIZE помещается целиком
+    longer[SP_VAL_CACHE_VALUE_SIZE] = '\0';
+    store_text(3, 1, 3, longer, 5200);
+    TEST_ASSERT_TRUE(val_cache_lookup(3, 1, 3, 1000, 5200, value, &len, NULL));
+    TEST_ASSERT_EQUAL_UINT32(SP_VAL_CACHE_VALUE_SIZE, len);
+}
+
+static void test_parse_number(void)
+{
+    uint16_t n;
+    TEST_ASSERT_TRUE(val_cache_parse_number((const uint8_t *)"65535", 5, &n));
+    TEST_ASSERT_EQUAL_UINT16(65535, n);
+    TEST_ASSERT_FALSE(val_cache_parse_number((const uint8_t *)"65536", 5, &n));
+    TEST_ASSERT_FALSE(val_cache_parse_number((const uint8_t *)"1a", 2, &n));
+    TEST_ASSERT_FALSE(val_cache_parse_number((const uint8_t *)"", 0, &n));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_lookup_within_ttl);
+    RUN_TEST(test_oldest_evicted);
+    RUN_TEST(test_oversized_value_not_cached);
+    RUN_TEST(test_parse_number);
+    return UNITY_END();
+}